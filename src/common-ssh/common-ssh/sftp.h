@@ -20,7 +20,7 @@
 #ifndef GUAC_COMMON_SSH_SFTP_H
 #define GUAC_COMMON_SSH_SFTP_H
 
-#include "common/json.h"
+#include "common/listing.h"
 #include "ssh.h"
 
 #include <guacamole/object.h>
@@ -38,6 +38,14 @@
  */
 #define GUAC_COMMON_SSH_SFTP_MAX_DEPTH 1024
 
+/**
+ * The number of bytes of uploaded data to collect before writing to the SFTP
+ * server. Given a large buffer, libssh2 splits each write into many SFTP
+ * write requests which are all in flight at once, rather than waiting a full
+ * round trip for each blob received.
+ */
+#define GUAC_COMMON_SSH_SFTP_WRITE_BUFFER_SIZE 262144
+
 /**
  * Representation of an SFTP-driven filesystem object. Unlike guac_object, this
  * structure is not tied to any particular user.
@@ -80,6 +88,12 @@ typedef struct guac_common_ssh_sftp_filesystem {
      */
     int disable_upload;
 
+    /**
+     * Recently-read directory listings, keyed by the absolute path of each
+     * directory on the SFTP server.
+     */
+    guac_common_listing_cache* listing_cache;
+
 } guac_common_ssh_sftp_filesystem;
 
 /**
@@ -99,17 +113,47 @@ typedef struct guac_common_ssh_sftp_ls_state {
     LIBSSH2_SFTP_HANDLE* directory;
 
     /**
-     * The absolute path of the directory being listed.
+     * The path of the directory being listed, relative to the root of the
+     * filesystem object, which is used as the basis of each path within the
+     * listing.
      */
     char directory_name[GUAC_COMMON_SSH_SFTP_MAX_PATH];
 
     /**
-     * The current state of the JSON directory object being written.
+     * The absolute path of the directory being listed on the SFTP server.
      */
-    guac_common_json_state json_state;
+    char directory_path[GUAC_COMMON_SSH_SFTP_MAX_PATH];
 
 } guac_common_ssh_sftp_ls_state;
 
+/**
+ * The current state of a file being uploaded via SFTP.
+ */
+typedef struct guac_common_ssh_sftp_upload_state {
+
+    /**
+     * The file being written, opened via libssh2_sftp_open().
+     */
+    LIBSSH2_SFTP_HANDLE* file;
+
+    /**
+     * Data received but not yet written to the file.
+     */
+    char buffer[GUAC_COMMON_SSH_SFTP_WRITE_BUFFER_SIZE];
+
+    /**
+     * The number of bytes of data within buffer.
+     */
+    int length;
+
+    /**
+     * Non-zero if a write to the file has failed, in which case all further
+     * data is rejected.
+     */
+    int failed;
+
+} guac_common_ssh_sftp_upload_state;
+
 /**
  * Creates a new Guacamole filesystem object which provides access to files
  * and directories via SFTP using the given SSH session. When the filesystem
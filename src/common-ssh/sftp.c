@@ -17,6 +17,8 @@
  * under the License.
  */
 
+#include "common/download.h"
+#include "common/listing.h"
 #include "common-ssh/sftp.h"
 #include "common-ssh/ssh.h"
 
@@ -25,6 +27,7 @@
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
 #include <guacamole/string.h>
+#include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 #include <libssh2.h>
 
@@ -283,11 +286,46 @@ static int guac_ssh_append_path(char* fullpath, const char* path_a,
 
 }
 
+/**
+ * Writes all data buffered within the given upload state to its file. As the
+ * buffer is large, libssh2 keeps many SFTP write requests in flight at once,
+ * returning as each is acknowledged.
+ *
+ * @param upload
+ *     The upload state whose buffered data should be written.
+ *
+ * @return
+ *     Zero if all buffered data was written successfully, non-zero otherwise.
+ */
+static int guac_common_ssh_sftp_flush_upload(
+        guac_common_ssh_sftp_upload_state* upload) {
+
+    int written = 0;
+    while (written < upload->length) {
+
+        ssize_t result = libssh2_sftp_write(upload->file,
+                upload->buffer + written, upload->length - written);
+
+        if (result < 0) {
+            upload->failed = 1;
+            return 1;
+        }
+
+        written += result;
+
+    }
+
+    upload->length = 0;
+    return 0;
+
+}
+
 /**
  * Handler for blob messages which continue an inbound SFTP data transfer
  * (upload). The data associated with the given stream is expected to be a
- * pointer to an open LIBSSH2_SFTP_HANDLE for the file to which the data
- * should be written.
+ * pointer to a guac_common_ssh_sftp_upload_state. Received data is buffered
+ * and acknowledged immediately, and is only written once the buffer is full,
+ * such that the user can continue sending while data is written.
  *
  * @param user
  *     The user receiving the blob message.
@@ -307,12 +345,19 @@ static int guac_ssh_append_path(char* fullpath, const char* path_a,
 static int guac_common_ssh_sftp_blob_handler(guac_user* user,
         guac_stream* stream, void* data, int length) {
 
-    /* Pull file from stream */
-    LIBSSH2_SFTP_HANDLE* file = (LIBSSH2_SFTP_HANDLE*) stream->data;
+    /* Pull upload state from stream */
+    guac_common_ssh_sftp_upload_state* upload =
+        (guac_common_ssh_sftp_upload_state*) stream->data;
 
-    /* Attempt write */
-    if (libssh2_sftp_write(file, data, length) == length) {
-        guac_user_log(user, GUAC_LOG_DEBUG, "%i bytes written", length);
+    /* Write buffered data once the buffer cannot contain the new data */
+    if (!upload->failed
+            && upload->length + length > (int) sizeof(upload->buffer))
+        guac_common_ssh_sftp_flush_upload(upload);
+
+    /* Buffer received data, acknowledging it immediately */
+    if (!upload->failed && length <= (int) sizeof(upload->buffer)) {
+        memcpy(upload->buffer + upload->length, data, length);
+        upload->length += length;
         guac_protocol_send_ack(user->socket, stream, "SFTP: OK",
                 GUAC_PROTOCOL_STATUS_SUCCESS);
         guac_socket_flush(user->socket);
@@ -333,8 +378,8 @@ static int guac_common_ssh_sftp_blob_handler(guac_user* user,
 /**
  * Handler for end messages which terminate an inbound SFTP data transfer
  * (upload). The data associated with the given stream is expected to be a
- * pointer to an open LIBSSH2_SFTP_HANDLE for the file to which the data
- * has been written and which should now be closed.
+ * pointer to a guac_common_ssh_sftp_upload_state whose remaining data should
+ * be written and whose file should now be closed.
  *
  * @param user
  *     The user receiving the end message.
@@ -348,27 +393,69 @@ static int guac_common_ssh_sftp_blob_handler(guac_user* user,
 static int guac_common_ssh_sftp_end_handler(guac_user* user,
         guac_stream* stream) {
 
-    /* Pull file from stream */
-    LIBSSH2_SFTP_HANDLE* file = (LIBSSH2_SFTP_HANDLE*) stream->data;
+    /* Pull upload state from stream */
+    guac_common_ssh_sftp_upload_state* upload =
+        (guac_common_ssh_sftp_upload_state*) stream->data;
+
+    /* Write any remaining data */
+    if (!upload->failed && guac_common_ssh_sftp_flush_upload(upload))
+        guac_user_log(user, GUAC_LOG_INFO, "Unable to write to file");
 
     /* Attempt to close file */
-    if (libssh2_sftp_close(file) == 0) {
+    int closed = (libssh2_sftp_close(upload->file) == 0);
+
+    if (closed && !upload->failed) {
         guac_user_log(user, GUAC_LOG_DEBUG, "File closed");
         guac_protocol_send_ack(user->socket, stream, "SFTP: OK",
                 GUAC_PROTOCOL_STATUS_SUCCESS);
         guac_socket_flush(user->socket);
     }
-    else {
+    else if (!closed) {
         guac_user_log(user, GUAC_LOG_INFO, "Unable to close file");
         guac_protocol_send_ack(user->socket, stream, "SFTP: Close failed",
                 GUAC_PROTOCOL_STATUS_SERVER_ERROR);
         guac_socket_flush(user->socket);
     }
+    else {
+        guac_protocol_send_ack(user->socket, stream, "SFTP: Write failed",
+                GUAC_PROTOCOL_STATUS_SERVER_ERROR);
+        guac_socket_flush(user->socket);
+    }
 
+    free(upload);
     return 0;
 
 }
 
+/**
+ * Associates the given stream with a new upload of data to the given file,
+ * setting the stream handlers which receive the uploaded data.
+ *
+ * @param stream
+ *     The stream over which data will be received.
+ *
+ * @param file
+ *     The open file to which data should be written.
+ */
+static void guac_common_ssh_sftp_begin_upload(guac_stream* stream,
+        LIBSSH2_SFTP_HANDLE* file) {
+
+    guac_common_ssh_sftp_upload_state* upload =
+        malloc(sizeof(guac_common_ssh_sftp_upload_state));
+
+    upload->file = file;
+    upload->length = 0;
+    upload->failed = 0;
+
+    /* Set handlers for file stream */
+    stream->blob_handler = guac_common_ssh_sftp_blob_handler;
+    stream->end_handler = guac_common_ssh_sftp_end_handler;
+
+    /* Store upload state within stream */
+    stream->data = upload;
+
+}
+
 int guac_common_ssh_sftp_handle_file_stream(
         guac_common_ssh_sftp_filesystem* filesystem, guac_user* user,
         guac_stream* stream, char* mimetype, char* filename) {
@@ -417,9 +504,17 @@ int guac_common_ssh_sftp_handle_file_stream(
                 "File \"%s\" opened",
                 fullpath);
 
+        /* Listing of containing directory may now differ */
+        guac_common_listing_cache_invalidate(filesystem->listing_cache,
+                fullpath);
+
         guac_protocol_send_ack(user->socket, stream, "SFTP: File opened",
                 GUAC_PROTOCOL_STATUS_SUCCESS);
         guac_socket_flush(user->socket);
+
+        /* Receive file data via stream */
+        guac_common_ssh_sftp_begin_upload(stream, file);
+
     }
     else {
         guac_user_log(user, GUAC_LOG_INFO,
@@ -429,96 +524,96 @@ int guac_common_ssh_sftp_handle_file_stream(
         guac_socket_flush(user->socket);
     }
 
-    /* Set handlers for file stream */
-    stream->blob_handler = guac_common_ssh_sftp_blob_handler;
-    stream->end_handler = guac_common_ssh_sftp_end_handler;
-
-    /* Store file within stream */
-    stream->data = file;
     return 0;
 
 }
 
 /**
- * Handler for ack messages which continue an outbound SFTP data transfer
- * (download), signaling the current status and requesting additional data.
- * The data associated with the given stream is expected to be a pointer to an
- * open LIBSSH2_SFTP_HANDLE for the file from which the data is to be read.
+ * Read handler for downloads of files via SFTP, reading the next chunk of the
+ * file. The data associated with the download is expected to be a pointer to
+ * an open LIBSSH2_SFTP_HANDLE for the file from which the data is to be read.
+ * As reads are large, libssh2 pipelines the underlying SFTP read requests.
  *
  * @param user
- *     The user receiving the ack message.
+ *     The user receiving the download.
  *
- * @param stream
- *     The Guacamole protocol stream associated with the received ack message.
+ * @param data
+ *     The LIBSSH2_SFTP_HANDLE of the file being downloaded.
  *
- * @param message
- *     An arbitrary human-readable message describing the nature of the
- *     success or failure denoted by the ack message.
+ * @param buffer
+ *     The buffer into which data should be read.
  *
- * @param status
- *     The status code associated with the ack message, which may indicate
- *     success or an error.
+ * @param length
+ *     The maximum number of bytes to read.
  *
  * @return
- *     Zero if the file is read from successfully, or non-zero on error.
+ *     The number of bytes read, zero on EOF, or a negative value on error.
  */
-static int guac_common_ssh_sftp_ack_handler(guac_user* user,
-        guac_stream* stream, char* message, guac_protocol_status status) {
-
-    /* Pull file from stream */
-    LIBSSH2_SFTP_HANDLE* file = (LIBSSH2_SFTP_HANDLE*) stream->data;
-
-    /* If successful, read data */
-    if (status == GUAC_PROTOCOL_STATUS_SUCCESS) {
+static int guac_common_ssh_sftp_download_read_handler(guac_user* user,
+        void* data, char* buffer, int length) {
 
-        /* Attempt read into buffer */
-        char buffer[4096];
-        int bytes_read = libssh2_sftp_read(file, buffer, sizeof(buffer)); 
+    LIBSSH2_SFTP_HANDLE* file = (LIBSSH2_SFTP_HANDLE*) data;
+    return libssh2_sftp_read(file, buffer, length);
 
-        /* If bytes read, send as blob */
-        if (bytes_read > 0) {
-            guac_protocol_send_blob(user->socket, stream,
-                    buffer, bytes_read);
-
-            guac_user_log(user, GUAC_LOG_DEBUG, "%i bytes sent to user",
-                    bytes_read);
-
-        }
-
-        /* If bytes could not be read, handle EOF or error condition */
-        else {
-
-            /* If EOF, send end */
-            if (bytes_read == 0) {
-                guac_user_log(user, GUAC_LOG_DEBUG, "File sent");
-                guac_protocol_send_end(user->socket, stream);
-                guac_user_free_stream(user, stream);
-            }
+}
 
-            /* Otherwise, fail stream */
-            else {
-                guac_user_log(user, GUAC_LOG_INFO, "Error reading file");
-                guac_protocol_send_end(user->socket, stream);
-                guac_user_free_stream(user, stream);
-            }
+/**
+ * End handler for downloads of files via SFTP, closing the file. The data
+ * associated with the download is expected to be a pointer to an open
+ * LIBSSH2_SFTP_HANDLE for the file which was being downloaded.
+ *
+ * @param user
+ *     The user which was receiving the download.
+ *
+ * @param data
+ *     The LIBSSH2_SFTP_HANDLE of the file which was being downloaded.
+ *
+ * @param success
+ *     Non-zero if the entire file was sent, zero otherwise.
+ */
+static void guac_common_ssh_sftp_download_end_handler(guac_user* user,
+        void* data, int success) {
 
-            /* Close file */
-            if (libssh2_sftp_close(file) == 0)
-                guac_user_log(user, GUAC_LOG_DEBUG, "File closed");
-            else
-                guac_user_log(user, GUAC_LOG_INFO, "Unable to close file");
+    LIBSSH2_SFTP_HANDLE* file = (LIBSSH2_SFTP_HANDLE*) data;
 
-        }
+    if (libssh2_sftp_close(file) == 0)
+        guac_user_log(user, GUAC_LOG_DEBUG, "File closed");
+    else
+        guac_user_log(user, GUAC_LOG_INFO, "Unable to close file");
 
-        guac_socket_flush(user->socket);
+}
 
-    }
+/**
+ * Prepares the given stream to send the contents of the given file once the
+ * stream has been announced to the user, closing the file when done. If the
+ * download cannot be prepared, the file is closed and the stream freed.
+ *
+ * @param user
+ *     The user that will receive the file.
+ *
+ * @param stream
+ *     The stream over which the file should be sent.
+ *
+ * @param file
+ *     The open file to send.
+ *
+ * @return
+ *     Zero on success, non-zero if the download could not be prepared.
+ */
+static int guac_common_ssh_sftp_begin_download(guac_user* user,
+        guac_stream* stream, LIBSSH2_SFTP_HANDLE* file) {
 
-    /* Otherwise, return stream to user */
-    else
+    if (guac_common_download_begin(user, stream,
+                GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW,
+                guac_common_ssh_sftp_download_read_handler,
+                guac_common_ssh_sftp_download_end_handler, file)) {
         guac_user_free_stream(user, stream);
+        libssh2_sftp_close(file);
+        return 1;
+    }
 
     return 0;
+
 }
 
 guac_stream* guac_common_ssh_sftp_download_file(
@@ -548,8 +643,8 @@ guac_stream* guac_common_ssh_sftp_download_file(
 
     /* Allocate stream */
     stream = guac_user_alloc_stream(user);
-    stream->ack_handler = guac_common_ssh_sftp_ack_handler;
-    stream->data = file;
+    if (guac_common_ssh_sftp_begin_download(user, stream, file))
+        return NULL;
 
     /* Send stream start, strip name */
     filename = basename(filename);
@@ -583,107 +678,96 @@ void guac_common_ssh_sftp_set_upload_path(
 }
 
 /**
- * Handler for ack messages received due to receipt of a "body" or "blob"
- * instruction associated with a SFTP directory list operation.
+ * Listing entry handler which reads the next entry of the directory being
+ * listed, adding that entry to the listing unless it is the current or
+ * parent directory. Symbolic links are followed to determine whether they
+ * point to directories.
  *
  * @param user
- *     The user receiving the ack message.
- *
- * @param stream
- *     The Guacamole protocol stream associated with the received ack message.
+ *     The user requesting the directory listing.
  *
- * @param message
- *     An arbitrary human-readable message describing the nature of the
- *     success or failure denoted by this ack message.
+ * @param data
+ *     The guac_common_ssh_sftp_ls_state of the directory being listed.
  *
- * @param status
- *     The status code associated with this ack message, which may indicate
- *     success or an error.
+ * @param listing
+ *     The directory listing being read.
  *
  * @return
- *     Zero on success, non-zero on error.
+ *     Non-zero if an entry was read, zero if no entries remain.
  */
-static int guac_common_ssh_sftp_ls_ack_handler(guac_user* user,
-        guac_stream* stream, char* message, guac_protocol_status status) {
+static int guac_common_ssh_sftp_ls_entry_handler(guac_user* user, void* data,
+        guac_common_listing* listing) {
 
-    int bytes_read;
+    guac_common_ssh_sftp_ls_state* list_state =
+        (guac_common_ssh_sftp_ls_state*) data;
 
     char filename[GUAC_COMMON_SSH_SFTP_MAX_PATH];
+    char absolute_path[GUAC_COMMON_SSH_SFTP_MAX_PATH];
     LIBSSH2_SFTP_ATTRIBUTES attributes;
 
-    guac_common_ssh_sftp_ls_state* list_state =
-        (guac_common_ssh_sftp_ls_state*) stream->data;
+    LIBSSH2_SFTP* sftp = list_state->filesystem->sftp_session;
 
-    guac_common_ssh_sftp_filesystem* filesystem = list_state->filesystem;
-
-    LIBSSH2_SFTP* sftp = filesystem->sftp_session;
-
-    /* If unsuccessful, free stream and abort */
-    if (status != GUAC_PROTOCOL_STATUS_SUCCESS) {
-        libssh2_sftp_closedir(list_state->directory);
-        guac_user_free_stream(user, stream);
-        free(list_state);
+    /* Stop once no directory entries remain */
+    if (libssh2_sftp_readdir(list_state->directory, filename,
+                sizeof(filename), &attributes) <= 0)
         return 0;
-    }
-
-    /* While directory entries remain */
-    while ((bytes_read = libssh2_sftp_readdir(list_state->directory,
-                filename, sizeof(filename), &attributes)) > 0) {
-
-        char absolute_path[GUAC_COMMON_SSH_SFTP_MAX_PATH];
 
-        /* Skip current and parent directory entries */
-        if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
-            continue;
+    /* Skip current and parent directory entries */
+    if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
+        return 1;
 
-        /* Concatenate into absolute path - skip if invalid */
-        if (!guac_ssh_append_filename(absolute_path, 
-                    list_state->directory_name, filename)) {
+    /* Concatenate into absolute path - skip if invalid */
+    if (!guac_ssh_append_filename(absolute_path,
+                list_state->directory_name, filename)) {
 
-            guac_user_log(user, GUAC_LOG_DEBUG,
-                    "Skipping filename \"%s\" - filename is invalid or "
-                    "resulting path is too long", filename);
-
-            continue;
-        }
+        guac_user_log(user, GUAC_LOG_DEBUG,
+                "Skipping filename \"%s\" - filename is invalid or "
+                "resulting path is too long", filename);
 
-        /* Stat explicitly if symbolic link (might point to directory) */
-        if (LIBSSH2_SFTP_S_ISLNK(attributes.permissions))
-            libssh2_sftp_stat(sftp, absolute_path, &attributes);
+        return 1;
+    }
 
-        /* Determine mimetype */
-        const char* mimetype;
-        if (LIBSSH2_SFTP_S_ISDIR(attributes.permissions))
-            mimetype = GUAC_USER_STREAM_INDEX_MIMETYPE;
-        else
-            mimetype = "application/octet-stream";
+    /* Stat explicitly if symbolic link (might point to directory) */
+    if (LIBSSH2_SFTP_S_ISLNK(attributes.permissions)) {
 
-        /* Write entry, waiting for next ack if a blob is written */
-        if (guac_common_json_write_property(user, stream,
-                    &list_state->json_state, absolute_path, mimetype))
-            break;
+        char link_path[GUAC_COMMON_SSH_SFTP_MAX_PATH];
+        if (guac_ssh_append_filename(link_path, list_state->directory_path,
+                    filename))
+            libssh2_sftp_stat(sftp, link_path, &attributes);
 
     }
 
-    /* Complete JSON and cleanup at end of directory */
-    if (bytes_read <= 0) {
+    /* Determine mimetype */
+    const char* mimetype;
+    if (LIBSSH2_SFTP_S_ISDIR(attributes.permissions))
+        mimetype = GUAC_USER_STREAM_INDEX_MIMETYPE;
+    else
+        mimetype = "application/octet-stream";
 
-        /* Complete JSON object */
-        guac_common_json_end_object(user, stream, &list_state->json_state);
-        guac_common_json_flush(user, stream, &list_state->json_state);
+    guac_common_listing_add(listing, absolute_path, mimetype);
+    return 1;
 
-        /* Clean up resources */
-        libssh2_sftp_closedir(list_state->directory);
-        free(list_state);
+}
 
-        /* Signal of stream */
-        guac_protocol_send_end(user->socket, stream);
-        guac_user_free_stream(user, stream);
+/**
+ * Listing free handler which closes the directory that was being listed and
+ * frees its guac_common_ssh_sftp_ls_state.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param data
+ *     The guac_common_ssh_sftp_ls_state of the directory that was being
+ *     listed.
+ */
+static void guac_common_ssh_sftp_ls_free_handler(guac_user* user,
+        void* data) {
 
-    }
+    guac_common_ssh_sftp_ls_state* list_state =
+        (guac_common_ssh_sftp_ls_state*) data;
 
-    guac_socket_flush(user->socket);
-    return 0;
+    libssh2_sftp_closedir(list_state->directory);
+    free(list_state);
 
 }
 
@@ -764,39 +848,59 @@ static int guac_common_ssh_sftp_get_handler(guac_user* user,
     /* If directory, send contents of directory */
     if (LIBSSH2_SFTP_S_ISDIR(attributes.permissions)) {
 
-        /* Open as directory */
-        LIBSSH2_SFTP_HANDLE* dir = libssh2_sftp_opendir(sftp, fullpath);
-        if (dir == NULL) {
-            guac_user_log(user, GUAC_LOG_INFO,
-                    "Unable to read directory \"%s\"", fullpath);
-            return 0;
-        }
+        guac_common_listing_cache* cache = filesystem->listing_cache;
 
-        /* Init directory listing state */
-        guac_common_ssh_sftp_ls_state* list_state =
-            malloc(sizeof(guac_common_ssh_sftp_ls_state));
+        /* Read directory only if not recently read */
+        guac_common_listing* listing = guac_common_listing_cache_get(cache,
+                fullpath, guac_timestamp_current());
 
-        list_state->directory = dir;
-        list_state->filesystem = filesystem;
+        guac_common_ssh_sftp_ls_state* list_state = NULL;
+        if (listing == NULL) {
 
-        int length = guac_strlcpy(list_state->directory_name, name,
-                sizeof(list_state->directory_name));
+            /* Init directory listing state */
+            list_state = malloc(sizeof(guac_common_ssh_sftp_ls_state));
+            list_state->filesystem = filesystem;
+
+            int name_length = guac_strlcpy(list_state->directory_name, name,
+                    sizeof(list_state->directory_name));
+
+            int path_length = guac_strlcpy(list_state->directory_path,
+                    fullpath, sizeof(list_state->directory_path));
+
+            /* Bail out if directory name is too long to store */
+            if (name_length >= sizeof(list_state->directory_name)
+                    || path_length >= sizeof(list_state->directory_path)) {
+                guac_user_log(user, GUAC_LOG_INFO, "Unable to read directory "
+                        "\"%s\": Path too long", fullpath);
+                free(list_state);
+                return 0;
+            }
+
+            /* Open as directory */
+            list_state->directory = libssh2_sftp_opendir(sftp, fullpath);
+            if (list_state->directory == NULL) {
+                guac_user_log(user, GUAC_LOG_INFO,
+                        "Unable to read directory \"%s\"", fullpath);
+                free(list_state);
+                return 0;
+            }
 
-        /* Bail out if directory name is too long to store */
-        if (length >= sizeof(list_state->directory_name)) {
-            guac_user_log(user, GUAC_LOG_INFO, "Unable to read directory "
-                    "\"%s\": Path too long", fullpath);
-            free(list_state);
-            return 0;
         }
 
         /* Allocate stream for body */
         guac_stream* stream = guac_user_alloc_stream(user);
-        stream->ack_handler = guac_common_ssh_sftp_ls_ack_handler;
-        stream->data = list_state;
 
-        /* Init JSON object state */
-        guac_common_json_begin_object(user, stream, &list_state->json_state);
+        /* Send cached listing, if any */
+        if (listing != NULL) {
+            if (guac_common_listing_send(user, stream, listing))
+                return 0;
+        }
+
+        /* Otherwise, read the directory as its listing is sent */
+        else if (guac_common_listing_stream(user, stream, cache, fullpath,
+                    guac_common_ssh_sftp_ls_entry_handler,
+                    guac_common_ssh_sftp_ls_free_handler, list_state))
+            return 0;
 
         /* Associate new stream with get request */
         guac_protocol_send_body(user->socket, object, stream,
@@ -826,8 +930,8 @@ static int guac_common_ssh_sftp_get_handler(guac_user* user,
 
         /* Allocate stream for body */
         guac_stream* stream = guac_user_alloc_stream(user);
-        stream->ack_handler = guac_common_ssh_sftp_ack_handler;
-        stream->data = file;
+        if (guac_common_ssh_sftp_begin_download(user, stream, file))
+            return 0;
 
         /* Associate new stream with get request */
         guac_protocol_send_body(user->socket, object, stream,
@@ -902,6 +1006,14 @@ static int guac_common_ssh_sftp_put_handler(guac_user* user,
         guac_user_log(user, GUAC_LOG_DEBUG, "File \"%s\" opened", fullpath);
         guac_protocol_send_ack(user->socket, stream, "SFTP: File opened",
                 GUAC_PROTOCOL_STATUS_SUCCESS);
+
+        /* Listing of containing directory may now differ */
+        guac_common_listing_cache_invalidate(filesystem->listing_cache,
+                fullpath);
+
+        /* Receive file data via stream */
+        guac_common_ssh_sftp_begin_upload(stream, file);
+
     }
 
     /* Abort on failure */
@@ -912,13 +1024,6 @@ static int guac_common_ssh_sftp_put_handler(guac_user* user,
                 guac_sftp_get_status(filesystem));
     }
 
-    /* Set handlers for file stream */
-    stream->blob_handler = guac_common_ssh_sftp_blob_handler;
-    stream->end_handler = guac_common_ssh_sftp_end_handler;
-
-    /* Store file within stream */
-    stream->data = file;
-
     guac_socket_flush(user->socket);
     return 0;
 }
@@ -997,6 +1102,8 @@ guac_common_ssh_sftp_filesystem* guac_common_ssh_create_sftp_filesystem(
     /* Initially upload files to current directory */
     strcpy(filesystem->upload_path, ".");
 
+    filesystem->listing_cache = guac_common_listing_cache_alloc();
+
     /* Return allocated filesystem */
     return filesystem;
 
@@ -1009,6 +1116,7 @@ void guac_common_ssh_destroy_sftp_filesystem(
     libssh2_sftp_shutdown(filesystem->sftp_session);
 
     /* Free associated memory */
+    guac_common_listing_cache_free(filesystem->listing_cache);
     free(filesystem->name);
     free(filesystem);
 
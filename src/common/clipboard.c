@@ -29,14 +29,30 @@
 #include <string.h>
 #include <stdlib.h>
 
-guac_common_clipboard* guac_common_clipboard_alloc() {
+/**
+ * The largest number of bytes that guac_iconv() may write for any single
+ * character, including newline characters written as CRLF sequences.
+ */
+#define GUAC_COMMON_CLIPBOARD_MAX_CHAR_SIZE 4
+
+guac_common_clipboard* guac_common_clipboard_alloc(int max_length) {
 
     guac_common_clipboard* clipboard = malloc(sizeof(guac_common_clipboard));
 
-    /* Init clipboard */
+    if (max_length > GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE)
+        max_length = GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE;
+    else if (max_length < 1)
+        max_length = 1;
+
+    /* Init clipboard, deferring allocation of most of the buffer until
+     * large amounts of data are actually received */
+    clipboard->max_length = max_length;
+    clipboard->available = GUAC_COMMON_CLIPBOARD_BLOCK_SIZE;
+    if (clipboard->available > max_length)
+        clipboard->available = max_length;
+
     clipboard->mimetype[0] = '\0';
-    clipboard->buffer = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
-    clipboard->available = GUAC_COMMON_CLIPBOARD_MAX_LENGTH;
+    clipboard->buffer = malloc(clipboard->available);
     clipboard->length = 0;
 
     pthread_mutex_init(&(clipboard->lock), NULL);
@@ -145,14 +161,50 @@ void guac_common_clipboard_reset(guac_common_clipboard* clipboard,
 
 }
 
-void guac_common_clipboard_append(guac_common_clipboard* clipboard, const char* data, int length) {
+/**
+ * Doubles the size of the buffer of the given clipboard, up to the maximum
+ * length of the clipboard. The clipboard must already be locked.
+ *
+ * @param clipboard
+ *     The clipboard whose buffer should be grown.
+ *
+ * @return
+ *     Zero if the buffer was grown, non-zero if the buffer is already as
+ *     large as allowed or could not be grown.
+ */
+static int guac_common_clipboard_grow(guac_common_clipboard* clipboard) {
+
+    if (clipboard->available >= clipboard->max_length)
+        return 1;
+
+    int available = clipboard->available * 2;
+    if (available > clipboard->max_length)
+        available = clipboard->max_length;
+
+    char* buffer = realloc(clipboard->buffer, available);
+    if (buffer == NULL)
+        return 1;
+
+    clipboard->buffer = buffer;
+    clipboard->available = available;
+    return 0;
+
+}
+
+int guac_common_clipboard_append(guac_common_clipboard* clipboard, const char* data, int length) {
+
+    int truncated = 0;
 
     pthread_mutex_lock(&(clipboard->lock));
 
-    /* Truncate data to available length */
-    int remaining = clipboard->available - clipboard->length;
-    if (remaining < length)
-        length = remaining;
+    /* Grow buffer as necessary, truncating data to maximum length */
+    while (clipboard->available - clipboard->length < length) {
+        if (guac_common_clipboard_grow(clipboard)) {
+            length = clipboard->available - clipboard->length;
+            truncated = 1;
+            break;
+        }
+    }
 
     /* Append to buffer */
     memcpy(clipboard->buffer + clipboard->length, data, length);
@@ -162,5 +214,108 @@ void guac_common_clipboard_append(guac_common_clipboard* clipboard, const char*
 
     pthread_mutex_unlock(&(clipboard->lock));
 
+    return truncated;
+
+}
+
+int guac_common_clipboard_append_text(guac_common_clipboard* clipboard,
+        guac_iconv_read* reader, const char* data, int length) {
+
+    int truncated = 0;
+
+    pthread_mutex_lock(&(clipboard->lock));
+
+    /* Convert directly into the clipboard buffer, growing the buffer each
+     * time it fills */
+    for (;;) {
+
+        const char* input_start = data;
+        char* output = clipboard->buffer + clipboard->length;
+
+        int complete = guac_iconv(reader, &data, length,
+                GUAC_WRITE_UTF8, &output,
+                clipboard->available - clipboard->length);
+
+        length -= data - input_start;
+        clipboard->length = output - clipboard->buffer;
+
+        /* Do not store the null terminator */
+        if (complete) {
+            clipboard->length--;
+            break;
+        }
+
+        /* Stop once all text has been read. As conversion stops early only
+         * if the next character does not fit, any text remaining despite
+         * ample space is an incomplete trailing character. */
+        if (length <= 0 || clipboard->available - clipboard->length
+                >= GUAC_COMMON_CLIPBOARD_MAX_CHAR_SIZE)
+            break;
+
+        if (guac_common_clipboard_grow(clipboard)) {
+            truncated = 1;
+            break;
+        }
+
+    }
+
+    pthread_mutex_unlock(&(clipboard->lock));
+
+    return truncated;
+
 }
 
+char* guac_common_clipboard_convert(guac_common_clipboard* clipboard,
+        guac_iconv_read* reader, guac_iconv_write* writer, int* length) {
+
+    pthread_mutex_lock(&(clipboard->lock));
+
+    const char* input = clipboard->buffer;
+    int remaining = clipboard->length;
+
+    /* Most conversions need no more than twice the space of the original */
+    int size = clipboard->length * 2 + 4;
+    int used = 0;
+    char* buffer = malloc(size);
+
+    while (buffer != NULL) {
+
+        const char* input_start = input;
+        char* output = buffer + used;
+
+        int complete = guac_iconv(reader, &input, remaining,
+                writer, &output, size - used);
+
+        remaining -= input - input_start;
+        used = output - buffer;
+
+        if (complete)
+            break;
+
+        /* Terminate converted text once all input has been read, ignoring
+         * any incomplete trailing character */
+        if (remaining <= 0
+                || size - used >= GUAC_COMMON_CLIPBOARD_MAX_CHAR_SIZE) {
+            writer(&output, size - used, 0);
+            if (output != buffer + used) {
+                used = output - buffer;
+                break;
+            }
+        }
+
+        /* Grow output buffer to fit remaining text */
+        size *= 2;
+        char* grown = realloc(buffer, size);
+        if (grown == NULL)
+            free(buffer);
+
+        buffer = grown;
+
+    }
+
+    pthread_mutex_unlock(&(clipboard->lock));
+
+    *length = used;
+    return buffer;
+
+}
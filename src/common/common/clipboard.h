@@ -21,6 +21,7 @@
 #define __GUAC_CLIPBOARD_H
 
 #include "config.h"
+#include "common/iconv.h"
 
 #include <guacamole/client.h>
 #include <pthread.h>
@@ -32,10 +33,16 @@
 #define GUAC_COMMON_CLIPBOARD_BLOCK_SIZE 4096
 
 /**
- * The maximum number of bytes to allow within the clipboard.
+ * The default maximum number of bytes to allow within the clipboard.
  */
 #define GUAC_COMMON_CLIPBOARD_MAX_LENGTH 262144
 
+/**
+ * The largest permitted maximum number of bytes to allow within the
+ * clipboard.
+ */
+#define GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE 52428800
+
 /**
  * Generic clipboard structure.
  */
@@ -64,16 +71,31 @@ typedef struct guac_common_clipboard {
     int length;
 
     /**
-     * The total number of bytes available in the clipboard buffer.
+     * The total number of bytes available in the clipboard buffer. The buffer
+     * is grown as data is appended, up to max_length bytes.
      */
     int available;
 
+    /**
+     * The maximum number of bytes to allow within the clipboard. Data
+     * appended beyond this length is truncated.
+     */
+    int max_length;
+
 } guac_common_clipboard;
 
 /**
  * Creates a new clipboard.
+ *
+ * @param max_length
+ *     The maximum number of bytes to allow within the clipboard, typically
+ *     GUAC_COMMON_CLIPBOARD_MAX_LENGTH. This is limited to
+ *     GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE.
+ *
+ * @return
+ *     A newly-allocated, empty clipboard.
  */
-guac_common_clipboard* guac_common_clipboard_alloc();
+guac_common_clipboard* guac_common_clipboard_alloc(int max_length);
 
 /**
  * Frees the given clipboard.
@@ -107,8 +129,65 @@ void guac_common_clipboard_reset(guac_common_clipboard* clipboard, const char* m
  * @param clipboard The clipboard to append data to.
  * @param data The data to append.
  * @param length The number of bytes to append from the data given.
+ * @return Zero if all data was appended, non-zero if the data was truncated
+ *         because the clipboard is full.
+ */
+int guac_common_clipboard_append(guac_common_clipboard* clipboard, const char* data, int length);
+
+/**
+ * Appends the given text to the current clipboard contents, converting it to
+ * UTF-8 as it is appended. Conversion stops at the end of the given data or
+ * at the first null terminator, which is not appended. The clipboard buffer
+ * is grown as conversion proceeds, such that no intermediate copy of the
+ * converted text is needed. The mimetype chosen for the clipboard data by
+ * guac_common_clipboard_reset() should be a text mimetype, such as
+ * "text/plain".
+ *
+ * @param clipboard
+ *     The clipboard to append text to.
+ *
+ * @param reader
+ *     The guac_iconv_read implementation to use to read the given text.
+ *
+ * @param data
+ *     The text to append.
+ *
+ * @param length
+ *     The number of bytes of text to read from the data given.
+ *
+ * @return
+ *     Zero if all text was appended, non-zero if the text was truncated
+ *     because the clipboard is full.
+ */
+int guac_common_clipboard_append_text(guac_common_clipboard* clipboard,
+        guac_iconv_read* reader, const char* data, int length);
+
+/**
+ * Converts the current clipboard contents, which must be text, to another
+ * encoding, returning a newly-allocated buffer containing the converted text.
+ * The converted text is always null-terminated. The clipboard cannot be
+ * modified while the conversion is in progress.
+ *
+ * @param clipboard
+ *     The clipboard whose contents should be converted.
+ *
+ * @param reader
+ *     The guac_iconv_read implementation to use to read the clipboard
+ *     contents, typically GUAC_READ_UTF8 or a variant of GUAC_READ_UTF8.
+ *
+ * @param writer
+ *     The guac_iconv_write implementation to use to write the converted text.
+ *
+ * @param length
+ *     Pointer to an int which will receive the number of bytes of converted
+ *     text, including the null terminator.
+ *
+ * @return
+ *     A newly-allocated buffer containing the converted text, which must be
+ *     freed with free(), or NULL if memory could not be allocated.
  */
-void guac_common_clipboard_append(guac_common_clipboard* clipboard, const char* data, int length);
+char* guac_common_clipboard_convert(guac_common_clipboard* clipboard,
+        guac_iconv_read* reader, guac_iconv_write* writer, int* length);
 
 #endif
 
@@ -106,6 +106,13 @@ typedef struct guac_common_display {
      */
     int lossless;
 
+    /**
+     * Non-zero if rapidly-updating regions of the visible layers of this
+     * display may be streamed as video, 0 otherwise. By default, video is not
+     * used.
+     */
+    int video;
+
     /**
      * Mutex which is locked internally when access to the display must be
      * synchronized. All public functions of guac_common_display should be
@@ -257,5 +264,24 @@ void guac_common_display_free_buffer(guac_common_display* display,
 void guac_common_display_set_lossless(guac_common_display* display,
         int lossless);
 
+/**
+ * Sets whether rapidly-updating regions of the visible layers of the given
+ * display may be streamed as video, affecting all current and future layers
+ * maintained by the display. Video is only actually streamed if
+ * libguac_common was built with video support and all connected users
+ * support the video format used. Buffers are never streamed as video.
+ *
+ * Note that this can also be adjusted on a per-layer basis with
+ * guac_common_surface_set_video().
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param video
+ *     Non-zero if rapidly-updating regions may be streamed as video, 0
+ *     otherwise.
+ */
+void guac_common_display_set_video(guac_common_display* display, int video);
+
 #endif
 
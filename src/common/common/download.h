@@ -0,0 +1,250 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_DOWNLOAD_H
+#define GUAC_COMMON_DOWNLOAD_H
+
+#include "config.h"
+
+#include <guacamole/protocol.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+/**
+ * The number of blobs which may be awaiting acknowledgement when a download
+ * begins. The window grows from here for as long as the round trip time of
+ * each blob does not increase.
+ */
+#define GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW 4
+
+/**
+ * The default maximum number of blobs which may be awaiting acknowledgement
+ * at any one time. At the maximum blob size, this allows roughly 1.5 MB to be
+ * in flight.
+ */
+#define GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW 256
+
+/**
+ * The absolute maximum number of blobs which may be awaiting acknowledgement
+ * at any one time, regardless of the maximum requested.
+ */
+#define GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT 1024
+
+/**
+ * The amount by which the round trip time of a blob may exceed the lowest
+ * round trip time observed before the connection is considered congested, in
+ * milliseconds. This is in addition to the lowest round trip time itself,
+ * such that congestion is detected once queueing roughly doubles the
+ * round trip time.
+ */
+#define GUAC_COMMON_DOWNLOAD_RTT_SLACK 10
+
+/**
+ * The number of bytes read from the source of a download at once. Reads of
+ * this size are split into as many blobs as necessary.
+ */
+#define GUAC_COMMON_DOWNLOAD_READ_SIZE 65536
+
+/**
+ * Flow control state for a download, tracking the blobs sent but not yet
+ * acknowledged. Each acknowledgement measures the round trip time of the
+ * oldest outstanding blob. The window grows while round trip times stay near
+ * the lowest observed, and is halved (at most once per round trip) when they
+ * do not, such that the window tracks the bandwidth-delay product of the
+ * connection without filling intermediate buffers.
+ */
+typedef struct guac_common_download_window {
+
+    /**
+     * The number of blobs which may currently be awaiting acknowledgement.
+     */
+    int size;
+
+    /**
+     * The maximum value of size.
+     */
+    int max_size;
+
+    /**
+     * The number of blobs currently awaiting acknowledgement.
+     */
+    int in_flight;
+
+    /**
+     * The time each blob awaiting acknowledgement was sent, as a ring buffer
+     * beginning at the oldest blob.
+     */
+    guac_timestamp sent[GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT];
+
+    /**
+     * The index within sent of the oldest blob awaiting acknowledgement.
+     */
+    int oldest;
+
+    /**
+     * The lowest round trip time observed, in milliseconds, or -1 if no round
+     * trip time has yet been measured.
+     */
+    int min_rtt;
+
+    /**
+     * The time that the window was last reduced, or -1 if the window has
+     * never been reduced. Blobs sent before this time were sent with the
+     * previous window, and so cannot cause further reduction.
+     */
+    guac_timestamp last_reduce;
+
+} guac_common_download_window;
+
+/**
+ * Handler which reads the next chunk of data to be downloaded.
+ *
+ * @param user
+ *     The user receiving the download.
+ *
+ * @param data
+ *     The arbitrary data given to guac_common_download_begin().
+ *
+ * @param buffer
+ *     The buffer into which data should be read.
+ *
+ * @param length
+ *     The maximum number of bytes to read.
+ *
+ * @return
+ *     The number of bytes read, zero if the end of the data has been reached,
+ *     or a negative value if an error occurs.
+ */
+typedef int guac_common_download_read_handler(guac_user* user, void* data,
+        char* buffer, int length);
+
+/**
+ * Handler which is invoked once a download has ended, successfully or not,
+ * and which must release any resources associated with the download.
+ *
+ * @param user
+ *     The user which was receiving the download.
+ *
+ * @param data
+ *     The arbitrary data given to guac_common_download_begin().
+ *
+ * @param success
+ *     Non-zero if all data was sent, zero if the download failed or was
+ *     cancelled.
+ */
+typedef void guac_common_download_end_handler(guac_user* user, void* data,
+        int success);
+
+/**
+ * Initializes the given flow control state.
+ *
+ * @param window
+ *     The flow control state to initialize.
+ *
+ * @param max_size
+ *     The maximum number of blobs which may be awaiting acknowledgement.
+ *     This is limited to GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT.
+ */
+void guac_common_download_window_init(guac_common_download_window* window,
+        int max_size);
+
+/**
+ * Returns the number of additional blobs which may currently be sent.
+ *
+ * @param window
+ *     The flow control state to check.
+ *
+ * @return
+ *     The number of additional blobs which may be sent before any further
+ *     acknowledgements are received.
+ */
+int guac_common_download_window_available(
+        const guac_common_download_window* window);
+
+/**
+ * Records that a blob has been sent.
+ *
+ * @param window
+ *     The flow control state to update.
+ *
+ * @param now
+ *     The time that the blob was sent.
+ */
+void guac_common_download_window_sent(guac_common_download_window* window,
+        guac_timestamp now);
+
+/**
+ * Records that the oldest outstanding blob has been acknowledged, resizing
+ * the window according to its round trip time.
+ *
+ * @param window
+ *     The flow control state to update.
+ *
+ * @param now
+ *     The time that the acknowledgement was received.
+ *
+ * @return
+ *     The round trip time of the acknowledged blob in milliseconds, or -1 if
+ *     no blobs were awaiting acknowledgement.
+ */
+int guac_common_download_window_acked(guac_common_download_window* window,
+        guac_timestamp now);
+
+/**
+ * Begins sending data from an arbitrary source over the given stream, which
+ * must not yet have been announced to the user. The stream's ack handler and
+ * data are replaced. Once the caller has sent the instruction which begins
+ * the stream (such as "file" or "body"), the user's acknowledgement of that
+ * instruction begins the transfer. Data is read GUAC_COMMON_DOWNLOAD_READ_SIZE
+ * bytes at a time and sent in blobs of the maximum size, with as many blobs
+ * awaiting acknowledgement as the connection can sustain. The stream is
+ * ended and freed automatically, and the end handler invoked, once all data
+ * has been acknowledged, if an error occurs, or if the user rejects the
+ * stream.
+ *
+ * @param user
+ *     The user that will receive the download.
+ *
+ * @param stream
+ *     The stream over which the download should be sent.
+ *
+ * @param max_window
+ *     The maximum number of blobs which may be awaiting acknowledgement at
+ *     any one time, typically GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW.
+ *
+ * @param read_handler
+ *     The handler which reads data to be sent.
+ *
+ * @param end_handler
+ *     The handler to invoke once the download has ended.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given handlers.
+ *
+ * @return
+ *     Zero if the download was prepared successfully, non-zero otherwise. If
+ *     the download could not be prepared, the end handler is not invoked.
+ */
+int guac_common_download_begin(guac_user* user, guac_stream* stream,
+        int max_window, guac_common_download_read_handler* read_handler,
+        guac_common_download_end_handler* end_handler, void* data);
+
+#endif
+
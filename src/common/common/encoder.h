@@ -0,0 +1,265 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_ENCODER_H
+#define __GUAC_COMMON_ENCODER_H
+
+#include "config.h"
+
+#include <guacamole/timestamp.h>
+
+#include <stdint.h>
+
+/**
+ * The minimum amount of time between bandwidth samples, in milliseconds.
+ * Shorter intervals would mostly measure the burstiness of individual
+ * frames rather than the throughput of the connection.
+ */
+#define GUAC_COMMON_BANDWIDTH_SAMPLE_INTERVAL 250
+
+/**
+ * The minimum number of bytes which must have been sent during a sample
+ * interval for that interval to be used to lower the bandwidth estimate.
+ * Intervals in which almost nothing was sent say little about the capacity
+ * of the connection, even if the client is lagging behind.
+ */
+#define GUAC_COMMON_BANDWIDTH_MIN_SAMPLE_BYTES 16384
+
+/**
+ * The amount by which processing lag must exceed the lowest processing lag
+ * observed for the connection before the connection is considered
+ * saturated, in milliseconds. The lowest observed lag approximates the round
+ * trip time of the connection, which is not in itself a sign of congestion.
+ */
+#define GUAC_COMMON_BANDWIDTH_SATURATED_LAG 40
+
+/**
+ * The bandwidth, in bytes per second, beyond which the connection is
+ * considered unconstrained and the bandwidth estimate is discarded.
+ */
+#define GUAC_COMMON_BANDWIDTH_UNCONSTRAINED (64 * 1024 * 1024)
+
+/**
+ * The image encodings which may be used to send graphical updates.
+ */
+typedef enum guac_common_encoder {
+
+    /**
+     * Lossless PNG.
+     */
+    GUAC_COMMON_ENCODER_PNG,
+
+    /**
+     * Lossy JPEG.
+     */
+    GUAC_COMMON_ENCODER_JPEG,
+
+    /**
+     * WebP, lossy unless lossless compression is required.
+     */
+    GUAC_COMMON_ENCODER_WEBP
+
+} guac_common_encoder;
+
+/**
+ * The number of values defined by guac_common_encoder.
+ */
+#define GUAC_COMMON_ENCODER_COUNT 3
+
+/**
+ * The measured cost of encoding image data with a particular encoder,
+ * relative to the number of pixels encoded. Each value is a moving average of
+ * the measurements recorded with guac_common_encoder_cost_record(), or zero
+ * if nothing has yet been recorded.
+ */
+typedef struct guac_common_encoder_cost {
+
+    /**
+     * The number of bytes sent for every 1024 pixels encoded, including the
+     * overhead of the Guacamole protocol.
+     */
+    int bytes_per_kpixel;
+
+    /**
+     * The CPU time required to encode every 1024 pixels, in microseconds.
+     */
+    int usec_per_kpixel;
+
+} guac_common_encoder_cost;
+
+/**
+ * An estimate of the rate at which data can be delivered to the client and
+ * processed, derived from the rate at which data is written to the client's
+ * socket and the processing lag reported for the client.
+ */
+typedef struct guac_common_bandwidth {
+
+    /**
+     * The estimated bandwidth, in bytes per second, or zero if the connection
+     * has not been observed to be constrained.
+     */
+    int bytes_per_second;
+
+    /**
+     * The lowest processing lag observed, in milliseconds, or -1 if no
+     * processing lag has yet been observed.
+     */
+    int min_lag;
+
+    /**
+     * The time that the current sample interval began.
+     */
+    guac_timestamp sample_start;
+
+    /**
+     * The total number of bytes written to the socket when the current sample
+     * interval began.
+     */
+    uint64_t sample_bytes;
+
+} guac_common_bandwidth;
+
+/**
+ * Returns the default cost of the given encoder, used for regions where no
+ * measurements are yet available. Each default is a rough typical value for
+ * desktop content.
+ *
+ * @param encoder
+ *     The encoder whose default cost should be returned.
+ *
+ * @return
+ *     The default cost of the given encoder.
+ */
+const guac_common_encoder_cost* guac_common_encoder_default_cost(
+        guac_common_encoder encoder);
+
+/**
+ * Records a measurement of the cost of encoding image data, updating the
+ * moving averages within the given cost.
+ *
+ * @param cost
+ *     The cost to update.
+ *
+ * @param pixels
+ *     The number of pixels encoded. If this is not positive, the measurement
+ *     is ignored.
+ *
+ * @param bytes
+ *     The number of bytes sent as a result of encoding those pixels.
+ *
+ * @param usec
+ *     The CPU time required to encode those pixels, in microseconds.
+ */
+void guac_common_encoder_cost_record(guac_common_encoder_cost* cost,
+        int pixels, uint64_t bytes, int64_t usec);
+
+/**
+ * Estimates the time between beginning to encode the given number of pixels
+ * and the client receiving the result, based on the given cost and
+ * bandwidth.
+ *
+ * @param cost
+ *     The cost of the encoder being considered.
+ *
+ * @param bandwidth
+ *     The current bandwidth estimate. If the connection has not been observed
+ *     to be constrained, only encoding time is considered.
+ *
+ * @param pixels
+ *     The number of pixels to be encoded.
+ *
+ * @return
+ *     The estimated latency, in microseconds.
+ */
+int64_t guac_common_encoder_cost_estimate(const guac_common_encoder_cost* cost,
+        const guac_common_bandwidth* bandwidth, int pixels);
+
+/**
+ * Estimates the time required to transfer the given number of pixels after
+ * encoding, based on the given cost and bandwidth.
+ *
+ * @param cost
+ *     The cost of the encoder being considered.
+ *
+ * @param bandwidth
+ *     The current bandwidth estimate.
+ *
+ * @param pixels
+ *     The number of pixels to be encoded.
+ *
+ * @return
+ *     The estimated transfer time, in microseconds, or zero if the connection
+ *     has not been observed to be constrained.
+ */
+int64_t guac_common_encoder_cost_estimate_transfer(
+        const guac_common_encoder_cost* cost,
+        const guac_common_bandwidth* bandwidth, int pixels);
+
+/**
+ * Returns the CPU time consumed so far by the calling thread, for measuring
+ * encoding time independently of any time spent blocked on the network. If
+ * per-thread CPU time is not available, wall-clock time is used instead.
+ *
+ * @return
+ *     The CPU time consumed so far by the calling thread, in microseconds.
+ */
+int64_t guac_common_encoder_clock();
+
+/**
+ * Initializes the given bandwidth estimate, beginning its first sample
+ * interval. Until the connection is observed to be constrained, the
+ * estimate is zero.
+ *
+ * @param bandwidth
+ *     The bandwidth estimate to initialize.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @param bytes
+ *     The total number of bytes written to the socket so far.
+ */
+void guac_common_bandwidth_init(guac_common_bandwidth* bandwidth,
+        guac_timestamp now, uint64_t bytes);
+
+/**
+ * Updates the given bandwidth estimate. If the current sample interval has
+ * lasted at least GUAC_COMMON_BANDWIDTH_SAMPLE_INTERVAL, the throughput over
+ * that interval is compared with the estimate and a new interval begins. If
+ * the processing lag shows the connection to be saturated, the estimate moves
+ * toward that throughput. Otherwise the estimate increases, such that the
+ * connection is again considered unconstrained once congestion clears.
+ *
+ * @param bandwidth
+ *     The bandwidth estimate to update.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @param bytes
+ *     The total number of bytes written to the socket so far.
+ *
+ * @param lag
+ *     The current processing lag of the client, in milliseconds.
+ */
+void guac_common_bandwidth_update(guac_common_bandwidth* bandwidth,
+        guac_timestamp now, uint64_t bytes, int lag);
+
+#endif
+
@@ -40,7 +40,12 @@ typedef void guac_iconv_write(char** output, int remaining, int value);
  * Converts characters within a given string from one encoding to another,
  * as defined by the reader/writer functions specified. The input and output
  * string pointers will be updated based on the number of bytes read or
- * written.
+ * written. Characters are never partially written: if the output string is
+ * too small to contain the next character, or the input string ends partway
+ * through a character, conversion stops with that character left unread,
+ * such that conversion can be resumed by invoking guac_iconv() again with
+ * the updated pointers. Runs of ASCII characters are copied in bulk wherever
+ * both encodings represent those characters identically.
  *
  * @param reader The reader function to use when reading the input string.
  * @param input Pointer to the beginning of the input string.
@@ -0,0 +1,322 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_LISTING_H
+#define GUAC_COMMON_LISTING_H
+
+#include "config.h"
+
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+/**
+ * The number of milliseconds that a cached directory listing remains valid.
+ * Listings are also invalidated explicitly when files within the directory
+ * are created, deleted, or renamed through Guacamole, such that this need
+ * only cover changes made by other means.
+ */
+#define GUAC_COMMON_LISTING_CACHE_TTL 10000
+
+/**
+ * The maximum number of directory listings which may be cached by a single
+ * guac_common_listing_cache. Once full, the least recently cached listing is
+ * replaced. Listings are cached regardless of their size, so the memory
+ * occupied by a cache is the combined size of the listings within it.
+ */
+#define GUAC_COMMON_LISTING_CACHE_SIZE 32
+
+/**
+ * The initial number of bytes allocated for the JSON of a directory listing.
+ * The buffer is doubled in size as necessary.
+ */
+#define GUAC_COMMON_LISTING_INITIAL_SIZE 4096
+
+/**
+ * The contents of a directory, as the JSON object sent to users in response
+ * to a "get" request for that directory. Each property of the object is the
+ * absolute path of a file within the directory, and the value of each
+ * property is the mimetype of that file.
+ */
+typedef struct guac_common_listing {
+
+    /**
+     * The JSON of the directory listing. Until guac_common_listing_end() is
+     * invoked, this is not a complete JSON object.
+     */
+    char* json;
+
+    /**
+     * The number of bytes of JSON within the json buffer.
+     */
+    int length;
+
+    /**
+     * The number of bytes allocated for the json buffer.
+     */
+    int size;
+
+    /**
+     * The number of files added to the listing.
+     */
+    int entries;
+
+} guac_common_listing;
+
+/**
+ * Handler which reads the next entry of a directory being listed with
+ * guac_common_listing_stream(), adding that entry to the given listing unless
+ * it should be skipped.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param data
+ *     The arbitrary data given to guac_common_listing_stream().
+ *
+ * @param listing
+ *     The directory listing being read.
+ *
+ * @return
+ *     Non-zero if an entry was read, even if that entry was skipped, or zero
+ *     if no entries remain.
+ */
+typedef int guac_common_listing_entry_handler(guac_user* user, void* data,
+        guac_common_listing* listing);
+
+/**
+ * Handler which is invoked once a directory listing started with
+ * guac_common_listing_stream() has ended, successfully or not, and which must
+ * close the directory being listed and release any associated resources.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param data
+ *     The arbitrary data given to guac_common_listing_stream().
+ */
+typedef void guac_common_listing_free_handler(guac_user* user, void* data);
+
+/**
+ * A cache of recently-read directory listings, keyed by the absolute path of
+ * each directory. Paths may use either "/" or "\" as the path separator, and
+ * trailing separators are ignored. Access to the cache is threadsafe.
+ */
+typedef struct guac_common_listing_cache guac_common_listing_cache;
+
+/**
+ * Allocates a new, empty directory listing.
+ *
+ * @return
+ *     A newly-allocated directory listing, which must eventually be freed
+ *     with guac_common_listing_free().
+ */
+guac_common_listing* guac_common_listing_alloc();
+
+/**
+ * Adds the given file to the given directory listing.
+ *
+ * @param listing
+ *     The directory listing to add the file to.
+ *
+ * @param path
+ *     The absolute path of the file.
+ *
+ * @param mimetype
+ *     The mimetype of the file. For directories, this should be
+ *     GUAC_USER_STREAM_INDEX_MIMETYPE.
+ */
+void guac_common_listing_add(guac_common_listing* listing, const char* path,
+        const char* mimetype);
+
+/**
+ * Completes the JSON object of the given directory listing. No further files
+ * may be added once the listing has been completed.
+ *
+ * @param listing
+ *     The directory listing to complete.
+ */
+void guac_common_listing_end(guac_common_listing* listing);
+
+/**
+ * Frees the given directory listing.
+ *
+ * @param listing
+ *     The directory listing to free.
+ */
+void guac_common_listing_free(guac_common_listing* listing);
+
+/**
+ * Begins sending the given completed directory listing over the given stream
+ * using guac_common_download_begin(), such that as many blobs of the listing
+ * are in flight at once as the connection can sustain. The stream must not
+ * yet have been announced to the user, and the caller must announce the
+ * stream (with a "body" instruction) after this function returns
+ * successfully. The listing is freed automatically once sent.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param stream
+ *     The stream over which the directory listing should be sent.
+ *
+ * @param listing
+ *     The completed directory listing to send.
+ *
+ * @return
+ *     Zero if sending of the listing was prepared successfully, non-zero
+ *     otherwise. If sending could not be prepared, the listing is freed
+ *     immediately.
+ */
+int guac_common_listing_send(guac_user* user, guac_stream* stream,
+        guac_common_listing* listing);
+
+/**
+ * Begins reading the contents of a directory and sending those contents as a
+ * JSON directory listing over the given stream using
+ * guac_common_download_begin(). The directory is read only as quickly as its
+ * listing is sent, with only enough entries read to produce the next
+ * GUAC_COMMON_DOWNLOAD_READ_SIZE bytes of JSON as earlier blobs are
+ * acknowledged, such that reading a large directory does not block the
+ * user's other instructions for the duration of the entire read. The
+ * stream must not yet have been announced to the user, and the caller must
+ * announce the stream (with a "body" instruction) after this function returns
+ * successfully.
+ *
+ * The entire listing is retained while the directory is read and, once the
+ * directory has been read in full, a copy of the listing is stored in the
+ * given cache. The memory required to list a directory is therefore up to
+ * twice the size of its JSON listing during the read (the listing buffer
+ * grows by doubling), plus one further copy while that listing remains
+ * cached. Changes to the directory made while it is being read may not be
+ * reflected in the cached listing until that listing expires.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param stream
+ *     The stream over which the directory listing should be sent.
+ *
+ * @param cache
+ *     The cache which should receive the listing once the directory has been
+ *     read in full, or NULL if the listing should not be cached.
+ *
+ * @param path
+ *     The absolute path of the directory, used as the key of the listing
+ *     within the cache.
+ *
+ * @param entry_handler
+ *     The handler to invoke to read each entry of the directory.
+ *
+ * @param free_handler
+ *     The handler to invoke once the listing has ended, successfully or not.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given handlers, typically describing the
+ *     open directory being read.
+ *
+ * @return
+ *     Zero if sending of the listing was prepared successfully, non-zero
+ *     otherwise. If sending could not be prepared, the free handler is
+ *     invoked immediately.
+ */
+int guac_common_listing_stream(guac_user* user, guac_stream* stream,
+        guac_common_listing_cache* cache, const char* path,
+        guac_common_listing_entry_handler* entry_handler,
+        guac_common_listing_free_handler* free_handler, void* data);
+
+/**
+ * Allocates a new, empty cache of directory listings.
+ *
+ * @return
+ *     A newly-allocated directory listing cache, which must eventually be
+ *     freed with guac_common_listing_cache_free().
+ */
+guac_common_listing_cache* guac_common_listing_cache_alloc();
+
+/**
+ * Frees the given directory listing cache, including all listings within.
+ *
+ * @param cache
+ *     The directory listing cache to free.
+ */
+void guac_common_listing_cache_free(guac_common_listing_cache* cache);
+
+/**
+ * Returns a copy of the cached listing of the directory having the given
+ * path, if that listing was cached within the last
+ * GUAC_COMMON_LISTING_CACHE_TTL milliseconds. The copy is owned by the
+ * caller, such that each cached listing being sent occupies memory equal to
+ * its size in addition to the cached listing itself.
+ *
+ * @param cache
+ *     The directory listing cache to search.
+ *
+ * @param path
+ *     The absolute path of the directory.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     A newly-allocated copy of the cached listing, which must eventually be
+ *     freed with guac_common_listing_free(), or NULL if no valid listing of
+ *     the directory is cached.
+ */
+guac_common_listing* guac_common_listing_cache_get(
+        guac_common_listing_cache* cache, const char* path,
+        guac_timestamp now);
+
+/**
+ * Stores a copy of the given completed directory listing within the given
+ * cache, replacing any listing already cached for the same directory.
+ *
+ * @param cache
+ *     The directory listing cache to update.
+ *
+ * @param path
+ *     The absolute path of the directory.
+ *
+ * @param listing
+ *     The completed listing of the directory.
+ *
+ * @param now
+ *     The current time.
+ */
+void guac_common_listing_cache_put(guac_common_listing_cache* cache,
+        const char* path, const guac_common_listing* listing,
+        guac_timestamp now);
+
+/**
+ * Removes any cached listings which may be affected by the creation,
+ * deletion, or renaming of the file having the given path. This includes the
+ * listing of the directory containing that file and, if the file is itself a
+ * directory, the listing of that directory.
+ *
+ * @param cache
+ *     The directory listing cache to update.
+ *
+ * @param path
+ *     The absolute path of the file that was created, deleted, or renamed.
+ */
+void guac_common_listing_cache_invalidate(guac_common_listing_cache* cache,
+        const char* path);
+
+#endif
+
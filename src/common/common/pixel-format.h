@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_PIXEL_FORMAT_H
+#define __GUAC_COMMON_PIXEL_FORMAT_H
+
+#include "config.h"
+#include "common/pixel.h"
+
+#include <stdint.h>
+
+/**
+ * A packed true-color pixel format, such as those used by VNC framebuffers,
+ * in which each pixel is a native-endian 8, 16, or 32-bit integer containing
+ * red, green, and blue components at arbitrary offsets.
+ */
+typedef struct guac_common_pixel_format {
+
+    /**
+     * The number of bits in each pixel. This must be 8, 16, or 32.
+     */
+    int bits_per_pixel;
+
+    /**
+     * The number of bits the pixel value must be shifted right to obtain the
+     * red component.
+     */
+    int red_shift;
+
+    /**
+     * The number of bits the pixel value must be shifted right to obtain the
+     * green component.
+     */
+    int green_shift;
+
+    /**
+     * The number of bits the pixel value must be shifted right to obtain the
+     * blue component.
+     */
+    int blue_shift;
+
+    /**
+     * The maximum value of the red component.
+     */
+    int red_max;
+
+    /**
+     * The maximum value of the green component.
+     */
+    int green_max;
+
+    /**
+     * The maximum value of the blue component.
+     */
+    int blue_max;
+
+    /**
+     * Non-zero if the red and blue components must be swapped after
+     * conversion, zero otherwise.
+     */
+    int swap_red_blue;
+
+} guac_common_pixel_format;
+
+/**
+ * Converts rows of pixels from a particular guac_common_pixel_format to the
+ * pixel format of CAIRO_FORMAT_RGB24. The conversion kernel is selected once,
+ * when the converter is allocated, based on the pixel format and on the
+ * implementation returned by guac_common_pixel_get_impl() at that time.
+ */
+typedef struct guac_common_pixel_converter guac_common_pixel_converter;
+
+/**
+ * Converts a single pixel from the given pixel format to the pixel format of
+ * CAIRO_FORMAT_RGB24. Each component is scaled to the range 0-255, and the
+ * most significant byte of the result is zero. This is the reference
+ * conversion which all converters reproduce exactly.
+ *
+ * @param format
+ *     The format of the pixel to convert.
+ *
+ * @param value
+ *     The pixel to convert.
+ *
+ * @return
+ *     The converted pixel.
+ */
+uint32_t guac_common_pixel_format_convert(
+        const guac_common_pixel_format* format, uint32_t value);
+
+/**
+ * Returns whether the given pixel formats are identical.
+ *
+ * @param a
+ *     The first pixel format to compare.
+ *
+ * @param b
+ *     The second pixel format to compare.
+ *
+ * @return
+ *     Non-zero if the pixel formats are identical, zero otherwise.
+ */
+int guac_common_pixel_format_equals(const guac_common_pixel_format* a,
+        const guac_common_pixel_format* b);
+
+/**
+ * Allocates a new converter for the given pixel format, selecting the
+ * fastest conversion kernel for that format.
+ *
+ * @param format
+ *     The pixel format that the converter should convert from. The contents
+ *     of this structure are copied.
+ *
+ * @return
+ *     A newly-allocated converter, or NULL if the pixel format is not
+ *     supported.
+ */
+guac_common_pixel_converter* guac_common_pixel_converter_alloc(
+        const guac_common_pixel_format* format);
+
+/**
+ * Frees the given converter.
+ *
+ * @param converter
+ *     The converter to free.
+ */
+void guac_common_pixel_converter_free(guac_common_pixel_converter* converter);
+
+/**
+ * Returns the pixel format that the given converter converts from.
+ *
+ * @param converter
+ *     The converter to query.
+ *
+ * @return
+ *     The pixel format that the converter converts from.
+ */
+const guac_common_pixel_format* guac_common_pixel_converter_get_format(
+        const guac_common_pixel_converter* converter);
+
+/**
+ * Returns whether pixels of the format converted by the given converter may
+ * be used directly as CAIRO_FORMAT_RGB24 pixels without conversion. The
+ * most significant byte of such pixels is not necessarily zero, but is
+ * ignored by CAIRO_FORMAT_RGB24.
+ *
+ * @param converter
+ *     The converter to query.
+ *
+ * @return
+ *     Non-zero if conversion is unnecessary, zero otherwise.
+ */
+int guac_common_pixel_converter_is_identity(
+        const guac_common_pixel_converter* converter);
+
+/**
+ * Converts a row of pixels, producing exactly the same output as
+ * guac_common_pixel_format_convert() for each pixel.
+ *
+ * @param converter
+ *     The converter to use.
+ *
+ * @param dst
+ *     The row which should receive the converted pixels.
+ *
+ * @param src
+ *     The row of pixels to convert, which must be suitably aligned for the
+ *     size of each pixel.
+ *
+ * @param width
+ *     The number of pixels to convert.
+ */
+void guac_common_pixel_convert_row(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width);
+
+#endif
+
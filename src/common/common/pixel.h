@@ -0,0 +1,222 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_PIXEL_H
+#define __GUAC_COMMON_PIXEL_H
+
+#include "config.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+
+/**
+ * The implementations available for the row-level pixel operations used by
+ * guac_common_surface. All implementations produce identical output; they
+ * differ only in which instruction set extensions they require.
+ */
+typedef enum guac_common_pixel_impl {
+
+    /**
+     * Portable implementation which processes one pixel at a time. This
+     * implementation is always available.
+     */
+    GUAC_COMMON_PIXEL_SCALAR,
+
+    /**
+     * Implementation which processes four pixels at a time using SSE4.1.
+     * This implementation is available only on x86 processors which support
+     * SSE4.1.
+     */
+    GUAC_COMMON_PIXEL_SSE41,
+
+    /**
+     * Implementation which processes eight pixels at a time using AVX2. This
+     * implementation is available only on x86 processors which support AVX2.
+     */
+    GUAC_COMMON_PIXEL_AVX2
+
+} guac_common_pixel_impl;
+
+/**
+ * Returns the implementation currently used for row-level pixel operations.
+ * Unless overridden with guac_common_pixel_set_impl(), this will be the
+ * fastest implementation supported by the current processor.
+ *
+ * @return
+ *     The implementation currently used for row-level pixel operations.
+ */
+guac_common_pixel_impl guac_common_pixel_get_impl();
+
+/**
+ * Overrides the implementation used for row-level pixel operations. This
+ * affects all surfaces and is intended only for testing and benchmarking. It
+ * must not be invoked while other threads may be drawing.
+ *
+ * @param impl
+ *     The implementation to use.
+ *
+ * @return
+ *     Zero if the implementation is now in use, non-zero if the requested
+ *     implementation is not supported by this build or by the current
+ *     processor.
+ */
+int guac_common_pixel_set_impl(guac_common_pixel_impl impl);
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending each component
+ * of the two given pre-multiplied ARGB colors.
+ *
+ * @param dst
+ *     The destination ARGB color.
+ *
+ * @param src
+ *     The source ARGB color.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination colors.
+ */
+uint32_t guac_common_pixel_blend(uint32_t dst, uint32_t src);
+
+/**
+ * Copies a row of ARGB pixels into the given destination row, either
+ * ignoring the alpha channel of the source or blending the source over the
+ * destination with guac_common_pixel_blend(). The range of pixels which
+ * actually changed is stored in the given first/last pointers.
+ *
+ * @param dst
+ *     The destination row.
+ *
+ * @param src
+ *     The source row. This row must not overlap the destination row.
+ *
+ * @param width
+ *     The number of pixels in each row.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the source should be ignored, zero if
+ *     the source should be blended over the destination.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the leftmost changed
+ *     pixel. This value is only modified if a pixel changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the rightmost
+ *     changed pixel. This value is only modified if a pixel changed.
+ *
+ * @return
+ *     Non-zero if any pixel within the destination row changed, zero
+ *     otherwise.
+ */
+int guac_common_pixel_put_row(uint32_t* dst, const uint32_t* src, int width,
+        int opaque, int* first, int* last);
+
+/**
+ * Assigns the given ARGB color to every pixel within the given row. The
+ * range of pixels which actually changed is stored in the given first/last
+ * pointers.
+ *
+ * @param dst
+ *     The destination row.
+ *
+ * @param color
+ *     The ARGB color to assign.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the leftmost changed
+ *     pixel. This value is only modified if a pixel changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the rightmost
+ *     changed pixel. This value is only modified if a pixel changed.
+ *
+ * @return
+ *     Non-zero if any pixel within the row changed, zero otherwise.
+ */
+int guac_common_pixel_set_row(uint32_t* dst, uint32_t color, int width,
+        int* first, int* last);
+
+/**
+ * Combines a row of source pixels with the given destination row using the
+ * given transfer function. The alpha channel of the destination is preserved
+ * by all transfer functions other than GUAC_TRANSFER_BINARY_BLACK,
+ * GUAC_TRANSFER_BINARY_WHITE, GUAC_TRANSFER_BINARY_SRC and
+ * GUAC_TRANSFER_BINARY_NSRC. The range of pixels which actually changed is
+ * stored in the given first/last pointers.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param src
+ *     The source row.
+ *
+ * @param dst
+ *     The destination row.
+ *
+ * @param width
+ *     The number of pixels in each row.
+ *
+ * @param backwards
+ *     Non-zero if the row must be processed from right to left, as required
+ *     when the source and destination overlap and the destination lies to
+ *     the right of the source, zero otherwise.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the leftmost changed
+ *     pixel. This value is only modified if a pixel changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the rightmost
+ *     changed pixel. This value is only modified if a pixel changed.
+ *
+ * @return
+ *     Non-zero if any pixel within the destination row changed, zero
+ *     otherwise.
+ */
+int guac_common_pixel_transfer_row(guac_transfer_function op,
+        const uint32_t* src, uint32_t* dst, int width, int backwards,
+        int* first, int* last);
+
+/**
+ * Assigns the given ARGB color to each pixel within the destination row for
+ * which the corresponding pixel of the mask row has a non-zero alpha
+ * component.
+ *
+ * @param dst
+ *     The destination row.
+ *
+ * @param mask
+ *     The mask row. This row must not overlap the destination row.
+ *
+ * @param color
+ *     The ARGB color to assign.
+ *
+ * @param width
+ *     The number of pixels in each row.
+ */
+void guac_common_pixel_fill_mask_row(uint32_t* dst, const uint32_t* mask,
+        uint32_t color, int width);
+
+#endif
+
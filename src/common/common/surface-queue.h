@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_SURFACE_QUEUE_H
+#define __GUAC_COMMON_SURFACE_QUEUE_H
+
+#include "config.h"
+#include "rect.h"
+
+#include <stdint.h>
+
+/**
+ * The maximum number of updates to allow within the bitmap queue. Once the
+ * queue is full, each new update is merged with the queued update that it
+ * least enlarges.
+ */
+#define GUAC_COMMON_SURFACE_QUEUE_SIZE 256
+
+/**
+ * The width and height of each tile by which queued updates are indexed, in
+ * pixels. A new update is only compared against queued updates which cover
+ * the tiles it covers or the tiles adjacent to those.
+ */
+#define GUAC_COMMON_SURFACE_QUEUE_TILE_SIZE 128
+
+/**
+ * The number of tile buckets along each side of the index of a bitmap queue.
+ * Tiles beyond this many rows or columns share buckets with earlier tiles,
+ * which only results in additional queued updates being compared, such that
+ * the index need not be resized along with its surface.
+ */
+#define GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE 16
+
+/**
+ * The number of 64-bit words required to hold one bit for every update
+ * within the bitmap queue.
+ */
+#define GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS \
+    ((GUAC_COMMON_SURFACE_QUEUE_SIZE + 63) / 64)
+
+/**
+ * Representation of a bitmap update, having a rectangle of image data (stored
+ * elsewhere) and a flushed/not-flushed state.
+ */
+typedef struct guac_common_surface_bitmap_rect {
+
+    /**
+     * Whether this rectangle has been flushed.
+     */
+    int flushed;
+
+    /**
+     * The rectangle containing the bitmap update.
+     */
+    guac_common_rect rect;
+
+} guac_common_surface_bitmap_rect;
+
+/**
+ * Queue of bitmap updates pending for a surface. Updates are merged as they
+ * are queued, such that no two nearby queued updates would be better sent as
+ * one. Queued updates are indexed by the tiles they cover, such that each new
+ * update need only be compared against queued updates in its vicinity.
+ */
+typedef struct guac_common_surface_queue {
+
+    /**
+     * The number of updates in the queue.
+     */
+    int length;
+
+    /**
+     * All queued updates. Only the first length entries are meaningful.
+     */
+    guac_common_surface_bitmap_rect rects[GUAC_COMMON_SURFACE_QUEUE_SIZE];
+
+    /**
+     * For each tile bucket, a bitmask of the queued updates which cover any
+     * tile within that bucket, where bit N of the mask corresponds to
+     * rects[N]. Tile (x, y) belongs to the bucket at
+     * [y % GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE]
+     * [x % GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE].
+     */
+    uint64_t tiles[GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE]
+                  [GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE]
+                  [GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS];
+
+} guac_common_surface_queue;
+
+/**
+ * Returns whether the given rectangle should be combined with an existing
+ * update, to be eventually flushed as a single image, or would be best kept
+ * independent of that update.
+ *
+ * @param existing
+ *     The bounding rectangle of the existing update.
+ *
+ * @param rect
+ *     The bounding rectangle of the new update.
+ *
+ * @param rect_only
+ *     Non-zero if the new update, by its nature, contains only
+ *     metainformation about the update's bounding rectangle, zero if the
+ *     update also contains image data.
+ *
+ * @return
+ *     Non-zero if the updates should be combined, zero otherwise.
+ */
+int guac_common_surface_queue_should_combine(const guac_common_rect* existing,
+        const guac_common_rect* rect, int rect_only);
+
+/**
+ * Adds the given rectangle to the given bitmap queue, merging it with any
+ * nearby queued updates with which it should be combined. Each merge may
+ * make further merges worthwhile, so merging continues until no nearby
+ * queued update should be combined with the result. If the queue is full,
+ * the slot of an update which has already been flushed is reused or, if
+ * there is no such update, the queued update which can be combined with the
+ * least increase in cost is merged regardless, such that the queue never
+ * overflows.
+ *
+ * @param queue
+ *     The queue which should receive the rectangle.
+ *
+ * @param rect
+ *     The rectangle to add.
+ */
+void guac_common_surface_queue_add(guac_common_surface_queue* queue,
+        const guac_common_rect* rect);
+
+/**
+ * Removes all updates from the given bitmap queue, flushed or not.
+ *
+ * @param queue
+ *     The queue to clear.
+ */
+void guac_common_surface_queue_clear(guac_common_surface_queue* queue);
+
+#endif
+
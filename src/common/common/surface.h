@@ -21,7 +21,10 @@
 #define __GUAC_COMMON_SURFACE_H
 
 #include "config.h"
+#include "encoder.h"
 #include "rect.h"
+#include "surface-queue.h"
+#include "video.h"
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
@@ -31,11 +34,6 @@
 
 #include <pthread.h>
 
-/**
- * The maximum number of updates to allow within the bitmap queue.
- */
-#define GUAC_COMMON_SURFACE_QUEUE_SIZE 256
-
 /**
  * Heat map cell size in pixels. Each side of each heat map cell will consist
  * of this many pixels.
@@ -51,6 +49,16 @@
             / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE      \
 )
 
+/**
+ * Damage tile size in pixels. Draws larger than a single tile are compared
+ * against the surface one tile at a time, with each tile that actually changed
+ * reported as a separate update. A draw which changes only a few small,
+ * distant regions of a large area thus results in updates covering only
+ * those regions, rather than their combined bounding box. Tiles are aligned
+ * with the cells of the heat map.
+ */
+#define GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE 64
+
 /**
  * The number of entries to collect within each heat map cell. Collected
  * history entries are used to determine the framerate of the region associated
@@ -79,25 +87,13 @@ typedef struct guac_common_surface_heat_cell {
      */
     int oldest_entry;
 
-} guac_common_surface_heat_cell;
-
-/**
- * Representation of a bitmap update, having a rectangle of image data (stored
- * elsewhere) and a flushed/not-flushed state.
- */
-typedef struct guac_common_surface_bitmap_rect {
-
     /**
-     * Whether this rectangle has been flushed.
+     * The measured cost of each encoder for updates covering the location
+     * associated with this heat map cell, indexed by guac_common_encoder.
      */
-    int flushed;
+    guac_common_encoder_cost encoder_costs[GUAC_COMMON_ENCODER_COUNT];
 
-    /**
-     * The rectangle containing the bitmap update.
-     */
-    guac_common_rect rect;
-
-} guac_common_surface_bitmap_rect;
+} guac_common_surface_heat_cell;
 
 /**
  * Surface which backs a Guacamole buffer or layer, automatically
@@ -187,6 +183,20 @@ typedef struct guac_common_surface {
      */
     unsigned char* buffer;
 
+    /**
+     * Non-zero if the underlying buffer is owned by an external component and
+     * has been bound to this surface with guac_common_surface_bind(), zero if
+     * the buffer is owned by this surface.
+     */
+    int bound;
+
+    /**
+     * Non-zero if the alpha channel of the underlying buffer is meaningless
+     * and all pixels must be treated as fully opaque, zero otherwise. This
+     * may only be set for bound buffers.
+     */
+    int opaque;
+
     /**
      * Non-zero if the location or parent layer of this surface has been
      * changed and needs to be flushed, 0 otherwise.
@@ -225,15 +235,10 @@ typedef struct guac_common_surface {
      */
     guac_common_rect clip_rect;
 
-    /**
-     * The number of updates in the bitmap queue.
-     */
-    int bitmap_queue_length;
-
     /**
      * All queued bitmap updates.
      */
-    guac_common_surface_bitmap_rect bitmap_queue[GUAC_COMMON_SURFACE_QUEUE_SIZE];
+    guac_common_surface_queue bitmap_queue;
 
     /**
      * A heat map keeping track of the refresh frequency of
@@ -241,6 +246,64 @@ typedef struct guac_common_surface {
      */
     guac_common_surface_heat_cell* heat_map;
 
+    /**
+     * The measured cost of each encoder for updates anywhere within this
+     * surface, indexed by guac_common_encoder. These costs are used for
+     * regions whose heat map cells have no measurements of their own.
+     */
+    guac_common_encoder_cost encoder_costs[GUAC_COMMON_ENCODER_COUNT];
+
+    /**
+     * The estimated bandwidth available for sending updates over the socket
+     * of this surface.
+     */
+    guac_common_bandwidth bandwidth;
+
+    /**
+     * Non-zero if regions of this surface which are updated rapidly and
+     * continuously may be streamed as video, zero otherwise. Video is
+     * streamed only if libguac_common was built with video support, only
+     * for visible layers, and only while all users support video.
+     */
+    int video_enabled;
+
+    /**
+     * The region of this surface currently being streamed as video, or NULL
+     * if no region is being streamed.
+     */
+    guac_common_video* video;
+
+    /**
+     * The number of users connected when the current video began. The video
+     * must be restarted when users join or leave, as new users will not have
+     * received the beginning of the stream.
+     */
+    int video_users;
+
+    /**
+     * The last time that the region being streamed as video was updated.
+     */
+    guac_timestamp video_last_update;
+
+    /**
+     * The region which has been updated rapidly enough to be considered for
+     * streaming as video. This is only meaningful if video_candidate_start
+     * is non-zero.
+     */
+    guac_common_rect video_candidate;
+
+    /**
+     * The time that the region described by video_candidate began updating
+     * rapidly, or zero if no such region exists.
+     */
+    guac_timestamp video_candidate_start;
+
+    /**
+     * The last time that the region described by video_candidate was
+     * updated rapidly.
+     */
+    guac_timestamp video_candidate_last;
+
     /**
      * Mutex which is locked internally when access to the surface must be
      * synchronized. All public functions of guac_common_surface should be
@@ -291,11 +354,89 @@ void guac_common_surface_free(guac_common_surface* surface);
  */
 void guac_common_surface_resize(guac_common_surface* surface, int w, int h);
 
+/**
+ * Replaces the backing buffer of the given surface with the given
+ * externally-owned buffer, which must contain 32-bit pixels in the same
+ * format as CAIRO_FORMAT_ARGB32 (or CAIRO_FORMAT_RGB24 if opaque). Any buffer
+ * previously owned by the surface is freed, and the entire surface is marked
+ * dirty.
+ *
+ * Once bound, the buffer is used directly for all drawing operations and
+ * encoding, avoiding maintaining and updating a separate copy. The external
+ * owner of the buffer must invoke guac_common_surface_invalidate() for any
+ * region that it modifies directly, as such changes cannot otherwise be
+ * detected. The surface never frees or reallocates a bound buffer; the
+ * buffer must remain valid until the surface is freed, resized, or
+ * guac_common_surface_unbind() is invoked, whichever happens first.
+ *
+ * @param surface
+ *     The surface to bind the buffer to.
+ *
+ * @param buffer
+ *     The buffer to use as the backing buffer of the surface.
+ *
+ * @param stride
+ *     The number of bytes in each row of the buffer.
+ *
+ * @param w
+ *     The width of the buffer, in pixels. If this differs from the current
+ *     width of the surface, the surface is resized.
+ *
+ * @param h
+ *     The height of the buffer, in pixels. If this differs from the current
+ *     height of the surface, the surface is resized.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the buffer is meaningless and all
+ *     pixels must be treated as fully opaque, zero otherwise.
+ */
+void guac_common_surface_bind(guac_common_surface* surface,
+        unsigned char* buffer, int stride, int w, int h, int opaque);
+
+/**
+ * Stops using any externally-owned buffer previously bound with
+ * guac_common_surface_bind(), copying its current contents into a new buffer
+ * owned by the surface. If no buffer is bound, this function has no effect.
+ * Resizing a surface with guac_common_surface_resize() implicitly unbinds
+ * any bound buffer in the same manner.
+ *
+ * @param surface
+ *     The surface to unbind.
+ */
+void guac_common_surface_unbind(guac_common_surface* surface);
+
+/**
+ * Notifies the given surface that a rectangle of its backing buffer has been
+ * modified by something other than the surface itself, as may happen only
+ * when an externally-owned buffer has been bound with
+ * guac_common_surface_bind(). As the previous contents of that rectangle are
+ * not known, the entire rectangle will be sent to connected users.
+ *
+ * @param surface
+ *     The surface that was modified.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the modified rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the modified rectangle.
+ *
+ * @param w
+ *     The width of the modified rectangle.
+ *
+ * @param h
+ *     The height of the modified rectangle.
+ */
+void guac_common_surface_invalidate(guac_common_surface* surface,
+        int x, int y, int w, int h);
+
 /**
  * Draws the given data to the given guac_common_surface. If the source surface
  * is ARGB, the draw operation will be performed using the Porter-Duff "over"
  * composite operator. If the source surface is RGB (no alpha channel), no
- * compositing is performed and destination pixels are ignored.
+ * compositing is performed and destination pixels are ignored. Only the
+ * portions of the surface which actually change are sent to connected users,
+ * tracked at a granularity of GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE pixels.
  *
  * @param surface
  *     The surface to draw to.
@@ -535,5 +676,22 @@ void guac_common_surface_set_multitouch(guac_common_surface* surface,
 void guac_common_surface_set_lossless(guac_common_surface* surface,
         int lossless);
 
+/**
+ * Sets whether regions of the given surface which are updated rapidly and
+ * continuously may be streamed as video, rather than as a series of
+ * individual images. Video is streamed only if all connected users support
+ * it, and only if libguac_common was built with video support. Video is
+ * disabled by default.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param enabled
+ *     Non-zero if rapidly-updating regions may be streamed as video, zero
+ *     otherwise.
+ */
+void guac_common_surface_set_video(guac_common_surface* surface,
+        int enabled);
+
 #endif
 
@@ -0,0 +1,150 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_VIDEO_H
+#define __GUAC_COMMON_VIDEO_H
+
+#include "config.h"
+#include "rect.h"
+
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+/**
+ * The mimetype of the video streams produced by guac_common_video. Video is
+ * streamed only if every connected user supports this mimetype.
+ */
+#define GUAC_COMMON_VIDEO_MIMETYPE "video/webm"
+
+/**
+ * The maximum number of frames between keyframes.
+ */
+#define GUAC_COMMON_VIDEO_KEYFRAME_INTERVAL 60
+
+/**
+ * The size of the buffer used to collect muxed video data before it is sent
+ * as blobs, in bytes.
+ */
+#define GUAC_COMMON_VIDEO_IO_BUFFER_SIZE 65536
+
+/**
+ * A rectangular region of a layer which is being streamed to all connected
+ * users as VP8 video within WebM, via the "video" instruction. As the
+ * "video" instruction plays video across an entire layer, the video is
+ * played within a dedicated layer which is created as a child of the layer
+ * containing the region and which covers exactly that region. That layer is
+ * disposed when the video is freed.
+ *
+ * This structure is available only if libguac_common was built with
+ * libavcodec, libavformat, libavutil, and libswscale (ENABLE_COMMON_VIDEO).
+ */
+typedef struct guac_common_video guac_common_video;
+
+/**
+ * Returns whether all users of the given client support the video streams
+ * produced by guac_common_video.
+ *
+ * @param client
+ *     The client to check.
+ *
+ * @return
+ *     Non-zero if at least one user is connected and all connected users
+ *     support GUAC_COMMON_VIDEO_MIMETYPE, zero otherwise.
+ */
+int guac_common_video_supported(guac_client* client);
+
+/**
+ * Begins streaming the given region of the given layer as video, creating
+ * the layer in which the video will be played and sending the "video"
+ * instruction and stream header.
+ *
+ * @param client
+ *     The client associated with the layer.
+ *
+ * @param socket
+ *     The socket over which the video should be sent.
+ *
+ * @param parent
+ *     The layer containing the region being streamed.
+ *
+ * @param rect
+ *     The region being streamed. The width and height of this region must be
+ *     even.
+ *
+ * @param bitrate
+ *     The target bitrate of the video, in bits per second.
+ *
+ * @return
+ *     A newly-allocated guac_common_video, or NULL if the video could not be
+ *     created, in which case nothing will have been sent.
+ */
+guac_common_video* guac_common_video_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* parent,
+        const guac_common_rect* rect, int bitrate);
+
+/**
+ * Returns the region being streamed by the given video.
+ *
+ * @param video
+ *     The video to query.
+ *
+ * @return
+ *     The region being streamed.
+ */
+const guac_common_rect* guac_common_video_get_rect(
+        const guac_common_video* video);
+
+/**
+ * Encodes and sends a new frame of the given video.
+ *
+ * @param video
+ *     The video to which the frame should be added.
+ *
+ * @param buffer
+ *     The ARGB image data of the frame, beginning at the upper-left corner of
+ *     the region being streamed. The image must be at least as large as that
+ *     region.
+ *
+ * @param stride
+ *     The number of bytes in each row of the image data.
+ *
+ * @param timestamp
+ *     The time at which the frame was rendered.
+ *
+ * @return
+ *     Zero if the frame was encoded successfully, non-zero otherwise.
+ */
+int guac_common_video_write_frame(guac_common_video* video,
+        const unsigned char* buffer, int stride, guac_timestamp timestamp);
+
+/**
+ * Ends the given video, sending any remaining encoded data, ending its
+ * stream, and disposing of the layer in which it was played. The contents
+ * of the region which was streamed must be resent to the parent layer, as
+ * that layer was not updated while the video played.
+ *
+ * @param video
+ *     The video to free.
+ */
+void guac_common_video_free(guac_common_video* video);
+
+#endif
+
@@ -206,6 +206,28 @@ void guac_common_display_set_lossless(guac_common_display* display,
 
 }
 
+void guac_common_display_set_video(guac_common_display* display, int video) {
+
+    pthread_mutex_lock(&display->_lock);
+
+    /* Update video setting to be applied to all newly-allocated layers */
+    display->video = video;
+
+    /* Update all allocated layers (buffers are never visible, and thus are
+     * never streamed) */
+    guac_common_display_layer* current = display->layers;
+    while (current != NULL) {
+        guac_common_surface_set_video(current->surface, video);
+        current = current->next;
+    }
+
+    /* Update default display layer (not included within layers list) */
+    guac_common_surface_set_video(display->default_surface, video);
+
+    pthread_mutex_unlock(&display->_lock);
+
+}
+
 void guac_common_display_flush(guac_common_display* display) {
 
     pthread_mutex_lock(&display->_lock);
@@ -311,8 +333,9 @@ guac_common_display_layer* guac_common_display_alloc_layer(
     guac_common_surface* surface = guac_common_surface_alloc(display->client,
             display->client->socket, layer, width, height);
 
-    /* Apply current display losslessness */
+    /* Apply current display losslessness and video policy */
     guac_common_surface_set_lossless(surface, display->lossless);
+    guac_common_surface_set_video(surface, display->video);
 
     /* Add layer and surface to list */
     guac_common_display_layer* display_layer =
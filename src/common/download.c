@@ -0,0 +1,302 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/download.h"
+
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <stdlib.h>
+
+/**
+ * The state of a download started with guac_common_download_begin().
+ */
+typedef struct guac_common_download {
+
+    /**
+     * Flow control state for the blobs sent.
+     */
+    guac_common_download_window window;
+
+    /**
+     * The handler which reads data to be sent.
+     */
+    guac_common_download_read_handler* read_handler;
+
+    /**
+     * The handler to invoke once the download has ended.
+     */
+    guac_common_download_end_handler* end_handler;
+
+    /**
+     * Arbitrary data to pass to the read and end handlers.
+     */
+    void* data;
+
+    /**
+     * Data read from the source but not yet sent.
+     */
+    char buffer[GUAC_COMMON_DOWNLOAD_READ_SIZE];
+
+    /**
+     * The offset within buffer of the first byte not yet sent.
+     */
+    int offset;
+
+    /**
+     * The number of bytes of buffer which contain data read from the source.
+     */
+    int length;
+
+    /**
+     * Non-zero if the end of the source has been reached.
+     */
+    int eof;
+
+} guac_common_download;
+
+void guac_common_download_window_init(guac_common_download_window* window,
+        int max_size) {
+
+    if (max_size > GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT)
+        max_size = GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT;
+    else if (max_size < 1)
+        max_size = 1;
+
+    window->max_size = max_size;
+    window->size = GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW;
+    if (window->size > max_size)
+        window->size = max_size;
+
+    window->in_flight = 0;
+    window->oldest = 0;
+    window->min_rtt = -1;
+    window->last_reduce = -1;
+
+}
+
+int guac_common_download_window_available(
+        const guac_common_download_window* window) {
+
+    int available = window->size - window->in_flight;
+    return available > 0 ? available : 0;
+
+}
+
+void guac_common_download_window_sent(guac_common_download_window* window,
+        guac_timestamp now) {
+
+    /* The window never allows more blobs than can be tracked */
+    if (window->in_flight >= GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT)
+        return;
+
+    int index = (window->oldest + window->in_flight)
+              % GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT;
+
+    window->sent[index] = now;
+    window->in_flight++;
+
+}
+
+int guac_common_download_window_acked(guac_common_download_window* window,
+        guac_timestamp now) {
+
+    /* Ignore acknowledgements which do not correspond to blobs (such as the
+     * acknowledgement of the stream itself) */
+    if (window->in_flight == 0)
+        return -1;
+
+    guac_timestamp sent = window->sent[window->oldest];
+    int rtt = now - sent;
+    if (rtt < 0)
+        rtt = 0;
+
+    window->oldest = (window->oldest + 1) % GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT;
+    window->in_flight--;
+
+    if (window->min_rtt < 0 || rtt < window->min_rtt)
+        window->min_rtt = rtt;
+
+    /* Grow window while blobs are not being queued along the way */
+    if (rtt <= window->min_rtt * 2 + GUAC_COMMON_DOWNLOAD_RTT_SLACK) {
+        if (window->size < window->max_size)
+            window->size++;
+    }
+
+    /* Otherwise, halve window, ignoring blobs sent before the window was
+     * last reduced */
+    else if (sent > window->last_reduce) {
+        window->size /= 2;
+        if (window->size < 1)
+            window->size = 1;
+        window->last_reduce = now;
+    }
+
+    return rtt;
+
+}
+
+/**
+ * Ends the given download, freeing the stream, invoking the end handler, and
+ * freeing the download itself.
+ *
+ * @param user
+ *     The user receiving the download.
+ *
+ * @param stream
+ *     The stream over which the download was sent.
+ *
+ * @param download
+ *     The download to end.
+ *
+ * @param success
+ *     Non-zero if all data was sent and acknowledged, zero otherwise.
+ */
+static void guac_common_download_end(guac_user* user, guac_stream* stream,
+        guac_common_download* download, int success) {
+
+    guac_user_free_stream(user, stream);
+    download->end_handler(user, download->data, success);
+    free(download);
+
+}
+
+/**
+ * Handler for ack messages which continue a download started with
+ * guac_common_download_begin(), sending as many blobs as the window allows.
+ *
+ * @param user
+ *     The user receiving the ack message.
+ *
+ * @param stream
+ *     The stream associated with the received ack message.
+ *
+ * @param message
+ *     An arbitrary human-readable message describing the nature of the
+ *     success or failure denoted by the ack message.
+ *
+ * @param status
+ *     The status code associated with the ack message, which may indicate
+ *     success or an error.
+ *
+ * @return
+ *     Always zero.
+ */
+static int guac_common_download_ack_handler(guac_user* user,
+        guac_stream* stream, char* message, guac_protocol_status status) {
+
+    guac_common_download* download = (guac_common_download*) stream->data;
+
+    /* Abort if the user has rejected the stream */
+    if (status != GUAC_PROTOCOL_STATUS_SUCCESS) {
+        guac_user_log(user, GUAC_LOG_DEBUG, "Download rejected: %s",
+                message);
+        guac_common_download_end(user, stream, download, 0);
+        return 0;
+    }
+
+    guac_common_download_window* window = &download->window;
+    guac_timestamp now = guac_timestamp_current();
+    guac_common_download_window_acked(window, now);
+
+    /* Send as many blobs as the window allows */
+    while (guac_common_download_window_available(window) > 0) {
+
+        /* Read ahead once all previously-read data has been sent */
+        if (download->offset == download->length) {
+
+            if (download->eof)
+                break;
+
+            int bytes_read = download->read_handler(user, download->data,
+                    download->buffer, sizeof(download->buffer));
+
+            if (bytes_read < 0) {
+                guac_user_log(user, GUAC_LOG_INFO, "Error reading file "
+                        "for download");
+                guac_protocol_send_end(user->socket, stream);
+                guac_socket_flush(user->socket);
+                guac_common_download_end(user, stream, download, 0);
+                return 0;
+            }
+
+            if (bytes_read == 0) {
+                download->eof = 1;
+                break;
+            }
+
+            download->offset = 0;
+            download->length = bytes_read;
+
+        }
+
+        int length = download->length - download->offset;
+        if (length > GUAC_PROTOCOL_BLOB_MAX_LENGTH)
+            length = GUAC_PROTOCOL_BLOB_MAX_LENGTH;
+
+        guac_protocol_send_blob(user->socket, stream,
+                download->buffer + download->offset, length);
+
+        guac_common_download_window_sent(window, now);
+        download->offset += length;
+
+    }
+
+    /* End stream only once all blobs are acknowledged, as the stream index
+     * may be reused as soon as the stream is freed */
+    if (download->eof && window->in_flight == 0) {
+        guac_user_log(user, GUAC_LOG_DEBUG, "File sent");
+        guac_protocol_send_end(user->socket, stream);
+        guac_socket_flush(user->socket);
+        guac_common_download_end(user, stream, download, 1);
+        return 0;
+    }
+
+    guac_socket_flush(user->socket);
+    return 0;
+
+}
+
+int guac_common_download_begin(guac_user* user, guac_stream* stream,
+        int max_window, guac_common_download_read_handler* read_handler,
+        guac_common_download_end_handler* end_handler, void* data) {
+
+    guac_common_download* download = malloc(sizeof(guac_common_download));
+    if (download == NULL)
+        return 1;
+
+    guac_common_download_window_init(&download->window, max_window);
+    download->read_handler = read_handler;
+    download->end_handler = end_handler;
+    download->data = data;
+    download->offset = 0;
+    download->length = 0;
+    download->eof = 0;
+
+    stream->ack_handler = guac_common_download_ack_handler;
+    stream->data = download;
+
+    return 0;
+
+}
+
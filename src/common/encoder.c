@@ -0,0 +1,197 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/encoder.h"
+
+#include <guacamole/timestamp.h>
+
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The weight of each new measurement within the moving averages of
+ * guac_common_encoder_cost, as the denominator of a fraction (new
+ * measurements contribute 1/GUAC_COMMON_ENCODER_COST_WEIGHT).
+ */
+#define GUAC_COMMON_ENCODER_COST_WEIGHT 4
+
+/**
+ * Default costs, indexed by guac_common_encoder. These are rough values
+ * measured for typical desktop content, and are replaced by real
+ * measurements as soon as any are available.
+ */
+static const guac_common_encoder_cost GUAC_COMMON_ENCODER_DEFAULT_COSTS[] = {
+    [GUAC_COMMON_ENCODER_PNG]  = { .bytes_per_kpixel = 2048, .usec_per_kpixel = 60 },
+    [GUAC_COMMON_ENCODER_JPEG] = { .bytes_per_kpixel = 400,  .usec_per_kpixel = 12 },
+    [GUAC_COMMON_ENCODER_WEBP] = { .bytes_per_kpixel = 300,  .usec_per_kpixel = 40 }
+};
+
+const guac_common_encoder_cost* guac_common_encoder_default_cost(
+        guac_common_encoder encoder) {
+    return &GUAC_COMMON_ENCODER_DEFAULT_COSTS[encoder];
+}
+
+/**
+ * Updates the given moving average with a new measurement. Averages are
+ * never zero once a measurement has been recorded, as zero denotes the lack
+ * of any measurement.
+ *
+ * @param average
+ *     The moving average to update.
+ *
+ * @param value
+ *     The new measurement, which need not be within the range of an int.
+ */
+static void guac_common_encoder_average(int* average, int64_t value) {
+
+    if (value > INT_MAX)
+        value = INT_MAX;
+    else if (value < 1)
+        value = 1;
+
+    /* First measurement is taken as-is */
+    if (*average == 0)
+        *average = value;
+
+    else
+        *average += (value - *average) / GUAC_COMMON_ENCODER_COST_WEIGHT;
+
+}
+
+void guac_common_encoder_cost_record(guac_common_encoder_cost* cost,
+        int pixels, uint64_t bytes, int64_t usec) {
+
+    if (pixels <= 0)
+        return;
+
+    guac_common_encoder_average(&cost->bytes_per_kpixel,
+            (int64_t) bytes * 1024 / pixels);
+
+    guac_common_encoder_average(&cost->usec_per_kpixel,
+            usec * 1024 / pixels);
+
+}
+
+int64_t guac_common_encoder_cost_estimate_transfer(
+        const guac_common_encoder_cost* cost,
+        const guac_common_bandwidth* bandwidth, int pixels) {
+
+    /* Transfer time is negligible unless bandwidth is constrained */
+    if (bandwidth->bytes_per_second <= 0)
+        return 0;
+
+    int64_t bytes = (int64_t) cost->bytes_per_kpixel * pixels / 1024;
+    return bytes * 1000000 / bandwidth->bytes_per_second;
+
+}
+
+int64_t guac_common_encoder_cost_estimate(const guac_common_encoder_cost* cost,
+        const guac_common_bandwidth* bandwidth, int pixels) {
+
+    int64_t encode = (int64_t) cost->usec_per_kpixel * pixels / 1024;
+    return encode + guac_common_encoder_cost_estimate_transfer(cost,
+            bandwidth, pixels);
+
+}
+
+int64_t guac_common_encoder_clock() {
+
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0)
+        return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+
+    return (int64_t) guac_timestamp_current() * 1000;
+
+}
+
+void guac_common_bandwidth_init(guac_common_bandwidth* bandwidth,
+        guac_timestamp now, uint64_t bytes) {
+
+    bandwidth->bytes_per_second = 0;
+    bandwidth->min_lag = -1;
+    bandwidth->sample_start = now;
+    bandwidth->sample_bytes = bytes;
+
+}
+
+void guac_common_bandwidth_update(guac_common_bandwidth* bandwidth,
+        guac_timestamp now, uint64_t bytes, int lag) {
+
+    /* Track the lowest lag seen, approximating round trip time */
+    if (bandwidth->min_lag < 0 || lag < bandwidth->min_lag)
+        bandwidth->min_lag = lag;
+
+    /* Wait until the current sample interval is complete */
+    guac_timestamp elapsed = now - bandwidth->sample_start;
+    if (elapsed < GUAC_COMMON_BANDWIDTH_SAMPLE_INTERVAL)
+        return;
+
+    uint64_t sent = bytes - bandwidth->sample_bytes;
+    int64_t throughput = (int64_t) (sent * 1000 / elapsed);
+    if (throughput > INT_MAX)
+        throughput = INT_MAX;
+
+    /* If the client is falling behind, the data actually sent is all the
+     * connection can handle */
+    if (lag - bandwidth->min_lag >= GUAC_COMMON_BANDWIDTH_SATURATED_LAG) {
+
+        if (sent >= GUAC_COMMON_BANDWIDTH_MIN_SAMPLE_BYTES) {
+
+            if (bandwidth->bytes_per_second == 0)
+                bandwidth->bytes_per_second = throughput;
+            else
+                bandwidth->bytes_per_second +=
+                    (throughput - bandwidth->bytes_per_second) / 2;
+
+            if (bandwidth->bytes_per_second < 1)
+                bandwidth->bytes_per_second = 1;
+
+        }
+
+    }
+
+    /* Otherwise, the connection can handle at least what was sent, and
+     * possibly more, so probe upwards */
+    else if (bandwidth->bytes_per_second != 0) {
+
+        int64_t probe = (int64_t) bandwidth->bytes_per_second
+                      + bandwidth->bytes_per_second / 4 + 1;
+
+        if (throughput > probe)
+            probe = throughput;
+
+        /* Consider the connection unconstrained once again if the estimate
+         * becomes sufficiently large */
+        if (probe >= GUAC_COMMON_BANDWIDTH_UNCONSTRAINED)
+            probe = 0;
+
+        bandwidth->bytes_per_second = probe;
+
+    }
+
+    /* Begin next sample interval */
+    bandwidth->sample_start = now;
+    bandwidth->sample_bytes = bytes;
+
+}
+
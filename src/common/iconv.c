@@ -22,6 +22,7 @@
 
 #include <guacamole/unicode.h>
 #include <stdint.h>
+#include <string.h>
 
 /**
  * Lookup table for Unicode code points, indexed by CP-1252 codepoint.
@@ -61,23 +62,309 @@ const static int __GUAC_RDP_CP1252_CODEPOINT[32] = {
     0x0178, /* 0x9F */
 };
 
+/**
+ * Returns the number of bytes used by each character of the given reader if
+ * the ASCII characters it reads can be copied verbatim by
+ * guac_iconv_ascii(), or zero if every character must be read individually.
+ *
+ * @param reader
+ *     The reader to test.
+ *
+ * @param normalized
+ *     Set to non-zero if the given reader normalizes newline sequences, such
+ *     that carriage returns must be read individually, or zero otherwise.
+ *
+ * @return
+ *     The number of bytes in each ASCII character read by the given reader
+ *     (1 or 2), or zero if the reader is not supported by guac_iconv_ascii().
+ */
+static int guac_iconv_reader_width(guac_iconv_read* reader, int* normalized) {
+
+    *normalized = (reader == GUAC_READ_UTF8_NORMALIZED
+                || reader == GUAC_READ_CP1252_NORMALIZED
+                || reader == GUAC_READ_ISO8859_1_NORMALIZED
+                || reader == GUAC_READ_UTF16_NORMALIZED);
+
+    if (reader == GUAC_READ_UTF8 || reader == GUAC_READ_UTF8_NORMALIZED
+            || reader == GUAC_READ_CP1252
+            || reader == GUAC_READ_CP1252_NORMALIZED
+            || reader == GUAC_READ_ISO8859_1
+            || reader == GUAC_READ_ISO8859_1_NORMALIZED)
+        return 1;
+
+    if (reader == GUAC_READ_UTF16 || reader == GUAC_READ_UTF16_NORMALIZED)
+        return 2;
+
+    return 0;
+
+}
+
+/**
+ * Returns the number of bytes used by each character of the given writer if
+ * ASCII characters can be copied verbatim by guac_iconv_ascii(), or zero if
+ * every character must be written individually.
+ *
+ * @param writer
+ *     The writer to test.
+ *
+ * @param crlf
+ *     Set to non-zero if the given writer translates newline characters, such
+ *     that newline characters must be written individually, or zero
+ *     otherwise.
+ *
+ * @return
+ *     The number of bytes in each ASCII character written by the given writer
+ *     (1 or 2), or zero if the writer is not supported by guac_iconv_ascii().
+ */
+static int guac_iconv_writer_width(guac_iconv_write* writer, int* crlf) {
+
+    *crlf = (writer == GUAC_WRITE_UTF8_CRLF
+          || writer == GUAC_WRITE_CP1252_CRLF
+          || writer == GUAC_WRITE_ISO8859_1_CRLF
+          || writer == GUAC_WRITE_UTF16_CRLF);
+
+    if (writer == GUAC_WRITE_UTF8 || writer == GUAC_WRITE_UTF8_CRLF
+            || writer == GUAC_WRITE_CP1252 || writer == GUAC_WRITE_CP1252_CRLF
+            || writer == GUAC_WRITE_ISO8859_1
+            || writer == GUAC_WRITE_ISO8859_1_CRLF)
+        return 1;
+
+    if (writer == GUAC_WRITE_UTF16 || writer == GUAC_WRITE_UTF16_CRLF)
+        return 2;
+
+    return 0;
+
+}
+
+/**
+ * Returns non-zero if any byte within the given 64-bit word is equal to the
+ * given value.
+ *
+ * @param word
+ *     The word to test.
+ *
+ * @param value
+ *     The byte value to search for.
+ *
+ * @return
+ *     Non-zero if any byte of the given word is equal to the given value,
+ *     zero otherwise.
+ */
+static uint64_t guac_iconv_has_byte(uint64_t word, unsigned char value) {
+    uint64_t test = word ^ (0x0101010101010101ULL * value);
+    return (test - 0x0101010101010101ULL) & ~test & 0x8080808080808080ULL;
+}
+
+/**
+ * Returns whether the given character may be copied verbatim by
+ * guac_iconv_ascii(). Only non-null ASCII characters may be copied, excluding
+ * carriage returns if newline sequences are being normalized and newline
+ * characters if newline characters are being translated.
+ *
+ * @param value
+ *     The character to test.
+ *
+ * @param normalized
+ *     Non-zero if carriage returns must be read individually.
+ *
+ * @param crlf
+ *     Non-zero if newline characters must be written individually.
+ *
+ * @return
+ *     Non-zero if the given character may be copied verbatim, zero otherwise.
+ */
+static int guac_iconv_is_plain(unsigned int value, int normalized, int crlf) {
+    return value != 0 && value < 0x80
+        && !(normalized && value == '\r')
+        && !(crlf && value == '\n');
+}
+
+/**
+ * Returns the number of leading single-byte characters within the given
+ * input which may be copied verbatim by guac_iconv_ascii(). Input is tested
+ * eight bytes at a time until a word containing any other character is
+ * encountered.
+ *
+ * @param input
+ *     The input to scan.
+ *
+ * @param length
+ *     The number of characters within the input.
+ *
+ * @param normalized
+ *     Non-zero if carriage returns must be read individually.
+ *
+ * @param crlf
+ *     Non-zero if newline characters must be written individually.
+ *
+ * @return
+ *     The number of leading characters which may be copied verbatim.
+ */
+static int guac_iconv_ascii_span(const unsigned char* input, int length,
+        int normalized, int crlf) {
+
+    int count = 0;
+
+    /* Skip whole words containing only plain characters */
+    while (length - count >= 8) {
+
+        uint64_t word;
+        memcpy(&word, input + count, sizeof(word));
+
+        if ((word & 0x8080808080808080ULL)
+                || guac_iconv_has_byte(word, 0)
+                || (normalized && guac_iconv_has_byte(word, '\r'))
+                || (crlf && guac_iconv_has_byte(word, '\n')))
+            break;
+
+        count += 8;
+
+    }
+
+    /* Locate first character which cannot be copied */
+    while (count < length
+            && guac_iconv_is_plain(input[count], normalized, crlf))
+        count++;
+
+    return count;
+
+}
+
+/**
+ * Copies as many leading ASCII characters as possible from the given input to
+ * the given output, widening or narrowing each character if the input and
+ * output encodings differ in width, and stopping at the first character that
+ * guac_iconv_is_plain() does not accept. ASCII characters are represented
+ * identically by every encoding supported by guac_iconv(), such that runs of
+ * these characters need not be read and written individually.
+ *
+ * @param input
+ *     Pointer to the location within the input buffer of the first character
+ *     to copy. This pointer is advanced past all characters copied.
+ *
+ * @param in_remaining
+ *     The number of bytes remaining in the input buffer.
+ *
+ * @param in_width
+ *     The number of bytes in each ASCII character of the input encoding.
+ *
+ * @param output
+ *     Pointer to the location within the output buffer that the first
+ *     character should be written. This pointer is advanced past all
+ *     characters written.
+ *
+ * @param out_remaining
+ *     The number of bytes remaining in the output buffer.
+ *
+ * @param out_width
+ *     The number of bytes in each ASCII character of the output encoding.
+ *
+ * @param normalized
+ *     Non-zero if carriage returns must be read individually.
+ *
+ * @param crlf
+ *     Non-zero if newline characters must be written individually.
+ *
+ * @return
+ *     The number of characters copied.
+ */
+static int guac_iconv_ascii(const char** input, int in_remaining,
+        int in_width, char** output, int out_remaining, int out_width,
+        int normalized, int crlf) {
+
+    int length = in_remaining / in_width;
+    if (length > out_remaining / out_width)
+        length = out_remaining / out_width;
+
+    const unsigned char* in = (const unsigned char*) *input;
+    unsigned char* out = (unsigned char*) *output;
+    int count = 0;
+
+    /* Single-byte input, copied verbatim or widened to UTF-16 */
+    if (in_width == 1) {
+
+        count = guac_iconv_ascii_span(in, length, normalized, crlf);
+
+        if (out_width == 1)
+            memcpy(out, in, count);
+
+        else {
+            for (int i = 0; i < count; i++) {
+                uint16_t value = in[i];
+                memcpy(out + i * 2, &value, sizeof(value));
+            }
+        }
+
+    }
+
+    /* UTF-16 input, copied verbatim or narrowed to single bytes */
+    else {
+
+        for (; count < length; count++) {
+
+            uint16_t value;
+            memcpy(&value, in + count * 2, sizeof(value));
+            if (!guac_iconv_is_plain(value, normalized, crlf))
+                break;
+
+            if (out_width == 1)
+                out[count] = (unsigned char) value;
+            else
+                memcpy(out + count * 2, &value, sizeof(value));
+
+        }
+
+    }
+
+    *input += count * in_width;
+    *output += count * out_width;
+    return count;
+
+}
+
 int guac_iconv(guac_iconv_read* reader, const char** input, int in_remaining,
                guac_iconv_write* writer, char** output, int out_remaining) {
 
+    /* Copy runs of ASCII characters directly where both encodings allow */
+    int normalized, crlf;
+    int in_width = guac_iconv_reader_width(reader, &normalized);
+    int out_width = guac_iconv_writer_width(writer, &crlf);
+
     while (in_remaining > 0 && out_remaining > 0) {
 
         int value;
         const char* read_start;
         char* write_start;
 
-        /* Read character */
+        if (in_width && out_width) {
+
+            int copied = guac_iconv_ascii(input, in_remaining, in_width,
+                    output, out_remaining, out_width, normalized, crlf);
+
+            in_remaining -= copied * in_width;
+            out_remaining -= copied * out_width;
+
+            if (in_remaining <= 0 || out_remaining <= 0)
+                break;
+
+        }
+
+        /* Read character, stopping if only part of a character remains */
         read_start = *input;
         value = reader(input, in_remaining);
+        if (*input == read_start)
+            break;
+
         in_remaining -= *input - read_start;
 
-        /* Write character */
+        /* Write character, leaving it unread if it does not fit */
         write_start = *output;
         writer(output, out_remaining, value);
+        if (*output == write_start) {
+            *input = read_start;
+            break;
+        }
+
         out_remaining -= *output - write_start;
 
         /* Stop if null terminator reached */
@@ -93,7 +380,7 @@ int guac_iconv(guac_iconv_read* reader, const char** input, int in_remaining,
 
 int GUAC_READ_UTF8(const char** input, int remaining) {
 
-    int value;
+    int value = 0;
 
     *input += guac_utf8_read(*input, remaining, &value);
     return value;
@@ -283,9 +570,14 @@ static void guac_iconv_write_crlf(guac_iconv_write* writer, char** output,
     writer(output, remaining, '\r');
 
     remaining -= *output - output_start;
+    char* newline_start = *output;
     if (remaining > 0)
         writer(output, remaining, '\n');
 
+    /* Write nothing unless the entire CRLF sequence fits */
+    if (*output == newline_start)
+        *output = output_start;
+
 }
 
 void GUAC_WRITE_UTF8_CRLF(char** output, int remaining, int value) {
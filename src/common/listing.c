@@ -0,0 +1,613 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/download.h"
+#include "common/listing.h"
+
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A single directory listing stored within a guac_common_listing_cache.
+ */
+typedef struct guac_common_listing_cache_entry {
+
+    /**
+     * The absolute path of the directory, without any trailing separators, or
+     * NULL if this entry is unused.
+     */
+    char* path;
+
+    /**
+     * The cached listing of the directory.
+     */
+    guac_common_listing* listing;
+
+    /**
+     * The time that the listing was cached.
+     */
+    guac_timestamp cached;
+
+} guac_common_listing_cache_entry;
+
+struct guac_common_listing_cache {
+
+    /**
+     * Lock which is acquired whenever the cache is read or modified.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * All cached directory listings.
+     */
+    guac_common_listing_cache_entry entries[GUAC_COMMON_LISTING_CACHE_SIZE];
+
+};
+
+/**
+ * The current state of a directory listing being sent with
+ * guac_common_listing_send().
+ */
+typedef struct guac_common_listing_transfer {
+
+    /**
+     * The directory listing being sent.
+     */
+    guac_common_listing* listing;
+
+    /**
+     * The offset within the JSON of the listing of the first byte not yet
+     * read for sending.
+     */
+    int offset;
+
+    /**
+     * Non-zero if the listing is complete, zero if entries of the directory
+     * remain to be read.
+     */
+    int complete;
+
+    /**
+     * The handler which reads each remaining entry of the directory, or NULL
+     * if the listing was already complete when sending began.
+     */
+    guac_common_listing_entry_handler* entry_handler;
+
+    /**
+     * The handler to invoke once the listing has ended, or NULL if the
+     * listing was already complete when sending began.
+     */
+    guac_common_listing_free_handler* free_handler;
+
+    /**
+     * The arbitrary data to pass to entry_handler and free_handler.
+     */
+    void* data;
+
+    /**
+     * The cache which should receive the listing once complete, or NULL if
+     * the listing should not be cached.
+     */
+    guac_common_listing_cache* cache;
+
+    /**
+     * The absolute path of the directory being listed, or NULL if the
+     * listing should not be cached.
+     */
+    char* path;
+
+} guac_common_listing_transfer;
+
+/**
+ * Appends the given data to the JSON of the given directory listing,
+ * expanding the buffer as necessary.
+ *
+ * @param listing
+ *     The directory listing to append to.
+ *
+ * @param buffer
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes to append.
+ */
+static void guac_common_listing_append(guac_common_listing* listing,
+        const char* buffer, int length) {
+
+    /* Expand buffer as necessary */
+    if (listing->length + length > listing->size) {
+
+        int size = listing->size * 2;
+        while (listing->length + length > size)
+            size *= 2;
+
+        listing->json = realloc(listing->json, size);
+        listing->size = size;
+
+    }
+
+    memcpy(listing->json + listing->length, buffer, length);
+    listing->length += length;
+
+}
+
+/**
+ * Appends the given string to the JSON of the given directory listing as a
+ * JSON string, including starting and ending quotes and escaping quotes and
+ * backslashes.
+ *
+ * @param listing
+ *     The directory listing to append to.
+ *
+ * @param str
+ *     The string to append.
+ */
+static void guac_common_listing_append_string(guac_common_listing* listing,
+        const char* str) {
+
+    guac_common_listing_append(listing, "\"", 1);
+
+    const char* current = str;
+    for (; *current != '\0'; current++) {
+
+        /* Escape all quotes and back-slashes */
+        if (*current == '"' || *current == '\\') {
+            guac_common_listing_append(listing, str, current - str);
+            guac_common_listing_append(listing, "\\", 1);
+            str = current;
+        }
+
+    }
+
+    guac_common_listing_append(listing, str, current - str);
+    guac_common_listing_append(listing, "\"", 1);
+
+}
+
+guac_common_listing* guac_common_listing_alloc() {
+
+    guac_common_listing* listing = malloc(sizeof(guac_common_listing));
+    listing->json = malloc(GUAC_COMMON_LISTING_INITIAL_SIZE);
+    listing->size = GUAC_COMMON_LISTING_INITIAL_SIZE;
+    listing->length = 0;
+    listing->entries = 0;
+
+    guac_common_listing_append(listing, "{", 1);
+    return listing;
+
+}
+
+void guac_common_listing_add(guac_common_listing* listing, const char* path,
+        const char* mimetype) {
+
+    /* Write leading comma if not first property */
+    if (listing->entries != 0)
+        guac_common_listing_append(listing, ",", 1);
+
+    guac_common_listing_append_string(listing, path);
+    guac_common_listing_append(listing, ":", 1);
+    guac_common_listing_append_string(listing, mimetype);
+
+    listing->entries++;
+
+}
+
+void guac_common_listing_end(guac_common_listing* listing) {
+    guac_common_listing_append(listing, "}", 1);
+}
+
+void guac_common_listing_free(guac_common_listing* listing) {
+    free(listing->json);
+    free(listing);
+}
+
+/**
+ * Returns a newly-allocated copy of the given directory listing.
+ *
+ * @param listing
+ *     The directory listing to copy.
+ *
+ * @return
+ *     A newly-allocated copy of the given directory listing, which must
+ *     eventually be freed with guac_common_listing_free().
+ */
+static guac_common_listing* guac_common_listing_copy(
+        const guac_common_listing* listing) {
+
+    guac_common_listing* copy = malloc(sizeof(guac_common_listing));
+    copy->json = malloc(listing->size);
+    copy->size = listing->size;
+    copy->length = listing->length;
+    copy->entries = listing->entries;
+
+    memcpy(copy->json, listing->json, listing->length);
+    return copy;
+
+}
+
+/**
+ * Download read handler which reads the JSON of the directory listing being
+ * sent, first reading further entries of the directory being listed until
+ * enough JSON is available or the directory has been read in full.
+ *
+ * @param user
+ *     The user receiving the directory listing.
+ *
+ * @param data
+ *     The guac_common_listing_transfer of the directory listing being sent.
+ *
+ * @param buffer
+ *     The buffer into which the JSON should be read.
+ *
+ * @param length
+ *     The maximum number of bytes to read.
+ *
+ * @return
+ *     The number of bytes read, or zero if the entire listing has been read.
+ */
+static int guac_common_listing_read_handler(guac_user* user, void* data,
+        char* buffer, int length) {
+
+    guac_common_listing_transfer* transfer =
+        (guac_common_listing_transfer*) data;
+
+    guac_common_listing* listing = transfer->listing;
+
+    /* Read only as many entries as are needed to fill the blob */
+    while (!transfer->complete && listing->length - transfer->offset < length) {
+
+        if (transfer->entry_handler(user, transfer->data, listing))
+            continue;
+
+        guac_common_listing_end(listing);
+        transfer->complete = 1;
+
+        /* Cache the listing now that the entire directory has been read */
+        if (transfer->cache != NULL)
+            guac_common_listing_cache_put(transfer->cache, transfer->path,
+                    listing, guac_timestamp_current());
+
+    }
+
+    int remaining = listing->length - transfer->offset;
+    if (length > remaining)
+        length = remaining;
+
+    memcpy(buffer, listing->json + transfer->offset, length);
+    transfer->offset += length;
+
+    return length;
+
+}
+
+/**
+ * Download end handler which frees the directory listing that was sent,
+ * invoking the free handler of the directory being listed, if any.
+ *
+ * @param user
+ *     The user that was receiving the directory listing.
+ *
+ * @param data
+ *     The guac_common_listing_transfer of the directory listing that was
+ *     sent.
+ *
+ * @param success
+ *     Non-zero if the entire listing was sent, zero otherwise.
+ */
+static void guac_common_listing_end_handler(guac_user* user, void* data,
+        int success) {
+
+    guac_common_listing_transfer* transfer =
+        (guac_common_listing_transfer*) data;
+
+    if (transfer->free_handler != NULL)
+        transfer->free_handler(user, transfer->data);
+
+    guac_common_listing_free(transfer->listing);
+    free(transfer->path);
+    free(transfer);
+
+}
+
+int guac_common_listing_send(guac_user* user, guac_stream* stream,
+        guac_common_listing* listing) {
+
+    guac_common_listing_transfer* transfer =
+        malloc(sizeof(guac_common_listing_transfer));
+
+    transfer->listing = listing;
+    transfer->offset = 0;
+    transfer->complete = 1;
+    transfer->entry_handler = NULL;
+    transfer->free_handler = NULL;
+    transfer->data = NULL;
+    transfer->cache = NULL;
+    transfer->path = NULL;
+
+    if (guac_common_download_begin(user, stream,
+                GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW,
+                guac_common_listing_read_handler,
+                guac_common_listing_end_handler, transfer)) {
+        guac_common_listing_free(listing);
+        free(transfer);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+int guac_common_listing_stream(guac_user* user, guac_stream* stream,
+        guac_common_listing_cache* cache, const char* path,
+        guac_common_listing_entry_handler* entry_handler,
+        guac_common_listing_free_handler* free_handler, void* data) {
+
+    guac_common_listing_transfer* transfer =
+        malloc(sizeof(guac_common_listing_transfer));
+
+    transfer->listing = guac_common_listing_alloc();
+    transfer->offset = 0;
+    transfer->complete = 0;
+    transfer->entry_handler = entry_handler;
+    transfer->free_handler = free_handler;
+    transfer->data = data;
+    transfer->cache = cache;
+    transfer->path = (cache != NULL) ? strdup(path) : NULL;
+
+    if (guac_common_download_begin(user, stream,
+                GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW,
+                guac_common_listing_read_handler,
+                guac_common_listing_end_handler, transfer)) {
+        free_handler(user, data);
+        guac_common_listing_free(transfer->listing);
+        free(transfer->path);
+        free(transfer);
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Returns whether the given character is a path separator.
+ *
+ * @param c
+ *     The character to test.
+ *
+ * @return
+ *     Non-zero if the given character is "/" or "\", zero otherwise.
+ */
+static int guac_common_listing_is_separator(char c) {
+    return c == '/' || c == '\\';
+}
+
+/**
+ * Returns the length of the given path excluding any trailing separators. The
+ * root directory (a path consisting only of a separator) retains its
+ * separator.
+ *
+ * @param path
+ *     The path to measure.
+ *
+ * @return
+ *     The number of characters of the given path which identify its
+ *     directory within a guac_common_listing_cache.
+ */
+static int guac_common_listing_key_length(const char* path) {
+
+    int length = strlen(path);
+    while (length > 1 && guac_common_listing_is_separator(path[length - 1]))
+        length--;
+
+    return length;
+
+}
+
+/**
+ * Returns the cache entry for the directory having the given path, if any.
+ *
+ * IMPORTANT: The cache's lock MUST already be held when invoking this
+ * function.
+ *
+ * @param cache
+ *     The directory listing cache to search.
+ *
+ * @param path
+ *     The absolute path of the directory.
+ *
+ * @param length
+ *     The number of characters of the path to consider, as returned by
+ *     guac_common_listing_key_length().
+ *
+ * @return
+ *     The cache entry for the directory, or NULL if no listing of the
+ *     directory is cached.
+ */
+static guac_common_listing_cache_entry* guac_common_listing_cache_find(
+        guac_common_listing_cache* cache, const char* path, int length) {
+
+    for (int i = 0; i < GUAC_COMMON_LISTING_CACHE_SIZE; i++) {
+
+        guac_common_listing_cache_entry* entry = &cache->entries[i];
+        if (entry->path != NULL
+                && strncmp(entry->path, path, length) == 0
+                && entry->path[length] == '\0')
+            return entry;
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Frees the listing within the given cache entry, marking the entry as
+ * unused.
+ *
+ * IMPORTANT: The cache's lock MUST already be held when invoking this
+ * function.
+ *
+ * @param entry
+ *     The cache entry to clear.
+ */
+static void guac_common_listing_cache_clear(
+        guac_common_listing_cache_entry* entry) {
+
+    if (entry->path == NULL)
+        return;
+
+    guac_common_listing_free(entry->listing);
+    free(entry->path);
+
+    entry->path = NULL;
+    entry->listing = NULL;
+
+}
+
+guac_common_listing_cache* guac_common_listing_cache_alloc() {
+
+    guac_common_listing_cache* cache =
+        calloc(1, sizeof(guac_common_listing_cache));
+
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+
+}
+
+void guac_common_listing_cache_free(guac_common_listing_cache* cache) {
+
+    for (int i = 0; i < GUAC_COMMON_LISTING_CACHE_SIZE; i++)
+        guac_common_listing_cache_clear(&cache->entries[i]);
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+
+}
+
+guac_common_listing* guac_common_listing_cache_get(
+        guac_common_listing_cache* cache, const char* path,
+        guac_timestamp now) {
+
+    guac_common_listing* listing = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+
+    guac_common_listing_cache_entry* entry = guac_common_listing_cache_find(
+            cache, path, guac_common_listing_key_length(path));
+
+    if (entry != NULL) {
+
+        /* Copy listing only if still valid */
+        if (now - entry->cached < GUAC_COMMON_LISTING_CACHE_TTL)
+            listing = guac_common_listing_copy(entry->listing);
+
+        /* Otherwise, discard */
+        else
+            guac_common_listing_cache_clear(entry);
+
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    return listing;
+
+}
+
+void guac_common_listing_cache_put(guac_common_listing_cache* cache,
+        const char* path, const guac_common_listing* listing,
+        guac_timestamp now) {
+
+    int length = guac_common_listing_key_length(path);
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* Replace any existing listing of the same directory, otherwise the
+     * least recently cached listing (unused entries are never cached) */
+    guac_common_listing_cache_entry* entry = guac_common_listing_cache_find(
+            cache, path, length);
+
+    if (entry == NULL) {
+
+        entry = &cache->entries[0];
+        for (int i = 1; i < GUAC_COMMON_LISTING_CACHE_SIZE; i++) {
+
+            guac_common_listing_cache_entry* current = &cache->entries[i];
+            if (entry->path == NULL)
+                break;
+
+            if (current->path == NULL || current->cached < entry->cached)
+                entry = current;
+
+        }
+
+    }
+
+    guac_common_listing_cache_clear(entry);
+
+    entry->path = strndup(path, length);
+    entry->listing = guac_common_listing_copy(listing);
+    entry->cached = now;
+
+    pthread_mutex_unlock(&cache->lock);
+
+}
+
+void guac_common_listing_cache_invalidate(guac_common_listing_cache* cache,
+        const char* path) {
+
+    int length = guac_common_listing_key_length(path);
+
+    /* Locate the directory containing the given file, if any */
+    int parent_length = length - 1;
+    while (parent_length >= 0
+            && !guac_common_listing_is_separator(path[parent_length]))
+        parent_length--;
+
+    /* The parent of a file at the root is the root itself */
+    if (parent_length == 0)
+        parent_length = 1;
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* Invalidate the file itself, in case it is a directory */
+    guac_common_listing_cache_entry* entry = guac_common_listing_cache_find(
+            cache, path, length);
+
+    if (entry != NULL)
+        guac_common_listing_cache_clear(entry);
+
+    /* Invalidate the directory containing the file */
+    if (parent_length > 0) {
+
+        entry = guac_common_listing_cache_find(cache, path, parent_length);
+        if (entry != NULL)
+            guac_common_listing_cache_clear(entry);
+
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+}
+
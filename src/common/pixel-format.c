@@ -0,0 +1,517 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/pixel.h"
+#include "common/pixel-format.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * As with the row-level operations of common/pixel.h, SIMD kernels are
+ * compiled for x86 only, and are used only if supported by the processor.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GUAC_COMMON_PIXEL_FORMAT_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Function which converts a row of pixels using the given converter, having
+ * the same semantics as guac_common_pixel_convert_row().
+ */
+typedef void guac_common_pixel_convert_row_kernel(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width);
+
+struct guac_common_pixel_converter {
+
+    /**
+     * The pixel format being converted.
+     */
+    guac_common_pixel_format format;
+
+    /**
+     * The kernel selected for the pixel format.
+     */
+    guac_common_pixel_convert_row_kernel* convert_row;
+
+    /**
+     * Whether conversion is unnecessary (the pixel format is already that of
+     * CAIRO_FORMAT_RGB24).
+     */
+    int identity;
+
+    /**
+     * Lookup table containing the converted value of every possible pixel,
+     * if the pixel format is 8 or 16 bits per pixel, or NULL otherwise.
+     */
+    uint32_t* lut;
+
+    /**
+     * For 32-bit pixel formats whose components are each a full byte, the
+     * index of the source byte providing each byte of a converted pixel
+     * (blue, green, red, in that order), or 0x80 if that byte is always zero.
+     * The mask is repeated for each pixel in a 256-bit vector, as required
+     * by the SSE4.1 and AVX2 byte shuffle instructions.
+     */
+    uint8_t shuffle[32];
+
+};
+
+/**
+ * Scales a single component of the given pixel to the range 0-255.
+ *
+ * @param value
+ *     The pixel containing the component.
+ *
+ * @param shift
+ *     The number of bits the pixel must be shifted right to obtain the
+ *     component.
+ *
+ * @param max
+ *     The maximum value of the component.
+ *
+ * @return
+ *     The scaled component.
+ */
+static uint8_t guac_common_pixel_format_scale(uint32_t value, int shift,
+        int max) {
+    return (uint8_t) ((value >> shift) * 0x100 / ((uint32_t) max + 1));
+}
+
+uint32_t guac_common_pixel_format_convert(
+        const guac_common_pixel_format* format, uint32_t value) {
+
+    uint32_t red = guac_common_pixel_format_scale(value, format->red_shift,
+            format->red_max);
+
+    uint32_t green = guac_common_pixel_format_scale(value,
+            format->green_shift, format->green_max);
+
+    uint32_t blue = guac_common_pixel_format_scale(value, format->blue_shift,
+            format->blue_max);
+
+    if (format->swap_red_blue)
+        return (blue << 16) | (green << 8) | red;
+
+    return (red << 16) | (green << 8) | blue;
+
+}
+
+int guac_common_pixel_format_equals(const guac_common_pixel_format* a,
+        const guac_common_pixel_format* b) {
+    return a->bits_per_pixel == b->bits_per_pixel
+        && a->red_shift      == b->red_shift
+        && a->green_shift    == b->green_shift
+        && a->blue_shift     == b->blue_shift
+        && a->red_max        == b->red_max
+        && a->green_max      == b->green_max
+        && a->blue_max       == b->blue_max
+        && a->swap_red_blue  == b->swap_red_blue;
+}
+
+/**
+ * Converts a row of pixels of any supported format one pixel at a time using
+ * guac_common_pixel_format_convert().
+ */
+static void guac_common_pixel_convert_row_generic(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const guac_common_pixel_format* format = &converter->format;
+    int x;
+
+    switch (format->bits_per_pixel) {
+
+        case 32:
+            for (x = 0; x < width; x++)
+                dst[x] = guac_common_pixel_format_convert(format,
+                        ((const uint32_t*) src)[x]);
+            break;
+
+        case 16:
+            for (x = 0; x < width; x++)
+                dst[x] = guac_common_pixel_format_convert(format,
+                        ((const uint16_t*) src)[x]);
+            break;
+
+        default:
+            for (x = 0; x < width; x++)
+                dst[x] = guac_common_pixel_format_convert(format,
+                        ((const uint8_t*) src)[x]);
+
+    }
+
+}
+
+/**
+ * Converts a row of 8-bit pixels using the lookup table of the converter.
+ */
+static void guac_common_pixel_convert_row_lut8(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint8_t* current = (const uint8_t*) src;
+    int x;
+
+    for (x = 0; x < width; x++)
+        dst[x] = converter->lut[current[x]];
+
+}
+
+/**
+ * Converts a row of 16-bit pixels using the lookup table of the converter.
+ */
+static void guac_common_pixel_convert_row_lut16(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint16_t* current = (const uint16_t*) src;
+    int x;
+
+    for (x = 0; x < width; x++)
+        dst[x] = converter->lut[current[x]];
+
+}
+
+/**
+ * Rearranges the bytes of a single 32-bit pixel according to the given
+ * shuffle mask.
+ *
+ * @param shuffle
+ *     The shuffle mask of the converter.
+ *
+ * @param value
+ *     The pixel to convert.
+ *
+ * @return
+ *     The converted pixel.
+ */
+static inline uint32_t guac_common_pixel_shuffle_int(const uint8_t* shuffle,
+        uint32_t value) {
+
+    return ((value >> (shuffle[0] * 8)) & 0xFF)
+        | (((value >> (shuffle[1] * 8)) & 0xFF) << 8)
+        | (((value >> (shuffle[2] * 8)) & 0xFF) << 16);
+
+}
+
+/**
+ * Converts a row of 32-bit pixels whose components are each a full byte by
+ * rearranging the bytes of each pixel.
+ */
+static void guac_common_pixel_convert_row_shuffle(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint32_t* current = (const uint32_t*) src;
+    int x;
+
+    /* Copy mask locally, as stores to dst may otherwise alias the mask */
+    uint8_t shuffle[3] = {
+        converter->shuffle[0],
+        converter->shuffle[1],
+        converter->shuffle[2]
+    };
+
+    for (x = 0; x < width; x++)
+        dst[x] = guac_common_pixel_shuffle_int(shuffle, current[x]);
+
+}
+
+#ifdef GUAC_COMMON_PIXEL_FORMAT_X86
+
+/**
+ * SSE4.1 implementation of guac_common_pixel_convert_row_shuffle().
+ */
+__attribute__((target("sse4.1")))
+static void guac_common_pixel_convert_row_shuffle_sse41(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint32_t* current = (const uint32_t*) src;
+    __m128i mask = _mm_loadu_si128((const __m128i*) converter->shuffle);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (current + x));
+        _mm_storeu_si128((__m128i*) (dst + x),
+                _mm_shuffle_epi8(pixels, mask));
+    }
+
+    for (; x < width; x++)
+        dst[x] = guac_common_pixel_shuffle_int(converter->shuffle, current[x]);
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_convert_row_shuffle().
+ */
+__attribute__((target("avx2")))
+static void guac_common_pixel_convert_row_shuffle_avx2(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint32_t* current = (const uint32_t*) src;
+    __m256i mask = _mm256_loadu_si256((const __m256i*) converter->shuffle);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*) (current + x));
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                _mm256_shuffle_epi8(pixels, mask));
+    }
+
+    for (; x < width; x++)
+        dst[x] = guac_common_pixel_shuffle_int(converter->shuffle, current[x]);
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_convert_row_lut8(), looking up
+ * eight pixels at a time.
+ */
+__attribute__((target("avx2")))
+static void guac_common_pixel_convert_row_lut8_avx2(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint8_t* current = (const uint8_t*) src;
+    const int* lut = (const int*) converter->lut;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i*) (current + x)));
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                _mm256_i32gather_epi32(lut, index, 4));
+    }
+
+    for (; x < width; x++)
+        dst[x] = converter->lut[current[x]];
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_convert_row_lut16(), looking up
+ * eight pixels at a time.
+ */
+__attribute__((target("avx2")))
+static void guac_common_pixel_convert_row_lut16_avx2(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+
+    const uint16_t* current = (const uint16_t*) src;
+    const int* lut = (const int*) converter->lut;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i index = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128((const __m128i*) (current + x)));
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                _mm256_i32gather_epi32(lut, index, 4));
+    }
+
+    for (; x < width; x++)
+        dst[x] = converter->lut[current[x]];
+
+}
+
+#endif
+
+/**
+ * Returns the index of the byte containing the given component within a
+ * 32-bit pixel, if the component occupies exactly one full byte.
+ *
+ * @param shift
+ *     The number of bits the pixel must be shifted right to obtain the
+ *     component.
+ *
+ * @param max
+ *     The maximum value of the component.
+ *
+ * @return
+ *     The index of the byte containing the component, or -1 if the
+ *     component does not occupy exactly one full byte.
+ */
+static int guac_common_pixel_format_byte(int shift, int max) {
+
+    if (max != 0xFF || shift % 8 != 0 || shift > 24)
+        return -1;
+
+    return shift / 8;
+
+}
+
+/**
+ * Initializes the shuffle mask of the given converter, if the components of
+ * its pixel format each occupy exactly one full byte of a 32-bit pixel.
+ *
+ * @param converter
+ *     The converter to initialize.
+ *
+ * @return
+ *     Non-zero if the shuffle mask was initialized, zero if the pixel format
+ *     cannot be converted by rearranging bytes.
+ */
+static int guac_common_pixel_converter_init_shuffle(
+        guac_common_pixel_converter* converter) {
+
+    const guac_common_pixel_format* format = &converter->format;
+
+    if (format->bits_per_pixel != 32)
+        return 0;
+
+    int red = guac_common_pixel_format_byte(format->red_shift,
+            format->red_max);
+
+    int green = guac_common_pixel_format_byte(format->green_shift,
+            format->green_max);
+
+    int blue = guac_common_pixel_format_byte(format->blue_shift,
+            format->blue_max);
+
+    if (red < 0 || green < 0 || blue < 0)
+        return 0;
+
+    /* Source bytes of output blue, green, and red */
+    uint8_t bytes[3] = {
+        format->swap_red_blue ? red : blue,
+        green,
+        format->swap_red_blue ? blue : red
+    };
+
+    /* Byte indices are relative to the start of each 128-bit lane */
+    int i;
+    for (i = 0; i < (int) sizeof(converter->shuffle); i += 4) {
+        converter->shuffle[i]     = i % 16 + bytes[0];
+        converter->shuffle[i + 1] = i % 16 + bytes[1];
+        converter->shuffle[i + 2] = i % 16 + bytes[2];
+        converter->shuffle[i + 3] = 0x80;
+    }
+
+    converter->identity = bytes[0] == 0 && bytes[1] == 1 && bytes[2] == 2;
+    return 1;
+
+}
+
+/**
+ * Allocates and populates the lookup table of the given converter, which
+ * must convert a pixel format of 8 or 16 bits per pixel.
+ *
+ * @param converter
+ *     The converter to initialize.
+ */
+static void guac_common_pixel_converter_init_lut(
+        guac_common_pixel_converter* converter) {
+
+    uint32_t count = 1 << converter->format.bits_per_pixel;
+    converter->lut = malloc(sizeof(uint32_t) * count);
+
+    uint32_t value;
+    for (value = 0; value < count; value++)
+        converter->lut[value] = guac_common_pixel_format_convert(
+                &converter->format, value);
+
+}
+
+guac_common_pixel_converter* guac_common_pixel_converter_alloc(
+        const guac_common_pixel_format* format) {
+
+    /* Verify format is supported */
+    if (format->bits_per_pixel != 8 && format->bits_per_pixel != 16
+            && format->bits_per_pixel != 32)
+        return NULL;
+
+    if (format->red_shift < 0 || format->red_shift > 31
+            || format->green_shift < 0 || format->green_shift > 31
+            || format->blue_shift < 0 || format->blue_shift > 31)
+        return NULL;
+
+    if (format->red_max < 0 || format->green_max < 0 || format->blue_max < 0)
+        return NULL;
+
+    guac_common_pixel_converter* converter =
+        calloc(1, sizeof(guac_common_pixel_converter));
+
+    converter->format = *format;
+    converter->convert_row = guac_common_pixel_convert_row_generic;
+
+#ifdef GUAC_COMMON_PIXEL_FORMAT_X86
+    guac_common_pixel_impl impl = guac_common_pixel_get_impl();
+#endif
+
+    /* Convert small formats with a lookup table covering every pixel */
+    if (format->bits_per_pixel == 8) {
+        guac_common_pixel_converter_init_lut(converter);
+        converter->convert_row = guac_common_pixel_convert_row_lut8;
+#ifdef GUAC_COMMON_PIXEL_FORMAT_X86
+        if (impl == GUAC_COMMON_PIXEL_AVX2)
+            converter->convert_row = guac_common_pixel_convert_row_lut8_avx2;
+#endif
+    }
+
+    else if (format->bits_per_pixel == 16) {
+        guac_common_pixel_converter_init_lut(converter);
+        converter->convert_row = guac_common_pixel_convert_row_lut16;
+#ifdef GUAC_COMMON_PIXEL_FORMAT_X86
+        if (impl == GUAC_COMMON_PIXEL_AVX2)
+            converter->convert_row = guac_common_pixel_convert_row_lut16_avx2;
+#endif
+    }
+
+    /* Convert byte-aligned 32-bit formats by rearranging bytes */
+    else if (guac_common_pixel_converter_init_shuffle(converter)) {
+        converter->convert_row = guac_common_pixel_convert_row_shuffle;
+#ifdef GUAC_COMMON_PIXEL_FORMAT_X86
+        if (impl == GUAC_COMMON_PIXEL_AVX2)
+            converter->convert_row = guac_common_pixel_convert_row_shuffle_avx2;
+        else if (impl == GUAC_COMMON_PIXEL_SSE41)
+            converter->convert_row = guac_common_pixel_convert_row_shuffle_sse41;
+#endif
+    }
+
+    return converter;
+
+}
+
+void guac_common_pixel_converter_free(guac_common_pixel_converter* converter) {
+    free(converter->lut);
+    free(converter);
+}
+
+const guac_common_pixel_format* guac_common_pixel_converter_get_format(
+        const guac_common_pixel_converter* converter) {
+    return &converter->format;
+}
+
+int guac_common_pixel_converter_is_identity(
+        const guac_common_pixel_converter* converter) {
+    return converter->identity;
+}
+
+void guac_common_pixel_convert_row(
+        const guac_common_pixel_converter* converter, uint32_t* dst,
+        const void* src, int width) {
+    converter->convert_row(converter, dst, src, width);
+}
+
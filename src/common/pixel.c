@@ -0,0 +1,1194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/pixel.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * SIMD implementations are compiled for x86 only, and only with compilers
+ * which allow individual functions to target instruction set extensions not
+ * enabled for the build as a whole. Whether those extensions may actually be
+ * used is determined at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GUAC_COMMON_PIXEL_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Bitmask covering the alpha component of an ARGB pixel.
+ */
+#define GUAC_COMMON_PIXEL_ALPHA 0xFF000000
+
+/**
+ * Bitmask covering the red, green, and blue components of an ARGB pixel.
+ */
+#define GUAC_COMMON_PIXEL_RGB 0x00FFFFFF
+
+/**
+ * The set of row-level pixel operations provided by a single implementation.
+ * Each function has the same semantics as the public function of the same
+ * name, except that each must calculate the range of changed pixels itself.
+ */
+typedef struct guac_common_pixel_kernels {
+
+    /**
+     * The implementation providing these functions.
+     */
+    guac_common_pixel_impl impl;
+
+    /**
+     * Implementation of guac_common_pixel_put_row().
+     */
+    int (*put_row)(uint32_t* dst, const uint32_t* src, int width,
+            int opaque, int* first, int* last);
+
+    /**
+     * Implementation of guac_common_pixel_set_row().
+     */
+    int (*set_row)(uint32_t* dst, uint32_t color, int width,
+            int* first, int* last);
+
+    /**
+     * Implementation of guac_common_pixel_transfer_row(). The transfer
+     * function is never GUAC_TRANSFER_BINARY_DEST.
+     */
+    int (*transfer_row)(guac_transfer_function op, const uint32_t* src,
+            uint32_t* dst, int width, int backwards, int* first, int* last);
+
+    /**
+     * Implementation of guac_common_pixel_fill_mask_row().
+     */
+    void (*fill_mask_row)(uint32_t* dst, const uint32_t* mask,
+            uint32_t color, int width);
+
+} guac_common_pixel_kernels;
+
+/**
+ * Stores the given range of changed pixels in the given first/last pointers,
+ * if any pixels changed at all.
+ *
+ * @param min_x
+ *     The index of the leftmost changed pixel.
+ *
+ * @param max_x
+ *     The index of the rightmost changed pixel, or a negative value if no
+ *     pixels changed.
+ *
+ * @param first
+ *     Pointer to an int which should receive min_x if any pixels changed.
+ *
+ * @param last
+ *     Pointer to an int which should receive max_x if any pixels changed.
+ *
+ * @return
+ *     Non-zero if any pixels changed, zero otherwise.
+ */
+static int guac_common_pixel_report(int min_x, int max_x,
+        int* first, int* last) {
+
+    if (max_x < 0)
+        return 0;
+
+    *first = min_x;
+    *last = max_x;
+    return 1;
+
+}
+
+/**
+ * Expands the given range of changed pixels to include the given pixel.
+ *
+ * @param x
+ *     The index of the changed pixel.
+ *
+ * @param min_x
+ *     Pointer to the index of the leftmost changed pixel.
+ *
+ * @param max_x
+ *     Pointer to the index of the rightmost changed pixel.
+ */
+static inline void guac_common_pixel_track(int x, int* min_x, int* max_x) {
+    if (x < *min_x) *min_x = x;
+    if (x > *max_x) *max_x = x;
+}
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending the two given
+ * color components using the given alpha value.
+ *
+ * @param dst
+ *     The destination color component.
+ *
+ * @param src
+ *     The source color component.
+ *
+ * @param alpha
+ *     The alpha value which applies to the blending operation.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination components.
+ */
+static int guac_common_pixel_blend_component(int dst, int src, int alpha) {
+
+    int blended = src + dst * (0xFF - alpha);
+
+    /* Do not exceed maximum component value */
+    if (blended > 0xFF)
+        return 0xFF;
+
+    return blended;
+
+}
+
+uint32_t guac_common_pixel_blend(uint32_t dst, uint32_t src) {
+
+    /* Separate destination ARGB color into its components */
+    int dst_a = (dst >> 24) & 0xFF;
+    int dst_r = (dst >> 16) & 0xFF;
+    int dst_g = (dst >>  8) & 0xFF;
+    int dst_b =  dst        & 0xFF;
+
+    /* Separate source ARGB color into its components */
+    int src_a = (src >> 24) & 0xFF;
+    int src_r = (src >> 16) & 0xFF;
+    int src_g = (src >>  8) & 0xFF;
+    int src_b =  src        & 0xFF;
+
+    /* If source is fully opaque (or destination is fully transparent), the
+     * blended result is the source */
+    if (src_a == 0xFF || dst_a == 0x00)
+        return src;
+
+    /* If source is fully transparent, the blended result is the destination */
+    if (src_a == 0x00)
+        return dst;
+
+    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
+    int r = guac_common_pixel_blend_component(dst_r, src_r, src_a);
+    int g = guac_common_pixel_blend_component(dst_g, src_g, src_a);
+    int b = guac_common_pixel_blend_component(dst_b, src_b, src_a);
+    int a = guac_common_pixel_blend_component(dst_a, src_a, src_a);
+
+    /* Recombine blended components */
+    return (a << 24) | (r << 16) | (g << 8) | b;
+
+}
+
+/**
+ * Applies the given transfer function to a single pixel.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param src
+ *     The source pixel.
+ *
+ * @param dst
+ *     Pointer to the destination pixel, which will hold the result of the
+ *     transfer.
+ *
+ * @return
+ *     Non-zero if the destination pixel was changed, zero otherwise.
+ */
+static int guac_common_pixel_transfer_int(guac_transfer_function op,
+        uint32_t src, uint32_t* dst) {
+
+    uint32_t orig = *dst;
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            *dst = 0xFF000000;
+            break;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            *dst = 0xFFFFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            *dst = src;
+            break;
+
+        case GUAC_TRANSFER_BINARY_DEST:
+            /* NOP */
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            *dst = src ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            *dst = *dst ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_AND:
+            *dst = ((*dst) & (0xFF000000 | src));
+            break;
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            *dst = ((*dst) & (0xFF000000 | src)) ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_OR:
+            *dst = ((*dst) | (0x00FFFFFF & src));
+            break;
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            *dst = ((*dst) | (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            *dst = ((*dst) ^ (0x00FFFFFF & src));
+            break;
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            *dst = ((*dst) ^ (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            *dst = ((*dst) & (0xFF000000 | (src ^ 0x00FFFFFF)));
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            *dst = ((*dst) & (0xFF000000 | (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            *dst = ((*dst) | (0x00FFFFFF & (src ^ 0x00FFFFFF)));
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            *dst = ((*dst) | (0x00FFFFFF & (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+            break;
+
+    }
+
+    return *dst != orig;
+
+}
+
+/**
+ * Copies or blends a single pixel as defined by guac_common_pixel_put_row(),
+ * expanding the given range of changed pixels if the destination changes.
+ *
+ * @param dst
+ *     The destination row.
+ *
+ * @param src
+ *     The source row.
+ *
+ * @param x
+ *     The index of the pixel within both rows.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the source should be ignored, zero if
+ *     the source should be blended over the destination.
+ *
+ * @param min_x
+ *     Pointer to the index of the leftmost changed pixel.
+ *
+ * @param max_x
+ *     Pointer to the index of the rightmost changed pixel.
+ */
+static inline void guac_common_pixel_put_int(uint32_t* dst,
+        const uint32_t* src, int x, int opaque, int* min_x, int* max_x) {
+
+    uint32_t color;
+
+    /* Ignore alpha channel if opaque */
+    if (opaque)
+        color = src[x] | GUAC_COMMON_PIXEL_ALPHA;
+
+    /* Otherwise, perform alpha blending operation */
+    else
+        color = guac_common_pixel_blend(dst[x], src[x]);
+
+    /* If the destination color is changing, update bounds and store the new
+     * color */
+    if (dst[x] != color) {
+        guac_common_pixel_track(x, min_x, max_x);
+        dst[x] = color;
+    }
+
+}
+
+static int guac_common_pixel_put_row_scalar(uint32_t* dst,
+        const uint32_t* src, int width, int opaque, int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x < width; x++)
+        guac_common_pixel_put_int(dst, src, x, opaque, &min_x, &max_x);
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+static int guac_common_pixel_set_row_scalar(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, &min_x, &max_x);
+            dst[x] = color;
+        }
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+static int guac_common_pixel_transfer_row_scalar(guac_transfer_function op,
+        const uint32_t* src, uint32_t* dst, int width, int backwards,
+        int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    /* Transfer from right to left if requested */
+    if (backwards) {
+        for (x = width - 1; x >= 0; x--) {
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+    }
+
+    /* Otherwise, transfer from left to right */
+    else {
+        for (x = 0; x < width; x++) {
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+static void guac_common_pixel_fill_mask_row_scalar(uint32_t* dst,
+        const uint32_t* mask, uint32_t color, int width) {
+
+    int x;
+
+    /* Fill with color if opaque */
+    for (x = 0; x < width; x++) {
+        if (mask[x] & GUAC_COMMON_PIXEL_ALPHA)
+            dst[x] = color;
+    }
+
+}
+
+/**
+ * Portable, one-pixel-at-a-time implementations of all row-level pixel
+ * operations.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_scalar = {
+    .impl          = GUAC_COMMON_PIXEL_SCALAR,
+    .put_row       = guac_common_pixel_put_row_scalar,
+    .set_row       = guac_common_pixel_set_row_scalar,
+    .transfer_row  = guac_common_pixel_transfer_row_scalar,
+    .fill_mask_row = guac_common_pixel_fill_mask_row_scalar
+};
+
+#ifdef GUAC_COMMON_PIXEL_X86
+
+/**
+ * Every transfer function other than GUAC_TRANSFER_BINARY_DEST, expressed as
+ * a fixed sequence of bitwise operations such that it can be applied to many
+ * pixels at once without branching:
+ *
+ *     term   = ((src ^ src_xor) & src_and) | src_or
+ *     result = ((dst & dst_and) ^ (term & term_and) ^ (dst & term & both_and))
+ *              ^ result_xor
+ *
+ * Depending on the masks chosen, the combination of dst and term is
+ * equivalent to AND, OR, XOR, or simple assignment of term.
+ */
+typedef struct guac_common_pixel_rop {
+
+    /**
+     * Value XOR'd with each source pixel.
+     */
+    uint32_t src_xor;
+
+    /**
+     * Value AND'd with each source pixel after src_xor is applied.
+     */
+    uint32_t src_and;
+
+    /**
+     * Value OR'd with each source pixel after src_and is applied.
+     */
+    uint32_t src_or;
+
+    /**
+     * Mask selecting the bits of the destination pixel that contribute
+     * directly to the result.
+     */
+    uint32_t dst_and;
+
+    /**
+     * Mask selecting the bits of the transformed source pixel that
+     * contribute directly to the result.
+     */
+    uint32_t term_and;
+
+    /**
+     * Mask selecting the bits of the AND of the destination pixel and
+     * transformed source pixel that contribute to the result.
+     */
+    uint32_t both_and;
+
+    /**
+     * Value XOR'd with the final result.
+     */
+    uint32_t result_xor;
+
+} guac_common_pixel_rop;
+
+/**
+ * Combines the destination with the transformed source using assignment.
+ */
+#define GUAC_COMMON_PIXEL_ROP_SET 0x00000000, 0xFFFFFFFF, 0x00000000
+
+/**
+ * Combines the destination with the transformed source using AND.
+ */
+#define GUAC_COMMON_PIXEL_ROP_AND 0x00000000, 0x00000000, 0xFFFFFFFF
+
+/**
+ * Combines the destination with the transformed source using OR.
+ */
+#define GUAC_COMMON_PIXEL_ROP_OR  0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+
+/**
+ * Combines the destination with the transformed source using XOR.
+ */
+#define GUAC_COMMON_PIXEL_ROP_XOR 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000
+
+/**
+ * Initializes the given guac_common_pixel_rop such that it is equivalent to
+ * the given transfer function, as implemented by
+ * guac_common_pixel_transfer_int().
+ *
+ * @param rop
+ *     The guac_common_pixel_rop to initialize.
+ *
+ * @param op
+ *     The transfer function to represent. This must not be
+ *     GUAC_TRANSFER_BINARY_DEST.
+ */
+static void guac_common_pixel_rop_init(guac_common_pixel_rop* rop,
+        guac_transfer_function op) {
+
+    /* Source transform (XOR, AND, OR), combining operator, and final XOR
+     * for each transfer function */
+    static const guac_common_pixel_rop rops[] = {
+        [GUAC_TRANSFER_BINARY_BLACK]     = { 0x00000000, 0x00000000, 0xFF000000, GUAC_COMMON_PIXEL_ROP_SET, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_WHITE]     = { 0x00000000, 0x00000000, 0xFFFFFFFF, GUAC_COMMON_PIXEL_ROP_SET, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_SRC]        = { 0x00000000, 0xFFFFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_SET, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_NSRC]       = { 0x00FFFFFF, 0xFFFFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_SET, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_NDEST]     = { 0x00000000, 0x00000000, 0x00FFFFFF, GUAC_COMMON_PIXEL_ROP_XOR, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_AND]        = { 0x00000000, 0xFFFFFFFF, 0xFF000000, GUAC_COMMON_PIXEL_ROP_AND, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_NAND]       = { 0x00000000, 0xFFFFFFFF, 0xFF000000, GUAC_COMMON_PIXEL_ROP_AND, 0x00FFFFFF },
+        [GUAC_TRANSFER_BINARY_OR]         = { 0x00000000, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_OR,  0x00000000 },
+        [GUAC_TRANSFER_BINARY_NOR]        = { 0x00000000, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_OR,  0x00FFFFFF },
+        [GUAC_TRANSFER_BINARY_XOR]        = { 0x00000000, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_XOR, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_XNOR]       = { 0x00000000, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_XOR, 0x00FFFFFF },
+        [GUAC_TRANSFER_BINARY_NSRC_AND]   = { 0x00FFFFFF, 0xFFFFFFFF, 0xFF000000, GUAC_COMMON_PIXEL_ROP_AND, 0x00000000 },
+        [GUAC_TRANSFER_BINARY_NSRC_NAND]  = { 0x00FFFFFF, 0xFFFFFFFF, 0xFF000000, GUAC_COMMON_PIXEL_ROP_AND, 0x00FFFFFF },
+        [GUAC_TRANSFER_BINARY_NSRC_OR]    = { 0x00FFFFFF, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_OR,  0x00000000 },
+        [GUAC_TRANSFER_BINARY_NSRC_NOR]   = { 0x00FFFFFF, 0x00FFFFFF, 0x00000000, GUAC_COMMON_PIXEL_ROP_OR,  0x00FFFFFF }
+    };
+
+    *rop = rops[op];
+
+}
+
+/**
+ * Updates the given range of changed pixels using a bitmask of changed
+ * pixels within a group of pixels processed at once.
+ *
+ * @param changed
+ *     Bitmask of changed pixels, where the least significant bit corresponds
+ *     to the pixel at index base.
+ *
+ * @param base
+ *     The index of the first pixel in the group.
+ *
+ * @param min_x
+ *     Pointer to the index of the leftmost changed pixel.
+ *
+ * @param max_x
+ *     Pointer to the index of the rightmost changed pixel.
+ */
+static inline void guac_common_pixel_track_mask(unsigned int changed,
+        int base, int* min_x, int* max_x) {
+    guac_common_pixel_track(base + __builtin_ctz(changed), min_x, max_x);
+    guac_common_pixel_track(base + 31 - __builtin_clz(changed), min_x, max_x);
+}
+
+/**
+ * Blends four pre-multiplied ARGB source pixels over four destination
+ * pixels, producing exactly the same result as guac_common_pixel_blend().
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i guac_common_pixel_blend_sse41(__m128i dst, __m128i src) {
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(0xFF);
+
+    /* Broadcast the alpha of each pixel across that pixel's 16-bit lanes */
+    const __m128i alpha_lo = _mm_setr_epi8(
+             3, -1,  3, -1,  3, -1,  3, -1,  7, -1,  7, -1,  7, -1,  7, -1);
+    const __m128i alpha_hi = _mm_setr_epi8(
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1);
+
+    __m128i inv_lo = _mm_sub_epi16(max, _mm_shuffle_epi8(src, alpha_lo));
+    __m128i inv_hi = _mm_sub_epi16(max, _mm_shuffle_epi8(src, alpha_hi));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 0xFF00, saturated to
+     * 0xFF per component */
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(src, zero),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), inv_lo));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(src, zero),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), inv_hi));
+
+    __m128i blended = _mm_packus_epi16(_mm_min_epu16(lo, max),
+            _mm_min_epu16(hi, max));
+
+    /* Fully transparent source leaves destination untouched, while fully
+     * transparent destination takes precedence and yields the source (fully
+     * opaque source already yields the source above) */
+    blended = _mm_blendv_epi8(blended, dst,
+            _mm_cmpeq_epi32(_mm_srli_epi32(src, 24), zero));
+    blended = _mm_blendv_epi8(blended, src,
+            _mm_cmpeq_epi32(_mm_srli_epi32(dst, 24), zero));
+
+    return blended;
+
+}
+
+/**
+ * Stores the given four pixels at the given location if any differ from the
+ * four pixels already there, returning a bitmask of the pixels that differ.
+ */
+__attribute__((target("sse4.1")))
+static inline unsigned int guac_common_pixel_store_sse41(uint32_t* dst,
+        __m128i old_color, __m128i color) {
+
+    unsigned int changed = ~_mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(old_color, color))) & 0xF;
+
+    if (changed)
+        _mm_storeu_si128((__m128i*) dst, color);
+
+    return changed;
+
+}
+
+__attribute__((target("sse4.1")))
+static int guac_common_pixel_put_row_sse41(uint32_t* dst,
+        const uint32_t* src, int width, int opaque, int* first, int* last) {
+
+    const __m128i alpha = _mm_set1_epi32((int) GUAC_COMMON_PIXEL_ALPHA);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        __m128i color;
+        if (opaque)
+            color = _mm_or_si128(s, alpha);
+        else
+            color = guac_common_pixel_blend_sse41(d, s);
+
+        unsigned int changed = guac_common_pixel_store_sse41(dst + x, d, color);
+        if (changed)
+            guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++)
+        guac_common_pixel_put_int(dst, src, x, opaque, &min_x, &max_x);
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+__attribute__((target("sse4.1")))
+static int guac_common_pixel_set_row_sse41(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    const __m128i c = _mm_set1_epi32((int) color);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + x));
+        unsigned int changed = guac_common_pixel_store_sse41(dst + x, d, c);
+        if (changed)
+            guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++) {
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, &min_x, &max_x);
+            dst[x] = color;
+        }
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+/**
+ * Applies the given guac_common_pixel_rop to the four pixels at the given
+ * index, returning a bitmask of the pixels that changed.
+ */
+__attribute__((target("sse4.1")))
+static inline unsigned int guac_common_pixel_transfer_sse41(
+        const guac_common_pixel_rop* rop, const uint32_t* src, uint32_t* dst,
+        int x) {
+
+    __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+    __m128i d = _mm_loadu_si128((const __m128i*) (dst + x));
+
+    __m128i term = _mm_or_si128(_mm_and_si128(
+                _mm_xor_si128(s, _mm_set1_epi32((int) rop->src_xor)),
+                _mm_set1_epi32((int) rop->src_and)),
+                _mm_set1_epi32((int) rop->src_or));
+
+    __m128i color = _mm_xor_si128(
+            _mm_and_si128(d, _mm_set1_epi32((int) rop->dst_and)),
+            _mm_and_si128(term, _mm_set1_epi32((int) rop->term_and)));
+
+    color = _mm_xor_si128(color, _mm_and_si128(_mm_and_si128(d, term),
+                _mm_set1_epi32((int) rop->both_and)));
+
+    color = _mm_xor_si128(color, _mm_set1_epi32((int) rop->result_xor));
+
+    return guac_common_pixel_store_sse41(dst + x, d, color);
+
+}
+
+__attribute__((target("sse4.1")))
+static int guac_common_pixel_transfer_row_sse41(guac_transfer_function op,
+        const uint32_t* src, uint32_t* dst, int width, int backwards,
+        int* first, int* last) {
+
+    guac_common_pixel_rop rop;
+    guac_common_pixel_rop_init(&rop, op);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    unsigned int changed;
+
+    /* Transfer from right to left if requested, such that overlapping
+     * source pixels are read before being overwritten */
+    if (backwards) {
+
+        for (x = width; x >= 4;) {
+            x -= 4;
+            changed = guac_common_pixel_transfer_sse41(&rop, src, dst, x);
+            if (changed)
+                guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+        }
+
+        while (x > 0) {
+            x--;
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+
+    }
+
+    /* Otherwise, transfer from left to right */
+    else {
+
+        for (x = 0; x + 4 <= width; x += 4) {
+            changed = guac_common_pixel_transfer_sse41(&rop, src, dst, x);
+            if (changed)
+                guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+        }
+
+        for (; x < width; x++) {
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+__attribute__((target("sse4.1")))
+static void guac_common_pixel_fill_mask_row_sse41(uint32_t* dst,
+        const uint32_t* mask, uint32_t color, int width) {
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32((int) GUAC_COMMON_PIXEL_ALPHA);
+    const __m128i c = _mm_set1_epi32((int) color);
+
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i m = _mm_loadu_si128((const __m128i*) (mask + x));
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        /* Keep destination wherever mask is fully transparent */
+        __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(m, alpha), zero);
+        _mm_storeu_si128((__m128i*) (dst + x),
+                _mm_blendv_epi8(c, d, transparent));
+
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++) {
+        if (mask[x] & GUAC_COMMON_PIXEL_ALPHA)
+            dst[x] = color;
+    }
+
+}
+
+/**
+ * Implementations of all row-level pixel operations which process four
+ * pixels at a time using SSE4.1.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_sse41 = {
+    .impl          = GUAC_COMMON_PIXEL_SSE41,
+    .put_row       = guac_common_pixel_put_row_sse41,
+    .set_row       = guac_common_pixel_set_row_sse41,
+    .transfer_row  = guac_common_pixel_transfer_row_sse41,
+    .fill_mask_row = guac_common_pixel_fill_mask_row_sse41
+};
+
+/**
+ * Blends eight pre-multiplied ARGB source pixels over eight destination
+ * pixels, producing exactly the same result as guac_common_pixel_blend().
+ * Unpacking, shuffling, and packing all operate within each 128-bit lane,
+ * such that each lane is handled exactly as by
+ * guac_common_pixel_blend_sse41().
+ */
+__attribute__((target("avx2")))
+static inline __m256i guac_common_pixel_blend_avx2(__m256i dst, __m256i src) {
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(0xFF);
+
+    /* Broadcast the alpha of each pixel across that pixel's 16-bit lanes */
+    const __m256i alpha_lo = _mm256_setr_epi8(
+             3, -1,  3, -1,  3, -1,  3, -1,  7, -1,  7, -1,  7, -1,  7, -1,
+             3, -1,  3, -1,  3, -1,  3, -1,  7, -1,  7, -1,  7, -1,  7, -1);
+    const __m256i alpha_hi = _mm256_setr_epi8(
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1,
+            11, -1, 11, -1, 11, -1, 11, -1, 15, -1, 15, -1, 15, -1, 15, -1);
+
+    __m256i inv_lo = _mm256_sub_epi16(max, _mm256_shuffle_epi8(src, alpha_lo));
+    __m256i inv_hi = _mm256_sub_epi16(max, _mm256_shuffle_epi8(src, alpha_hi));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 0xFF00, saturated to
+     * 0xFF per component */
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(src, zero),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), inv_lo));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(src, zero),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), inv_hi));
+
+    __m256i blended = _mm256_packus_epi16(_mm256_min_epu16(lo, max),
+            _mm256_min_epu16(hi, max));
+
+    /* Handle fully transparent source and destination exactly as
+     * guac_common_pixel_blend() does */
+    blended = _mm256_blendv_epi8(blended, dst,
+            _mm256_cmpeq_epi32(_mm256_srli_epi32(src, 24), zero));
+    blended = _mm256_blendv_epi8(blended, src,
+            _mm256_cmpeq_epi32(_mm256_srli_epi32(dst, 24), zero));
+
+    return blended;
+
+}
+
+/**
+ * Stores the given eight pixels at the given location if any differ from the
+ * eight pixels already there, returning a bitmask of the pixels that differ.
+ */
+__attribute__((target("avx2")))
+static inline unsigned int guac_common_pixel_store_avx2(uint32_t* dst,
+        __m256i old_color, __m256i color) {
+
+    unsigned int changed = ~_mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(old_color, color))) & 0xFF;
+
+    if (changed)
+        _mm256_storeu_si256((__m256i*) dst, color);
+
+    return changed;
+
+}
+
+__attribute__((target("avx2")))
+static int guac_common_pixel_put_row_avx2(uint32_t* dst,
+        const uint32_t* src, int width, int opaque, int* first, int* last) {
+
+    const __m256i alpha = _mm256_set1_epi32((int) GUAC_COMMON_PIXEL_ALPHA);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i s = _mm256_loadu_si256((const __m256i*) (src + x));
+        __m256i d = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        __m256i color;
+        if (opaque)
+            color = _mm256_or_si256(s, alpha);
+        else
+            color = guac_common_pixel_blend_avx2(d, s);
+
+        unsigned int changed = guac_common_pixel_store_avx2(dst + x, d, color);
+        if (changed)
+            guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++)
+        guac_common_pixel_put_int(dst, src, x, opaque, &min_x, &max_x);
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+__attribute__((target("avx2")))
+static int guac_common_pixel_set_row_avx2(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    const __m256i c = _mm256_set1_epi32((int) color);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i*) (dst + x));
+        unsigned int changed = guac_common_pixel_store_avx2(dst + x, d, c);
+        if (changed)
+            guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++) {
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, &min_x, &max_x);
+            dst[x] = color;
+        }
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+/**
+ * Applies the given guac_common_pixel_rop to the eight pixels at the given
+ * index, returning a bitmask of the pixels that changed.
+ */
+__attribute__((target("avx2")))
+static inline unsigned int guac_common_pixel_transfer_avx2(
+        const guac_common_pixel_rop* rop, const uint32_t* src, uint32_t* dst,
+        int x) {
+
+    __m256i s = _mm256_loadu_si256((const __m256i*) (src + x));
+    __m256i d = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+    __m256i term = _mm256_or_si256(_mm256_and_si256(
+                _mm256_xor_si256(s, _mm256_set1_epi32((int) rop->src_xor)),
+                _mm256_set1_epi32((int) rop->src_and)),
+                _mm256_set1_epi32((int) rop->src_or));
+
+    __m256i color = _mm256_xor_si256(
+            _mm256_and_si256(d, _mm256_set1_epi32((int) rop->dst_and)),
+            _mm256_and_si256(term, _mm256_set1_epi32((int) rop->term_and)));
+
+    color = _mm256_xor_si256(color, _mm256_and_si256(_mm256_and_si256(d, term),
+                _mm256_set1_epi32((int) rop->both_and)));
+
+    color = _mm256_xor_si256(color, _mm256_set1_epi32((int) rop->result_xor));
+
+    return guac_common_pixel_store_avx2(dst + x, d, color);
+
+}
+
+__attribute__((target("avx2")))
+static int guac_common_pixel_transfer_row_avx2(guac_transfer_function op,
+        const uint32_t* src, uint32_t* dst, int width, int backwards,
+        int* first, int* last) {
+
+    guac_common_pixel_rop rop;
+    guac_common_pixel_rop_init(&rop, op);
+
+    int min_x = width;
+    int max_x = -1;
+    int x;
+
+    unsigned int changed;
+
+    /* Transfer from right to left if requested, such that overlapping
+     * source pixels are read before being overwritten */
+    if (backwards) {
+
+        for (x = width; x >= 8;) {
+            x -= 8;
+            changed = guac_common_pixel_transfer_avx2(&rop, src, dst, x);
+            if (changed)
+                guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+        }
+
+        while (x > 0) {
+            x--;
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+
+    }
+
+    /* Otherwise, transfer from left to right */
+    else {
+
+        for (x = 0; x + 8 <= width; x += 8) {
+            changed = guac_common_pixel_transfer_avx2(&rop, src, dst, x);
+            if (changed)
+                guac_common_pixel_track_mask(changed, x, &min_x, &max_x);
+        }
+
+        for (; x < width; x++) {
+            if (guac_common_pixel_transfer_int(op, src[x], &dst[x]))
+                guac_common_pixel_track(x, &min_x, &max_x);
+        }
+
+    }
+
+    return guac_common_pixel_report(min_x, max_x, first, last);
+
+}
+
+__attribute__((target("avx2")))
+static void guac_common_pixel_fill_mask_row_avx2(uint32_t* dst,
+        const uint32_t* mask, uint32_t color, int width) {
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32((int) GUAC_COMMON_PIXEL_ALPHA);
+    const __m256i c = _mm256_set1_epi32((int) color);
+
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i m = _mm256_loadu_si256((const __m256i*) (mask + x));
+        __m256i d = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        /* Keep destination wherever mask is fully transparent */
+        __m256i transparent = _mm256_cmpeq_epi32(
+                _mm256_and_si256(m, alpha), zero);
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                _mm256_blendv_epi8(c, d, transparent));
+
+    }
+
+    /* Handle remaining pixels individually */
+    for (; x < width; x++) {
+        if (mask[x] & GUAC_COMMON_PIXEL_ALPHA)
+            dst[x] = color;
+    }
+
+}
+
+/**
+ * Implementations of all row-level pixel operations which process eight
+ * pixels at a time using AVX2.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_avx2 = {
+    .impl          = GUAC_COMMON_PIXEL_AVX2,
+    .put_row       = guac_common_pixel_put_row_avx2,
+    .set_row       = guac_common_pixel_set_row_avx2,
+    .transfer_row  = guac_common_pixel_transfer_row_avx2,
+    .fill_mask_row = guac_common_pixel_fill_mask_row_avx2
+};
+
+#endif
+
+/**
+ * The implementation currently used for all row-level pixel operations.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_current =
+    &guac_common_pixel_scalar;
+
+/**
+ * Guard ensuring the fastest supported implementation is selected exactly
+ * once.
+ */
+static pthread_once_t guac_common_pixel_init_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Returns the kernels of the given implementation, if that implementation is
+ * supported by both this build and the current processor.
+ *
+ * @param impl
+ *     The implementation to retrieve.
+ *
+ * @return
+ *     The kernels of the given implementation, or NULL if the implementation
+ *     is not supported.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_lookup(
+        guac_common_pixel_impl impl) {
+
+    switch (impl) {
+
+        case GUAC_COMMON_PIXEL_SCALAR:
+            return &guac_common_pixel_scalar;
+
+#ifdef GUAC_COMMON_PIXEL_X86
+        case GUAC_COMMON_PIXEL_SSE41:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse4.1"))
+                return &guac_common_pixel_sse41;
+            break;
+
+        case GUAC_COMMON_PIXEL_AVX2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return &guac_common_pixel_avx2;
+            break;
+#endif
+
+        default:
+            break;
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Selects the fastest implementation supported by the current processor.
+ * This function is invoked exactly once via pthread_once().
+ */
+static void guac_common_pixel_init() {
+
+    const guac_common_pixel_kernels* kernels;
+
+    if ((kernels = guac_common_pixel_lookup(GUAC_COMMON_PIXEL_AVX2)) == NULL
+            && (kernels = guac_common_pixel_lookup(GUAC_COMMON_PIXEL_SSE41)) == NULL)
+        kernels = &guac_common_pixel_scalar;
+
+    guac_common_pixel_current = kernels;
+
+}
+
+/**
+ * Returns the kernels of the implementation currently in use, selecting the
+ * fastest supported implementation if no implementation has yet been
+ * selected.
+ *
+ * @return
+ *     The kernels of the implementation currently in use.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_kernels_get() {
+    pthread_once(&guac_common_pixel_init_once, guac_common_pixel_init);
+    return guac_common_pixel_current;
+}
+
+guac_common_pixel_impl guac_common_pixel_get_impl() {
+    return guac_common_pixel_kernels_get()->impl;
+}
+
+int guac_common_pixel_set_impl(guac_common_pixel_impl impl) {
+
+    /* Ensure automatic selection does not later replace the override */
+    guac_common_pixel_kernels_get();
+
+    const guac_common_pixel_kernels* kernels = guac_common_pixel_lookup(impl);
+    if (kernels == NULL)
+        return 1;
+
+    guac_common_pixel_current = kernels;
+    return 0;
+
+}
+
+int guac_common_pixel_put_row(uint32_t* dst, const uint32_t* src, int width,
+        int opaque, int* first, int* last) {
+    return guac_common_pixel_kernels_get()->put_row(dst, src, width, opaque,
+            first, last);
+}
+
+int guac_common_pixel_set_row(uint32_t* dst, uint32_t color, int width,
+        int* first, int* last) {
+    return guac_common_pixel_kernels_get()->set_row(dst, color, width,
+            first, last);
+}
+
+int guac_common_pixel_transfer_row(guac_transfer_function op,
+        const uint32_t* src, uint32_t* dst, int width, int backwards,
+        int* first, int* last) {
+
+    /* Destination is never modified by GUAC_TRANSFER_BINARY_DEST */
+    if (op == GUAC_TRANSFER_BINARY_DEST)
+        return 0;
+
+    return guac_common_pixel_kernels_get()->transfer_row(op, src, dst, width,
+            backwards, first, last);
+
+}
+
+void guac_common_pixel_fill_mask_row(uint32_t* dst, const uint32_t* mask,
+        uint32_t color, int width) {
+    guac_common_pixel_kernels_get()->fill_mask_row(dst, mask, color, width);
+}
+
@@ -0,0 +1,389 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/rect.h"
+#include "common/surface-queue.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The width of an update which should be considered negible and thus
+ * trivial overhead compared ot the cost of two updates.
+ */
+#define GUAC_SURFACE_NEGLIGIBLE_WIDTH 64
+
+/**
+ * The height of an update which should be considered negible and thus
+ * trivial overhead compared ot the cost of two updates.
+ */
+#define GUAC_SURFACE_NEGLIGIBLE_HEIGHT 64
+
+/**
+ * The proportional increase in cost contributed by transfer and processing of
+ * image data, compared to processing an equivalent amount of client-side
+ * data.
+ */
+#define GUAC_SURFACE_DATA_FACTOR 16
+
+/**
+ * The base cost of every update. Each update should be considered to have
+ * this starting cost, plus any additional cost estimated from its
+ * content.
+ */
+#define GUAC_SURFACE_BASE_COST 4096
+
+/**
+ * An increase in cost is negligible if it is less than
+ * 1/GUAC_SURFACE_NEGLIGIBLE_INCREASE of the old cost.
+ */
+#define GUAC_SURFACE_NEGLIGIBLE_INCREASE 4
+
+/**
+ * If combining an update because it appears to be follow a fill pattern,
+ * the combined cost must not exceed
+ * GUAC_SURFACE_FILL_PATTERN_FACTOR * (total uncombined cost).
+ */
+#define GUAC_SURFACE_FILL_PATTERN_FACTOR 3
+
+int guac_common_surface_queue_should_combine(const guac_common_rect* existing,
+        const guac_common_rect* rect, int rect_only) {
+
+    int combined_cost, existing_cost, update_cost;
+
+    /* Simulate combination */
+    guac_common_rect combined = *existing;
+    guac_common_rect_extend(&combined, rect);
+
+    /* Combine if result is still small */
+    if (combined.width <= GUAC_SURFACE_NEGLIGIBLE_WIDTH && combined.height <= GUAC_SURFACE_NEGLIGIBLE_HEIGHT)
+        return 1;
+
+    /* Estimate costs of the existing update, new update, and both combined */
+    combined_cost = GUAC_SURFACE_BASE_COST + combined.width * combined.height;
+    existing_cost = GUAC_SURFACE_BASE_COST + existing->width * existing->height;
+    update_cost   = GUAC_SURFACE_BASE_COST + rect->width * rect->height;
+
+    /* Reduce cost if no image data */
+    if (rect_only)
+        update_cost /= GUAC_SURFACE_DATA_FACTOR;
+
+    /* Combine if cost estimate shows benefit */
+    if (combined_cost <= update_cost + existing_cost)
+        return 1;
+
+    /* Combine if increase in cost is negligible */
+    if (combined_cost - existing_cost <= existing_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
+        return 1;
+
+    if (combined_cost - update_cost <= update_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
+        return 1;
+
+    /* Combine if we anticipate further updates, as this update follows a common fill pattern */
+    if (rect->x == existing->x && rect->y == existing->y + existing->height) {
+        if (combined_cost <= (existing_cost + update_cost) * GUAC_SURFACE_FILL_PATTERN_FACTOR)
+            return 1;
+    }
+
+    /* Otherwise, do not combine */
+    return 0;
+
+}
+
+
+/**
+ * Calculates the range of tiles covered by the given rectangle, expanded by
+ * the given number of tiles in each direction. Coordinates to the left of or
+ * above the origin are treated as belonging to the first column or row of
+ * tiles.
+ *
+ * @param rect
+ *     The rectangle whose tiles should be calculated.
+ *
+ * @param margin
+ *     The number of additional tiles to include on each side of the tiles
+ *     covered by the rectangle.
+ *
+ * @param min_x
+ *     Storage for the column of the leftmost tile in the range.
+ *
+ * @param min_y
+ *     Storage for the row of the topmost tile in the range.
+ *
+ * @param max_x
+ *     Storage for the column of the rightmost tile in the range.
+ *
+ * @param max_y
+ *     Storage for the row of the bottommost tile in the range.
+ */
+static void __guac_common_surface_queue_tile_range(const guac_common_rect* rect,
+        int margin, int* min_x, int* min_y, int* max_x, int* max_y) {
+
+    int left   = rect->x > 0 ? rect->x : 0;
+    int top    = rect->y > 0 ? rect->y : 0;
+    int right  = rect->x + rect->width  - 1;
+    int bottom = rect->y + rect->height - 1;
+
+    if (right < left)
+        right = left;
+
+    if (bottom < top)
+        bottom = top;
+
+    *min_x = left   / GUAC_COMMON_SURFACE_QUEUE_TILE_SIZE - margin;
+    *min_y = top    / GUAC_COMMON_SURFACE_QUEUE_TILE_SIZE - margin;
+    *max_x = right  / GUAC_COMMON_SURFACE_QUEUE_TILE_SIZE + margin;
+    *max_y = bottom / GUAC_COMMON_SURFACE_QUEUE_TILE_SIZE + margin;
+
+    if (*min_x < 0) *min_x = 0;
+    if (*min_y < 0) *min_y = 0;
+
+    /* Ranges spanning the whole grid cover every bucket exactly once */
+    if (*max_x - *min_x >= GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE)
+        *max_x = *min_x + GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE - 1;
+
+    if (*max_y - *min_y >= GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE)
+        *max_y = *min_y + GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE - 1;
+
+}
+
+/**
+ * Returns the bitmask of queued updates within the bucket of the tile at the
+ * given column and row.
+ *
+ * @param queue
+ *     The queue whose index should be accessed.
+ *
+ * @param x
+ *     The column of the tile.
+ *
+ * @param y
+ *     The row of the tile.
+ *
+ * @return
+ *     The GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS words of the bitmask of the
+ *     bucket containing the given tile.
+ */
+static uint64_t* __guac_common_surface_queue_bucket(
+        guac_common_surface_queue* queue, int x, int y) {
+    return queue->tiles[y % GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE]
+                       [x % GUAC_COMMON_SURFACE_QUEUE_GRID_SIZE];
+}
+
+/**
+ * Sets or clears the bit of the given queued update within the buckets of
+ * all tiles covered by that update.
+ *
+ * @param queue
+ *     The queue containing the update.
+ *
+ * @param index
+ *     The index of the update within the queue.
+ *
+ * @param set
+ *     Non-zero if the bit of the update should be set, zero if it should be
+ *     cleared.
+ */
+static void __guac_common_surface_queue_index(guac_common_surface_queue* queue,
+        int index, int set) {
+
+    int min_x, min_y, max_x, max_y;
+    __guac_common_surface_queue_tile_range(&queue->rects[index].rect, 0,
+            &min_x, &min_y, &max_x, &max_y);
+
+    int word = index / 64;
+    uint64_t bit = UINT64_C(1) << (index % 64);
+
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+
+            uint64_t* mask = __guac_common_surface_queue_bucket(queue, x, y);
+
+            if (set)
+                mask[word] |= bit;
+            else
+                mask[word] &= ~bit;
+
+        }
+    }
+
+}
+
+/**
+ * Removes the update at the given index from the given queue, filling its
+ * slot with the last update in the queue.
+ *
+ * @param queue
+ *     The queue to remove the update from.
+ *
+ * @param index
+ *     The index of the update to remove.
+ */
+static void __guac_common_surface_queue_remove(guac_common_surface_queue* queue,
+        int index) {
+
+    int last = --queue->length;
+
+    __guac_common_surface_queue_index(queue, index, 0);
+    if (index == last)
+        return;
+
+    __guac_common_surface_queue_index(queue, last, 0);
+    queue->rects[index] = queue->rects[last];
+    __guac_common_surface_queue_index(queue, index, 1);
+
+}
+
+/**
+ * Searches the queued updates covering the tiles around the given rectangle
+ * for an update which has not yet been flushed and which should be combined
+ * with that rectangle.
+ *
+ * @param queue
+ *     The queue to search.
+ *
+ * @param rect
+ *     The rectangle being queued.
+ *
+ * @return
+ *     The index of the queued update which should be combined with the given
+ *     rectangle, or -1 if there is no such update.
+ */
+static int __guac_common_surface_queue_find(guac_common_surface_queue* queue,
+        const guac_common_rect* rect) {
+
+    uint64_t nearby[GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS] = { 0 };
+
+    /* Gather all updates covering the same or adjacent tiles */
+    int min_x, min_y, max_x, max_y;
+    __guac_common_surface_queue_tile_range(rect, 1,
+            &min_x, &min_y, &max_x, &max_y);
+
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+
+            uint64_t* mask = __guac_common_surface_queue_bucket(queue, x, y);
+
+            for (int word = 0; word < GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS;
+                    word++)
+                nearby[word] |= mask[word];
+
+        }
+    }
+
+    /* Check only those updates */
+    for (int word = 0; word < GUAC_COMMON_SURFACE_QUEUE_MASK_WORDS; word++) {
+
+        uint64_t remaining = nearby[word];
+        while (remaining) {
+
+            int index = word * 64 + __builtin_ctzll(remaining);
+            remaining &= remaining - 1;
+
+            guac_common_surface_bitmap_rect* current = &queue->rects[index];
+            if (!current->flushed && guac_common_surface_queue_should_combine(
+                        &current->rect, rect, 0))
+                return index;
+
+        }
+
+    }
+
+    return -1;
+
+}
+
+void guac_common_surface_queue_add(guac_common_surface_queue* queue,
+        const guac_common_rect* rect) {
+
+    guac_common_surface_bitmap_rect* rects = queue->rects;
+    guac_common_rect merged = *rect;
+
+    for (;;) {
+
+        /* Find a nearby queued update that should be combined with this
+         * update */
+        int i = __guac_common_surface_queue_find(queue, &merged);
+
+        /* If the queue is full, reuse the slot of an update which has already
+         * been flushed, or otherwise choose the update which adds the least
+         * cost when combined */
+        if (i == -1 && queue->length == GUAC_COMMON_SURFACE_QUEUE_SIZE) {
+
+            int best_cost = INT_MAX;
+            int best = 0;
+
+            for (i = 0; i < queue->length; i++) {
+
+                if (rects[i].flushed)
+                    break;
+
+                guac_common_rect combined = rects[i].rect;
+                guac_common_rect_extend(&combined, &merged);
+
+                int cost = combined.width * combined.height
+                         - rects[i].rect.width * rects[i].rect.height;
+
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = i;
+                }
+
+            }
+
+            /* Flushed updates can simply be replaced */
+            if (i < queue->length) {
+                __guac_common_surface_queue_remove(queue, i);
+                break;
+            }
+
+            i = best;
+
+        }
+
+        /* Stop once no further combination is possible */
+        if (i == -1)
+            break;
+
+        /* Absorb queued update */
+        guac_common_rect_extend(&merged, &rects[i].rect);
+        __guac_common_surface_queue_remove(queue, i);
+
+    }
+
+    rects[queue->length].rect = merged;
+    rects[queue->length].flushed = 0;
+    __guac_common_surface_queue_index(queue, queue->length, 1);
+    queue->length++;
+
+}
+
+void guac_common_surface_queue_clear(guac_common_surface_queue* queue) {
+
+    /* Queued updates may have been modified since they were indexed (for
+     * example, clipped while being flushed), so the index is cleared
+     * entirely rather than update by update */
+    if (queue->length > 0)
+        memset(queue->tiles, 0, sizeof(queue->tiles));
+
+    queue->length = 0;
+
+}
@@ -18,8 +18,11 @@
  */
 
 #include "config.h"
+#include "common/encoder.h"
+#include "common/pixel.h"
 #include "common/rect.h"
 #include "common/surface.h"
+#include "common/surface-queue.h"
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
@@ -34,54 +37,75 @@
 #include <stdint.h>
 #include <string.h>
 
+/* Define cairo_format_stride_for_width() if missing */
+#ifndef HAVE_CAIRO_FORMAT_STRIDE_FOR_WIDTH
+#define cairo_format_stride_for_width(format, width) (width*4)
+#endif
+
 /**
- * The width of an update which should be considered negible and thus
- * trivial overhead compared ot the cost of two updates.
+ * The framerate which, if exceeded, indicates that JPEG is preferred.
  */
-#define GUAC_SURFACE_NEGLIGIBLE_WIDTH 64
+#define GUAC_COMMON_SURFACE_JPEG_FRAMERATE 3
 
 /**
- * The height of an update which should be considered negible and thus
- * trivial overhead compared ot the cost of two updates.
+ * The estimated latency, in milliseconds, beyond which a lossless update is
+ * considered too slow for the connection. Updates which would exceed this
+ * latency are sent using a lossy encoding, if one would be substantially
+ * faster, and lossy updates which would exceed this latency are sent at
+ * reduced quality.
  */
-#define GUAC_SURFACE_NEGLIGIBLE_HEIGHT 64
+#define GUAC_COMMON_SURFACE_LATENCY_BUDGET 100
 
 /**
- * The proportional increase in cost contributed by transfer and processing of
- * image data, compared to processing an equivalent amount of client-side
- * data.
+ * The factor by which the estimated latency of a lossy encoding must be
+ * lower than that of PNG for the lossy encoding to be used solely to meet
+ * GUAC_COMMON_SURFACE_LATENCY_BUDGET.
  */
-#define GUAC_SURFACE_DATA_FACTOR 16
+#define GUAC_COMMON_SURFACE_LOSSY_SPEEDUP 2
 
 /**
- * The base cost of every update. Each update should be considered to have
- * this starting cost, plus any additional cost estimated from its
- * content.
+ * The average framerate which, if sustained for
+ * GUAC_COMMON_SURFACE_VIDEO_DURATION, indicates that the updated region
+ * should be streamed as video.
  */
-#define GUAC_SURFACE_BASE_COST 4096
+#define GUAC_COMMON_SURFACE_VIDEO_FRAMERATE 15
 
 /**
- * An increase in cost is negligible if it is less than
- * 1/GUAC_SURFACE_NEGLIGIBLE_INCREASE of the old cost.
+ * The minimum area of a region streamed as video, in pixels. Smaller regions,
+ * such as animated icons or progress indicators, are sent as images.
  */
-#define GUAC_SURFACE_NEGLIGIBLE_INCREASE 4
+#define GUAC_COMMON_SURFACE_VIDEO_MIN_SIZE 40000
 
 /**
- * If combining an update because it appears to be follow a fill pattern,
- * the combined cost must not exceed
- * GUAC_SURFACE_FILL_PATTERN_FACTOR * (total uncombined cost).
+ * The amount of time that a region must be updated at
+ * GUAC_COMMON_SURFACE_VIDEO_FRAMERATE before it is streamed as video, in
+ * milliseconds.
  */
-#define GUAC_SURFACE_FILL_PATTERN_FACTOR 3
+#define GUAC_COMMON_SURFACE_VIDEO_DURATION 2000
 
-/* Define cairo_format_stride_for_width() if missing */
-#ifndef HAVE_CAIRO_FORMAT_STRIDE_FOR_WIDTH
-#define cairo_format_stride_for_width(format, width) (width*4)
-#endif
+/**
+ * The amount of time that a region streamed as video (or a region being
+ * considered for streaming as video) may go without rapid updates before
+ * video is abandoned and images are used once again, in milliseconds.
+ */
+#define GUAC_COMMON_SURFACE_VIDEO_IDLE_TIMEOUT 1000
 
 /**
- * The framerate which, if exceeded, indicates that JPEG is preferred.
+ * The bitrate of video if bandwidth is not constrained, in bits per second.
  */
-#define GUAC_COMMON_SURFACE_JPEG_FRAMERATE 3
+#define GUAC_COMMON_SURFACE_VIDEO_BITRATE 4000000
+
+/**
+ * The lowest bitrate that will be used for video regardless of available
+ * bandwidth, in bits per second.
+ */
+#define GUAC_COMMON_SURFACE_VIDEO_MIN_BITRATE 250000
+
+/**
+ * The block size to which regions streamed as video are aligned, matching
+ * the macroblock size of VP8.
+ */
+#define GUAC_COMMON_SURFACE_VIDEO_BLOCK_SIZE 16
 
 /**
  * Minimum JPEG bitmap size (area). If the bitmap is smaller than this threshold,
@@ -125,6 +149,15 @@ void guac_common_surface_set_lossless(guac_common_surface* surface,
 
 }
 
+void guac_common_surface_set_video(guac_common_surface* surface,
+        int enabled) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->video_enabled = enabled;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
 void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -251,6 +284,10 @@ static int __guac_common_surface_is_opaque(guac_common_surface* surface,
 
     int x, y;
 
+    /* Surfaces with meaningless alpha are opaque by definition */
+    if (surface->opaque)
+        return 1;
+
     int stride = surface ->stride;
     unsigned char* buffer =
         surface->buffer + (stride * rect->y) + (4 * rect->x);
@@ -279,6 +316,34 @@ static int __guac_common_surface_is_opaque(guac_common_surface* surface,
 
 }
 
+/**
+ * Returns whether the given rectangle intersects a region of the given
+ * surface which is currently being streamed as video. The contents of such
+ * regions within the surface's own layer are stale, and so may not be the
+ * source or destination of client-side operations.
+ *
+ * @param surface
+ *     The surface to check.
+ *
+ * @param rect
+ *     The rectangle to check.
+ *
+ * @return
+ *     Non-zero if the rectangle intersects a region being streamed as video,
+ *     zero otherwise.
+ */
+static int __guac_common_surface_video_intersects(
+        guac_common_surface* surface, const guac_common_rect* rect) {
+
+#ifdef ENABLE_COMMON_VIDEO
+    if (surface->video != NULL)
+        return guac_common_rect_intersects(rect,
+                guac_common_video_get_rect(surface->video));
+#endif
+
+    return 0;
+
+}
 
 /**
  * Returns whether the given rectangle should be combined into the existing
@@ -307,46 +372,14 @@ static int __guac_common_should_combine(guac_common_surface* surface, const guac
     if (!surface->realized)
         return 1;
 
-    if (surface->dirty) {
-
-        int combined_cost, dirty_cost, update_cost;
-
-        /* Simulate combination */
-        guac_common_rect combined = surface->dirty_rect;
-        guac_common_rect_extend(&combined, rect);
-
-        /* Combine if result is still small */
-        if (combined.width <= GUAC_SURFACE_NEGLIGIBLE_WIDTH && combined.height <= GUAC_SURFACE_NEGLIGIBLE_HEIGHT)
-            return 1;
-
-        /* Estimate costs of the existing update, new update, and both combined */
-        combined_cost = GUAC_SURFACE_BASE_COST + combined.width * combined.height;
-        dirty_cost    = GUAC_SURFACE_BASE_COST + surface->dirty_rect.width * surface->dirty_rect.height;
-        update_cost   = GUAC_SURFACE_BASE_COST + rect->width * rect->height;
-
-        /* Reduce cost if no image data */
-        if (rect_only)
-            update_cost /= GUAC_SURFACE_DATA_FACTOR;
-
-        /* Combine if cost estimate shows benefit */
-        if (combined_cost <= update_cost + dirty_cost)
-            return 1;
-
-        /* Combine if increase in cost is negligible */
-        if (combined_cost - dirty_cost <= dirty_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
-            return 1;
-
-        if (combined_cost - update_cost <= update_cost / GUAC_SURFACE_NEGLIGIBLE_INCREASE)
-            return 1;
+    /* Updates within video must be sent as part of the video */
+    if (__guac_common_surface_video_intersects(surface, rect))
+        return 1;
 
-        /* Combine if we anticipate further updates, as this update follows a common fill pattern */
-        if (rect->x == surface->dirty_rect.x && rect->y == surface->dirty_rect.y + surface->dirty_rect.height) {
-            if (combined_cost <= (dirty_cost + update_cost) * GUAC_SURFACE_FILL_PATTERN_FACTOR)
-                return 1;
-        }
+    if (surface->dirty)
+        return guac_common_surface_queue_should_combine(&surface->dirty_rect,
+                rect, rect_only);
 
-    }
-    
     /* Otherwise, do not combine */
     return 0;
 
@@ -455,6 +488,171 @@ static unsigned int __guac_common_surface_calculate_framerate(
 
     return 0;
 
+}
+
+/**
+ * Retrieves the measured cost of the given encoder for the given area of the
+ * surface, averaging the costs measured for each heat map cell within that
+ * area. If no such measurements exist, the cost measured for the surface as
+ * a whole is used, falling back to the default cost of the encoder.
+ *
+ * @param surface
+ *     The surface containing the area whose cost should be retrieved.
+ *
+ * @param rect
+ *     The area whose cost should be retrieved. This area must be within the
+ *     bounds of the surface.
+ *
+ * @param encoder
+ *     The encoder whose cost should be retrieved.
+ *
+ * @param cost
+ *     The guac_common_encoder_cost to populate with the retrieved cost.
+ */
+static void __guac_common_surface_get_encoder_cost(
+        guac_common_surface* surface, const guac_common_rect* rect,
+        guac_common_encoder encoder, guac_common_encoder_cost* cost) {
+
+    int x, y;
+
+    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+
+    /* Calculate range of heat map cells intersecting given rect */
+    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_x = (rect->x + rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (rect->y + rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    int64_t sum_bytes = 0;
+    int64_t sum_usec = 0;
+    int count = 0;
+
+    const guac_common_surface_heat_cell* heat_row =
+        surface->heat_map + min_y * heat_width + min_x;
+
+    /* Sum the costs of all cells having measurements */
+    for (y = min_y; y <= max_y; y++) {
+
+        const guac_common_surface_heat_cell* heat_cell = heat_row;
+        for (x = min_x; x <= max_x; x++) {
+
+            const guac_common_encoder_cost* cell_cost =
+                &heat_cell->encoder_costs[encoder];
+
+            if (cell_cost->bytes_per_kpixel != 0) {
+                sum_bytes += cell_cost->bytes_per_kpixel;
+                sum_usec += cell_cost->usec_per_kpixel;
+                count++;
+            }
+
+            heat_cell++;
+
+        }
+
+        heat_row += heat_width;
+
+    }
+
+    if (count) {
+        cost->bytes_per_kpixel = sum_bytes / count;
+        cost->usec_per_kpixel = sum_usec / count;
+    }
+
+    /* Fall back to surface-wide measurements, then to defaults */
+    else if (surface->encoder_costs[encoder].bytes_per_kpixel != 0)
+        *cost = surface->encoder_costs[encoder];
+    else
+        *cost = *guac_common_encoder_default_cost(encoder);
+
+}
+
+/**
+ * Estimates the time between beginning to encode the given area of the
+ * surface with the given encoder and the client receiving the result.
+ *
+ * @param surface
+ *     The surface containing the area to be encoded.
+ *
+ * @param rect
+ *     The area to be encoded. This area must be within the bounds of the
+ *     surface.
+ *
+ * @param encoder
+ *     The encoder being considered.
+ *
+ * @return
+ *     The estimated latency, in microseconds.
+ */
+static int64_t __guac_common_surface_estimate_latency(
+        guac_common_surface* surface, const guac_common_rect* rect,
+        guac_common_encoder encoder) {
+
+    guac_common_encoder_cost cost;
+    __guac_common_surface_get_encoder_cost(surface, rect, encoder, &cost);
+
+    return guac_common_encoder_cost_estimate(&cost, &surface->bandwidth,
+            rect->width * rect->height);
+
+}
+
+/**
+ * Records the measured cost of encoding the given area of the surface with
+ * the given encoder, updating the costs of the heat map cells within that
+ * area and of the surface as a whole.
+ *
+ * @param surface
+ *     The surface containing the area that was encoded.
+ *
+ * @param rect
+ *     The area that was encoded. This area must be within the bounds of the
+ *     surface.
+ *
+ * @param encoder
+ *     The encoder that was used.
+ *
+ * @param bytes
+ *     The number of bytes sent as a result of encoding.
+ *
+ * @param usec
+ *     The CPU time required for encoding, in microseconds.
+ */
+static void __guac_common_surface_record_encoder_cost(
+        guac_common_surface* surface, const guac_common_rect* rect,
+        guac_common_encoder encoder, uint64_t bytes, int64_t usec) {
+
+    int x, y;
+
+    int pixels = rect->width * rect->height;
+    if (pixels <= 0)
+        return;
+
+    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+
+    /* Calculate range of heat map cells intersecting given rect */
+    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_x = (rect->x + rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (rect->y + rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    guac_common_surface_heat_cell* heat_row =
+        surface->heat_map + min_y * heat_width + min_x;
+
+    for (y = min_y; y <= max_y; y++) {
+
+        guac_common_surface_heat_cell* heat_cell = heat_row;
+        for (x = min_x; x <= max_x; x++) {
+            guac_common_encoder_cost_record(&heat_cell->encoder_costs[encoder],
+                    pixels, bytes, usec);
+            heat_cell++;
+        }
+
+        heat_row += heat_width;
+
+    }
+
+    guac_common_encoder_cost_record(&surface->encoder_costs[encoder],
+            pixels, bytes, usec);
+
 }
 
  /**
@@ -527,70 +725,101 @@ static int __guac_common_surface_png_optimality(guac_common_surface* surface,
 }
 
 /**
- * Returns whether the given rectangle would be optimally encoded as JPEG
- * rather than PNG.
+ * Selects the encoder which should be used for the given rectangle. Lossy
+ * encodings are used for regions which are updated frequently and whose
+ * contents would not compress well as PNG, choosing whichever lossy encoding
+ * is estimated to reach the client soonest. Other regions are sent as PNG,
+ * unless the connection is constrained such that PNG would exceed
+ * GUAC_COMMON_SURFACE_LATENCY_BUDGET and a lossy encoding would be
+ * substantially faster.
  *
  * @param surface
  *     The surface to be queried.
  *
  * @param rect
- *     The rectangle to check.
+ *     The rectangle to be encoded.
+ *
+ * @param opaque
+ *     Whether the rectangle contains only fully-opaque pixels.
  *
  * @return
- *     Non-zero if the rectangle would be optimally encoded as JPEG, zero
- *     otherwise.
+ *     The encoder which should be used for the given rectangle.
  */
-static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+static guac_common_encoder __guac_common_surface_select_encoder(
+        guac_common_surface* surface, const guac_common_rect* rect,
+        int opaque) {
 
-    /* Do not use JPEG if lossless quality is required */
-    if (surface->lossless)
-        return 0;
+    int rect_size = rect->width * rect->height;
 
-    /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+    /* WebP can be used only if supported, and is lossless if lossless
+     * quality is required */
+    int webp_allowed = guac_client_supports_webp(surface->client);
 
-    int rect_size = rect->width * rect->height;
+    /* JPEG can be used only for opaque images where lossy compression is
+     * acceptable, and only if large enough to avoid the JPEG compression
+     * tax */
+    int jpeg_allowed = opaque && !surface->lossless
+        && rect_size > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE;
 
-    /* JPEG is preferred if:
-     * - frame rate is high enough
-     * - image size is large enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
-        && rect_size > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+    if (!webp_allowed && !jpeg_allowed)
+        return GUAC_COMMON_ENCODER_PNG;
 
-}
+    /* Lossy encodings are preferred if frame rate is high enough and PNG is
+     * not more optimal based on image contents */
+    if (__guac_common_surface_calculate_framerate(surface, rect)
+                >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
+            && __guac_common_surface_png_optimality(surface, rect) < 0) {
 
-/**
- * Returns whether the given rectangle would be optimally encoded as WebP
- * rather than PNG.
- *
- * @param surface
- *     The surface to be queried.
- *
- * @param rect
- *     The rectangle to check.
- *
- * @return
- *     Non-zero if the rectangle would be optimally encoded as WebP, zero
- *     otherwise.
- */
-static int __guac_common_surface_should_use_webp(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+        if (!jpeg_allowed)
+            return GUAC_COMMON_ENCODER_WEBP;
 
-    /* Do not use WebP if not supported */
-    if (!guac_client_supports_webp(surface->client))
-        return 0;
+        if (!webp_allowed)
+            return GUAC_COMMON_ENCODER_JPEG;
+
+        /* Prefer WebP unless JPEG would be faster */
+        if (__guac_common_surface_estimate_latency(surface, rect,
+                    GUAC_COMMON_ENCODER_JPEG)
+                < __guac_common_surface_estimate_latency(surface, rect,
+                    GUAC_COMMON_ENCODER_WEBP))
+            return GUAC_COMMON_ENCODER_JPEG;
 
-    /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+        return GUAC_COMMON_ENCODER_WEBP;
 
-    /* WebP is preferred if:
-     * - frame rate is high enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+    }
+
+    /* Otherwise, PNG is used unless lossy compression is acceptable and
+     * the connection is constrained */
+    if (surface->lossless || surface->bandwidth.bytes_per_second == 0)
+        return GUAC_COMMON_ENCODER_PNG;
+
+    int64_t latency = __guac_common_surface_estimate_latency(surface, rect,
+            GUAC_COMMON_ENCODER_PNG);
+
+    if (latency <= GUAC_COMMON_SURFACE_LATENCY_BUDGET * 1000)
+        return GUAC_COMMON_ENCODER_PNG;
+
+    /* PNG would be too slow; use the fastest lossy encoding if it is
+     * substantially faster */
+    guac_common_encoder encoder = GUAC_COMMON_ENCODER_PNG;
+    latency /= GUAC_COMMON_SURFACE_LOSSY_SPEEDUP;
+
+    if (webp_allowed) {
+        int64_t webp_latency = __guac_common_surface_estimate_latency(surface,
+                rect, GUAC_COMMON_ENCODER_WEBP);
+        if (webp_latency < latency) {
+            encoder = GUAC_COMMON_ENCODER_WEBP;
+            latency = webp_latency;
+        }
+    }
+
+    if (jpeg_allowed) {
+        int64_t jpeg_latency = __guac_common_surface_estimate_latency(surface,
+                rect, GUAC_COMMON_ENCODER_JPEG);
+        if (jpeg_latency < latency)
+            encoder = GUAC_COMMON_ENCODER_JPEG;
+    }
+
+    return encoder;
 
 }
 
@@ -660,24 +889,22 @@ static void __guac_common_surface_touch_rect(guac_common_surface* surface,
 }
 
 /**
- * Flushes the bitmap update currently described by the dirty rectangle within the
- * given surface to that surface's bitmap queue. There MUST be space within the
- * queue.
+ * Adds the current dirty rectangle of the given surface to the bitmap queue,
+ * combining it with any queued updates as appropriate, and marks the surface
+ * as no longer dirty. If the surface is not dirty, this function has no
+ * effect.
  *
- * @param surface The surface to flush.
+ * @param surface
+ *     The surface whose dirty rectangle should be queued.
  */
 static void __guac_common_surface_flush_to_queue(guac_common_surface* surface) {
 
-    guac_common_surface_bitmap_rect* rect;
-
     /* Do not flush if not dirty */
     if (!surface->dirty)
         return;
 
-    /* Add new rect to queue */
-    rect = &(surface->bitmap_queue[surface->bitmap_queue_length++]);
-    rect->rect = surface->dirty_rect;
-    rect->flushed = 0;
+    guac_common_surface_queue_add(&surface->bitmap_queue,
+            &surface->dirty_rect);
 
     /* Surface now flushed */
     surface->dirty = 0;
@@ -693,6 +920,23 @@ static void __guac_common_surface_flush_to_queue(guac_common_surface* surface) {
  */
 static void __guac_common_surface_flush(guac_common_surface* surface);
 
+#ifdef ENABLE_COMMON_VIDEO
+/**
+ * Ends any video being streamed from the given surface. The surface's own
+ * layer is not updated while video plays, so the region which was streamed
+ * may be queued for resending as an image.
+ *
+ * @param surface
+ *     The surface whose video should be ended.
+ *
+ * @param refresh
+ *     Non-zero if the region which was streamed should be queued for
+ *     resending as an image, zero otherwise.
+ */
+static void __guac_common_surface_stop_video(guac_common_surface* surface,
+        int refresh);
+#endif
+
 /**
  * Schedules a deferred flush of the given surface. This will not immediately
  * flush the surface to the client. Instead, the result of the flush is
@@ -707,101 +951,12 @@ static void __guac_common_surface_flush_deferred(guac_common_surface* surface) {
     if (!surface->dirty)
         return;
 
-    /* Flush if queue size has reached maximum (space is reserved for the final
-     * dirty rect, as __guac_common_surface_flush() MAY add an additional rect
-     * to the queue */
-    if (surface->bitmap_queue_length == GUAC_COMMON_SURFACE_QUEUE_SIZE-1)
-        __guac_common_surface_flush(surface);
-
-    /* Append dirty rect to queue */
+    /* Add dirty rect to queue (the queue never overflows, as updates are
+     * merged as necessary) */
     __guac_common_surface_flush_to_queue(surface);
 
 }
 
-/**
- * Transfers a single uint32_t using the given transfer function.
- *
- * @param op The transfer function to use.
- * @param src The source of the uint32_t value.
- * @param dst THe destination which will hold the result of the transfer.
- * @return Non-zero if the destination value was changed, zero otherwise.
- */
-static int __guac_common_surface_transfer_int(guac_transfer_function op, uint32_t* src, uint32_t* dst) {
-
-    uint32_t orig = *dst;
-
-    switch (op) {
-
-        case GUAC_TRANSFER_BINARY_BLACK:
-            *dst = 0xFF000000;
-            break;
-
-        case GUAC_TRANSFER_BINARY_WHITE:
-            *dst = 0xFFFFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_SRC:
-            *dst = *src;
-            break;
-
-        case GUAC_TRANSFER_BINARY_DEST:
-            /* NOP */
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC:
-            *dst = *src ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_NDEST:
-            *dst = *dst ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_AND:
-            *dst = ((*dst) & (0xFF000000 | *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NAND:
-            *dst = ((*dst) & (0xFF000000 | *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_OR:
-            *dst = ((*dst) | (0x00FFFFFF & *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_XOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_XNOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC_AND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF)));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC_NAND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC_OR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF)));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
-
-    }
-
-    return *dst != orig;
-
-}
-
 /**
  * Assigns the given value to all pixels within a rectangle of the backing
  * surface of the given destination surface. The color of all pixels within the
@@ -832,7 +987,7 @@ static int __guac_common_surface_transfer_int(guac_transfer_function op, uint32_
 static void __guac_common_surface_set(guac_common_surface* dst,
         guac_common_rect* rect, int red, int green, int blue, int alpha) {
 
-    int x, y;
+    int y;
 
     int dst_stride;
     unsigned char* dst_buffer;
@@ -850,22 +1005,15 @@ static void __guac_common_surface_set(guac_common_surface* dst,
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
+        int first, last;
 
-        /* Set row */
-        for (x=0; x < rect->width; x++) {
-
-            uint32_t old_color = *dst_current;
-
-            if (old_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
-
-            dst_current++;
+        /* Set row, tracking bounds of changed pixels */
+        if (guac_common_pixel_set_row((uint32_t*) dst_buffer, color,
+                    rect->width, &first, &last)) {
+            if (first < min_x) min_x = first;
+            if (y < min_y) min_y = y;
+            if (last > max_x) max_x = last;
+            if (y > max_y) max_y = y;
         }
 
         /* Next row */
@@ -887,83 +1035,6 @@ static void __guac_common_surface_set(guac_common_surface* dst,
 
 }
 
-/**
- * Applies the Porter-Duff "over" composite operator, blending the two given
- * color components using the given alpha value.
- *
- * @param dst
- *     The destination color component.
- *
- * @param src
- *     The source color component.
- *
- * @param alpha
- *     The alpha value which applies to the blending operation.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination components.
- */
-static int guac_common_surface_blend_component(int dst, int src, int alpha) {
-
-    int blended = src + dst * (0xFF - alpha);
-
-    /* Do not exceed maximum component value */
-    if (blended > 0xFF)
-        return 0xFF;
-
-    return blended;
-
-}
-
-/**
- * Applies the Porter-Duff "over" composite operator, blending each component
- * of the two given ARGB colors.
- *
- * @param dst
- *     The destination ARGB color.
- *
- * @param src
- *     The source ARGB color.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination colors.
- */
-static uint32_t guac_common_surface_argb_blend(uint32_t dst, uint32_t src) {
-
-    /* Separate destination ARGB color into its components */
-    int dst_a = (dst >> 24) & 0xFF;
-    int dst_r = (dst >> 16) & 0xFF;
-    int dst_g = (dst >>  8) & 0xFF;
-    int dst_b =  dst        & 0xFF;
-
-    /* Separate source ARGB color into its components */
-    int src_a = (src >> 24) & 0xFF;
-    int src_r = (src >> 16) & 0xFF;
-    int src_g = (src >>  8) & 0xFF;
-    int src_b =  src        & 0xFF;
-
-    /* If source is fully opaque (or destination is fully transparent), the
-     * blended result is the source */
-    if (src_a == 0xFF || dst_a == 0x00)
-        return src;
-
-    /* If source is fully transparent, the blended result is the destination */
-    if (src_a == 0x00)
-        return dst;
-
-    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
-    int r = guac_common_surface_blend_component(dst_r, src_r, src_a);
-    int g = guac_common_surface_blend_component(dst_g, src_g, src_a);
-    int b = guac_common_surface_blend_component(dst_b, src_b, src_a);
-    int a = guac_common_surface_blend_component(dst_a, src_a, src_a);
-
-    /* Recombine blended components */
-    return (a << 24) | (r << 16) | (g << 8) | b;
-
-}
-
 /**
  * Copies data from the given buffer to the surface at the given coordinates.
  * The dimensions and location of the destination rectangle will be altered
@@ -986,7 +1057,7 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
     unsigned char* dst_buffer = dst->buffer;
     int dst_stride = dst->stride;
 
-    int x, y;
+    int y;
 
     int min_x = rect->width;
     int min_y = rect->height;
@@ -1002,40 +1073,17 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Copy row */
-        for (x=0; x < rect->width; x++) {
-
-            uint32_t color;
-
-            /* Get source and destination color values */
-            uint32_t src_color = *src_current;
-            uint32_t dst_color = *dst_current;
-
-            /* Ignore alpha channel if opaque */
-            if (opaque)
-                color = src_color | 0xFF000000;
-
-            /* Otherwise, perform alpha blending operation */
-            else
-                color = guac_common_surface_argb_blend(dst_color, src_color);
-
-            /* If the destination color is changing, update rectangle bounds
-             * and store the new color */
-            if (dst_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
-
-            /* Advance to next pixel */
-            src_current++;
-            dst_current++;
-
+        int first, last;
+
+        /* Copy row (ignoring alpha if opaque, blending otherwise), tracking
+         * bounds of changed pixels */
+        if (guac_common_pixel_put_row((uint32_t*) dst_buffer,
+                    (uint32_t*) src_buffer, rect->width, opaque,
+                    &first, &last)) {
+            if (first < min_x) min_x = first;
+            if (y < min_y) min_y = y;
+            if (last > max_x) max_x = last;
+            if (y > max_y) max_y = y;
         }
 
         /* Next row */
@@ -1086,7 +1134,7 @@ static void __guac_common_surface_fill_mask(unsigned char* src_buffer, int src_s
     int dst_stride = dst->stride;
 
     uint32_t color = 0xFF000000 | (red << 16) | (green << 8) | blue;
-    int x, y;
+    int y;
 
     src_buffer += src_stride*sy + 4*sx;
     dst_buffer += (dst_stride * rect->y) + (4 * rect->x);
@@ -1094,19 +1142,9 @@ static void __guac_common_surface_fill_mask(unsigned char* src_buffer, int src_s
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
         /* Stencil row */
-        for (x=0; x < rect->width; x++) {
-
-            /* Fill with color if opaque */
-            if (*src_current & 0xFF000000)
-                *dst_current = color;
-
-            src_current++;
-            dst_current++;
-        }
+        guac_common_pixel_fill_mask_row((uint32_t*) dst_buffer,
+                (uint32_t*) src_buffer, color, rect->width);
 
         /* Next row */
         src_buffer += src_stride;
@@ -1135,9 +1173,9 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
     unsigned char* src_buffer = src->buffer;
     unsigned char* dst_buffer = dst->buffer;
 
-    int x, y;
+    int y;
     int src_stride, dst_stride;
-    int step = 1;
+    int backwards;
 
     int min_x = rect->width - 1;
     int min_y = rect->height - 1;
@@ -1153,36 +1191,31 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
         dst_buffer += (dst->stride * rect->y) + (4 * rect->x);
         src_stride = src->stride;
         dst_stride = dst->stride;
-        step = 1;
+        backwards = 0;
     }
 
     /* Otherwise, copy backwards */
     else {
-        src_buffer += src->stride * (*sy + rect->height - 1) + 4 * (*sx + rect->width - 1);
-        dst_buffer += dst->stride * (rect->y + rect->height - 1) + 4 * (rect->x + rect->width - 1);
+        src_buffer += src->stride * (*sy + rect->height - 1) + 4 * (*sx);
+        dst_buffer += dst->stride * (rect->y + rect->height - 1) + 4 * (rect->x);
         src_stride = -src->stride;
         dst_stride = -dst->stride;
-        step = -1;
+        backwards = 1;
     }
 
-    /* For each row */
-    for (y=0; y < rect->height; y++) {
-
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Transfer each pixel in row */
-        for (x=0; x < rect->width; x++) {
+    /* For each row */
+    for (y=0; y < rect->height; y++) {
 
-            if (__guac_common_surface_transfer_int(op, src_current, dst_current)) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-            }
+        int first, last;
 
-            src_current += step;
-            dst_current += step;
+        /* Transfer each pixel in row, tracking bounds of changed pixels */
+        if (guac_common_pixel_transfer_row(op, (uint32_t*) src_buffer,
+                    (uint32_t*) dst_buffer, rect->width, backwards,
+                    &first, &last)) {
+            if (first < min_x) min_x = first;
+            if (y < min_y) min_y = y;
+            if (last > max_x) max_x = last;
+            if (y > max_y) max_y = y;
         }
 
         /* Next row */
@@ -1191,13 +1224,6 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
 
     }
 
-    /* Translate X coordinate space of moving backwards */
-    if (step < 0) {
-        int old_max_x = max_x;
-        max_x = rect->width - 1 - min_x;
-        min_x = rect->width - 1 - old_max_x;
-    }
-
     /* Translate Y coordinate space of moving backwards */
     if (dst_stride < 0) {
         int old_max_y = max_y;
@@ -1250,6 +1276,10 @@ guac_common_surface* guac_common_surface_alloc(guac_client* client,
     surface->heat_map = calloc(heat_width * heat_height,
             sizeof(guac_common_surface_heat_cell));
 
+    /* Begin estimating available bandwidth */
+    guac_common_bandwidth_init(&surface->bandwidth, guac_timestamp_current(),
+            socket->bytes_written);
+
     /* Reset clipping rect */
     guac_common_surface_reset_clip(surface);
 
@@ -1268,6 +1298,11 @@ guac_common_surface* guac_common_surface_alloc(guac_client* client,
 
 void guac_common_surface_free(guac_common_surface* surface) {
 
+#ifdef ENABLE_COMMON_VIDEO
+    /* End any video (the layer is being disposed anyway) */
+    __guac_common_surface_stop_video(surface, 0);
+#endif
+
     /* Only dispose of surface if it exists */
     if (surface->realized)
         guac_protocol_send_dispose(surface->socket, surface->layer);
@@ -1275,7 +1310,11 @@ void guac_common_surface_free(guac_common_surface* surface) {
     pthread_mutex_destroy(&surface->_lock);
 
     free(surface->heat_map);
-    free(surface->buffer);
+
+    /* Bound buffers are owned externally */
+    if (!surface->bound)
+        free(surface->buffer);
+
     free(surface);
 
 }
@@ -1318,8 +1357,18 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     __guac_common_bound_rect(surface, &old_rect, NULL, NULL);
     __guac_common_surface_put(old_buffer, old_stride, &sx, &sy, surface, &old_rect, 1);
 
-    /* Free old data */
-    free(old_buffer);
+    /* Free old data, unless owned externally (the new buffer is always owned
+     * by the surface) */
+    if (!surface->bound)
+        free(old_buffer);
+
+    surface->bound = 0;
+    surface->opaque = 0;
+
+#ifdef ENABLE_COMMON_VIDEO
+    /* Video region may no longer fit; resend whatever remains of it */
+    __guac_common_surface_stop_video(surface, 1);
+#endif
 
     /* Allocate completely new heat map (can safely discard old stats) */
     free(surface->heat_map);
@@ -1342,6 +1391,474 @@ complete:
 
 }
 
+/**
+ * Records that the given rectangle of the given surface has changed as the
+ * result of a draw, updating the heat map and either combining the rectangle
+ * with the current dirty rectangle or deferring the current dirty rectangle
+ * to the bitmap queue.
+ *
+ * @param surface
+ *     The surface that changed.
+ *
+ * @param rect
+ *     The rectangle containing all pixels that changed.
+ */
+static void __guac_common_surface_damage(guac_common_surface* surface,
+        guac_common_rect* rect) {
+
+    /* Update the heat map for the update rectangle. */
+    guac_timestamp time = guac_timestamp_current();
+    __guac_common_surface_touch_rect(surface, rect, time);
+
+    /* Flush if not combining */
+    if (!__guac_common_should_combine(surface, rect, 0))
+        __guac_common_surface_flush_deferred(surface);
+
+    /* Always defer draws */
+    __guac_common_mark_dirty(surface, rect);
+
+}
+
+#ifdef ENABLE_COMMON_VIDEO
+static void __guac_common_surface_stop_video(guac_common_surface* surface,
+        int refresh) {
+
+    if (surface->video == NULL)
+        return;
+
+    guac_common_rect rect = *guac_common_video_get_rect(surface->video);
+
+    guac_common_video_free(surface->video);
+    surface->video = NULL;
+    surface->video_candidate_start = 0;
+
+    if (!refresh)
+        return;
+
+    __guac_common_bound_rect(surface, &rect, NULL, NULL);
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    /* Resend region within the same frame as the video layer is removed */
+    guac_common_surface_queue_add(&surface->bitmap_queue, &rect);
+
+}
+
+/**
+ * Encodes the current contents of the region of the given surface being
+ * streamed as video as a new frame. If encoding fails, video is ended and
+ * disabled for the surface.
+ *
+ * @param surface
+ *     The surface whose video should receive a new frame.
+ *
+ * @param now
+ *     The current time.
+ */
+static void __guac_common_surface_write_video_frame(
+        guac_common_surface* surface, guac_timestamp now) {
+
+    const guac_common_rect* rect = guac_common_video_get_rect(surface->video);
+    unsigned char* buffer = surface->buffer + rect->y * surface->stride
+                          + rect->x * 4;
+
+    if (guac_common_video_write_frame(surface->video, buffer, surface->stride,
+                now)) {
+        guac_client_log(surface->client, GUAC_LOG_DEBUG, "Video encoding "
+                "failed. Falling back to images.");
+        __guac_common_surface_stop_video(surface, 1);
+        surface->video_enabled = 0;
+    }
+
+}
+
+/**
+ * Begins streaming the given region of the given surface as video, sending
+ * its current contents as the first frame. The region is expanded to the
+ * VP8 block size where possible.
+ *
+ * @param surface
+ *     The surface containing the region to stream.
+ *
+ * @param region
+ *     The region to stream.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     Non-zero if video was successfully started, zero otherwise.
+ */
+static int __guac_common_surface_start_video(guac_common_surface* surface,
+        const guac_common_rect* region, guac_timestamp now) {
+
+    guac_common_rect rect = *region;
+
+    guac_common_rect max;
+    guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
+    guac_common_rect_expand_to_grid(GUAC_COMMON_SURFACE_VIDEO_BLOCK_SIZE,
+            &rect, &max);
+
+    /* YUV 4:2:0 requires even dimensions */
+    rect.width &= ~1;
+    rect.height &= ~1;
+
+    /* Leave a quarter of any constrained bandwidth for everything else */
+    int64_t bitrate = GUAC_COMMON_SURFACE_VIDEO_BITRATE;
+    if (surface->bandwidth.bytes_per_second != 0) {
+
+        int64_t available = (int64_t) surface->bandwidth.bytes_per_second
+                          * 8 * 3 / 4;
+
+        if (available < bitrate)
+            bitrate = available;
+
+        if (bitrate < GUAC_COMMON_SURFACE_VIDEO_MIN_BITRATE)
+            bitrate = GUAC_COMMON_SURFACE_VIDEO_MIN_BITRATE;
+
+    }
+
+    surface->video = guac_common_video_alloc(surface->client, surface->socket,
+            surface->layer, &rect, bitrate);
+
+    if (surface->video == NULL)
+        return 0;
+
+    surface->video_users = surface->client->connected_users;
+    surface->video_last_update = now;
+
+    __guac_common_surface_write_video_frame(surface, now);
+    return surface->video != NULL;
+
+}
+
+/**
+ * Streams any region of the given surface which has been updated rapidly and
+ * continuously as video, beginning and ending video as necessary. Queued
+ * updates which lie entirely within the region being streamed are marked as
+ * flushed, as they are sent as part of the video.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_video(guac_common_surface* surface) {
+
+    int i;
+
+    /* Video can only be played within visible layers */
+    if (surface->layer->index < 0)
+        return;
+
+    guac_timestamp now = guac_timestamp_current();
+    int started = 0;
+
+    if (surface->video != NULL) {
+
+        /* End video if no longer allowed */
+        if (!surface->video_enabled)
+            __guac_common_surface_stop_video(surface, 1);
+
+        /* Restart video if users have joined or left, as the stream must be
+         * received from the beginning */
+        else if (surface->client->connected_users != surface->video_users) {
+
+            guac_common_rect rect = *guac_common_video_get_rect(surface->video);
+            __guac_common_surface_stop_video(surface, 1);
+
+            if (guac_common_video_supported(surface->client))
+                started = __guac_common_surface_start_video(surface, &rect,
+                        now);
+
+        }
+
+    }
+
+    /* Look for regions which should be streamed as video */
+    else if (surface->video_enabled) {
+
+        guac_common_rect updated;
+        int found = 0;
+
+        /* Determine overall region updated */
+        guac_common_surface_bitmap_rect* current = surface->bitmap_queue.rects;
+        for (i = 0; i < surface->bitmap_queue.length; i++, current++) {
+
+            if (current->flushed)
+                continue;
+
+            if (found)
+                guac_common_rect_extend(&updated, &current->rect);
+            else {
+                updated = current->rect;
+                found = 1;
+            }
+
+        }
+
+        if (found)
+            __guac_common_bound_rect(surface, &updated, NULL, NULL);
+
+        /* Track region for as long as it continues to update rapidly */
+        if (found && updated.width * updated.height
+                    >= GUAC_COMMON_SURFACE_VIDEO_MIN_SIZE
+                && __guac_common_surface_calculate_framerate(surface, &updated)
+                    >= GUAC_COMMON_SURFACE_VIDEO_FRAMERATE) {
+
+            if (surface->video_candidate_start == 0) {
+                surface->video_candidate = updated;
+                surface->video_candidate_start = now;
+            }
+            else
+                guac_common_rect_extend(&surface->video_candidate, &updated);
+
+            surface->video_candidate_last = now;
+
+        }
+
+        else if (surface->video_candidate_start != 0
+                && now - surface->video_candidate_last
+                    > GUAC_COMMON_SURFACE_VIDEO_IDLE_TIMEOUT)
+            surface->video_candidate_start = 0;
+
+        /* Stream region as video once it has updated rapidly for long
+         * enough, if all users support video */
+        if (surface->video_candidate_start != 0
+                && now - surface->video_candidate_start
+                    >= GUAC_COMMON_SURFACE_VIDEO_DURATION) {
+
+            if (guac_common_video_supported(surface->client))
+                started = __guac_common_surface_start_video(surface,
+                        &surface->video_candidate, now);
+
+            /* Try again later if video could not be started */
+            if (!started)
+                surface->video_candidate_start = 0;
+
+        }
+
+    }
+
+    if (surface->video == NULL)
+        return;
+
+    const guac_common_rect* video_rect =
+        guac_common_video_get_rect(surface->video);
+
+    /* Updates entirely within the video are sent as part of the video,
+     * while updates which only partially overlap are sent both ways */
+    int updated = 0;
+    guac_common_surface_bitmap_rect* current = surface->bitmap_queue.rects;
+    for (i = 0; i < surface->bitmap_queue.length; i++, current++) {
+
+        if (current->flushed)
+            continue;
+
+        int intersection = guac_common_rect_intersects(&current->rect,
+                video_rect);
+
+        if (intersection == 2)
+            current->flushed = 1;
+
+        if (intersection)
+            updated = 1;
+
+    }
+
+    if (updated) {
+        surface->video_last_update = now;
+        if (!started)
+            __guac_common_surface_write_video_frame(surface, now);
+    }
+
+    /* End video once region is no longer updating */
+    else if (now - surface->video_last_update
+            > GUAC_COMMON_SURFACE_VIDEO_IDLE_TIMEOUT)
+        __guac_common_surface_stop_video(surface, 1);
+
+}
+#endif
+
+/**
+ * Copies data from the given buffer to the surface at the given coordinates
+ * one damage tile at a time, recording the changed portion of each tile as
+ * separate damage. Tiles are aligned to multiples of
+ * GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE relative to the surface origin.
+ *
+ * @param src_buffer
+ *     The buffer to copy.
+ *
+ * @param src_stride
+ *     The number of bytes in each row of the source buffer.
+ *
+ * @param sx
+ *     The X coordinate of the source rectangle.
+ *
+ * @param sy
+ *     The Y coordinate of the source rectangle.
+ *
+ * @param dst
+ *     The destination surface.
+ *
+ * @param rect
+ *     The destination rectangle, which must already be clipped.
+ *
+ * @param opaque
+ *     Non-zero if the source surface is opaque (its alpha channel should be
+ *     ignored), zero otherwise.
+ */
+static void __guac_common_surface_put_tiled(unsigned char* src_buffer,
+        int src_stride, int sx, int sy, guac_common_surface* dst,
+        const guac_common_rect* rect, int opaque) {
+
+    int tile_size = GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE;
+    int right = rect->x + rect->width;
+    int bottom = rect->y + rect->height;
+
+    int tile_x, tile_y;
+
+    /* For each row of tiles */
+    for (tile_y = rect->y; tile_y < bottom;) {
+
+        int tile_bottom = (tile_y / tile_size + 1) * tile_size;
+        if (tile_bottom > bottom)
+            tile_bottom = bottom;
+
+        /* For each tile in row */
+        for (tile_x = rect->x; tile_x < right;) {
+
+            int tile_right = (tile_x / tile_size + 1) * tile_size;
+            if (tile_right > right)
+                tile_right = right;
+
+            guac_common_rect tile;
+            guac_common_rect_init(&tile, tile_x, tile_y,
+                    tile_right - tile_x, tile_bottom - tile_y);
+
+            /* Update tile, recording only the pixels which changed */
+            int tile_sx = sx + tile_x - rect->x;
+            int tile_sy = sy + tile_y - rect->y;
+            __guac_common_surface_put(src_buffer, src_stride,
+                    &tile_sx, &tile_sy, dst, &tile, opaque);
+
+            if (tile.width > 0 && tile.height > 0)
+                __guac_common_surface_damage(dst, &tile);
+
+            tile_x = tile_right;
+
+        }
+
+        tile_y = tile_bottom;
+
+    }
+
+}
+
+void guac_common_surface_bind(guac_common_surface* surface,
+        unsigned char* buffer, int stride, int w, int h, int opaque) {
+
+    pthread_mutex_lock(&surface->_lock);
+
+    /* Free old data, unless owned externally */
+    if (!surface->bound)
+        free(surface->buffer);
+
+    surface->buffer = buffer;
+    surface->stride = stride;
+    surface->bound = 1;
+    surface->opaque = opaque;
+
+    /* Update dimensions only if changed */
+    if (w != surface->width || h != surface->height) {
+
+        surface->width  = w;
+        surface->height = h;
+        __guac_common_bound_rect(surface, &surface->clip_rect, NULL, NULL);
+
+#ifdef ENABLE_COMMON_VIDEO
+        /* Video region may no longer fit; resend whatever remains of it */
+        __guac_common_surface_stop_video(surface, 1);
+#endif
+
+        /* Allocate completely new heat map (can safely discard old stats) */
+        int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
+        int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
+        free(surface->heat_map);
+        surface->heat_map = calloc(heat_width * heat_height,
+                sizeof(guac_common_surface_heat_cell));
+
+        /* Resize dirty rect to fit new surface dimensions */
+        if (surface->dirty) {
+            __guac_common_bound_rect(surface, &surface->dirty_rect, NULL, NULL);
+            if (surface->dirty_rect.width <= 0 || surface->dirty_rect.height <= 0)
+                surface->dirty = 0;
+        }
+
+        /* Update Guacamole layer */
+        if (surface->realized)
+            guac_protocol_send_size(surface->socket, surface->layer, w, h);
+
+    }
+
+    /* Contents of the new buffer are unknown */
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 0, 0, w, h);
+    if (rect.width > 0 && rect.height > 0)
+        __guac_common_surface_damage(surface, &rect);
+
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_unbind(guac_common_surface* surface) {
+
+    pthread_mutex_lock(&surface->_lock);
+
+    /* Ignore if buffer is already owned by the surface */
+    if (!surface->bound)
+        goto complete;
+
+    unsigned char* old_buffer = surface->buffer;
+    int old_stride = surface->stride;
+
+    int sx = 0;
+    int sy = 0;
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 0, 0, surface->width, surface->height);
+
+    /* Copy current contents into a buffer owned by the surface */
+    surface->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32,
+            surface->width);
+    surface->buffer = calloc(surface->height, surface->stride);
+    __guac_common_surface_put(old_buffer, old_stride, &sx, &sy, surface,
+            &rect, surface->opaque);
+
+    surface->bound = 0;
+    surface->opaque = 0;
+
+complete:
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_invalidate(guac_common_surface* surface,
+        int x, int y, int w, int h) {
+
+    pthread_mutex_lock(&surface->_lock);
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, x, y, w, h);
+
+    /* The buffer was modified directly, so the clipping region does not
+     * apply, only the bounds of the surface */
+    __guac_common_bound_rect(surface, &rect, NULL, NULL);
+    if (rect.width > 0 && rect.height > 0)
+        __guac_common_surface_damage(surface, &rect);
+
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
 void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_surface_t* src) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -1363,21 +1880,21 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
+    /* Update backing surface tile by tile if the draw is large enough that
+     * reducing the changed area to a single bounding box may be wasteful */
+    if (rect.width > GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE
+            || rect.height > GUAC_COMMON_SURFACE_DAMAGE_TILE_SIZE) {
+        __guac_common_surface_put_tiled(buffer, stride, sx, sy, surface,
+                &rect, format != CAIRO_FORMAT_ARGB32);
+        goto complete;
+    }
+
     /* Update backing surface */
     __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, format != CAIRO_FORMAT_ARGB32);
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
-    /* Update the heat map for the update rectangle. */
-    guac_timestamp time = guac_timestamp_current();
-    __guac_common_surface_touch_rect(surface, &rect, time);
-
-    /* Flush if not combining */
-    if (!__guac_common_should_combine(surface, &rect, 0))
-        __guac_common_surface_flush_deferred(surface);
-
-    /* Always defer draws */
-    __guac_common_mark_dirty(surface, &rect);
+    __guac_common_surface_damage(surface, &rect);
 
 complete:
     pthread_mutex_unlock(&surface->_lock);
@@ -1452,6 +1969,13 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
     /* NOTE: Being the last rectangle to be adjusted, only the width/height of
      * drect is now correct! */
 
+    /* The source cannot be read client-side if streamed as video */
+    guac_common_rect visible_srect;
+    guac_common_rect_init(&visible_srect, srect.x, srect.y,
+            drect.width, drect.height);
+    int src_stale = __guac_common_surface_video_intersects(src,
+            &visible_srect);
+
     /* Update backing surface first only if drect cannot intersect srect */
     if (src != dst) {
         __guac_common_surface_transfer(src, &srect.x, &srect.y,
@@ -1461,7 +1985,7 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
     }
 
     /* Defer if combining */
-    if (__guac_common_should_combine(dst, &drect, 1))
+    if (src_stale || __guac_common_should_combine(dst, &drect, 1))
         __guac_common_mark_dirty(dst, &drect);
 
     /* Otherwise, flush and draw immediately */
@@ -1520,6 +2044,13 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
     /* NOTE: Being the last rectangle to be adjusted, only the width/height of
      * drect is now correct! */
 
+    /* The source cannot be read client-side if streamed as video */
+    guac_common_rect visible_srect;
+    guac_common_rect_init(&visible_srect, srect.x, srect.y,
+            drect.width, drect.height);
+    int src_stale = __guac_common_surface_video_intersects(src,
+            &visible_srect);
+
     /* Update backing surface first only if drect cannot intersect srect */
     if (src != dst) {
         __guac_common_surface_transfer(src, &srect.x, &srect.y, op, dst, &drect);
@@ -1528,7 +2059,7 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
     }
 
     /* Defer if combining */
-    if (__guac_common_should_combine(dst, &drect, 1))
+    if (src_stale || __guac_common_should_combine(dst, &drect, 1))
         __guac_common_mark_dirty(dst, &drect);
 
     /* Otherwise, flush and draw immediately */
@@ -1692,26 +2223,46 @@ static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
 }
 
 /**
- * Returns an appropriate quality between 0 and 100 for lossy encoding
- * depending on the current processing lag calculated for the given client.
+ * Returns an appropriate quality between 0 and 100 for lossy encoding of the
+ * dirty rectangle of the given surface, depending on the current processing
+ * lag calculated for the client and on the time that the encoded rectangle
+ * is estimated to take to transfer.
+ *
+ * @param surface
+ *     The surface whose dirty rectangle is being encoded.
  *
- * @param client
- *     The client for which the lossy quality is being calculated.
+ * @param encoder
+ *     The lossy encoder being used.
  *
  * @return
  *     A value between 0 and 100 inclusive which seems appropriate for the
- *     client based on lag measurements.
+ *     client based on lag and bandwidth measurements.
  */
-static int guac_common_surface_suggest_quality(guac_client* client) {
+static int guac_common_surface_suggest_quality(guac_common_surface* surface,
+        guac_common_encoder encoder) {
 
-    int lag = guac_client_get_processing_lag(client);
+    int lag = guac_client_get_processing_lag(surface->client);
 
     /* Scale quality linearly from 90 to 30 as lag varies from 20ms to 80ms */
     int quality = 90 - (lag - 20);
 
     /* Do not exceed 90 for quality */
     if (quality > 90)
-        return 90;
+        quality = 90;
+
+    /* Reduce quality proportionally if the update would otherwise take
+     * longer than the latency budget to transfer */
+    guac_common_encoder_cost cost;
+    __guac_common_surface_get_encoder_cost(surface, &surface->dirty_rect,
+            encoder, &cost);
+
+    int64_t transfer = guac_common_encoder_cost_estimate_transfer(&cost,
+            &surface->bandwidth,
+            surface->dirty_rect.width * surface->dirty_rect.height);
+
+    if (transfer > GUAC_COMMON_SURFACE_LATENCY_BUDGET * 1000)
+        quality = quality * GUAC_COMMON_SURFACE_LATENCY_BUDGET * 1000
+                / transfer;
 
     /* Do not go below 30 for quality */
     if (quality < 30)
@@ -1757,7 +2308,8 @@ static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
         /* Send JPEG for rect */
         guac_client_stream_jpeg(surface->client, socket, GUAC_COMP_OVER, layer,
                 surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client));
+                guac_common_surface_suggest_quality(surface,
+                    GUAC_COMMON_ENCODER_JPEG));
 
         cairo_surface_destroy(rect);
         surface->realized = 1;
@@ -1819,7 +2371,8 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
         /* Send WebP for rect */
         guac_client_stream_webp(surface->client, socket, GUAC_COMP_OVER, layer,
                 surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client),
+                guac_common_surface_suggest_quality(surface,
+                    GUAC_COMMON_ENCODER_WEBP),
                 surface->lossless ? 1 : 0);
 
         cairo_surface_destroy(rect);
@@ -1832,29 +2385,6 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
 
 }
 
-/**
- * Comparator for instances of guac_common_surface_bitmap_rect, the elements
- * which make up a surface's bitmap buffer.
- *
- * @see qsort
- */
-static int __guac_common_surface_bitmap_rect_compare(const void* a, const void* b) {
-
-    guac_common_surface_bitmap_rect* ra = (guac_common_surface_bitmap_rect*) a;
-    guac_common_surface_bitmap_rect* rb = (guac_common_surface_bitmap_rect*) b;
-
-    /* Order roughly top to bottom, left to right */
-    if (ra->rect.y != rb->rect.y) return ra->rect.y - rb->rect.y;
-    if (ra->rect.x != rb->rect.x) return ra->rect.x - rb->rect.x;
-
-    /* Wider updates should come first (more likely to intersect later) */
-    if (ra->rect.width != rb->rect.width) return rb->rect.width - ra->rect.width;
-
-    /* Shorter updates should come first (less likely to increase cost) */
-    return ra->rect.height - rb->rect.height;
-
-}
-
 /**
  * Flushes only the properties of the given surface, such as layer location or
  * opacity. Image state is not flushed. If the surface represents a buffer or
@@ -1892,86 +2422,73 @@ static void __guac_common_surface_flush(guac_common_surface* surface) {
     /* Flush final dirty rectangle to queue. */
     __guac_common_surface_flush_to_queue(surface);
 
-    guac_common_surface_bitmap_rect* current = surface->bitmap_queue;
-    int i, j;
-    int original_queue_length;
-    int flushed = 0;
-
-    original_queue_length = surface->bitmap_queue_length;
-
-    /* Sort updates to make combination less costly */
-    qsort(surface->bitmap_queue, surface->bitmap_queue_length, sizeof(guac_common_surface_bitmap_rect),
-          __guac_common_surface_bitmap_rect_compare);
+    /* Update bandwidth estimate prior to selecting encoders for any pending
+     * updates */
+    if (surface->bitmap_queue.length > 0)
+        guac_common_bandwidth_update(&surface->bandwidth,
+                guac_timestamp_current(), surface->socket->bytes_written,
+                guac_client_get_processing_lag(surface->client));
 
-    /* Flush all rects in queue */
-    for (i=0; i < surface->bitmap_queue_length; i++) {
-
-        /* Get next unflushed candidate */
-        guac_common_surface_bitmap_rect* candidate = current;
-        if (!candidate->flushed) {
-
-            int combined = 0;
-
-            /* Build up rect as much as possible */
-            for (j=i; j < surface->bitmap_queue_length; j++) {
-
-                if (!candidate->flushed) {
-
-                    /* Clip candidate within current bounds */
-                    __guac_common_bound_rect(surface, &candidate->rect, NULL, NULL);
-                    if (candidate->rect.width <= 0 || candidate->rect.height <= 0)
-                        candidate->flushed = 1;
+#ifdef ENABLE_COMMON_VIDEO
+    /* Send rapidly-updating regions as video rather than images */
+    __guac_common_surface_flush_video(surface);
+#endif
 
-                    /* Combine if reasonable */
-                    else if (__guac_common_should_combine(surface, &candidate->rect, 0) || !surface->dirty) {
-                        __guac_common_mark_dirty(surface, &candidate->rect);
-                        candidate->flushed = 1;
-                        combined++;
-                    }
+    /* Queued updates have already been combined as they were queued, and
+     * need only be sent */
+    guac_common_surface_bitmap_rect* current = surface->bitmap_queue.rects;
+    int i;
 
-                }
+    for (i = 0; i < surface->bitmap_queue.length; i++, current++) {
 
-                candidate++;
+        if (current->flushed)
+            continue;
 
-            }
+        /* Clip update within current bounds */
+        __guac_common_bound_rect(surface, &current->rect, NULL, NULL);
+        if (current->rect.width <= 0 || current->rect.height <= 0)
+            continue;
 
-            /* Re-add to queue if there's room and this update was modified or we expect others might be */
-            if ((combined > 1 || i < original_queue_length)
-                    && surface->bitmap_queue_length < GUAC_COMMON_SURFACE_QUEUE_SIZE)
-                __guac_common_surface_flush_to_queue(surface);
+        __guac_common_mark_dirty(surface, &current->rect);
+        current->flushed = 1;
 
-            /* Flush as bitmap otherwise */
-            else if (surface->dirty) {
+        int opaque = __guac_common_surface_is_opaque(surface,
+                    &surface->dirty_rect);
 
-                flushed++;
+        guac_common_encoder encoder =
+            __guac_common_surface_select_encoder(surface,
+                    &surface->dirty_rect, opaque);
 
-                int opaque = __guac_common_surface_is_opaque(surface,
-                            &surface->dirty_rect);
+        /* Measure cost of encoding for future selections */
+        uint64_t start_bytes = surface->socket->bytes_written;
+        int64_t start_time = guac_common_encoder_clock();
 
-                /* Prefer WebP when reasonable */
-                if (__guac_common_surface_should_use_webp(surface,
-                            &surface->dirty_rect))
-                    __guac_common_surface_flush_to_webp(surface, opaque);
+        switch (encoder) {
 
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (opaque && __guac_common_surface_should_use_jpeg(
-                            surface, &surface->dirty_rect))
-                    __guac_common_surface_flush_to_jpeg(surface);
+            case GUAC_COMMON_ENCODER_WEBP:
+                __guac_common_surface_flush_to_webp(surface, opaque);
+                break;
 
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    __guac_common_surface_flush_to_png(surface, opaque);
+            case GUAC_COMMON_ENCODER_JPEG:
+                __guac_common_surface_flush_to_jpeg(surface);
+                break;
 
-            }
+            default:
+                __guac_common_surface_flush_to_png(surface, opaque);
 
         }
 
-        current++;
+        /* Lossy encodings may have expanded the dirty rect to cover
+         * everything actually encoded */
+        __guac_common_surface_record_encoder_cost(surface,
+                &surface->dirty_rect, encoder,
+                surface->socket->bytes_written - start_bytes,
+                guac_common_encoder_clock() - start_time);
 
     }
 
     /* Flush complete */
-    surface->bitmap_queue_length = 0;
+    guac_common_surface_queue_clear(&surface->bitmap_queue);
 
 }
 
@@ -2024,7 +2541,8 @@ void guac_common_surface_dup(guac_common_surface* surface, guac_user* user,
 
         /* Get entire surface */
         cairo_surface_t* rect = cairo_image_surface_create_for_data(
-                surface->buffer, CAIRO_FORMAT_ARGB32,
+                surface->buffer,
+                surface->opaque ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32,
                 surface->width, surface->height, surface->stride);
 
         /* Send PNG for rect */
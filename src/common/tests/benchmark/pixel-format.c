@@ -0,0 +1,231 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Benchmark comparing per-pixel conversion of VNC framebuffer pixel formats
+ * against each implementation of the conversion kernels selected by
+ * guac_common_pixel_converter, converting a full 1920x1080 frame. This is not
+ * run as part of "make check"; build and run it explicitly with
+ * "make bench_common_pixel_format".
+ */
+
+#include "common/pixel.h"
+#include "common/pixel-format.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The width of the benchmarked frame, in pixels.
+ */
+#define BENCH_WIDTH 1920
+
+/**
+ * The height of the benchmarked frame, in pixels.
+ */
+#define BENCH_HEIGHT 1080
+
+/**
+ * The number of times each frame is converted.
+ */
+#define BENCH_ITERATIONS 50
+
+/**
+ * The name of each implementation, indexed by guac_common_pixel_impl.
+ */
+static const char* BENCH_IMPL_NAMES[] = {
+    [GUAC_COMMON_PIXEL_SCALAR] = "scalar",
+    [GUAC_COMMON_PIXEL_SSE41]  = "sse4.1",
+    [GUAC_COMMON_PIXEL_AVX2]   = "avx2"
+};
+
+/**
+ * A named pixel format.
+ */
+typedef struct bench_format {
+
+    /**
+     * Human-readable name of the pixel format.
+     */
+    const char* name;
+
+    /**
+     * The pixel format.
+     */
+    guac_common_pixel_format format;
+
+} bench_format;
+
+/**
+ * All benchmarked pixel formats, including each format that the VNC client
+ * may request.
+ */
+static const bench_format BENCH_FORMATS[] = {
+    { "8bpp",           {  8,  0,  3,  6, 0x07, 0x07, 0x03, 0 } },
+    { "16bpp",          { 16, 11,  5,  0, 0x1F, 0x3F, 0x1F, 0 } },
+    { "32bpp",          { 32, 16,  8,  0, 0xFF, 0xFF, 0xFF, 0 } },
+    { "32bpp (swap)",   { 32, 16,  8,  0, 0xFF, 0xFF, 0xFF, 1 } }
+};
+
+/**
+ * Source frame (the VNC framebuffer). Only the first byte or two of each
+ * pixel is used for 8 and 16-bit formats.
+ */
+static uint32_t bench_src[BENCH_WIDTH * BENCH_HEIGHT];
+
+/**
+ * Destination frame (the buffer drawn to the display surface).
+ */
+static uint32_t bench_dst[BENCH_WIDTH * BENCH_HEIGHT];
+
+/**
+ * Returns the current value of a monotonic clock, in seconds.
+ *
+ * @return
+ *     The current value of a monotonic clock, in seconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Converts the full frame one pixel at a time, as VNC updates were
+ * converted prior to the introduction of guac_common_pixel_converter.
+ *
+ * @param format
+ *     The pixel format of the source frame.
+ */
+static void bench_convert_per_pixel(const guac_common_pixel_format* format) {
+
+    int bpp = format->bits_per_pixel / 8;
+    const unsigned char* src = (const unsigned char*) bench_src;
+
+    int i;
+    for (i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; i++) {
+
+        uint32_t v;
+        switch (bpp) {
+            case 4: v = *((const uint32_t*) src); break;
+            case 2: v = *((const uint16_t*) src); break;
+            default: v = *src;
+        }
+
+        bench_dst[i] = guac_common_pixel_format_convert(format, v);
+        src += bpp;
+
+    }
+
+}
+
+/**
+ * Converts the full frame row by row using the given converter.
+ *
+ * @param converter
+ *     The converter to use.
+ */
+static void bench_convert_rows(const guac_common_pixel_converter* converter) {
+
+    int bpp = guac_common_pixel_converter_get_format(converter)->bits_per_pixel
+        / 8;
+    const unsigned char* src = (const unsigned char*) bench_src;
+
+    int y;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_convert_row(converter, bench_dst + y * BENCH_WIDTH,
+                src + y * BENCH_WIDTH * bpp, BENCH_WIDTH);
+
+}
+
+/**
+ * Prints a single line of benchmark results.
+ *
+ * @param format
+ *     The name of the benchmarked pixel format.
+ *
+ * @param impl
+ *     The name of the benchmarked implementation.
+ *
+ * @param elapsed
+ *     The total time taken by all iterations, in seconds.
+ */
+static void bench_report(const char* format, const char* impl,
+        double elapsed) {
+    printf("%-16s %-10s %12.3f %12.1f\n", format, impl,
+            elapsed * 1000.0 / BENCH_ITERATIONS,
+            (double) BENCH_WIDTH * BENCH_HEIGHT * BENCH_ITERATIONS
+                / elapsed / 1e6);
+}
+
+int main() {
+
+    int format, impl, i;
+    double start;
+
+    uint32_t seed = 1;
+    for (i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; i++) {
+        seed = seed * 1103515245 + 12345;
+        bench_src[i] = seed;
+    }
+
+    printf("%-16s %-10s %12s %12s\n", "format", "impl", "ms/frame",
+            "Mpixel/s");
+
+    int format_count = sizeof(BENCH_FORMATS) / sizeof(BENCH_FORMATS[0]);
+    for (format = 0; format < format_count; format++) {
+
+        const bench_format* current = &BENCH_FORMATS[format];
+
+        bench_convert_per_pixel(&current->format);
+        start = bench_now();
+        for (i = 0; i < BENCH_ITERATIONS; i++)
+            bench_convert_per_pixel(&current->format);
+        bench_report(current->name, "per-pixel", bench_now() - start);
+
+        for (impl = GUAC_COMMON_PIXEL_SCALAR; impl <= GUAC_COMMON_PIXEL_AVX2;
+                impl++) {
+
+            if (guac_common_pixel_set_impl(impl))
+                continue;
+
+            guac_common_pixel_converter* converter =
+                guac_common_pixel_converter_alloc(&current->format);
+
+            /* Warm up caches (including any lookup table) */
+            bench_convert_rows(converter);
+
+            start = bench_now();
+            for (i = 0; i < BENCH_ITERATIONS; i++)
+                bench_convert_rows(converter);
+            bench_report(current->name, BENCH_IMPL_NAMES[impl],
+                    bench_now() - start);
+
+            guac_common_pixel_converter_free(converter);
+
+        }
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
@@ -0,0 +1,280 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Benchmark comparing the available implementations of the row-level pixel
+ * operations used by guac_common_surface, using update patterns typical of a
+ * 1920x1080 remote desktop. This is not run as part of "make check"; build
+ * and run it explicitly with "make bench_common_pixel".
+ */
+
+#include "common/pixel.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The width of the benchmarked frame, in pixels.
+ */
+#define BENCH_WIDTH 1920
+
+/**
+ * The height of the benchmarked frame, in pixels.
+ */
+#define BENCH_HEIGHT 1080
+
+/**
+ * The number of times each pattern is applied to the full frame.
+ */
+#define BENCH_ITERATIONS 50
+
+/**
+ * The number of rows scrolled by the scrolling pattern, as when scrolling a
+ * text editor or browser by a few lines.
+ */
+#define BENCH_SCROLL_ROWS 48
+
+/**
+ * The name of each implementation, indexed by guac_common_pixel_impl.
+ */
+static const char* BENCH_IMPL_NAMES[] = {
+    [GUAC_COMMON_PIXEL_SCALAR] = "scalar",
+    [GUAC_COMMON_PIXEL_SSE41]  = "sse4.1",
+    [GUAC_COMMON_PIXEL_AVX2]   = "avx2"
+};
+
+/**
+ * Source frame (as decoded from the remote desktop protocol).
+ */
+static uint32_t bench_src[BENCH_WIDTH * BENCH_HEIGHT];
+
+/**
+ * Destination frame (the guac_common_surface backing buffer).
+ */
+static uint32_t bench_dst[BENCH_WIDTH * BENCH_HEIGHT];
+
+/**
+ * Returns the current value of a monotonic clock, in seconds.
+ *
+ * @return
+ *     The current value of a monotonic clock, in seconds.
+ */
+static double bench_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Fills the given frame with a deterministic, mostly-opaque pattern which
+ * resembles desktop content closely enough to exercise blending.
+ *
+ * @param frame
+ *     The frame to fill.
+ *
+ * @param seed
+ *     Arbitrary value varying the pattern.
+ */
+static void bench_fill(uint32_t* frame, uint32_t seed) {
+
+    int i;
+    for (i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t alpha = (seed >> 28) == 0 ? 0x80 : 0xFF;
+        frame[i] = (alpha << 24) | ((seed >> 8) & 0x7F7F7F);
+    }
+
+}
+
+/**
+ * Full-frame opaque update in which every pixel changes, as when switching
+ * between applications.
+ */
+static void bench_put_changed() {
+
+    /* Shift source rows with each frame such that every row changes */
+    static int frame = 0;
+    frame++;
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_put_row(bench_dst + y * BENCH_WIDTH,
+                bench_src + ((y + frame) % BENCH_HEIGHT) * BENCH_WIDTH,
+                BENCH_WIDTH, 1, &first, &last);
+
+}
+
+/**
+ * Full-frame opaque update in which nothing changes (after the untimed
+ * warm-up frame), as when a remote desktop server resends an entire frame
+ * containing only a blinking cursor.
+ */
+static void bench_put_unchanged() {
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_put_row(bench_dst + y * BENCH_WIDTH,
+                bench_src + y * BENCH_WIDTH, BENCH_WIDTH, 1, &first, &last);
+
+}
+
+/**
+ * Full-frame blended update, as when compositing translucent windows.
+ */
+static void bench_put_blend() {
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_put_row(bench_dst + y * BENCH_WIDTH,
+                bench_src + y * BENCH_WIDTH, BENCH_WIDTH, 0, &first, &last);
+
+}
+
+/**
+ * Vertical scroll of the full frame using GUAC_TRANSFER_BINARY_SRC, as
+ * performed by the RDP screen-to-screen blit order.
+ */
+static void bench_transfer_scroll() {
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT - BENCH_SCROLL_ROWS; y++)
+        guac_common_pixel_transfer_row(GUAC_TRANSFER_BINARY_SRC,
+                bench_dst + (y + BENCH_SCROLL_ROWS) * BENCH_WIDTH,
+                bench_dst + y * BENCH_WIDTH, BENCH_WIDTH, 0, &first, &last);
+
+}
+
+/**
+ * Full-frame GUAC_TRANSFER_BINARY_XOR, as used by RDP for drawing selection
+ * rectangles and similar inverted regions.
+ */
+static void bench_transfer_xor() {
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_transfer_row(GUAC_TRANSFER_BINARY_XOR,
+                bench_src + y * BENCH_WIDTH, bench_dst + y * BENCH_WIDTH,
+                BENCH_WIDTH, 0, &first, &last);
+
+}
+
+/**
+ * Full-frame solid fill, as when clearing the screen.
+ */
+static void bench_set() {
+
+    static uint32_t color = 0xFF000000;
+    color ^= 0x00FFFFFF;
+
+    int y, first, last;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_set_row(bench_dst + y * BENCH_WIDTH, color,
+                BENCH_WIDTH, &first, &last);
+
+}
+
+/**
+ * Full-frame stencil fill, as used for RDP glyph rendering.
+ */
+static void bench_fill_mask() {
+
+    int y;
+    for (y = 0; y < BENCH_HEIGHT; y++)
+        guac_common_pixel_fill_mask_row(bench_dst + y * BENCH_WIDTH,
+                bench_src + y * BENCH_WIDTH, 0xFF336699, BENCH_WIDTH);
+
+}
+
+/**
+ * A named benchmark pattern.
+ */
+typedef struct bench_pattern {
+
+    /**
+     * Human-readable name of the pattern.
+     */
+    const char* name;
+
+    /**
+     * Function which applies the pattern once to the full frame.
+     */
+    void (*run)();
+
+} bench_pattern;
+
+/**
+ * All benchmarked patterns.
+ */
+static const bench_pattern BENCH_PATTERNS[] = {
+    { "put (all changed)", bench_put_changed     },
+    { "put (unchanged)",   bench_put_unchanged   },
+    { "put (blend)",       bench_put_blend       },
+    { "transfer (scroll)", bench_transfer_scroll },
+    { "transfer (xor)",    bench_transfer_xor    },
+    { "set",               bench_set             },
+    { "fill mask",         bench_fill_mask       }
+};
+
+int main() {
+
+    int pattern, impl, i;
+
+    printf("%-20s %-8s %12s %12s\n", "pattern", "impl", "ms/frame",
+            "Mpixel/s");
+
+    int pattern_count = sizeof(BENCH_PATTERNS) / sizeof(BENCH_PATTERNS[0]);
+    for (pattern = 0; pattern < pattern_count; pattern++) {
+
+        for (impl = GUAC_COMMON_PIXEL_SCALAR; impl <= GUAC_COMMON_PIXEL_AVX2;
+                impl++) {
+
+            if (guac_common_pixel_set_impl(impl))
+                continue;
+
+            bench_fill(bench_src, 1);
+            bench_fill(bench_dst, 2);
+
+            /* Warm up caches (and establish the state expected by patterns
+             * which assume a previous frame) */
+            BENCH_PATTERNS[pattern].run();
+
+            double start = bench_now();
+            for (i = 0; i < BENCH_ITERATIONS; i++)
+                BENCH_PATTERNS[pattern].run();
+            double elapsed = bench_now() - start;
+
+            printf("%-20s %-8s %12.3f %12.1f\n", BENCH_PATTERNS[pattern].name,
+                    BENCH_IMPL_NAMES[impl],
+                    elapsed * 1000.0 / BENCH_ITERATIONS,
+                    (double) BENCH_WIDTH * BENCH_HEIGHT * BENCH_ITERATIONS
+                        / elapsed / 1e6);
+
+        }
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/clipboard.h"
+#include "common/iconv.h"
+
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Test which verifies that the clipboard grows to fit appended data, and
+ * truncates data only once its maximum length is reached.
+ */
+void test_clipboard__append() {
+
+    char data[10000];
+    memset(data, 'x', sizeof(data));
+
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc(16384);
+    guac_common_clipboard_reset(clipboard, "text/plain");
+
+    /* Data is stored verbatim while it fits */
+    CU_ASSERT_EQUAL(0, guac_common_clipboard_append(clipboard, data, sizeof(data)));
+    CU_ASSERT_EQUAL(sizeof(data), clipboard->length);
+
+    /* Data beyond the maximum length is truncated */
+    CU_ASSERT_NOT_EQUAL(0, guac_common_clipboard_append(clipboard, data, sizeof(data)));
+    CU_ASSERT_EQUAL(16384, clipboard->length);
+    CU_ASSERT_EQUAL(16384, clipboard->available);
+
+    /* Resetting the clipboard allows data to be stored once again */
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    CU_ASSERT_EQUAL(0, guac_common_clipboard_append(clipboard, "abc", 3));
+    CU_ASSERT_EQUAL(3, clipboard->length);
+    CU_ASSERT_EQUAL(0, memcmp(clipboard->buffer, "abc", 3));
+
+    guac_common_clipboard_free(clipboard);
+
+}
+
+/**
+ * Test which verifies that text appended with guac_common_clipboard_append_text()
+ * is converted to UTF-8, growing the clipboard as needed and never storing
+ * partial characters.
+ */
+void test_clipboard__append_text() {
+
+    /* Lines of "papà" with CRLF line endings as CP-1252, each of which is
+     * also 6 bytes once converted to UTF-8 with Unix line endings */
+    char input[6000];
+    for (int i = 0; i < (int) sizeof(input); i += 6)
+        memcpy(input + i, "pap\xE0\r\n", 6);
+
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc(65536);
+    guac_common_clipboard_reset(clipboard, "text/plain");
+
+    CU_ASSERT_EQUAL(0, guac_common_clipboard_append_text(clipboard,
+                GUAC_READ_CP1252_NORMALIZED, input, sizeof(input)));
+
+    /* Each line is "pap\xC3\xA0\n" once converted */
+    CU_ASSERT_EQUAL(sizeof(input), clipboard->length);
+    for (int i = 0; i < clipboard->length; i += 6)
+        CU_ASSERT_EQUAL(0, memcmp(clipboard->buffer + i, "pap\xC3\xA0\n", 6));
+
+    guac_common_clipboard_free(clipboard);
+
+    /* Truncation never splits a character */
+    clipboard = guac_common_clipboard_alloc(7);
+    guac_common_clipboard_reset(clipboard, "text/plain");
+
+    CU_ASSERT_NOT_EQUAL(0, guac_common_clipboard_append_text(clipboard,
+                GUAC_READ_CP1252, "\xE0\xE0\xE0\xE0", 4));
+    CU_ASSERT_EQUAL(6, clipboard->length);
+    CU_ASSERT_EQUAL(0, memcmp(clipboard->buffer, "\xC3\xA0\xC3\xA0\xC3\xA0", 6));
+
+    guac_common_clipboard_free(clipboard);
+
+}
+
+/**
+ * Test which verifies that guac_common_clipboard_convert() converts the
+ * entire contents of the clipboard, regardless of size, always producing
+ * null-terminated output.
+ */
+void test_clipboard__convert() {
+
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc(65536);
+    guac_common_clipboard_reset(clipboard, "text/plain");
+
+    /* Append several thousand lines of UTF-8 */
+    for (int i = 0; i < 4000; i++)
+        guac_common_clipboard_append(clipboard, "\xC3\xA8\n", 3);
+
+    /* Convert to UTF-16 with CRLF line endings (8 bytes per line) */
+    int length;
+    char* output = guac_common_clipboard_convert(clipboard, GUAC_READ_UTF8,
+            GUAC_WRITE_UTF16_CRLF, &length);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(output);
+    CU_ASSERT_EQUAL(4000 * 6 + 2, length);
+
+    const char expected[] = "\xE8\x00" "\r\x00" "\n\x00";
+    for (int i = 0; i < 4000 * 6; i += 6)
+        CU_ASSERT_EQUAL(0, memcmp(output + i, expected, 6));
+
+    CU_ASSERT_EQUAL(0, output[length - 2]);
+    CU_ASSERT_EQUAL(0, output[length - 1]);
+    free(output);
+
+    /* Empty clipboards convert to an empty string */
+    guac_common_clipboard_reset(clipboard, "text/plain");
+    output = guac_common_clipboard_convert(clipboard, GUAC_READ_UTF8,
+            GUAC_WRITE_CP1252, &length);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(output);
+    CU_ASSERT_EQUAL(1, length);
+    CU_ASSERT_EQUAL(0, output[0]);
+    free(output);
+
+    guac_common_clipboard_free(clipboard);
+
+}
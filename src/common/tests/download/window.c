@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/download.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that the download window grows by one blob for each
+ * acknowledgement while round trip times remain low, up to the maximum, and
+ * ignores acknowledgements which do not correspond to any blob.
+ */
+void test_download__window_growth() {
+
+    guac_common_download_window window;
+    guac_common_download_window_init(&window, 8);
+
+    CU_ASSERT_EQUAL(GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW,
+            guac_common_download_window_available(&window));
+
+    /* Acknowledgement of the stream itself is not a blob */
+    CU_ASSERT_EQUAL(-1, guac_common_download_window_acked(&window, 0));
+    CU_ASSERT_EQUAL(GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW, window.size);
+
+    /* Fill window */
+    int i;
+    for (i = 0; i < GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW; i++)
+        guac_common_download_window_sent(&window, 1000);
+
+    CU_ASSERT_EQUAL(0, guac_common_download_window_available(&window));
+
+    /* Each acknowledgement frees one slot and adds another */
+    CU_ASSERT_EQUAL(50, guac_common_download_window_acked(&window, 1050));
+    CU_ASSERT_EQUAL(GUAC_COMMON_DOWNLOAD_INITIAL_WINDOW + 1, window.size);
+    CU_ASSERT_EQUAL(2, guac_common_download_window_available(&window));
+    CU_ASSERT_EQUAL(50, window.min_rtt);
+
+    /* Window does not grow beyond maximum */
+    for (i = 0; i < 16; i++) {
+        guac_common_download_window_sent(&window, 1100);
+        guac_common_download_window_acked(&window, 1150);
+    }
+
+    CU_ASSERT_EQUAL(8, window.size);
+
+    /* Maximum is limited */
+    guac_common_download_window_init(&window,
+            GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT * 2);
+    CU_ASSERT_EQUAL(GUAC_COMMON_DOWNLOAD_WINDOW_LIMIT, window.max_size);
+
+}
+
+/**
+ * Test which verifies that the download window is halved once round trip
+ * times grow well beyond the lowest observed, but not again for blobs sent
+ * before the window was reduced.
+ */
+void test_download__window_congestion() {
+
+    guac_common_download_window window;
+    guac_common_download_window_init(&window, 64);
+
+    /* Grow window to 16 blobs with a 20 ms round trip time */
+    guac_timestamp now = 0;
+    while (window.size < 16) {
+        guac_common_download_window_sent(&window, now);
+        guac_common_download_window_acked(&window, now + 20);
+        now += 20;
+    }
+
+    CU_ASSERT_EQUAL(20, window.min_rtt);
+
+    /* Fill window, with every blob now delayed by queueing */
+    int i;
+    for (i = 0; i < 16; i++)
+        guac_common_download_window_sent(&window, now);
+
+    now += 200;
+
+    /* Window is halved immediately */
+    CU_ASSERT_EQUAL(200, guac_common_download_window_acked(&window, now));
+    CU_ASSERT_EQUAL(8, window.size);
+
+    /* Blobs sent with the previous window do not reduce it further */
+    for (i = 0; i < 15; i++)
+        guac_common_download_window_acked(&window, now);
+
+    CU_ASSERT_EQUAL(8, window.size);
+    CU_ASSERT_EQUAL(0, window.in_flight);
+
+    /* Window never shrinks below a single blob */
+    for (i = 0; i < 8; i++) {
+        now += 1000;
+        guac_common_download_window_sent(&window, now);
+        guac_common_download_window_acked(&window, now + 500);
+    }
+
+    CU_ASSERT_EQUAL(1, window.size);
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/encoder.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+
+/**
+ * Test which verifies that guac_common_bandwidth_update() does not consider
+ * the connection constrained merely because it has high round trip time,
+ * but does once processing lag grows.
+ */
+void test_encoder__bandwidth_saturation() {
+
+    guac_common_bandwidth bandwidth;
+    guac_common_bandwidth_init(&bandwidth, 1000, 0);
+    CU_ASSERT_EQUAL(0, bandwidth.bytes_per_second);
+
+    /* Steady lag is round trip time, not congestion */
+    guac_common_bandwidth_update(&bandwidth, 1500, 500000, 150);
+    guac_common_bandwidth_update(&bandwidth, 2000, 1000000, 160);
+    CU_ASSERT_EQUAL(0, bandwidth.bytes_per_second);
+    CU_ASSERT_EQUAL(150, bandwidth.min_lag);
+
+    /* Samples are not taken more frequently than the sample interval */
+    guac_common_bandwidth_update(&bandwidth, 2100, 1500000, 400);
+    CU_ASSERT_EQUAL(0, bandwidth.bytes_per_second);
+
+    /* Growing lag indicates saturation at the observed throughput */
+    guac_common_bandwidth_update(&bandwidth, 2500, 1500000, 400);
+    CU_ASSERT_EQUAL(1000000, bandwidth.bytes_per_second);
+
+    /* Further saturated samples move halfway toward the new throughput */
+    guac_common_bandwidth_update(&bandwidth, 3000, 1750000, 400);
+    CU_ASSERT_EQUAL(750000, bandwidth.bytes_per_second);
+
+    /* Saturated intervals in which little was sent are ignored */
+    guac_common_bandwidth_update(&bandwidth, 3500, 1751000, 400);
+    CU_ASSERT_EQUAL(750000, bandwidth.bytes_per_second);
+
+}
+
+/**
+ * Test which verifies that guac_common_bandwidth_update() raises the
+ * bandwidth estimate while the connection is not saturated, eventually
+ * considering the connection unconstrained.
+ */
+void test_encoder__bandwidth_recovery() {
+
+    guac_common_bandwidth bandwidth;
+    guac_common_bandwidth_init(&bandwidth, 0, 0);
+
+    /* Saturate at 100 KB/s */
+    guac_common_bandwidth_update(&bandwidth, 0, 0, 0);
+    guac_common_bandwidth_update(&bandwidth, 1000, 102400, 100);
+    CU_ASSERT_EQUAL(102400, bandwidth.bytes_per_second);
+
+    /* Estimate increases by a quarter while not saturated */
+    guac_common_bandwidth_update(&bandwidth, 2000, 112400, 0);
+    CU_ASSERT_EQUAL(128001, bandwidth.bytes_per_second);
+
+    /* Estimate increases to throughput if higher */
+    guac_common_bandwidth_update(&bandwidth, 3000, 1112400, 0);
+    CU_ASSERT_EQUAL(1000000, bandwidth.bytes_per_second);
+
+    /* Connection becomes unconstrained once estimate is large enough */
+    int i;
+    guac_timestamp now = 3000;
+    for (i = 0; i < 100 && bandwidth.bytes_per_second != 0; i++) {
+        now += 1000;
+        guac_common_bandwidth_update(&bandwidth, now, 1112400, 0);
+    }
+
+    CU_ASSERT_EQUAL(0, bandwidth.bytes_per_second);
+
+}
+
@@ -0,0 +1,86 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/encoder.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+
+/**
+ * Test which verifies that guac_common_encoder_cost_record() takes the first
+ * measurement as-is, moves toward later measurements gradually, and never
+ * produces a zero (unmeasured) cost once something has been recorded.
+ */
+void test_encoder__cost_record() {
+
+    guac_common_encoder_cost cost = { 0 };
+
+    /* Measurements of nothing are ignored */
+    guac_common_encoder_cost_record(&cost, 0, 1000, 1000);
+    CU_ASSERT_EQUAL(0, cost.bytes_per_kpixel);
+    CU_ASSERT_EQUAL(0, cost.usec_per_kpixel);
+
+    /* First measurement is taken as-is */
+    guac_common_encoder_cost_record(&cost, 2048, 1000, 100);
+    CU_ASSERT_EQUAL(500, cost.bytes_per_kpixel);
+    CU_ASSERT_EQUAL(50, cost.usec_per_kpixel);
+
+    /* Later measurements contribute one quarter */
+    guac_common_encoder_cost_record(&cost, 1024, 900, 10);
+    CU_ASSERT_EQUAL(600, cost.bytes_per_kpixel);
+    CU_ASSERT_EQUAL(40, cost.usec_per_kpixel);
+
+    /* Costs which round to zero are still distinguishable from no
+     * measurement at all */
+    guac_common_encoder_cost empty = { 0 };
+    guac_common_encoder_cost_record(&empty, 1000000, 0, 0);
+    CU_ASSERT_EQUAL(1, empty.bytes_per_kpixel);
+    CU_ASSERT_EQUAL(1, empty.usec_per_kpixel);
+
+}
+
+/**
+ * Test which verifies that guac_common_encoder_cost_estimate() considers
+ * transfer time only if bandwidth is known to be constrained.
+ */
+void test_encoder__cost_estimate() {
+
+    guac_common_encoder_cost cost = {
+        .bytes_per_kpixel = 2048,
+        .usec_per_kpixel  = 100
+    };
+
+    guac_common_bandwidth bandwidth;
+    guac_common_bandwidth_init(&bandwidth, 0, 0);
+
+    /* 10240 pixels take 1ms to encode */
+    CU_ASSERT_EQUAL(1000, guac_common_encoder_cost_estimate(&cost,
+                &bandwidth, 10240));
+    CU_ASSERT_EQUAL(0, guac_common_encoder_cost_estimate_transfer(&cost,
+                &bandwidth, 10240));
+
+    /* The resulting 20480 bytes take 200ms to send at 100 KB/s */
+    bandwidth.bytes_per_second = 102400;
+    CU_ASSERT_EQUAL(200000, guac_common_encoder_cost_estimate_transfer(&cost,
+                &bandwidth, 10240));
+    CU_ASSERT_EQUAL(201000, guac_common_encoder_cost_estimate(&cost,
+                &bandwidth, 10240));
+
+}
+
@@ -127,3 +127,120 @@ void test_iconv__normalize_crlf() {
     }
 }
 
+
+/**
+ * Test which verifies that conversion can be resumed where it left off if the
+ * output buffer fills, with every character either written in its entirety
+ * or left unread.
+ */
+void test_iconv__chunked() {
+    for (int i = 0; i < NUM_SUPPORTED_ENCODINGS; i++) {
+        for (int j = 0; j < NUM_SUPPORTED_ENCODINGS; j++) {
+
+            encoding_test_parameters* from = &test_params[i];
+            encoding_test_parameters* to = &test_params[j];
+
+            printf("# \"%s\" -> \"%s\" (chunked) ...\n", from->name, to->name);
+
+            /* Each chunk must be large enough for any single character */
+            for (int chunk_size = 4; chunk_size <= 9; chunk_size++) {
+
+                char output[4096];
+                const char* current_input = (const char*) from->test_mixed.buffer;
+                char* current_output = output;
+                int in_remaining = from->test_mixed.size;
+                int complete = 0;
+
+                while (!complete && in_remaining > 0) {
+
+                    const char* input_start = current_input;
+                    char* output_start = current_output;
+
+                    complete = guac_iconv(from->reader_normalized,
+                            &current_input, in_remaining, to->writer_crlf,
+                            &current_output, chunk_size);
+
+                    in_remaining -= current_input - input_start;
+
+                    /* Every chunk must make progress */
+                    CU_ASSERT_FATAL(current_output != output_start);
+
+                }
+
+                CU_ASSERT(complete);
+                CU_ASSERT_EQUAL(0, in_remaining);
+                CU_ASSERT_EQUAL(to->test_windows.size, current_output - output);
+                CU_ASSERT_EQUAL(0, memcmp(output, to->test_windows.buffer,
+                            to->test_windows.size));
+
+            }
+
+        }
+    }
+}
+
+/**
+ * Test which verifies that long runs of ASCII characters, which are copied
+ * in bulk rather than one character at a time, are converted correctly,
+ * including any line endings and non-ASCII characters within those runs.
+ */
+void test_iconv__ascii() {
+
+    const char input[] =
+        "The quick brown fox jumps over the lazy dog\r\n"
+        "The quick brown fox jumps over the lazy dog\n"
+        "The quick brown fox jumps over the lazy d\xC3\xB6g\r"
+        "The quick brown fox jumps over the lazy dog";
+
+    const char expected_unix[] =
+        "The quick brown fox jumps over the lazy dog\n"
+        "The quick brown fox jumps over the lazy dog\n"
+        "The quick brown fox jumps over the lazy d\xF6g\r"
+        "The quick brown fox jumps over the lazy dog";
+
+    const char expected_windows[] =
+        "The quick brown fox jumps over the lazy dog\r\n"
+        "The quick brown fox jumps over the lazy dog\r\n"
+        "The quick brown fox jumps over the lazy d\xF6g\r"
+        "The quick brown fox jumps over the lazy dog";
+
+    char output[4096];
+    char utf16[4096];
+    const char* current_input;
+    char* current_output;
+
+    /* UTF-8 to ISO 8859-1, normalizing to Unix line endings */
+    current_input = input;
+    current_output = output;
+    CU_ASSERT(guac_iconv(GUAC_READ_UTF8_NORMALIZED, &current_input,
+                sizeof(input), GUAC_WRITE_ISO8859_1, &current_output,
+                sizeof(output)));
+    CU_ASSERT_EQUAL(sizeof(expected_unix), current_output - output);
+    CU_ASSERT_EQUAL(0, memcmp(output, expected_unix, sizeof(expected_unix)));
+
+    /* UTF-8 to ISO 8859-1, normalizing to Windows line endings */
+    current_input = input;
+    current_output = output;
+    CU_ASSERT(guac_iconv(GUAC_READ_UTF8_NORMALIZED, &current_input,
+                sizeof(input), GUAC_WRITE_ISO8859_1_CRLF, &current_output,
+                sizeof(output)));
+    CU_ASSERT_EQUAL(sizeof(expected_windows), current_output - output);
+    CU_ASSERT_EQUAL(0, memcmp(output, expected_windows,
+                sizeof(expected_windows)));
+
+    /* UTF-8 to UTF-16 and back, preserving everything verbatim */
+    current_input = input;
+    current_output = utf16;
+    CU_ASSERT(guac_iconv(GUAC_READ_UTF8, &current_input, sizeof(input),
+                GUAC_WRITE_UTF16, &current_output, sizeof(utf16)));
+    CU_ASSERT_EQUAL((sizeof(input) - 1) * 2, current_output - utf16);
+
+    int utf16_length = current_output - utf16;
+    current_input = utf16;
+    current_output = output;
+    CU_ASSERT(guac_iconv(GUAC_READ_UTF16, &current_input, utf16_length,
+                GUAC_WRITE_UTF8, &current_output, sizeof(output)));
+    CU_ASSERT_EQUAL(sizeof(input), current_output - output);
+    CU_ASSERT_EQUAL(0, memcmp(output, input, sizeof(input)));
+
+}
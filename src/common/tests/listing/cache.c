@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/listing.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/user.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Asserts that the JSON of the given listing is identical to the given
+ * string.
+ *
+ * @param expected
+ *     The JSON that the listing is expected to contain.
+ *
+ * @param listing
+ *     The listing to test.
+ */
+static void assert_listing_json(const char* expected,
+        const guac_common_listing* listing) {
+
+    CU_ASSERT_EQUAL_FATAL(strlen(expected), listing->length);
+    CU_ASSERT_NSTRING_EQUAL(expected, listing->json, listing->length);
+
+}
+
+/**
+ * Test which verifies that directory listings are built as JSON objects
+ * mapping each path to its mimetype, with quotes and backslashes escaped.
+ */
+void test_listing__json() {
+
+    guac_common_listing* listing = guac_common_listing_alloc();
+    guac_common_listing_end(listing);
+    assert_listing_json("{}", listing);
+    guac_common_listing_free(listing);
+
+    listing = guac_common_listing_alloc();
+    guac_common_listing_add(listing, "/a", GUAC_USER_STREAM_INDEX_MIMETYPE);
+    guac_common_listing_add(listing, "\\b\"c", "application/octet-stream");
+    guac_common_listing_end(listing);
+
+    assert_listing_json("{\"/a\":\"" GUAC_USER_STREAM_INDEX_MIMETYPE "\","
+            "\"\\\\b\\\"c\":\"application/octet-stream\"}", listing);
+
+    CU_ASSERT_EQUAL(2, listing->entries);
+    guac_common_listing_free(listing);
+
+    /* Listings grow as necessary */
+    listing = guac_common_listing_alloc();
+    for (int i = 0; i < 1000; i++)
+        guac_common_listing_add(listing, "/0123456789", "text/plain");
+    guac_common_listing_end(listing);
+
+    CU_ASSERT_EQUAL(1000, listing->entries);
+    CU_ASSERT_EQUAL(2 + 1000 * 27 - 1, listing->length);
+    CU_ASSERT_EQUAL('}', listing->json[listing->length - 1]);
+    guac_common_listing_free(listing);
+
+}
+
+/**
+ * Test which verifies that cached listings are returned as copies only until
+ * they expire, and that trailing separators do not affect lookups.
+ */
+void test_listing__cache_ttl() {
+
+    guac_common_listing_cache* cache = guac_common_listing_cache_alloc();
+
+    guac_common_listing* listing = guac_common_listing_alloc();
+    guac_common_listing_add(listing, "/dir/file", "text/plain");
+    guac_common_listing_end(listing);
+
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir", 0));
+    guac_common_listing_cache_put(cache, "/dir/", listing, 1000);
+    guac_common_listing_free(listing);
+
+    /* Valid until TTL has elapsed */
+    guac_common_listing* cached = guac_common_listing_cache_get(cache,
+            "/dir", 1000 + GUAC_COMMON_LISTING_CACHE_TTL - 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cached);
+    assert_listing_json("{\"/dir/file\":\"text/plain\"}", cached);
+    guac_common_listing_free(cached);
+
+    /* Other directories are unaffected */
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/di", 1000));
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir/x", 1000));
+
+    /* Expired once TTL has elapsed */
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir",
+                1000 + GUAC_COMMON_LISTING_CACHE_TTL));
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir", 1000));
+
+    guac_common_listing_cache_free(cache);
+
+}
+
+/**
+ * Test which verifies that creating, deleting, or renaming a file invalidates
+ * the listing of its directory (and its own listing, if it is a directory),
+ * but no others.
+ */
+void test_listing__cache_invalidate() {
+
+    const char* paths[] = { "\\", "\\a", "\\a\\b", "\\c" };
+
+    guac_common_listing_cache* cache = guac_common_listing_cache_alloc();
+
+    guac_common_listing* listing = guac_common_listing_alloc();
+    guac_common_listing_end(listing);
+
+    for (int i = 0; i < 4; i++)
+        guac_common_listing_cache_put(cache, paths[i], listing, 0);
+
+    guac_common_listing_free(listing);
+
+    /* Changing "\a\b" affects "\a\b" and "\a" only */
+    guac_common_listing_cache_invalidate(cache, "\\a\\b");
+
+    guac_common_listing* cached;
+    int expected[] = { 1, 0, 0, 1 };
+
+    for (int i = 0; i < 4; i++) {
+        cached = guac_common_listing_cache_get(cache, paths[i], 0);
+        CU_ASSERT_EQUAL(expected[i], cached != NULL);
+        if (cached != NULL)
+            guac_common_listing_free(cached);
+    }
+
+    /* Changing "\c" affects the root */
+    guac_common_listing_cache_invalidate(cache, "\\c");
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "\\", 0));
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "\\c", 0));
+
+    guac_common_listing_cache_free(cache);
+
+}
+
+/**
+ * Test which verifies that the least recently cached listing is replaced
+ * once the cache is full.
+ */
+void test_listing__cache_full() {
+
+    char path[32];
+
+    guac_common_listing_cache* cache = guac_common_listing_cache_alloc();
+
+    guac_common_listing* listing = guac_common_listing_alloc();
+    guac_common_listing_end(listing);
+
+    for (int i = 0; i <= GUAC_COMMON_LISTING_CACHE_SIZE; i++) {
+        sprintf(path, "/%i", i);
+        guac_common_listing_cache_put(cache, path, listing, i);
+    }
+
+    guac_common_listing_free(listing);
+
+    /* Only the first listing was replaced */
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/0", 0));
+
+    for (int i = 1; i <= GUAC_COMMON_LISTING_CACHE_SIZE; i++) {
+        sprintf(path, "/%i", i);
+        guac_common_listing* cached = guac_common_listing_cache_get(cache,
+                path, GUAC_COMMON_LISTING_CACHE_SIZE);
+        CU_ASSERT_PTR_NOT_NULL(cached);
+        if (cached != NULL)
+            guac_common_listing_free(cached);
+    }
+
+    guac_common_listing_cache_free(cache);
+
+}
+
@@ -0,0 +1,212 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/listing.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/**
+ * The number of entries within the test directory. This is large enough that
+ * the listing of the directory cannot be sent in response to a single
+ * acknowledgement.
+ */
+#define TEST_ENTRIES 20000
+
+/**
+ * The maximum number of acknowledgements to send before assuming that a
+ * listing will never complete.
+ */
+#define TEST_MAX_ACKS 100000
+
+/**
+ * The state of the simulated directory being listed.
+ */
+typedef struct test_directory {
+
+    /**
+     * The number of entries read thus far.
+     */
+    int entries_read;
+
+    /**
+     * Non-zero if the free handler has been invoked.
+     */
+    int freed;
+
+} test_directory;
+
+/**
+ * Listing entry handler which adds the next entry of a simulated directory
+ * containing TEST_ENTRIES files.
+ *
+ * @param user
+ *     The user requesting the directory listing.
+ *
+ * @param data
+ *     The test_directory being listed.
+ *
+ * @param listing
+ *     The directory listing being read.
+ *
+ * @return
+ *     Non-zero if an entry was read, zero if no entries remain.
+ */
+static int test_entry_handler(guac_user* user, void* data,
+        guac_common_listing* listing) {
+
+    test_directory* directory = (test_directory*) data;
+    if (directory->entries_read == TEST_ENTRIES)
+        return 0;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/dir/file%05i", directory->entries_read++);
+    guac_common_listing_add(listing, path, "application/octet-stream");
+
+    return 1;
+
+}
+
+/**
+ * Listing free handler which records that the simulated directory has been
+ * closed.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param data
+ *     The test_directory that was being listed.
+ */
+static void test_free_handler(guac_user* user, void* data) {
+    ((test_directory*) data)->freed = 1;
+}
+
+/**
+ * Allocates a user whose socket discards all data written.
+ *
+ * @return
+ *     A newly-allocated user.
+ */
+static guac_user* test_user_alloc() {
+
+    int fd = open("/dev/null", O_WRONLY);
+    CU_ASSERT_FATAL(fd >= 0);
+
+    guac_user* user = guac_user_alloc();
+    user->socket = guac_socket_open(fd);
+    return user;
+
+}
+
+/**
+ * Frees the given user allocated with test_user_alloc().
+ *
+ * @param user
+ *     The user to free.
+ */
+static void test_user_free(guac_user* user) {
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+}
+
+/**
+ * Test which verifies that a streamed directory listing reads the directory
+ * only as blobs are acknowledged, and that the completed listing is cached.
+ */
+void test_listing__stream() {
+
+    test_directory directory = { 0 };
+
+    guac_user* user = test_user_alloc();
+    guac_common_listing_cache* cache = guac_common_listing_cache_alloc();
+
+    guac_stream* stream = guac_user_alloc_stream(user);
+    CU_ASSERT_EQUAL_FATAL(guac_common_listing_stream(user, stream, cache,
+                "/dir", test_entry_handler, test_free_handler, &directory),
+            0);
+
+    /* Nothing is read until the stream is acknowledged */
+    CU_ASSERT_EQUAL(directory.entries_read, 0);
+
+    /* Only part of the directory is read in response to each
+     * acknowledgement */
+    stream->ack_handler(user, stream, "OK", GUAC_PROTOCOL_STATUS_SUCCESS);
+    CU_ASSERT(directory.entries_read > 0);
+    CU_ASSERT(directory.entries_read < TEST_ENTRIES);
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir",
+                guac_timestamp_current()));
+
+    /* Acknowledge each blob until the listing is complete */
+    for (int i = 0; i < TEST_MAX_ACKS && !directory.freed; i++)
+        stream->ack_handler(user, stream, "OK", GUAC_PROTOCOL_STATUS_SUCCESS);
+
+    CU_ASSERT_FATAL(directory.freed);
+    CU_ASSERT_EQUAL(directory.entries_read, TEST_ENTRIES);
+
+    /* The completed listing is cached */
+    guac_common_listing* cached = guac_common_listing_cache_get(cache, "/dir",
+            guac_timestamp_current());
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cached);
+    CU_ASSERT_EQUAL(cached->entries, TEST_ENTRIES);
+    CU_ASSERT_EQUAL(cached->json[cached->length - 1], '}');
+    guac_common_listing_free(cached);
+
+    guac_common_listing_cache_free(cache);
+    test_user_free(user);
+
+}
+
+/**
+ * Test which verifies that a streamed directory listing which is rejected by
+ * the user closes the directory without caching the partial listing.
+ */
+void test_listing__stream_rejected() {
+
+    test_directory directory = { 0 };
+
+    guac_user* user = test_user_alloc();
+    guac_common_listing_cache* cache = guac_common_listing_cache_alloc();
+
+    guac_stream* stream = guac_user_alloc_stream(user);
+    CU_ASSERT_EQUAL_FATAL(guac_common_listing_stream(user, stream, cache,
+                "/dir", test_entry_handler, test_free_handler, &directory),
+            0);
+
+    stream->ack_handler(user, stream, "OK", GUAC_PROTOCOL_STATUS_SUCCESS);
+    stream->ack_handler(user, stream, "FAIL",
+            GUAC_PROTOCOL_STATUS_CLIENT_FORBIDDEN);
+
+    CU_ASSERT(directory.freed);
+    CU_ASSERT(directory.entries_read < TEST_ENTRIES);
+    CU_ASSERT_PTR_NULL(guac_common_listing_cache_get(cache, "/dir",
+                guac_timestamp_current()));
+
+    guac_common_listing_cache_free(cache);
+    test_user_free(user);
+
+}
+
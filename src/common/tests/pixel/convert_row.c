@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "common/pixel-format.h"
+#include "pixel-test-data.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Pixel formats covering every conversion kernel: the 8, 16, and 32-bit
+ * formats requested by the VNC client, a byte-aligned 32-bit format in the
+ * opposite byte order, and a 32-bit format whose components are not
+ * byte-aligned.
+ */
+static const guac_common_pixel_format PIXEL_FORMATS[] = {
+    { 8,   0,  3,  6, 0x007, 0x007, 0x003, 0 },
+    { 16, 11,  5,  0, 0x01F, 0x03F, 0x01F, 0 },
+    { 32, 16,  8,  0, 0x0FF, 0x0FF, 0x0FF, 0 },
+    { 32,  0,  8, 16, 0x0FF, 0x0FF, 0x0FF, 0 },
+    { 32, 20, 10,  0, 0x3FF, 0x3FF, 0x3FF, 0 }
+};
+
+/**
+ * The number of entries in PIXEL_FORMATS.
+ */
+#define PIXEL_FORMAT_COUNT \
+    ((int) (sizeof(PIXEL_FORMATS) / sizeof(PIXEL_FORMATS[0])))
+
+/**
+ * Verifies that the converter selected for the given pixel format by the
+ * current implementation produces exactly the same pixels as
+ * guac_common_pixel_format_convert() for rows of every tested width.
+ *
+ * @param format
+ *     The pixel format to test.
+ *
+ * @param seed
+ *     The state of the pseudo-random number generator used to generate test
+ *     data.
+ */
+static void verify_convert_row(const guac_common_pixel_format* format,
+        uint32_t* seed) {
+
+    guac_common_pixel_converter* converter =
+        guac_common_pixel_converter_alloc(format);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+
+    int width, x;
+    for (width = 0; width <= PIXEL_TEST_MAX_WIDTH; width++) {
+
+        uint32_t random[PIXEL_TEST_MAX_WIDTH];
+        uint32_t actual[PIXEL_TEST_MAX_WIDTH];
+
+        uint8_t src8[PIXEL_TEST_MAX_WIDTH];
+        uint16_t src16[PIXEL_TEST_MAX_WIDTH];
+        const void* src = random;
+
+        /* Narrow random values to the size of each pixel */
+        pixel_test_random_row(random, width, seed);
+        for (x = 0; x < width; x++) {
+            src8[x] = random[x];
+            src16[x] = random[x];
+        }
+
+        if (format->bits_per_pixel == 8)
+            src = src8;
+        else if (format->bits_per_pixel == 16)
+            src = src16;
+
+        guac_common_pixel_convert_row(converter, actual, src, width);
+
+        for (x = 0; x < width; x++) {
+
+            uint32_t value = random[x];
+            if (format->bits_per_pixel == 8)
+                value = src8[x];
+            else if (format->bits_per_pixel == 16)
+                value = src16[x];
+
+            CU_ASSERT_EQUAL(guac_common_pixel_format_convert(format, value),
+                    actual[x]);
+
+        }
+
+    }
+
+    guac_common_pixel_converter_free(converter);
+
+}
+
+/**
+ * Test which verifies that every supported implementation of
+ * guac_common_pixel_convert_row() produces exactly the same pixels as the
+ * reference conversion, for each tested pixel format both with and without
+ * swapping red and blue.
+ */
+void test_pixel__convert_row() {
+
+    guac_common_pixel_impl original = guac_common_pixel_get_impl();
+
+    int i;
+    for (i = 0; i < PIXEL_TEST_IMPL_COUNT; i++) {
+
+        guac_common_pixel_impl impl = PIXEL_TEST_IMPLS[i];
+        if (guac_common_pixel_set_impl(impl)) {
+            printf("Skipping unsupported implementation %i\n", impl);
+            continue;
+        }
+
+        uint32_t seed = 0x5EEDF00D;
+
+        int index;
+        for (index = 0; index < PIXEL_FORMAT_COUNT; index++) {
+
+            guac_common_pixel_format format = PIXEL_FORMATS[index];
+            verify_convert_row(&format, &seed);
+
+            format.swap_red_blue = 1;
+            verify_convert_row(&format, &seed);
+
+        }
+
+    }
+
+    guac_common_pixel_set_impl(original);
+
+}
+
+/**
+ * Test which verifies that only formats equivalent to the native 32-bit
+ * format of CAIRO_FORMAT_RGB24 are reported as requiring no conversion.
+ */
+void test_pixel__convert_identity() {
+
+    int index;
+    for (index = 0; index < PIXEL_FORMAT_COUNT; index++) {
+
+        guac_common_pixel_format format = PIXEL_FORMATS[index];
+        guac_common_pixel_converter* converter;
+
+        converter = guac_common_pixel_converter_alloc(&format);
+        CU_ASSERT_EQUAL(index == 2,
+                guac_common_pixel_converter_is_identity(converter));
+        guac_common_pixel_converter_free(converter);
+
+        /* Swapping red and blue of the opposite byte order is equivalent */
+        format.swap_red_blue = 1;
+        converter = guac_common_pixel_converter_alloc(&format);
+        CU_ASSERT_EQUAL(index == 3,
+                guac_common_pixel_converter_is_identity(converter));
+        guac_common_pixel_converter_free(converter);
+
+    }
+
+}
+
+/**
+ * Test which verifies that unsupported pixel formats are rejected.
+ */
+void test_pixel__convert_unsupported() {
+
+    guac_common_pixel_format format = { 24, 16, 8, 0, 0xFF, 0xFF, 0xFF, 0 };
+    CU_ASSERT_PTR_NULL(guac_common_pixel_converter_alloc(&format));
+
+    format.bits_per_pixel = 32;
+    format.red_shift = 32;
+    CU_ASSERT_PTR_NULL(guac_common_pixel_converter_alloc(&format));
+
+}
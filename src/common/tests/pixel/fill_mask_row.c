@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "pixel-test-data.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Test which verifies that every supported SIMD implementation of
+ * guac_common_pixel_fill_mask_row() produces exactly the same pixels as the
+ * scalar implementation.
+ */
+void test_pixel__fill_mask_row() {
+
+    guac_common_pixel_impl original = guac_common_pixel_get_impl();
+
+    int i;
+    for (i = 0; i < PIXEL_TEST_IMPL_COUNT; i++) {
+
+        guac_common_pixel_impl impl = PIXEL_TEST_IMPLS[i];
+        if (guac_common_pixel_set_impl(impl)) {
+            printf("Skipping unsupported implementation %i\n", impl);
+            continue;
+        }
+
+        uint32_t seed = 0x0F1E2D3C;
+
+        int width, row;
+        for (width = 0; width <= PIXEL_TEST_MAX_WIDTH; width++) {
+            for (row = 0; row < PIXEL_TEST_ROWS; row++) {
+
+                uint32_t color[1];
+                uint32_t mask[PIXEL_TEST_MAX_WIDTH];
+                uint32_t expected[PIXEL_TEST_MAX_WIDTH];
+                uint32_t actual[PIXEL_TEST_MAX_WIDTH];
+
+                pixel_test_random_row(color, 1, &seed);
+                pixel_test_random_row(mask, width, &seed);
+                pixel_test_random_row(expected, width, &seed);
+                memcpy(actual, expected, sizeof(uint32_t) * width);
+
+                guac_common_pixel_set_impl(GUAC_COMMON_PIXEL_SCALAR);
+                guac_common_pixel_fill_mask_row(expected, mask, color[0], width);
+
+                guac_common_pixel_set_impl(impl);
+                guac_common_pixel_fill_mask_row(actual, mask, color[0], width);
+
+                CU_ASSERT_EQUAL(0, memcmp(expected, actual,
+                            sizeof(uint32_t) * width));
+
+            }
+        }
+
+    }
+
+    guac_common_pixel_set_impl(original);
+
+}
+
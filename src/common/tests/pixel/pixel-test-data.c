@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "pixel-test-data.h"
+
+#include <stdint.h>
+
+const guac_common_pixel_impl PIXEL_TEST_IMPLS[] = {
+    GUAC_COMMON_PIXEL_SSE41,
+    GUAC_COMMON_PIXEL_AVX2
+};
+
+const int PIXEL_TEST_IMPL_COUNT =
+    sizeof(PIXEL_TEST_IMPLS) / sizeof(PIXEL_TEST_IMPLS[0]);
+
+/**
+ * Returns the next value of a simple xorshift pseudo-random number
+ * generator. The sequence is deterministic for a given seed, such that test
+ * failures are reproducible.
+ *
+ * @param seed
+ *     The state of the generator, which will be updated.
+ *
+ * @return
+ *     The next pseudo-random value.
+ */
+static uint32_t pixel_test_next(uint32_t* seed) {
+
+    uint32_t value = *seed;
+
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+
+    *seed = value;
+    return value;
+
+}
+
+void pixel_test_random_row(uint32_t* row, int width, uint32_t* seed) {
+
+    int x;
+    for (x = 0; x < width; x++) {
+
+        uint32_t value = pixel_test_next(seed);
+
+        /* Repeat the previous pixel occasionally */
+        if (x > 0 && (value & 0x7) == 0) {
+            row[x] = row[x - 1];
+            continue;
+        }
+
+        /* Choose alpha, favoring fully opaque and fully transparent */
+        uint32_t alpha;
+        switch ((value >> 3) & 0x3) {
+            case 0:  alpha = 0x00; break;
+            case 1:  alpha = 0xFF; break;
+            default: alpha = (value >> 8) & 0xFF; break;
+        }
+
+        /* Pre-multiply color components, keeping each within alpha */
+        uint32_t color = pixel_test_next(seed);
+        uint32_t r = ((color >> 16) & 0xFF) * alpha / 0xFF;
+        uint32_t g = ((color >>  8) & 0xFF) * alpha / 0xFF;
+        uint32_t b = ( color        & 0xFF) * alpha / 0xFF;
+
+        row[x] = (alpha << 24) | (r << 16) | (g << 8) | b;
+
+    }
+
+}
+
@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <stdint.h>
+
+/**
+ * The largest row width tested, in pixels. This is deliberately not a
+ * multiple of any SIMD vector width, such that all tested implementations
+ * must handle partial vectors at the end of each row.
+ */
+#define PIXEL_TEST_MAX_WIDTH 67
+
+/**
+ * The number of rows of random data tested for each row width.
+ */
+#define PIXEL_TEST_ROWS 16
+
+/**
+ * The SIMD implementations which are compared against
+ * GUAC_COMMON_PIXEL_SCALAR. Implementations which are not supported by the
+ * current processor are skipped.
+ */
+extern const guac_common_pixel_impl PIXEL_TEST_IMPLS[];
+
+/**
+ * The number of entries in PIXEL_TEST_IMPLS.
+ */
+extern const int PIXEL_TEST_IMPL_COUNT;
+
+/**
+ * Fills the given row with pseudo-random pre-multiplied ARGB pixels. Fully
+ * opaque and fully transparent pixels are deliberately over-represented, as
+ * are runs of identical pixels, such that edge cases of blending and change
+ * detection are exercised.
+ *
+ * @param row
+ *     The row to fill.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param seed
+ *     The state of the pseudo-random number generator, which will be updated
+ *     as pixels are generated.
+ */
+void pixel_test_random_row(uint32_t* row, int width, uint32_t* seed);
+
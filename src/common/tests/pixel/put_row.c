@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "pixel-test-data.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Verifies that every supported SIMD implementation of
+ * guac_common_pixel_put_row() produces exactly the same pixels and the same
+ * range of changed pixels as the scalar implementation.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the source should be ignored, zero if
+ *     the source should be blended over the destination.
+ */
+static void verify_put_row(int opaque) {
+
+    guac_common_pixel_impl original = guac_common_pixel_get_impl();
+
+    int i;
+    for (i = 0; i < PIXEL_TEST_IMPL_COUNT; i++) {
+
+        guac_common_pixel_impl impl = PIXEL_TEST_IMPLS[i];
+        if (guac_common_pixel_set_impl(impl)) {
+            printf("Skipping unsupported implementation %i\n", impl);
+            continue;
+        }
+
+        uint32_t seed = 0x12345678;
+
+        int width, row;
+        for (width = 0; width <= PIXEL_TEST_MAX_WIDTH; width++) {
+            for (row = 0; row < PIXEL_TEST_ROWS; row++) {
+
+                uint32_t src[PIXEL_TEST_MAX_WIDTH];
+                uint32_t expected[PIXEL_TEST_MAX_WIDTH];
+                uint32_t actual[PIXEL_TEST_MAX_WIDTH];
+
+                pixel_test_random_row(src, width, &seed);
+                pixel_test_random_row(expected, width, &seed);
+
+                /* Leave part of the row unchanged on alternate rows */
+                if (row % 2 && width > 0)
+                    memcpy(expected, src, sizeof(uint32_t) * (width / 2));
+
+                memcpy(actual, expected, sizeof(uint32_t) * width);
+
+                int expected_first = -1, expected_last = -1;
+                int actual_first = -1, actual_last = -1;
+
+                guac_common_pixel_set_impl(GUAC_COMMON_PIXEL_SCALAR);
+                int expected_result = guac_common_pixel_put_row(expected,
+                        src, width, opaque, &expected_first, &expected_last);
+
+                guac_common_pixel_set_impl(impl);
+                int actual_result = guac_common_pixel_put_row(actual,
+                        src, width, opaque, &actual_first, &actual_last);
+
+                CU_ASSERT_EQUAL(expected_result, actual_result);
+                CU_ASSERT_EQUAL(expected_first, actual_first);
+                CU_ASSERT_EQUAL(expected_last, actual_last);
+                CU_ASSERT_EQUAL(0, memcmp(expected, actual,
+                            sizeof(uint32_t) * width));
+
+            }
+        }
+
+    }
+
+    guac_common_pixel_set_impl(original);
+
+}
+
+/**
+ * Test which verifies that all implementations of guac_common_pixel_put_row()
+ * behave identically when ignoring the alpha channel of the source.
+ */
+void test_pixel__put_row_opaque() {
+    verify_put_row(1);
+}
+
+/**
+ * Test which verifies that all implementations of guac_common_pixel_put_row()
+ * behave identically when blending the source over the destination.
+ */
+void test_pixel__put_row_blend() {
+    verify_put_row(0);
+}
+
+/**
+ * Test which verifies that guac_common_pixel_blend() handles fully opaque and
+ * fully transparent colors as the Porter-Duff "over" operator requires.
+ */
+void test_pixel__blend() {
+
+    /* Fully opaque source replaces destination */
+    CU_ASSERT_EQUAL(0xFF102030, guac_common_pixel_blend(0xFF405060, 0xFF102030));
+
+    /* Fully transparent destination is replaced by source */
+    CU_ASSERT_EQUAL(0x80102030, guac_common_pixel_blend(0x00405060, 0x80102030));
+
+    /* Fully transparent source leaves destination untouched */
+    CU_ASSERT_EQUAL(0xFF405060, guac_common_pixel_blend(0xFF405060, 0x00000000));
+
+    /* Destination components which are zero are left to the source */
+    CU_ASSERT_EQUAL(0xFF102030, guac_common_pixel_blend(0xFF000000, 0x80102030));
+
+}
+
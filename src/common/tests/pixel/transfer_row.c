@@ -0,0 +1,192 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+#include "pixel-test-data.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol-types.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The number of pixels by which the source and destination are offset when
+ * testing transfers between overlapping regions of the same row. This is
+ * deliberately smaller than any SIMD vector width.
+ */
+#define OVERLAP_OFFSET 3
+
+/**
+ * Every transfer function, in the order defined by guac_transfer_function.
+ */
+static const guac_transfer_function TRANSFER_FUNCTIONS[] = {
+    GUAC_TRANSFER_BINARY_BLACK,
+    GUAC_TRANSFER_BINARY_WHITE,
+    GUAC_TRANSFER_BINARY_SRC,
+    GUAC_TRANSFER_BINARY_DEST,
+    GUAC_TRANSFER_BINARY_NSRC,
+    GUAC_TRANSFER_BINARY_NDEST,
+    GUAC_TRANSFER_BINARY_AND,
+    GUAC_TRANSFER_BINARY_NAND,
+    GUAC_TRANSFER_BINARY_OR,
+    GUAC_TRANSFER_BINARY_NOR,
+    GUAC_TRANSFER_BINARY_XOR,
+    GUAC_TRANSFER_BINARY_XNOR,
+    GUAC_TRANSFER_BINARY_NSRC_AND,
+    GUAC_TRANSFER_BINARY_NSRC_NAND,
+    GUAC_TRANSFER_BINARY_NSRC_OR,
+    GUAC_TRANSFER_BINARY_NSRC_NOR
+};
+
+/**
+ * The number of entries in TRANSFER_FUNCTIONS.
+ */
+#define TRANSFER_FUNCTION_COUNT \
+    ((int) (sizeof(TRANSFER_FUNCTIONS) / sizeof(TRANSFER_FUNCTIONS[0])))
+
+/**
+ * Verifies that the given implementation of guac_common_pixel_transfer_row()
+ * produces exactly the same pixels and range of changed pixels as the scalar
+ * implementation for the given transfer function, both for distinct source
+ * and destination rows and for overlapping rows.
+ *
+ * @param impl
+ *     The implementation to compare against the scalar implementation.
+ *
+ * @param op
+ *     The transfer function to test.
+ *
+ * @param width
+ *     The width of the rows to test, in pixels.
+ *
+ * @param seed
+ *     The state of the pseudo-random number generator used to generate test
+ *     data.
+ */
+static void verify_transfer_row(guac_common_pixel_impl impl,
+        guac_transfer_function op, int width, uint32_t* seed) {
+
+    uint32_t src[PIXEL_TEST_MAX_WIDTH];
+    uint32_t expected[PIXEL_TEST_MAX_WIDTH + OVERLAP_OFFSET];
+    uint32_t actual[PIXEL_TEST_MAX_WIDTH + OVERLAP_OFFSET];
+
+    int expected_first = -1, expected_last = -1;
+    int actual_first = -1, actual_last = -1;
+    int expected_result, actual_result;
+    int backwards;
+
+    for (backwards = 0; backwards <= 1; backwards++) {
+
+        /* Distinct source and destination */
+        pixel_test_random_row(src, width, seed);
+        pixel_test_random_row(expected, width, seed);
+        memcpy(actual, expected, sizeof(uint32_t) * width);
+
+        guac_common_pixel_set_impl(GUAC_COMMON_PIXEL_SCALAR);
+        expected_result = guac_common_pixel_transfer_row(op, src, expected,
+                width, backwards, &expected_first, &expected_last);
+
+        guac_common_pixel_set_impl(impl);
+        actual_result = guac_common_pixel_transfer_row(op, src, actual,
+                width, backwards, &actual_first, &actual_last);
+
+        CU_ASSERT_EQUAL(expected_result, actual_result);
+        CU_ASSERT_EQUAL(expected_first, actual_first);
+        CU_ASSERT_EQUAL(expected_last, actual_last);
+        CU_ASSERT_EQUAL(0, memcmp(expected, actual, sizeof(uint32_t) * width));
+
+    }
+
+    /* Source and destination within the same row, destination to the left
+     * of the source (copied forwards) */
+    pixel_test_random_row(expected, width + OVERLAP_OFFSET, seed);
+    memcpy(actual, expected, sizeof(uint32_t) * (width + OVERLAP_OFFSET));
+
+    guac_common_pixel_set_impl(GUAC_COMMON_PIXEL_SCALAR);
+    expected_result = guac_common_pixel_transfer_row(op,
+            expected + OVERLAP_OFFSET, expected, width, 0,
+            &expected_first, &expected_last);
+
+    guac_common_pixel_set_impl(impl);
+    actual_result = guac_common_pixel_transfer_row(op,
+            actual + OVERLAP_OFFSET, actual, width, 0,
+            &actual_first, &actual_last);
+
+    CU_ASSERT_EQUAL(expected_result, actual_result);
+    CU_ASSERT_EQUAL(expected_first, actual_first);
+    CU_ASSERT_EQUAL(expected_last, actual_last);
+    CU_ASSERT_EQUAL(0, memcmp(expected, actual,
+                sizeof(uint32_t) * (width + OVERLAP_OFFSET)));
+
+    /* Source and destination within the same row, destination to the right
+     * of the source (copied backwards) */
+    pixel_test_random_row(expected, width + OVERLAP_OFFSET, seed);
+    memcpy(actual, expected, sizeof(uint32_t) * (width + OVERLAP_OFFSET));
+
+    guac_common_pixel_set_impl(GUAC_COMMON_PIXEL_SCALAR);
+    expected_result = guac_common_pixel_transfer_row(op,
+            expected, expected + OVERLAP_OFFSET, width, 1,
+            &expected_first, &expected_last);
+
+    guac_common_pixel_set_impl(impl);
+    actual_result = guac_common_pixel_transfer_row(op,
+            actual, actual + OVERLAP_OFFSET, width, 1,
+            &actual_first, &actual_last);
+
+    CU_ASSERT_EQUAL(expected_result, actual_result);
+    CU_ASSERT_EQUAL(expected_first, actual_first);
+    CU_ASSERT_EQUAL(expected_last, actual_last);
+    CU_ASSERT_EQUAL(0, memcmp(expected, actual,
+                sizeof(uint32_t) * (width + OVERLAP_OFFSET)));
+
+}
+
+/**
+ * Test which verifies that every supported SIMD implementation of
+ * guac_common_pixel_transfer_row() behaves identically to the scalar
+ * implementation for every transfer function.
+ */
+void test_pixel__transfer_row() {
+
+    guac_common_pixel_impl original = guac_common_pixel_get_impl();
+
+    int i;
+    for (i = 0; i < PIXEL_TEST_IMPL_COUNT; i++) {
+
+        guac_common_pixel_impl impl = PIXEL_TEST_IMPLS[i];
+        if (guac_common_pixel_set_impl(impl)) {
+            printf("Skipping unsupported implementation %i\n", impl);
+            continue;
+        }
+
+        uint32_t seed = 0xC0FFEE11;
+
+        int op, width;
+        for (op = 0; op < TRANSFER_FUNCTION_COUNT; op++) {
+            for (width = 0; width <= PIXEL_TEST_MAX_WIDTH; width++)
+                verify_transfer_row(impl, TRANSFER_FUNCTIONS[op], width, &seed);
+        }
+
+    }
+
+    guac_common_pixel_set_impl(original);
+
+}
+
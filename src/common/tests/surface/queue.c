@@ -0,0 +1,244 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/surface-queue.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdlib.h>
+
+/**
+ * The width and height of each update queued by test_queue_fill(), in
+ * pixels.
+ */
+#define TEST_RECT_SIZE 100
+
+/**
+ * The distance between the upper-left corners of adjacent updates queued by
+ * test_queue_fill(), in pixels. Updates this far apart are never combined.
+ */
+#define TEST_RECT_SPACING 300
+
+/**
+ * The number of rows and columns of updates queued by test_queue_fill().
+ */
+#define TEST_GRID_SIZE 16
+
+/**
+ * Allocates a new, empty bitmap queue.
+ *
+ * @return
+ *     A newly-allocated bitmap queue.
+ */
+static guac_common_surface_queue* test_queue_alloc() {
+
+    guac_common_surface_queue* queue = calloc(1,
+            sizeof(guac_common_surface_queue));
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(queue);
+    return queue;
+
+}
+
+/**
+ * Adds an update having the given position and dimensions to the given
+ * queue.
+ *
+ * @param queue
+ *     The queue to add the update to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the update.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the update.
+ *
+ * @param width
+ *     The width of the update.
+ *
+ * @param height
+ *     The height of the update.
+ */
+static void test_queue_add(guac_common_surface_queue* queue,
+        int x, int y, int width, int height) {
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, x, y, width, height);
+    guac_common_surface_queue_add(queue, &rect);
+
+}
+
+/**
+ * Fills the given queue with TEST_GRID_SIZE rows and columns of updates
+ * which are too far apart to be combined, filling the queue completely.
+ *
+ * @param queue
+ *     The queue to fill.
+ */
+static void test_queue_fill(guac_common_surface_queue* queue) {
+
+    for (int y = 0; y < TEST_GRID_SIZE; y++) {
+        for (int x = 0; x < TEST_GRID_SIZE; x++)
+            test_queue_add(queue, x * TEST_RECT_SPACING, y * TEST_RECT_SPACING,
+                    TEST_RECT_SIZE, TEST_RECT_SIZE);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(queue->length, GUAC_COMMON_SURFACE_QUEUE_SIZE);
+
+}
+
+/**
+ * Returns the index of the queued update having exactly the given position
+ * and dimensions.
+ *
+ * @param queue
+ *     The queue to search.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the update.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the update.
+ *
+ * @param width
+ *     The width of the update.
+ *
+ * @param height
+ *     The height of the update.
+ *
+ * @return
+ *     The index of the matching update, or -1 if no such update is queued.
+ */
+static int test_queue_find(guac_common_surface_queue* queue,
+        int x, int y, int width, int height) {
+
+    for (int i = 0; i < queue->length; i++) {
+        guac_common_rect* rect = &queue->rects[i].rect;
+        if (rect->x == x && rect->y == y
+                && rect->width == width && rect->height == height)
+            return i;
+    }
+
+    return -1;
+
+}
+
+/**
+ * Test which verifies that queued updates are combined with nearby updates
+ * as they are queued, including updates which only become worth combining
+ * after an earlier combination.
+ */
+void test_surface__queue_merge() {
+
+    guac_common_surface_queue* queue = test_queue_alloc();
+
+    /* Small updates close together are combined */
+    test_queue_add(queue, 0, 0, 10, 10);
+    test_queue_add(queue, 20, 0, 10, 10);
+    CU_ASSERT_EQUAL(queue->length, 1);
+    CU_ASSERT(test_queue_find(queue, 0, 0, 30, 10) != -1);
+
+    guac_common_surface_queue_clear(queue);
+    CU_ASSERT_EQUAL(queue->length, 0);
+
+    /* Large updates far apart are kept separate */
+    test_queue_add(queue, 0, 0, 100, 100);
+    test_queue_add(queue, 300, 0, 100, 100);
+    CU_ASSERT_EQUAL(queue->length, 2);
+
+    /* An update bridging both absorbs the first, after which the second is
+     * also worth absorbing */
+    test_queue_add(queue, 100, 0, 200, 100);
+    CU_ASSERT_EQUAL(queue->length, 1);
+    CU_ASSERT(test_queue_find(queue, 0, 0, 400, 100) != -1);
+
+    free(queue);
+
+}
+
+/**
+ * Test which verifies that an update added to a full queue is combined with
+ * the queued update which it enlarges least, leaving all other updates
+ * untouched.
+ */
+void test_surface__queue_full() {
+
+    guac_common_surface_queue* queue = test_queue_alloc();
+    test_queue_fill(queue);
+
+    /* The nearest queued update is at the end of the first row */
+    int last = (TEST_GRID_SIZE - 1) * TEST_RECT_SPACING;
+    int beyond = TEST_GRID_SIZE * TEST_RECT_SPACING;
+    test_queue_add(queue, beyond, 0, TEST_RECT_SIZE, TEST_RECT_SIZE);
+
+    CU_ASSERT_EQUAL(queue->length, GUAC_COMMON_SURFACE_QUEUE_SIZE);
+    CU_ASSERT(test_queue_find(queue, last, 0,
+                beyond - last + TEST_RECT_SIZE, TEST_RECT_SIZE) != -1);
+    CU_ASSERT(test_queue_find(queue, last - TEST_RECT_SPACING, 0,
+                TEST_RECT_SIZE, TEST_RECT_SIZE) != -1);
+    CU_ASSERT(test_queue_find(queue, last, TEST_RECT_SPACING,
+                TEST_RECT_SIZE, TEST_RECT_SIZE) != -1);
+
+    free(queue);
+
+}
+
+/**
+ * Test which verifies that an update added to a full queue replaces an
+ * update which has already been flushed, and that queued updates moved into
+ * the replaced slot can still be found and combined.
+ */
+void test_surface__queue_reuse_flushed() {
+
+    guac_common_surface_queue* queue = test_queue_alloc();
+    test_queue_fill(queue);
+
+    /* The final update is moved into the slot of the flushed update */
+    int last = (TEST_GRID_SIZE - 1) * TEST_RECT_SPACING;
+    queue->rects[5].flushed = 1;
+
+    int beyond = TEST_GRID_SIZE * TEST_RECT_SPACING;
+    test_queue_add(queue, beyond, beyond, TEST_RECT_SIZE, TEST_RECT_SIZE);
+
+    CU_ASSERT_EQUAL(queue->length, GUAC_COMMON_SURFACE_QUEUE_SIZE);
+    CU_ASSERT(test_queue_find(queue, beyond, beyond,
+                TEST_RECT_SIZE, TEST_RECT_SIZE) != -1);
+    CU_ASSERT_EQUAL(test_queue_find(queue, last, last,
+                TEST_RECT_SIZE, TEST_RECT_SIZE), 5);
+
+    for (int i = 0; i < queue->length; i++)
+        CU_ASSERT_FALSE(queue->rects[i].flushed);
+
+    /* The moved update is still combined with updates which adjoin it,
+     * rather than those updates replacing another flushed update */
+    queue->rects[7].flushed = 1;
+    test_queue_add(queue, last, last + TEST_RECT_SIZE,
+            TEST_RECT_SIZE, TEST_RECT_SIZE);
+
+    CU_ASSERT_EQUAL(queue->length, GUAC_COMMON_SURFACE_QUEUE_SIZE);
+    CU_ASSERT(test_queue_find(queue, last, last,
+                TEST_RECT_SIZE, 2 * TEST_RECT_SIZE) != -1);
+    CU_ASSERT_EQUAL(test_queue_find(queue, last, last + TEST_RECT_SIZE,
+                TEST_RECT_SIZE, TEST_RECT_SIZE), -1);
+
+    free(queue);
+
+}
+
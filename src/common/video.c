@@ -0,0 +1,469 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/rect.h"
+#include "common/video.h"
+
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The type of the buffer passed to the write callback of an AVIOContext
+ * became const with libavformat 61.
+ */
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+#define GUAC_COMMON_VIDEO_IO_CONST const
+#else
+#define GUAC_COMMON_VIDEO_IO_CONST
+#endif
+
+struct guac_common_video {
+
+    /**
+     * The client associated with the layer being streamed.
+     */
+    guac_client* client;
+
+    /**
+     * The socket over which the video is sent.
+     */
+    guac_socket* socket;
+
+    /**
+     * The layer in which the video is played, covering the region being
+     * streamed.
+     */
+    guac_layer* layer;
+
+    /**
+     * The stream over which encoded video is sent.
+     */
+    guac_stream* stream;
+
+    /**
+     * The region being streamed, relative to the parent layer.
+     */
+    guac_common_rect rect;
+
+    /**
+     * The open VP8 encoding context.
+     */
+    AVCodecContext* context;
+
+    /**
+     * The WebM muxing context, writing via a custom AVIOContext which sends
+     * all data as blobs over the stream.
+     */
+    AVFormatContext* format_context;
+
+    /**
+     * The sole stream within the WebM container.
+     */
+    AVStream* output_stream;
+
+    /**
+     * YUV frame which receives each converted frame prior to encoding,
+     * reused for all frames.
+     */
+    AVFrame* frame;
+
+    /**
+     * Context for converting ARGB image data into YUV frames, reused for all
+     * frames.
+     */
+    struct SwsContext* sws;
+
+    /**
+     * The time that the video began. Presentation timestamps are relative to
+     * this time, in milliseconds.
+     */
+    guac_timestamp start;
+
+    /**
+     * The presentation timestamp of the most recent frame, or -1 if no frames
+     * have yet been written.
+     */
+    int64_t last_pts;
+
+};
+
+/**
+ * Callback which is invoked by guac_client_foreach_user() for each user
+ * while determining whether video is supported.
+ *
+ * @param user
+ *     The user to check.
+ *
+ * @param data
+ *     Pointer to an int which is set to zero if the user lacks support for
+ *     GUAC_COMMON_VIDEO_MIMETYPE.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_video_support_callback(guac_user* user,
+        void* data) {
+
+    int* supported = (int*) data;
+
+    const char** mimetype = user->info.video_mimetypes;
+    if (mimetype != NULL) {
+        for (; *mimetype != NULL; mimetype++) {
+            if (strcmp(*mimetype, GUAC_COMMON_VIDEO_MIMETYPE) == 0)
+                return NULL;
+        }
+    }
+
+    *supported = 0;
+    return NULL;
+
+}
+
+int guac_common_video_supported(guac_client* client) {
+
+    if (client->connected_users == 0)
+        return 0;
+
+    int supported = 1;
+    guac_client_foreach_user(client, guac_common_video_support_callback,
+            &supported);
+
+    return supported;
+
+}
+
+/**
+ * Write callback for the AVIOContext of a guac_common_video, sending all
+ * muxed data as blobs over the video stream.
+ *
+ * @param opaque
+ *     The guac_common_video being written.
+ *
+ * @param buf
+ *     The muxed data to send.
+ *
+ * @param buf_size
+ *     The number of bytes of muxed data to send.
+ *
+ * @return
+ *     The number of bytes sent, or a negative value if an error occurs.
+ */
+static int guac_common_video_write_packet(void* opaque,
+        GUAC_COMMON_VIDEO_IO_CONST uint8_t* buf, int buf_size) {
+
+    guac_common_video* video = (guac_common_video*) opaque;
+
+    int remaining = buf_size;
+    while (remaining > 0) {
+
+        int length = remaining;
+        if (length > GUAC_PROTOCOL_BLOB_MAX_LENGTH)
+            length = GUAC_PROTOCOL_BLOB_MAX_LENGTH;
+
+        if (guac_protocol_send_blob(video->socket, video->stream, buf, length))
+            return AVERROR(EIO);
+
+        buf += length;
+        remaining -= length;
+
+    }
+
+    return buf_size;
+
+}
+
+/**
+ * Sends the given frame to the encoder, writing any resulting packets to the
+ * WebM container. If the frame is NULL, the encoder is drained.
+ *
+ * @param video
+ *     The video being encoded.
+ *
+ * @param frame
+ *     The frame to encode, or NULL to drain the encoder.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guac_common_video_encode(guac_common_video* video,
+        AVFrame* frame) {
+
+    if (avcodec_send_frame(video->context, frame) < 0)
+        return 1;
+
+    AVPacket* packet = av_packet_alloc();
+    if (packet == NULL)
+        return 1;
+
+    int result = 0;
+    while (avcodec_receive_packet(video->context, packet) == 0) {
+
+        av_packet_rescale_ts(packet, video->context->time_base,
+                video->output_stream->time_base);
+        packet->stream_index = video->output_stream->index;
+
+        if (av_write_frame(video->format_context, packet) < 0)
+            result = 1;
+
+        av_packet_unref(packet);
+
+    }
+
+    av_packet_free(&packet);
+
+    /* Send everything muxed so far, such that each frame reaches the client
+     * immediately */
+    avio_flush(video->format_context->pb);
+    return result;
+
+}
+
+/**
+ * Frees the AVIOContext of the given WebM muxing context, along with its
+ * buffer.
+ *
+ * @param format_context
+ *     The muxing context whose AVIOContext should be freed.
+ */
+static void guac_common_video_free_io(AVFormatContext* format_context) {
+
+    if (format_context->pb == NULL)
+        return;
+
+    av_freep(&format_context->pb->buffer);
+    avio_context_free(&format_context->pb);
+
+}
+
+guac_common_video* guac_common_video_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* parent,
+        const guac_common_rect* rect, int bitrate) {
+
+    /* YUV 4:2:0 requires even dimensions */
+    if (rect->width < 2 || rect->height < 2
+            || rect->width % 2 != 0 || rect->height % 2 != 0)
+        return NULL;
+
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_VP8);
+    if (codec == NULL) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "VP8 encoder is not "
+                "available. Video will not be streamed.");
+        return NULL;
+    }
+
+    guac_common_video* video = calloc(1, sizeof(guac_common_video));
+    if (video == NULL)
+        return NULL;
+
+    video->client = client;
+    video->socket = socket;
+    video->rect = *rect;
+    video->last_pts = -1;
+
+    /* Allocate WebM container */
+    if (avformat_alloc_output_context2(&video->format_context, NULL, "webm",
+                NULL) < 0 || video->format_context == NULL)
+        goto fail;
+
+    video->output_stream = avformat_new_stream(video->format_context, NULL);
+    if (video->output_stream == NULL)
+        goto fail;
+
+    /* Configure VP8 for realtime encoding, without buffering any frames */
+    video->context = avcodec_alloc_context3(codec);
+    if (video->context == NULL)
+        goto fail;
+
+    video->context->width = rect->width;
+    video->context->height = rect->height;
+    video->context->pix_fmt = AV_PIX_FMT_YUV420P;
+    video->context->time_base = (AVRational) { 1, 1000 };
+    video->context->bit_rate = bitrate;
+    video->context->gop_size = GUAC_COMMON_VIDEO_KEYFRAME_INTERVAL;
+    video->context->max_b_frames = 0;
+
+    av_opt_set(video->context->priv_data, "deadline", "realtime", 0);
+    av_opt_set(video->context->priv_data, "cpu-used", "8", 0);
+    av_opt_set(video->context->priv_data, "lag-in-frames", "0", 0);
+
+    if (video->format_context->oformat->flags & AVFMT_GLOBALHEADER)
+        video->context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    if (avcodec_open2(video->context, codec, NULL) < 0)
+        goto fail;
+
+    if (avcodec_parameters_from_context(video->output_stream->codecpar,
+                video->context) < 0)
+        goto fail;
+
+    video->output_stream->time_base = video->context->time_base;
+
+    /* Allocate frame and converter, reused for all frames */
+    video->frame = av_frame_alloc();
+    if (video->frame == NULL)
+        goto fail;
+
+    video->frame->format = video->context->pix_fmt;
+    video->frame->width = rect->width;
+    video->frame->height = rect->height;
+
+    if (av_frame_get_buffer(video->frame, 0) < 0)
+        goto fail;
+
+    video->sws = sws_getContext(rect->width, rect->height, AV_PIX_FMT_RGB32,
+            rect->width, rect->height, AV_PIX_FMT_YUV420P, SWS_POINT,
+            NULL, NULL, NULL);
+    if (video->sws == NULL)
+        goto fail;
+
+    /* Send all muxed data over the stream */
+    unsigned char* io_buffer = av_malloc(GUAC_COMMON_VIDEO_IO_BUFFER_SIZE);
+    if (io_buffer == NULL)
+        goto fail;
+
+    video->format_context->pb = avio_alloc_context(io_buffer,
+            GUAC_COMMON_VIDEO_IO_BUFFER_SIZE, 1, video, NULL,
+            guac_common_video_write_packet, NULL);
+
+    if (video->format_context->pb == NULL) {
+        av_free(io_buffer);
+        goto fail;
+    }
+
+    /* Create layer covering the streamed region */
+    video->layer = guac_client_alloc_layer(client);
+    video->stream = guac_client_alloc_stream(client);
+
+    guac_protocol_send_size(socket, video->layer, rect->width, rect->height);
+    guac_protocol_send_move(socket, video->layer, parent, rect->x, rect->y, 0);
+    guac_protocol_send_video(socket, video->stream, video->layer,
+            GUAC_COMMON_VIDEO_MIMETYPE);
+
+    /* Write a live (unseekable) WebM header */
+    AVDictionary* options = NULL;
+    av_dict_set(&options, "live", "1", 0);
+    int result = avformat_write_header(video->format_context, &options);
+    av_dict_free(&options);
+
+    if (result < 0) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "Unable to write WebM "
+                "header. Video will not be streamed.");
+        guac_protocol_send_end(socket, video->stream);
+        guac_protocol_send_dispose(socket, video->layer);
+        guac_client_free_stream(client, video->stream);
+        guac_client_free_layer(client, video->layer);
+        goto fail;
+    }
+
+    avio_flush(video->format_context->pb);
+    video->start = guac_timestamp_current();
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "Streaming %ix%i region at "
+            "(%i, %i) as video (%i bps).", rect->width, rect->height,
+            rect->x, rect->y, bitrate);
+
+    return video;
+
+fail:
+
+    if (video->sws != NULL)
+        sws_freeContext(video->sws);
+
+    av_frame_free(&video->frame);
+    avcodec_free_context(&video->context);
+
+    if (video->format_context != NULL) {
+        guac_common_video_free_io(video->format_context);
+        avformat_free_context(video->format_context);
+    }
+
+    free(video);
+    return NULL;
+
+}
+
+const guac_common_rect* guac_common_video_get_rect(
+        const guac_common_video* video) {
+    return &video->rect;
+}
+
+int guac_common_video_write_frame(guac_common_video* video,
+        const unsigned char* buffer, int stride, guac_timestamp timestamp) {
+
+    AVFrame* frame = video->frame;
+    if (av_frame_make_writable(frame) < 0)
+        return 1;
+
+    /* Convert ARGB image data to YUV */
+    const uint8_t* src_data[1] = { buffer };
+    const int src_linesize[1] = { stride };
+    sws_scale(video->sws, src_data, src_linesize, 0, video->rect.height,
+            frame->data, frame->linesize);
+
+    /* Timestamps must be strictly increasing */
+    int64_t pts = timestamp - video->start;
+    if (pts <= video->last_pts)
+        pts = video->last_pts + 1;
+
+    frame->pts = pts;
+    video->last_pts = pts;
+
+    return guac_common_video_encode(video, frame);
+
+}
+
+void guac_common_video_free(guac_common_video* video) {
+
+    /* Send any remaining frames and finish the container */
+    guac_common_video_encode(video, NULL);
+    av_write_trailer(video->format_context);
+    avio_flush(video->format_context->pb);
+
+    /* End stream and remove layer */
+    guac_protocol_send_end(video->socket, video->stream);
+    guac_protocol_send_dispose(video->socket, video->layer);
+    guac_client_free_stream(video->client, video->stream);
+    guac_client_free_layer(video->client, video->layer);
+
+    sws_freeContext(video->sws);
+    av_frame_free(&video->frame);
+    avcodec_free_context(&video->context);
+
+    guac_common_video_free_io(video->format_context);
+    avformat_free_context(video->format_context);
+
+    free(video);
+
+}
+
@@ -23,11 +23,39 @@
 #include "guacamole/client.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
+#include "guacamole/timestamp.h"
 #include "guacamole/user.h"
 #include "raw_encoder.h"
 
+#ifdef ENABLE_OGG
+#include "ogg_encoder.h"
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/**
+ * The number of bytes in each sample of PCM data provided to audio encoders,
+ * including all channels.
+ */
+#define GUAC_AUDIO_FRAME_SIZE (GUAC_AUDIO_CHANNELS * GUAC_AUDIO_BPS / 8)
+
+/**
+ * Returns the number of bytes of PCM data provided to audio encoders that
+ * represent the given duration.
+ *
+ * @param duration
+ *     The duration of audio, in milliseconds.
+ *
+ * @return
+ *     The number of bytes of PCM data representing the given duration.
+ */
+static int guac_audio_packet_size(int duration) {
+    return GUAC_AUDIO_RATE * duration / 1000 * GUAC_AUDIO_FRAME_SIZE;
+}
 
 /**
  * Sets the encoder associated with the given guac_audio_stream, automatically
@@ -52,6 +80,222 @@ static void guac_audio_stream_set_encoder(guac_audio_stream* audio,
 
 }
 
+/**
+ * Sets the format of PCM data written to the given guac_audio_stream,
+ * resetting the state of conversion to the format provided to encoders.
+ *
+ * @param audio
+ *     The guac_audio_stream whose PCM format is being set.
+ *
+ * @param rate
+ *     The number of samples per second of PCM data written to the stream.
+ *
+ * @param channels
+ *     The number of audio channels per sample of PCM data written to the
+ *     stream.
+ *
+ * @param bps
+ *     The number of bits per sample per channel for PCM data written to the
+ *     stream.
+ */
+static void guac_audio_stream_set_format(guac_audio_stream* audio,
+        int rate, int channels, int bps) {
+
+    audio->pcm_rate = rate;
+    audio->pcm_channels = channels;
+    audio->pcm_bps = bps;
+
+    audio->__resample_step = (int) (((int64_t) rate << 16) / GUAC_AUDIO_RATE);
+    audio->__resample_position = 0;
+    audio->__resample_primed = 0;
+
+}
+
+/**
+ * Provides all converted PCM data which has accumulated within the given
+ * guac_audio_stream to its encoder, if any, without flushing the encoder.
+ *
+ * @param audio
+ *     The guac_audio_stream whose accumulated PCM data should be encoded.
+ */
+static void guac_audio_stream_encode_packet(guac_audio_stream* audio) {
+
+    if (audio->__packet_length == 0)
+        return;
+
+    if (audio->encoder != NULL && audio->encoder->write_handler)
+        audio->encoder->write_handler(audio, audio->__packet,
+                audio->__packet_length);
+
+    audio->__packet_length = 0;
+
+}
+
+/**
+ * Provides all converted PCM data which has accumulated within the given
+ * guac_audio_stream to its encoder, if any, and flushes the encoder. The
+ * lock of the guac_audio_stream must already be held.
+ *
+ * @param audio
+ *     The guac_audio_stream to flush.
+ */
+static void guac_audio_stream_flush_packet(guac_audio_stream* audio) {
+
+    /* Encode any partial packet */
+    guac_audio_stream_encode_packet(audio);
+
+    /* Flush any buffered data */
+    if (audio->encoder != NULL && audio->encoder->flush_handler)
+        audio->encoder->flush_handler(audio);
+
+}
+
+/**
+ * Appends a single converted sample to the packet accumulating within the
+ * given guac_audio_stream, encoding and flushing the packet if it has reached
+ * its target size.
+ *
+ * @param audio
+ *     The guac_audio_stream receiving the sample.
+ *
+ * @param sample
+ *     The value of each of the GUAC_AUDIO_CHANNELS channels of the sample.
+ */
+static void guac_audio_stream_append(guac_audio_stream* audio,
+        const int* sample) {
+
+    int i;
+    unsigned char* current = audio->__packet + audio->__packet_length;
+
+    /* Store each channel as signed, little-endian 16-bit */
+    for (i = 0; i < GUAC_AUDIO_CHANNELS; i++) {
+        *(current++) = sample[i] & 0xFF;
+        *(current++) = (sample[i] >> 8) & 0xFF;
+    }
+
+    audio->__packet_length += GUAC_AUDIO_FRAME_SIZE;
+
+    /* Send packet once complete */
+    if (audio->__packet_length >= audio->__packet_size)
+        guac_audio_stream_flush_packet(audio);
+
+}
+
+/**
+ * Updates the measured regularity of PCM data written to the given
+ * guac_audio_stream, choosing a packet size which is large enough to absorb
+ * any irregularity. If PCM data resumes after a pause, any partial packet
+ * remaining from before the pause is sent first.
+ *
+ * @param audio
+ *     The guac_audio_stream receiving PCM data.
+ *
+ * @param duration
+ *     The duration of the PCM data being written, in milliseconds.
+ */
+static void guac_audio_stream_update_timing(guac_audio_stream* audio,
+        int duration) {
+
+    guac_timestamp now = guac_timestamp_current();
+
+    if (audio->__last_write != 0) {
+
+        int elapsed = now - audio->__last_write;
+
+        /* Any partial packet is the end of a sound if audio has paused */
+        if (elapsed > audio->__last_duration + GUAC_AUDIO_MAX_PACKET_DURATION)
+            guac_audio_stream_flush_packet(audio);
+
+        /* Otherwise, track deviation from the expected interval (the
+         * duration of the audio previously written), similar to the
+         * interarrival jitter of RFC 3550 */
+        else {
+
+            int deviation = elapsed - audio->__last_duration;
+            if (deviation < 0)
+                deviation = -deviation;
+
+            audio->__jitter += deviation - ((audio->__jitter + 8) >> 4);
+
+            int packet_duration = (audio->__jitter >> 4) * 2;
+            if (packet_duration < GUAC_AUDIO_MIN_PACKET_DURATION)
+                packet_duration = GUAC_AUDIO_MIN_PACKET_DURATION;
+            else if (packet_duration > GUAC_AUDIO_MAX_PACKET_DURATION)
+                packet_duration = GUAC_AUDIO_MAX_PACKET_DURATION;
+
+            audio->__packet_size = guac_audio_packet_size(packet_duration);
+
+        }
+
+    }
+
+    audio->__last_write = now;
+    audio->__last_duration = duration;
+
+}
+
+/**
+ * Thread which automatically flushes any partially-accumulated packet within
+ * the given guac_audio_stream once no further PCM data has been written for
+ * the duration of the audio last written plus the duration of a full packet.
+ * As the packet duration grows with the irregularity of written PCM, sources
+ * which write irregularly are allowed correspondingly more time before their
+ * audio is considered to have ended.
+ *
+ * @param data
+ *     The guac_audio_stream to flush.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_audio_stream_flush_thread(void* data) {
+
+    guac_audio_stream* audio = (guac_audio_stream*) data;
+
+    pthread_mutex_lock(&(audio->__lock));
+
+    while (!audio->__stopping) {
+
+        /* Wait for PCM data if there is nothing to flush */
+        if (audio->__packet_length == 0) {
+            pthread_cond_wait(&(audio->__modified), &(audio->__lock));
+            continue;
+        }
+
+        int packet_duration = audio->__packet_size / GUAC_AUDIO_FRAME_SIZE
+                            * 1000 / GUAC_AUDIO_RATE;
+
+        guac_timestamp deadline = audio->__last_write
+                                + audio->__last_duration + packet_duration;
+
+        /* Flush partial packet if PCM data has stopped arriving */
+        guac_timestamp now = guac_timestamp_current();
+        if (now >= deadline) {
+            guac_audio_stream_flush_packet(audio);
+            continue;
+        }
+
+        /* Otherwise, wait until the deadline unless more PCM arrives */
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+
+        guac_timestamp remaining = deadline - now;
+        wake.tv_sec += remaining / 1000;
+        wake.tv_nsec += (remaining % 1000) * 1000000;
+        if (wake.tv_nsec >= 1000000000) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000;
+        }
+
+        pthread_cond_timedwait(&(audio->__modified), &(audio->__lock), &wake);
+
+    }
+
+    pthread_mutex_unlock(&(audio->__lock));
+    return NULL;
+
+}
+
 /**
  * Assigns a new audio encoder to the given guac_audio_stream based on the
  * audio mimetypes declared as supported by the given user. If no audio encoder
@@ -83,6 +327,23 @@ static void* guac_audio_assign_encoder(guac_user* user, void* data) {
     if (user == NULL || audio->encoder != NULL)
         return audio->encoder;
 
+#ifdef ENABLE_OGG
+    /* Prefer compressed audio if supported, regardless of the order that
+     * mimetypes are declared */
+    if (ogg_encoder_supports(audio->rate, audio->channels, bps)) {
+        for (i=0; user->info.audio_mimetypes[i] != NULL; i++) {
+
+            const char* mimetype = user->info.audio_mimetypes[i];
+
+            if (strcmp(mimetype, ogg_encoder->mimetype) == 0) {
+                guac_audio_stream_set_encoder(audio, ogg_encoder);
+                return audio->encoder;
+            }
+
+        }
+    }
+#endif
+
     /* For each supported mimetype, check for an associated encoder */
     for (i=0; user->info.audio_mimetypes[i] != NULL; i++) {
 
@@ -123,10 +384,19 @@ guac_audio_stream* guac_audio_stream_alloc(guac_client* client,
         return NULL;
     }
 
-    /* Load PCM properties */
-    audio->rate = rate;
-    audio->channels = channels;
-    audio->bps = bps;
+    /* Encoders always receive the same PCM format */
+    audio->rate = GUAC_AUDIO_RATE;
+    audio->channels = GUAC_AUDIO_CHANNELS;
+    audio->bps = GUAC_AUDIO_BPS;
+
+    /* Load properties of PCM written to the stream */
+    guac_audio_stream_set_format(audio, rate, channels, bps);
+
+    /* Accumulate converted PCM in packets */
+    audio->__packet = malloc(guac_audio_packet_size(
+                GUAC_AUDIO_MAX_PACKET_DURATION));
+    audio->__packet_size = guac_audio_packet_size(
+            GUAC_AUDIO_MIN_PACKET_DURATION);
 
     /* Assign encoder if explicitly provided */
     if (encoder != NULL)
@@ -140,6 +410,12 @@ guac_audio_stream* guac_audio_stream_alloc(guac_client* client,
     if (audio->encoder == NULL)
         guac_client_foreach_user(client, guac_audio_assign_encoder, audio);
 
+    /* Automatically flush partial packets once PCM stops arriving */
+    pthread_mutex_init(&(audio->__lock), NULL);
+    pthread_cond_init(&(audio->__modified), NULL);
+    pthread_create(&(audio->__flush_thread), NULL,
+            guac_audio_stream_flush_thread, (void*) audio);
+
     return audio;
 
 }
@@ -147,34 +423,50 @@ guac_audio_stream* guac_audio_stream_alloc(guac_client* client,
 void guac_audio_stream_reset(guac_audio_stream* audio,
         guac_audio_encoder* encoder, int rate, int channels, int bps) {
 
+    pthread_mutex_lock(&(audio->__lock));
+
     /* Pull assigned encoder if no other encoder is requested */
     if (encoder == NULL)
         encoder = audio->encoder;
 
     /* Do nothing if nothing is changing */
     if (encoder == audio->encoder
-            && rate     == audio->rate
-            && channels == audio->channels
-            && bps      == audio->bps) {
+            && rate     == audio->pcm_rate
+            && channels == audio->pcm_channels
+            && bps      == audio->pcm_bps) {
+        pthread_mutex_unlock(&(audio->__lock));
         return;
     }
 
-    /* Free old encoder data */
-    if (audio->encoder != NULL && audio->encoder->end_handler)
-        audio->encoder->end_handler(audio);
+    /* Restart stream only if switching encoders, as the format provided to
+     * encoders never changes */
+    if (encoder != audio->encoder) {
 
-    /* Set PCM properties */
-    audio->rate = rate;
-    audio->channels = channels;
-    audio->bps = bps;
+        /* Send any remaining data using old encoder */
+        guac_audio_stream_flush_packet(audio);
 
-    /* Re-init encoder */
-    guac_audio_stream_set_encoder(audio, encoder);
+        /* Free old encoder data */
+        if (audio->encoder != NULL && audio->encoder->end_handler)
+            audio->encoder->end_handler(audio);
+
+        audio->encoder = NULL;
+
+        /* Init new encoder */
+        guac_audio_stream_set_encoder(audio, encoder);
+
+    }
+
+    /* Set PCM properties, continuing to fill the current packet */
+    guac_audio_stream_set_format(audio, rate, channels, bps);
+
+    pthread_mutex_unlock(&(audio->__lock));
 
 }
 
 void guac_audio_stream_add_user(guac_audio_stream* audio, guac_user* user) {
 
+    pthread_mutex_lock(&(audio->__lock));
+
     /* Attempt to assign encoder if no encoder has yet been assigned */
     if (audio->encoder == NULL)
         guac_audio_assign_encoder(user, audio);
@@ -183,12 +475,22 @@ void guac_audio_stream_add_user(guac_audio_stream* audio, guac_user* user) {
     if (audio->encoder != NULL && audio->encoder->join_handler)
         audio->encoder->join_handler(audio, user);
 
+    pthread_mutex_unlock(&(audio->__lock));
+
 }
 
 void guac_audio_stream_free(guac_audio_stream* audio) {
 
+    /* Stop automatic flushing */
+    pthread_mutex_lock(&(audio->__lock));
+    audio->__stopping = 1;
+    pthread_cond_signal(&(audio->__modified));
+    pthread_mutex_unlock(&(audio->__lock));
+
+    pthread_join(audio->__flush_thread, NULL);
+
     /* Flush stream encoding */
-    guac_audio_stream_flush(audio);
+    guac_audio_stream_flush_packet(audio);
 
     /* Clean up encoder */
     if (audio->encoder != NULL && audio->encoder->end_handler)
@@ -198,6 +500,10 @@ void guac_audio_stream_free(guac_audio_stream* audio) {
     guac_client_free_stream(audio->client, audio->stream);
 
     /* Free associated data */
+    pthread_cond_destroy(&(audio->__modified));
+    pthread_mutex_destroy(&(audio->__lock));
+
+    free(audio->__packet);
     free(audio);
 
 }
@@ -205,17 +511,85 @@ void guac_audio_stream_free(guac_audio_stream* audio) {
 void guac_audio_stream_write_pcm(guac_audio_stream* audio, 
         const unsigned char* data, int length) {
 
-    /* Write data */
-    if (audio->encoder != NULL && audio->encoder->write_handler)
-        audio->encoder->write_handler(audio, data, length);
+    int i;
 
-}
+    pthread_mutex_lock(&(audio->__lock));
 
-void guac_audio_stream_flush(guac_audio_stream* audio) {
+    /* Ignore data if there is no encoder to receive it */
+    if (audio->encoder == NULL) {
+        pthread_mutex_unlock(&(audio->__lock));
+        return;
+    }
 
-    /* Flush any buffered data */
-    if (audio->encoder != NULL && audio->encoder->flush_handler)
-        audio->encoder->flush_handler(audio);
+    int bytes_per_sample = audio->pcm_bps / 8;
+    int frame_size = audio->pcm_channels * bytes_per_sample;
+    int frames = length / frame_size;
+
+    guac_audio_stream_update_timing(audio, frames * 1000 / audio->pcm_rate);
+
+    int* previous = audio->__resample_previous;
+
+    for (; frames > 0; frames--, data += frame_size) {
+
+        int current[GUAC_AUDIO_CHANNELS];
+
+        /* Convert each channel to 16-bit, duplicating the last channel
+         * present as necessary and ignoring any extra channels */
+        for (i = 0; i < GUAC_AUDIO_CHANNELS; i++) {
 
+            int channel = i;
+            if (channel >= audio->pcm_channels)
+                channel = audio->pcm_channels - 1;
+
+            const unsigned char* sample = data + channel * bytes_per_sample;
+
+            /* 16-bit samples are signed and little-endian */
+            if (bytes_per_sample == 2)
+                current[i] = (int16_t) (sample[0] | (sample[1] << 8));
+
+            /* 8-bit samples are unsigned, centered on 128 */
+            else
+                current[i] = (sample[0] - 128) * 256;
+
+        }
+
+        /* Interpolation requires a previous sample */
+        if (!audio->__resample_primed) {
+            memcpy(previous, current, sizeof(current));
+            audio->__resample_primed = 1;
+            continue;
+        }
+
+        /* Produce all samples lying between the previous sample and the
+         * current sample by linear interpolation */
+        while (audio->__resample_position < 65536) {
+
+            int sample[GUAC_AUDIO_CHANNELS];
+            for (i = 0; i < GUAC_AUDIO_CHANNELS; i++)
+                sample[i] = previous[i]
+                    + (int) (((int64_t) (current[i] - previous[i])
+                                * audio->__resample_position) >> 16);
+
+            guac_audio_stream_append(audio, sample);
+            audio->__resample_position += audio->__resample_step;
+
+        }
+
+        audio->__resample_position -= 65536;
+        memcpy(previous, current, sizeof(current));
+
+    }
+
+    /* Any partial packet must now be flushed automatically if no further
+     * PCM arrives */
+    pthread_cond_signal(&(audio->__modified));
+    pthread_mutex_unlock(&(audio->__lock));
+
+}
+
+void guac_audio_stream_flush(guac_audio_stream* audio) {
+    pthread_mutex_lock(&(audio->__lock));
+    guac_audio_stream_flush_packet(audio);
+    pthread_mutex_unlock(&(audio->__lock));
 }
 
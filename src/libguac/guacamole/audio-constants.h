@@ -0,0 +1,65 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef _GUAC_AUDIO_CONSTANTS_H
+#define _GUAC_AUDIO_CONSTANTS_H
+
+/**
+ * Constants related to streaming audio.
+ *
+ * @file audio-constants.h
+ */
+
+/**
+ * The number of samples per second of all PCM data provided to audio
+ * encoders. PCM written to an audio stream at any other rate is resampled.
+ */
+#define GUAC_AUDIO_RATE 44100
+
+/**
+ * The number of channels of all PCM data provided to audio encoders. PCM
+ * written to an audio stream having any other number of channels is
+ * converted.
+ */
+#define GUAC_AUDIO_CHANNELS 2
+
+/**
+ * The number of bits per sample of all PCM data provided to audio encoders.
+ * Samples are signed and little-endian.
+ */
+#define GUAC_AUDIO_BPS 16
+
+/**
+ * The shortest duration of audio sent to the audio encoder at once, in
+ * milliseconds. PCM is accumulated into packets of at least this duration
+ * such that the number of instructions sent does not depend on how finely
+ * the source of the audio divides its data.
+ */
+#define GUAC_AUDIO_MIN_PACKET_DURATION 40
+
+/**
+ * The longest duration of audio sent to the audio encoder at once, in
+ * milliseconds. Packets grow up to this duration as the arrival of PCM data
+ * becomes less regular, at the cost of latency.
+ */
+#define GUAC_AUDIO_MAX_PACKET_DURATION 160
+
+#endif
+
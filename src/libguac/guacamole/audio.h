@@ -27,10 +27,14 @@
  * @file audio.h
  */
 
+#include "audio-constants.h"
 #include "audio-fntypes.h"
 #include "audio-types.h"
 #include "client-types.h"
 #include "stream-types.h"
+#include "timestamp-types.h"
+
+#include <pthread.h>
 
 struct guac_audio_encoder {
 
@@ -87,19 +91,32 @@ struct guac_audio_stream {
     guac_stream* stream;
 
     /**
-     * The number of samples per second of PCM data sent to this stream.
+     * The number of samples per second of PCM data provided to the encoder.
+     * This is always GUAC_AUDIO_RATE.
+     *
+     * NOTE: Prior to libguac.so.21 (-version-info 21:0:0), this was the rate
+     * of the PCM data written to the stream, which is now pcm_rate. As all
+     * PCM is now converted before reaching the encoder, encoders must use
+     * this value, while callers interested in the format of the PCM they
+     * write must use pcm_rate.
      */
     int rate;
 
     /**
-     * The number of audio channels per sample of PCM data. Legal values are
-     * 1 or 2.
+     * The number of audio channels per sample of PCM data provided to the
+     * encoder. This is always GUAC_AUDIO_CHANNELS.
+     *
+     * NOTE: Prior to libguac.so.21, this was the number of channels of the
+     * PCM data written to the stream, which is now pcm_channels.
      */
     int channels;
 
     /**
-     * The number of bits per sample per channel for PCM data. Legal values are
-     * 8 or 16.
+     * The number of bits per sample per channel for PCM data provided to the
+     * encoder. This is always GUAC_AUDIO_BPS.
+     *
+     * NOTE: Prior to libguac.so.21, this was the number of bits per sample
+     * of the PCM data written to the stream, which is now pcm_bps.
      */
     int bps;
 
@@ -108,6 +125,111 @@ struct guac_audio_stream {
      */
     void* data;
 
+    /**
+     * The number of samples per second of PCM data sent to this stream.
+     */
+    int pcm_rate;
+
+    /**
+     * The number of audio channels per sample of PCM data sent to this
+     * stream. Legal values are 1 or 2.
+     */
+    int pcm_channels;
+
+    /**
+     * The number of bits per sample per channel for PCM data sent to this
+     * stream. Legal values are 8 or 16.
+     */
+    int pcm_bps;
+
+    /**
+     * Converted PCM data which has not yet been provided to the encoder, in
+     * the format described by rate, channels, and bps. This buffer is large
+     * enough for GUAC_AUDIO_MAX_PACKET_DURATION milliseconds of audio.
+     */
+    unsigned char* __packet;
+
+    /**
+     * The number of bytes currently stored within __packet.
+     */
+    int __packet_length;
+
+    /**
+     * The number of bytes of converted PCM data which are provided to the
+     * encoder at once, varying with the regularity of written PCM data.
+     */
+    int __packet_size;
+
+    /**
+     * The distance between adjacent samples of PCM data sent to this stream,
+     * in units of 1/65536 of a sample of converted PCM data.
+     */
+    int __resample_step;
+
+    /**
+     * The position of the next converted sample relative to the previous
+     * sample sent to this stream, in units of 1/65536 of a sample sent to
+     * this stream.
+     */
+    int __resample_position;
+
+    /**
+     * The previous sample sent to this stream, after conversion to
+     * GUAC_AUDIO_CHANNELS channels of 16-bit samples.
+     */
+    int __resample_previous[GUAC_AUDIO_CHANNELS];
+
+    /**
+     * Non-zero if __resample_previous contains a sample, zero if no PCM has
+     * yet been sent to this stream in its current format.
+     */
+    int __resample_primed;
+
+    /**
+     * The time that PCM data was last written to this stream, or zero if no
+     * PCM data has been written.
+     */
+    guac_timestamp __last_write;
+
+    /**
+     * The duration of the PCM data last written to this stream, in
+     * milliseconds.
+     */
+    int __last_duration;
+
+    /**
+     * The average deviation between the time elapsed between writes and the
+     * duration of audio written, in units of 1/16 millisecond, as a measure
+     * of the regularity with which PCM data arrives.
+     */
+    int __jitter;
+
+    /**
+     * Lock which is acquired whenever the state of this audio stream is read
+     * or modified, such that __flush_thread may send accumulated PCM while
+     * other threads continue to write PCM.
+     */
+    pthread_mutex_t __lock;
+
+    /**
+     * Condition which is signalled whenever PCM data is written to this
+     * stream, or when __flush_thread must stop.
+     */
+    pthread_cond_t __modified;
+
+    /**
+     * Thread which automatically sends any partially-accumulated packet once
+     * no further PCM data has been written for long enough that the audio
+     * written so far has likely ended, such that short sounds and the ends of
+     * longer sounds are never held back indefinitely.
+     */
+    pthread_t __flush_thread;
+
+    /**
+     * Non-zero if __flush_thread must stop, zero otherwise.
+     */
+    int __stopping;
+
 };
 
 /**
@@ -159,7 +281,9 @@ guac_audio_stream* guac_audio_stream_alloc(guac_client* client,
  * channels, and bits per sample. If NULL is specified for the encoder, the
  * encoder is left unchanged. If the encoder, rate, channels, and bits per
  * sample are all identical to the current settings, this function has no
- * effect.
+ * effect. As PCM data is converted to the same format regardless of the
+ * format written, changing only the rate, channels, or bits per sample does
+ * not interrupt the stream.
  *
  * @param audio
  *     The guac_audio_stream to reset.
@@ -206,9 +330,16 @@ void guac_audio_stream_add_user(guac_audio_stream* audio, guac_user* user);
 void guac_audio_stream_free(guac_audio_stream* stream);
 
 /**
- * Writes PCM data to the given audio stream. This PCM data will be
- * automatically encoded by the audio encoder associated with this stream. The
- * PCM data must be 2-channel, 44100 Hz, with signed 16-bit samples.
+ * Writes PCM data to the given audio stream. This PCM data will be converted
+ * to GUAC_AUDIO_CHANNELS channels of GUAC_AUDIO_BPS-bit samples at
+ * GUAC_AUDIO_RATE Hz, accumulated into packets of between
+ * GUAC_AUDIO_MIN_PACKET_DURATION and GUAC_AUDIO_MAX_PACKET_DURATION
+ * milliseconds (depending on how regularly PCM data is written), and
+ * automatically encoded by the audio encoder associated with this stream as
+ * each packet is completed. The PCM data must be in the format specified when
+ * the stream was allocated or last reset, and must contain only complete
+ * samples. As with WAV, 16-bit samples are signed and little-endian, while
+ * 8-bit samples are unsigned, with 128 representing silence.
  *
  * @param stream
  *     The guac_audio_stream to write PCM data through.
@@ -225,7 +356,11 @@ void guac_audio_stream_write_pcm(guac_audio_stream* stream,
 /**
  * Flushes the underlying audio buffer, if any, ensuring that all audio
  * previously written via guac_audio_stream_write_pcm() has been encoded and
- * sent to the client.
+ * sent to the client. As this sends any partially-accumulated packet, this
+ * should be invoked only when no further audio is expected soon, such as at
+ * the end of a sound. Partially-accumulated packets are also flushed
+ * automatically once PCM data stops arriving, thus invoking this function is
+ * needed only to send audio sooner than that.
  *
  * @param stream
  *     The guac_audio_stream whose audio buffers should be flushed.
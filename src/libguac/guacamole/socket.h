@@ -113,6 +113,16 @@ struct guac_socket {
      */
     pthread_t __keep_alive_thread;
 
+    /**
+     * The total number of bytes successfully written to this guac_socket by
+     * any thread, including bytes of instructions unrelated to the caller.
+     * This may be compared over time to estimate the rate at which data is
+     * being sent. The counter is updated without synchronization, and thus
+     * values read by threads other than the writer may be stale, and are
+     * suitable only as an estimate.
+     */
+    uint64_t bytes_written;
+
 };
 
 /**
@@ -0,0 +1,333 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "config.h"
+
+#include "guacamole/audio.h"
+#include "guacamole/client.h"
+#include "guacamole/protocol.h"
+#include "guacamole/socket.h"
+#include "guacamole/stream.h"
+#include "guacamole/user.h"
+#include "ogg_encoder.h"
+
+#include <ogg/ogg.h>
+#include <vorbis/vorbisenc.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Sends the given Ogg page as blobs over the given audio stream.
+ *
+ * @param socket
+ *     The socket over which the page should be sent.
+ *
+ * @param audio
+ *     The audio stream associated with the page.
+ *
+ * @param page
+ *     The Ogg page to send.
+ */
+static void ogg_encoder_send_page(guac_socket* socket,
+        guac_audio_stream* audio, ogg_page* page) {
+
+    guac_protocol_send_blobs(socket, audio->stream,
+            page->header, page->header_len);
+
+    guac_protocol_send_blobs(socket, audio->stream,
+            page->body, page->body_len);
+
+}
+
+/**
+ * Encodes as many Vorbis packets as possible from the PCM submitted to the
+ * encoder, sending each Ogg page that is completed as a result.
+ *
+ * @param audio
+ *     The audio stream being encoded.
+ */
+static void ogg_encoder_encode(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    ogg_packet packet;
+    ogg_page page;
+
+    /* Encode all complete blocks */
+    while (vorbis_analysis_blockout(&(state->vorbis_state),
+                &(state->vorbis_block)) == 1) {
+
+        vorbis_analysis(&(state->vorbis_block), NULL);
+        vorbis_bitrate_addblock(&(state->vorbis_block));
+
+        /* Add each resulting packet to the Ogg stream */
+        while (vorbis_bitrate_flushpacket(&(state->vorbis_state), &packet))
+            ogg_stream_packetin(&(state->ogg_state), &packet);
+
+    }
+
+    /* Send each completed page */
+    while (ogg_stream_pageout(&(state->ogg_state), &page) != 0)
+        ogg_encoder_send_page(audio->client->socket, audio, &page);
+
+}
+
+/**
+ * Sends the "audio" instruction associating the given audio stream with Ogg
+ * Vorbis, followed by the stream headers.
+ *
+ * @param audio
+ *     The audio stream being encoded.
+ *
+ * @param socket
+ *     The socket over which the instruction and headers should be sent.
+ */
+static void ogg_encoder_send_audio(guac_audio_stream* audio,
+        guac_socket* socket) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Associate stream */
+    guac_protocol_send_audio(socket, audio->stream, ogg_encoder->mimetype);
+
+    /* Send stream headers, which must precede all other data */
+    guac_protocol_send_blobs(socket, audio->stream,
+            state->headers, state->headers_length);
+
+}
+
+int ogg_encoder_supports(int rate, int channels, int bps) {
+
+    /* Only 8-bit and 16-bit PCM are converted */
+    if (bps != 8 && bps != 16)
+        return 0;
+
+    /* Test whether Vorbis can be configured for the given PCM */
+    vorbis_info info;
+    vorbis_info_init(&info);
+    int result = vorbis_encode_init_vbr(&info, channels, rate,
+            GUAC_OGG_ENCODER_QUALITY);
+    vorbis_info_clear(&info);
+
+    return result == 0;
+
+}
+
+static void ogg_encoder_begin_handler(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state;
+
+    ogg_packet header;
+    ogg_packet header_comment;
+    ogg_packet header_codebooks;
+    ogg_page page;
+
+    /* Do not encode if PCM format is not supported */
+    audio->data = NULL;
+    if (!ogg_encoder_supports(audio->rate, audio->channels, audio->bps)) {
+        guac_client_log(audio->client, GUAC_LOG_WARNING, "Audio having "
+                "%i channel(s) of %i-bit samples at %i Hz cannot be encoded "
+                "as Ogg Vorbis.", audio->channels, audio->bps, audio->rate);
+        return;
+    }
+
+    /* Allocate and init encoder state */
+    audio->data = state = malloc(sizeof(ogg_encoder_state));
+    vorbis_info_init(&(state->info));
+    vorbis_encode_init_vbr(&(state->info), audio->channels, audio->rate,
+            GUAC_OGG_ENCODER_QUALITY);
+
+    vorbis_analysis_init(&(state->vorbis_state), &(state->info));
+    vorbis_block_init(&(state->vorbis_state), &(state->vorbis_block));
+
+    vorbis_comment_init(&(state->comment));
+    vorbis_comment_add_tag(&(state->comment), "ENCODER", "libguac");
+
+    /* Each stream has a unique index, and thus a unique serial number */
+    ogg_stream_init(&(state->ogg_state), audio->stream->index);
+
+    /* Produce stream headers */
+    vorbis_analysis_headerout(&(state->vorbis_state), &(state->comment),
+            &header, &header_comment, &header_codebooks);
+
+    ogg_stream_packetin(&(state->ogg_state), &header);
+    ogg_stream_packetin(&(state->ogg_state), &header_comment);
+    ogg_stream_packetin(&(state->ogg_state), &header_codebooks);
+
+    /* Store header pages for users that join later */
+    state->headers = NULL;
+    state->headers_length = 0;
+    while (ogg_stream_flush(&(state->ogg_state), &page) != 0) {
+
+        int length = page.header_len + page.body_len;
+        state->headers = realloc(state->headers,
+                state->headers_length + length);
+
+        memcpy(state->headers + state->headers_length,
+                page.header, page.header_len);
+        memcpy(state->headers + state->headers_length + page.header_len,
+                page.body, page.body_len);
+
+        state->headers_length += length;
+
+    }
+
+    /* Broadcast existence of stream */
+    ogg_encoder_send_audio(audio, audio->client->socket);
+
+}
+
+static void ogg_encoder_join_handler(guac_audio_stream* audio,
+        guac_user* user) {
+
+    /* Ignore if audio is not being encoded */
+    if (audio->data == NULL)
+        return;
+
+    /* Notify user of existence of stream */
+    ogg_encoder_send_audio(audio, user->socket);
+
+}
+
+static void ogg_encoder_end_handler(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Stream was never begun if audio was not being encoded */
+    if (state == NULL)
+        return;
+
+    ogg_page page;
+
+    /* Encode any remaining PCM, ending the stream */
+    vorbis_analysis_wrote(&(state->vorbis_state), 0);
+    ogg_encoder_encode(audio);
+
+    while (ogg_stream_flush(&(state->ogg_state), &page) != 0)
+        ogg_encoder_send_page(audio->client->socket, audio, &page);
+
+    /* Send end of stream */
+    guac_protocol_send_end(audio->client->socket, audio->stream);
+
+    /* Free state information */
+    ogg_stream_clear(&(state->ogg_state));
+    vorbis_block_clear(&(state->vorbis_block));
+    vorbis_dsp_clear(&(state->vorbis_state));
+    vorbis_comment_clear(&(state->comment));
+    vorbis_info_clear(&(state->info));
+
+    free(state->headers);
+    free(state);
+
+}
+
+void ogg_encoder_convert(float** buffer, const unsigned char* pcm_data,
+        int frames, int channels, int bps) {
+
+    int i, channel;
+
+    for (i = 0; i < frames; i++) {
+        for (channel = 0; channel < channels; channel++) {
+
+            /* 16-bit samples are signed and little-endian */
+            if (bps == 16) {
+                int16_t sample = (int16_t) (pcm_data[0] | (pcm_data[1] << 8));
+                buffer[channel][i] = sample / 32768.0f;
+                pcm_data += 2;
+            }
+
+            /* 8-bit samples are unsigned, centered on 128 */
+            else {
+                buffer[channel][i] = (pcm_data[0] - 128) / 128.0f;
+                pcm_data++;
+            }
+
+        }
+    }
+
+}
+
+static void ogg_encoder_write_handler(guac_audio_stream* audio,
+        const unsigned char* pcm_data, int length) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Drop data if audio is not being encoded */
+    if (state == NULL)
+        return;
+
+    /* Only complete frames can be encoded */
+    int frame_size = audio->channels * audio->bps / 8;
+    int frames = length / frame_size;
+
+    while (frames > 0) {
+
+        int block_frames = frames;
+        if (block_frames > GUAC_OGG_ENCODER_BLOCK_SIZE)
+            block_frames = GUAC_OGG_ENCODER_BLOCK_SIZE;
+
+        float** buffer = vorbis_analysis_buffer(&(state->vorbis_state),
+                block_frames);
+
+        ogg_encoder_convert(buffer, pcm_data, block_frames,
+                audio->channels, audio->bps);
+
+        pcm_data += block_frames * frame_size;
+
+        vorbis_analysis_wrote(&(state->vorbis_state), block_frames);
+        ogg_encoder_encode(audio);
+
+        frames -= block_frames;
+
+    }
+
+}
+
+static void ogg_encoder_flush_handler(guac_audio_stream* audio) {
+
+    ogg_encoder_state* state = (ogg_encoder_state*) audio->data;
+
+    /* Nothing to flush if audio is not being encoded */
+    if (state == NULL)
+        return;
+
+    ogg_page page;
+
+    /* End the current page, sending all encoded data */
+    while (ogg_stream_flush(&(state->ogg_state), &page) != 0)
+        ogg_encoder_send_page(audio->client->socket, audio, &page);
+
+}
+
+/* Ogg Vorbis encoder handlers */
+guac_audio_encoder _ogg_encoder = {
+    .mimetype      = "audio/ogg",
+    .begin_handler = ogg_encoder_begin_handler,
+    .write_handler = ogg_encoder_write_handler,
+    .flush_handler = ogg_encoder_flush_handler,
+    .join_handler  = ogg_encoder_join_handler,
+    .end_handler   = ogg_encoder_end_handler
+};
+
+/* Actual encoder definition */
+guac_audio_encoder* ogg_encoder = &_ogg_encoder;
+
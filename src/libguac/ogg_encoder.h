@@ -0,0 +1,141 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef GUAC_OGG_ENCODER_H
+#define GUAC_OGG_ENCODER_H
+
+#include "config.h"
+
+#include "guacamole/audio.h"
+
+#include <ogg/ogg.h>
+#include <vorbis/vorbisenc.h>
+
+/**
+ * The quality of the Vorbis encoding, as accepted by vorbis_encode_init_vbr(),
+ * where -0.1 is the lowest quality and 1.0 is the highest. A quality of 0.3
+ * results in roughly 112 kbps for 44.1 kHz stereo audio, less than a tenth of
+ * the equivalent raw PCM.
+ */
+#define GUAC_OGG_ENCODER_QUALITY 0.3
+
+/**
+ * The maximum number of frames (samples per channel) passed to the Vorbis
+ * encoder at once. PCM data is converted for the encoder in blocks of this
+ * size.
+ */
+#define GUAC_OGG_ENCODER_BLOCK_SIZE 1024
+
+/**
+ * The current state of the Ogg Vorbis encoder. Encoded data is sent as soon
+ * as each Vorbis packet is produced, with each flush of the audio stream
+ * ending the current Ogg page, such that latency is limited only by the
+ * Vorbis block size rather than by any additional buffering.
+ */
+typedef struct ogg_encoder_state {
+
+    /**
+     * Ogg state, used to produce the pages of the Ogg stream.
+     */
+    ogg_stream_state ogg_state;
+
+    /**
+     * Vorbis encoding configuration.
+     */
+    vorbis_info info;
+
+    /**
+     * Comments included within the Vorbis stream headers.
+     */
+    vorbis_comment comment;
+
+    /**
+     * Vorbis encoder state.
+     */
+    vorbis_dsp_state vorbis_state;
+
+    /**
+     * Vorbis block currently being encoded.
+     */
+    vorbis_block vorbis_block;
+
+    /**
+     * The Ogg pages containing the Vorbis stream headers, which must be sent
+     * to any user joining the stream before any further data.
+     */
+    unsigned char* headers;
+
+    /**
+     * The number of bytes within headers.
+     */
+    int headers_length;
+
+} ogg_encoder_state;
+
+/**
+ * Returns whether PCM having the given properties can be encoded by
+ * ogg_encoder. Streams which cannot be encoded should use raw PCM instead.
+ *
+ * @param rate
+ *     The sample rate of the PCM, in samples per second.
+ *
+ * @param channels
+ *     The number of channels within the PCM.
+ *
+ * @param bps
+ *     The number of bits per sample within the PCM.
+ *
+ * @return
+ *     Non-zero if the PCM can be encoded, zero otherwise.
+ */
+int ogg_encoder_supports(int rate, int channels, int bps);
+
+/**
+ * Converts interleaved PCM to the separate channels of floating point samples
+ * accepted by the Vorbis encoder, with each sample ranging from -1.0 to 1.0.
+ * As with WAV, 16-bit samples are signed and little-endian, while 8-bit
+ * samples are unsigned, with 128 representing silence.
+ *
+ * @param buffer
+ *     An array of channels buffers, each having space for at least the given
+ *     number of frames, as returned by vorbis_analysis_buffer().
+ *
+ * @param pcm_data
+ *     The interleaved PCM data to convert.
+ *
+ * @param frames
+ *     The number of frames (samples per channel) to convert.
+ *
+ * @param channels
+ *     The number of channels within the PCM.
+ *
+ * @param bps
+ *     The number of bits per sample within the PCM. This must be 8 or 16.
+ */
+void ogg_encoder_convert(float** buffer, const unsigned char* pcm_data,
+        int frames, int channels, int bps);
+
+/**
+ * Audio encoder which encodes 8-bit or 16-bit PCM as Ogg Vorbis.
+ */
+extern guac_audio_encoder* ogg_encoder;
+
+#endif
+
@@ -83,6 +83,20 @@ static void raw_encoder_end_handler(guac_audio_stream* audio) {
 
 }
 
+static void raw_encoder_flush_handler(guac_audio_stream* audio) {
+
+    raw_encoder_state* state = (raw_encoder_state*) audio->data;
+    guac_socket* socket = audio->client->socket;
+    guac_stream* stream = audio->stream;
+
+    /* Flush all data in buffer as blobs */
+    guac_protocol_send_blobs(socket, stream, state->buffer, state->written);
+
+    /* All data has been flushed */
+    state->written = 0;
+
+}
+
 static void raw_encoder_write_handler(guac_audio_stream* audio, 
         const unsigned char* pcm_data, int length) {
 
@@ -95,7 +109,7 @@ static void raw_encoder_write_handler(guac_audio_stream* audio,
 
         /* If no space remains, flush and retry */
         if (chunk_size == 0) {
-            guac_audio_stream_flush(audio);
+            raw_encoder_flush_handler(audio);
             continue;
         }
 
@@ -115,20 +129,6 @@ static void raw_encoder_write_handler(guac_audio_stream* audio,
 
 }
 
-static void raw_encoder_flush_handler(guac_audio_stream* audio) {
-
-    raw_encoder_state* state = (raw_encoder_state*) audio->data;
-    guac_socket* socket = audio->client->socket;
-    guac_stream* stream = audio->stream;
-
-    /* Flush all data in buffer as blobs */
-    guac_protocol_send_blobs(socket, stream, state->buffer, state->written);
-
-    /* All data has been flushed */
-    state->written = 0;
-
-}
-
 /* 8-bit raw encoder handlers */
 guac_audio_encoder _raw8_encoder = {
     .mimetype      = "audio/L8",
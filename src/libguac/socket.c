@@ -110,6 +110,7 @@ ssize_t guac_socket_write(guac_socket* socket,
         /* Advance buffer as data written */
         buffer += written;
         count  -= written;
+        socket->bytes_written += written;
 
     }
 
@@ -154,6 +155,7 @@ guac_socket* guac_socket_alloc() {
     socket->data = NULL;
     socket->state = GUAC_SOCKET_OPEN;
     socket->last_write_timestamp = guac_timestamp_current();
+    socket->bytes_written = 0;
 
     /* No keep alive ping by default */
     socket->__keep_alive_enabled = 0;
@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "ogg_encoder.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that 8-bit PCM is converted as unsigned samples, with
+ * 128 representing silence.
+ */
+void test_audio__ogg_convert_8bit() {
+
+    float left[3];
+    float right[3];
+    float* buffer[] = { left, right };
+
+    /* Three stereo frames: silence, minimum, and maximum */
+    const unsigned char pcm[] = {
+        128, 128,
+          0,  64,
+        255, 192
+    };
+
+    ogg_encoder_convert(buffer, pcm, 3, 2, 8);
+
+    CU_ASSERT_DOUBLE_EQUAL(left[0],  0.0,  0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(right[0], 0.0,  0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(left[1], -1.0,  0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(right[1], -0.5, 0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(left[2],  127 / 128.0, 0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(right[2], 0.5,  0.0001);
+
+}
+
+/**
+ * Test which verifies that 16-bit PCM is converted as signed, little-endian
+ * samples.
+ */
+void test_audio__ogg_convert_16bit() {
+
+    float left[3];
+    float* buffer[] = { left };
+
+    /* Three mono frames: silence, minimum, and half of maximum */
+    const unsigned char pcm[] = {
+        0x00, 0x00,
+        0x00, 0x80,
+        0x00, 0x40
+    };
+
+    ogg_encoder_convert(buffer, pcm, 3, 1, 16);
+
+    CU_ASSERT_DOUBLE_EQUAL(left[0],  0.0, 0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(left[1], -1.0, 0.0001);
+    CU_ASSERT_DOUBLE_EQUAL(left[2],  0.5, 0.0001);
+
+}
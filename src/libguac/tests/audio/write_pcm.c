@@ -0,0 +1,261 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <CUnit/CUnit.h>
+#include <guacamole/audio.h>
+#include <guacamole/client.h>
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Lock which guards all data recorded by test_encoder, as the handlers of
+ * test_encoder may be invoked by the automatic flush thread of the audio
+ * stream.
+ */
+static pthread_mutex_t received_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The total number of bytes of PCM data received by test_encoder.
+ */
+static int received_length;
+
+/**
+ * The number of times the write handler of test_encoder has been invoked.
+ */
+static int received_packets;
+
+/**
+ * The size of the smallest block of PCM data received by test_encoder, in
+ * bytes.
+ */
+static int smallest_packet;
+
+/**
+ * The number of times the flush handler of test_encoder has been invoked.
+ */
+static int received_flushes;
+
+/**
+ * The first sample received by test_encoder, as signed 16-bit values for
+ * each channel.
+ */
+static int16_t first_sample[GUAC_AUDIO_CHANNELS];
+
+/**
+ * Write handler for test_encoder which records the PCM data received.
+ */
+static void test_encoder_write_handler(guac_audio_stream* audio,
+        const unsigned char* pcm_data, int length) {
+
+    int i;
+
+    pthread_mutex_lock(&received_lock);
+
+    /* Encoders must always receive the normalized format */
+    CU_ASSERT_EQUAL(audio->rate, GUAC_AUDIO_RATE);
+    CU_ASSERT_EQUAL(audio->channels, GUAC_AUDIO_CHANNELS);
+    CU_ASSERT_EQUAL(audio->bps, GUAC_AUDIO_BPS);
+
+    /* Only complete samples may be received */
+    CU_ASSERT_EQUAL(length % (GUAC_AUDIO_CHANNELS * GUAC_AUDIO_BPS / 8), 0);
+
+    if (received_length == 0) {
+        for (i = 0; i < GUAC_AUDIO_CHANNELS; i++)
+            first_sample[i] = (int16_t) (pcm_data[i*2]
+                                       | (pcm_data[i*2 + 1] << 8));
+    }
+
+    if (received_packets == 0 || length < smallest_packet)
+        smallest_packet = length;
+
+    received_length += length;
+    received_packets++;
+
+    pthread_mutex_unlock(&received_lock);
+
+}
+
+/**
+ * Flush handler for test_encoder which records the number of flushes.
+ */
+static void test_encoder_flush_handler(guac_audio_stream* audio) {
+    pthread_mutex_lock(&received_lock);
+    received_flushes++;
+    pthread_mutex_unlock(&received_lock);
+}
+
+/**
+ * Audio encoder which does not send anything, instead recording the PCM data
+ * it receives.
+ */
+static guac_audio_encoder test_encoder = {
+    .mimetype      = "audio/x-test",
+    .write_handler = test_encoder_write_handler,
+    .flush_handler = test_encoder_flush_handler
+};
+
+/**
+ * Resets all data recorded by test_encoder.
+ */
+static void test_encoder_reset() {
+    pthread_mutex_lock(&received_lock);
+    received_length = 0;
+    received_packets = 0;
+    received_flushes = 0;
+    smallest_packet = 0;
+    memset(first_sample, 0, sizeof(first_sample));
+    pthread_mutex_unlock(&received_lock);
+}
+
+/**
+ * Test which verifies that PCM data written to an audio stream is converted
+ * to the normalized format, resampling and duplicating channels as necessary.
+ */
+void test_audio__write_pcm_convert() {
+
+    int i;
+    unsigned char pcm[441];
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    test_encoder_reset();
+
+    /* Mono, 8-bit PCM at half the normalized rate */
+    guac_audio_stream* audio = guac_audio_stream_alloc(client,
+            &test_encoder, GUAC_AUDIO_RATE / 2, 1, 8);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(audio);
+
+    /* Write one second of constant PCM, 20ms at a time (8-bit samples are
+     * unsigned, with 128 being silence) */
+    memset(pcm, 192, sizeof(pcm));
+    for (i = 0; i < 50; i++)
+        guac_audio_stream_write_pcm(audio, pcm, sizeof(pcm));
+
+    guac_audio_stream_flush(audio);
+
+    /* Roughly one second of stereo, 16-bit audio should have been received,
+     * less the final sample (awaiting the next for interpolation) */
+    int frames = received_length / (GUAC_AUDIO_CHANNELS * GUAC_AUDIO_BPS / 8);
+    CU_ASSERT(frames <= GUAC_AUDIO_RATE);
+    CU_ASSERT(frames >= GUAC_AUDIO_RATE - 2);
+
+    /* 8-bit samples should have been scaled to 16-bit on both channels */
+    CU_ASSERT_EQUAL(first_sample[0], 64 * 256);
+    CU_ASSERT_EQUAL(first_sample[1], 64 * 256);
+
+    guac_audio_stream_free(audio);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that PCM data written to an audio stream in small
+ * blocks is provided to the encoder in larger packets.
+ */
+void test_audio__write_pcm_packets() {
+
+    /* 10ms of stereo, 16-bit PCM at the normalized rate */
+    int i;
+    unsigned char pcm[GUAC_AUDIO_RATE / 100 * 4] = { 0 };
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    test_encoder_reset();
+
+    guac_audio_stream* audio = guac_audio_stream_alloc(client,
+            &test_encoder, GUAC_AUDIO_RATE, 2, 16);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(audio);
+
+    /* Write half a second of audio without flushing */
+    for (i = 0; i < 50; i++)
+        guac_audio_stream_write_pcm(audio, pcm, sizeof(pcm));
+
+    /* Only complete packets should have been sent, each containing at least
+     * the minimum duration (audio is not flushed automatically until PCM
+     * has stopped arriving for at least a packet's duration) */
+    pthread_mutex_lock(&received_lock);
+    CU_ASSERT(received_packets > 0);
+    CU_ASSERT(received_packets <= 500 / GUAC_AUDIO_MIN_PACKET_DURATION);
+    CU_ASSERT(smallest_packet >= GUAC_AUDIO_RATE
+            * GUAC_AUDIO_MIN_PACKET_DURATION / 1000 * 4);
+    pthread_mutex_unlock(&received_lock);
+
+    /* Flushing should send everything else */
+    guac_audio_stream_flush(audio);
+    CU_ASSERT(received_length >= (int) sizeof(pcm) * 50 - 4);
+
+    guac_audio_stream_free(audio);
+    guac_client_free(client);
+
+}
+
+
+/**
+ * Test which verifies that a single write of PCM data shorter than a packet
+ * is sent automatically, without any explicit flush, once no further PCM
+ * data arrives.
+ */
+void test_audio__write_pcm_short() {
+
+    int i;
+
+    /* 10ms of stereo, 16-bit PCM at the normalized rate */
+    unsigned char pcm[GUAC_AUDIO_RATE / 100 * 4] = { 0 };
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    test_encoder_reset();
+
+    guac_audio_stream* audio = guac_audio_stream_alloc(client,
+            &test_encoder, GUAC_AUDIO_RATE, 2, 16);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(audio);
+
+    guac_audio_stream_write_pcm(audio, pcm, sizeof(pcm));
+
+    /* Wait up to one second for the written audio to be sent */
+    int received = 0;
+    for (i = 0; i < 100 && !received; i++) {
+
+        guac_timestamp_msleep(10);
+
+        pthread_mutex_lock(&received_lock);
+        received = received_length > 0 && received_flushes > 0;
+        pthread_mutex_unlock(&received_lock);
+
+    }
+
+    /* Audio should have been encoded and flushed without explicitly flushing
+     * or freeing the stream */
+    CU_ASSERT(received);
+
+    pthread_mutex_lock(&received_lock);
+    CU_ASSERT(received_length >= (int) sizeof(pcm) - 4);
+    pthread_mutex_unlock(&received_lock);
+
+    guac_audio_stream_free(audio);
+    guac_client_free(client);
+
+}
@@ -26,6 +26,7 @@
 #include <guacamole/socket.h>
 #include <guacamole/user.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -52,6 +53,24 @@ int guac_kubernetes_argv_callback(guac_user* user, const char* mimetype,
                     kubernetes_client->settings->resolution);
     }
 
+    /* Search scrollback, leaving terminal dimensions untouched */
+    else if (strcmp(name, GUAC_KUBERNETES_ARGV_SEARCH) == 0) {
+
+        /* Reply with the row of the match, or with an empty value if there
+         * are no further matches */
+        char result[64] = "";
+        int row;
+        if (!guac_terminal_search(terminal, value, &row))
+            snprintf(result, sizeof(result), "%i", row);
+
+        guac_user_stream_argv(user, user->socket, "text/plain",
+                GUAC_KUBERNETES_ARGV_SEARCH, result);
+        guac_socket_flush(user->socket);
+
+        return 0;
+
+    }
+
     /* Update Kubernetes terminal size */
     guac_kubernetes_resize(client,
             guac_terminal_get_rows(terminal),
@@ -250,6 +250,7 @@ void* guac_kubernetes_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->frame_policy = settings->frame_policy;
 
     /* Create terminal */
     kubernetes_client->term = guac_terminal_create(client, options);
@@ -273,7 +274,8 @@ void* guac_kubernetes_client_thread(void* data) {
         guac_terminal_create_typescript(kubernetes_client->term,
                 settings->typescript_path,
                 settings->typescript_name,
-                settings->create_typescript_path);
+                settings->create_typescript_path,
+                settings->compress_typescript);
     }
 
     /* Init libwebsockets context creation parameters */
@@ -24,6 +24,7 @@
 #include <guacamole/user.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 /* Client plugin arguments */
 const char* GUAC_KUBERNETES_CLIENT_ARGS[] = {
@@ -44,6 +45,7 @@ const char* GUAC_KUBERNETES_CLIENT_ARGS[] = {
     "typescript-path",
     "typescript-name",
     "create-typescript-path",
+    "compress-typescript",
     "recording-path",
     "recording-name",
     "recording-exclude-output",
@@ -53,6 +55,7 @@ const char* GUAC_KUBERNETES_CLIENT_ARGS[] = {
     "read-only",
     "backspace",
     "scrollback",
+    "frame-policy",
     "disable-copy",
     "disable-paste",
     NULL
@@ -165,6 +168,12 @@ enum KUBERNETES_ARGS_IDX {
      */
     IDX_CREATE_TYPESCRIPT_PATH,
 
+    /**
+     * Whether the typescript data file should be compressed with gzip. The
+     * timing file is never compressed.
+     */
+    IDX_COMPRESS_TYPESCRIPT,
+
     /**
      * The full absolute path to the directory in which screen recordings
      * should be written.
@@ -226,6 +235,14 @@ enum KUBERNETES_ARGS_IDX {
      */
     IDX_SCROLLBACK,
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     * This may be either "adaptive" (the default), where frames are as short
+     * as possible for interactive output and grow longer under sustained
+     * output, or "fixed", where frame duration does not vary.
+     */
+    IDX_FRAME_POLICY,
+
     /**
      * Whether outbound clipboard access should be blocked. If set to "true",
      * it will not be possible to copy data from the terminal to the client
@@ -323,6 +340,20 @@ guac_kubernetes_settings* guac_kubernetes_parse_args(guac_user* user,
         guac_user_parse_args_int(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
                 IDX_SCROLLBACK, GUAC_TERMINAL_DEFAULT_MAX_SCROLLBACK);
 
+    /* Use fixed frame durations if requested */
+    if (strcmp(argv[IDX_FRAME_POLICY], "fixed") == 0)
+        settings->frame_policy = GUAC_TERMINAL_FRAME_POLICY_FIXED;
+
+    /* Use adaptive frame durations by default */
+    else {
+        if (argv[IDX_FRAME_POLICY][0] != '\0'
+                && strcmp(argv[IDX_FRAME_POLICY], "adaptive") != 0)
+            guac_user_log(user, GUAC_LOG_WARNING, "Invalid frame policy: "
+                    "\"%s\". Using adaptive frame policy.",
+                    argv[IDX_FRAME_POLICY]);
+        settings->frame_policy = GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE;
+    }
+
     /* Read font name */
     settings->font_name =
         guac_user_parse_args_string(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
@@ -358,6 +389,11 @@ guac_kubernetes_settings* guac_kubernetes_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
                 IDX_CREATE_TYPESCRIPT_PATH, false);
 
+    /* Parse typescript compression flag */
+    settings->compress_typescript =
+        guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
+                IDX_COMPRESS_TYPESCRIPT, false);
+
     /* Read recording path */
     settings->recording_path =
         guac_user_parse_args_string(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
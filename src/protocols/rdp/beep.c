@@ -93,11 +93,11 @@ static void guac_rdp_beep_fill_triangle_wave(unsigned char* buffer,
 static void guac_rdp_beep_write_pcm(guac_audio_stream* audio,
         int frequency, int duration) {
 
-    int buffer_size = audio->rate * duration / 1000;
+    int buffer_size = audio->pcm_rate * duration / 1000;
     unsigned char* buffer = malloc(buffer_size);
 
     /* Beep for given frequency/duration using a simple triangle wave */
-    guac_rdp_beep_fill_triangle_wave(buffer, frequency, audio->rate, buffer_size);
+    guac_rdp_beep_fill_triangle_wave(buffer, frequency, audio->pcm_rate, buffer_size);
     guac_audio_stream_write_pcm(audio, buffer, buffer_size);
 
     free(buffer);
@@ -26,16 +26,166 @@
 #include <cairo/cairo.h>
 #include <freerdp/freerdp.h>
 #include <guacamole/client.h>
+#include <guacamole/timestamp.h>
 #include <winpr/crt.h>
 #include <winpr/wtypes.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 
+guac_rdp_bitmap_cache* guac_rdp_bitmap_cache_alloc(guac_client* client,
+        int threshold, int budget) {
+
+    guac_rdp_bitmap_cache* cache = calloc(1, sizeof(guac_rdp_bitmap_cache));
+    cache->client = client;
+    cache->threshold = threshold;
+    cache->budget = budget;
+    cache->last_report = guac_timestamp_current();
+
+    return cache;
+
+}
+
+/**
+ * Logs the current statistics of the given bitmap cache.
+ *
+ * @param cache
+ *     The bitmap cache whose statistics should be logged.
+ */
+static void guac_rdp_bitmap_cache_log_stats(guac_rdp_bitmap_cache* cache) {
+    guac_client_log(cache->client, GUAC_LOG_DEBUG, "Bitmap cache: %i hits, "
+            "%i misses, %i evictions, %i of %i bytes in use.", cache->hits,
+            cache->misses, cache->evictions, cache->size, cache->budget);
+}
+
+void guac_rdp_bitmap_cache_free(guac_rdp_bitmap_cache* cache) {
+    guac_rdp_bitmap_cache_log_stats(cache);
+    free(cache);
+}
+
+/**
+ * Returns the number of bytes occupied by the cached image data of the given
+ * bitmap.
+ *
+ * @param bitmap
+ *     The bitmap to determine the size of.
+ *
+ * @return
+ *     The number of bytes occupied by the cached image data of the bitmap.
+ */
+static int guac_rdp_bitmap_size(guac_rdp_bitmap* bitmap) {
+    return 4 * bitmap->bitmap.width * bitmap->bitmap.height;
+}
+
+/**
+ * Removes the given cached, unpinned bitmap from the least-recently-used list
+ * of the given bitmap cache.
+ *
+ * @param cache
+ *     The bitmap cache containing the bitmap.
+ *
+ * @param bitmap
+ *     The bitmap to remove.
+ */
+static void guac_rdp_bitmap_cache_unlink(guac_rdp_bitmap_cache* cache,
+        guac_rdp_bitmap* bitmap) {
+
+    if (bitmap->prev != NULL)
+        bitmap->prev->next = bitmap->next;
+    else
+        cache->head = bitmap->next;
+
+    if (bitmap->next != NULL)
+        bitmap->next->prev = bitmap->prev;
+    else
+        cache->tail = bitmap->prev;
+
+    bitmap->prev = NULL;
+    bitmap->next = NULL;
+
+    cache->size -= guac_rdp_bitmap_size(bitmap);
+
+}
+
+/**
+ * Adds the given cached, unpinned bitmap to the least-recently-used list of
+ * the given bitmap cache as the most recently used bitmap.
+ *
+ * @param cache
+ *     The bitmap cache that should contain the bitmap.
+ *
+ * @param bitmap
+ *     The bitmap to add.
+ */
+static void guac_rdp_bitmap_cache_link(guac_rdp_bitmap_cache* cache,
+        guac_rdp_bitmap* bitmap) {
+
+    bitmap->prev = NULL;
+    bitmap->next = cache->head;
+
+    if (cache->head != NULL)
+        cache->head->prev = bitmap;
+    else
+        cache->tail = bitmap;
+
+    cache->head = bitmap;
+    cache->size += guac_rdp_bitmap_size(bitmap);
+
+}
+
+/**
+ * Evicts least recently used bitmaps from the given bitmap cache, freeing
+ * their buffers, until the given number of additional bytes may be cached
+ * without exceeding the budget of the cache, or until no unpinned bitmaps
+ * remain.
+ *
+ * @param cache
+ *     The bitmap cache to evict bitmaps from.
+ *
+ * @param display
+ *     The display from which the buffers of cached bitmaps were allocated.
+ *
+ * @param needed
+ *     The number of bytes about to be added to the cache.
+ */
+static void guac_rdp_bitmap_cache_evict(guac_rdp_bitmap_cache* cache,
+        guac_common_display* display, int needed) {
+
+    while (cache->tail != NULL && cache->size + needed > cache->budget) {
+
+        guac_rdp_bitmap* bitmap = cache->tail;
+        guac_rdp_bitmap_cache_unlink(cache, bitmap);
+
+        /* The bitmap may be cached again later (its image data is retained
+         * by FreeRDP) */
+        guac_common_display_free_buffer(display, bitmap->layer);
+        bitmap->layer = NULL;
+
+        cache->evictions++;
+
+    }
+
+}
+
 void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
     guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_bitmap_cache* cache = rdp_client->bitmap_cache;
+    guac_rdp_bitmap* guac_bitmap = (guac_rdp_bitmap*) bitmap;
+
+    /* Bitmaps larger than the entire cache are never tracked by the cache,
+     * as evicting every other bitmap still would not make room. Such bitmaps
+     * receive a buffer only because the caller requires one, and that buffer
+     * is retained like that of a pinned bitmap. */
+    if (!guac_bitmap->pinned
+            && guac_rdp_bitmap_size(guac_bitmap) > cache->budget)
+        guac_bitmap->pinned = 1;
+
+    /* Make room for new bitmap, if it is eligible for eviction */
+    if (!guac_bitmap->pinned)
+        guac_rdp_bitmap_cache_evict(cache, rdp_client->display,
+                guac_rdp_bitmap_size(guac_bitmap));
 
     /* Allocate buffer */
     guac_common_display_layer* buffer = guac_common_display_alloc_buffer(
@@ -58,17 +208,73 @@ void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
     }
 
     /* Store buffer reference in bitmap */
-    ((guac_rdp_bitmap*) bitmap)->layer = buffer;
+    guac_bitmap->layer = buffer;
+
+    if (!guac_bitmap->pinned)
+        guac_rdp_bitmap_cache_link(cache, guac_bitmap);
+
+}
+
+int guac_rdp_bitmap_use(rdpContext* context, rdpBitmap* bitmap) {
+
+    guac_client* client = ((rdp_freerdp_context*) context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_bitmap_cache* cache = rdp_client->bitmap_cache;
+    guac_rdp_bitmap* guac_bitmap = (guac_rdp_bitmap*) bitmap;
+
+    /* Bitmaps which are already cached can be drawn with a simple copy */
+    if (guac_bitmap->layer != NULL) {
+
+        cache->hits++;
+
+        /* Mark as most recently used */
+        if (!guac_bitmap->pinned) {
+            guac_rdp_bitmap_cache_unlink(cache, guac_bitmap);
+            guac_rdp_bitmap_cache_link(cache, guac_bitmap);
+        }
+
+    }
+
+    /* Otherwise, image data must be sent, but can be sent to a buffer for
+     * future use if the bitmap is drawn often enough and is not larger than
+     * the entire cache */
+    else {
+
+        cache->misses++;
+
+        if (guac_bitmap->used >= cache->threshold
+                && guac_rdp_bitmap_size(guac_bitmap) <= cache->budget)
+            guac_rdp_cache_bitmap(context, bitmap);
+
+    }
+
+    guac_bitmap->used++;
+
+    /* Log statistics periodically */
+    guac_timestamp now = guac_timestamp_current();
+    if (now - cache->last_report >= GUAC_RDP_BITMAP_CACHE_STATS_INTERVAL) {
+        guac_rdp_bitmap_cache_log_stats(cache);
+        cache->last_report = now;
+    }
+
+    return guac_bitmap->layer != NULL;
 
 }
 
 BOOL guac_rdp_bitmap_new(rdpContext* context, rdpBitmap* bitmap) {
 
+    guac_rdp_bitmap* guac_bitmap = (guac_rdp_bitmap*) bitmap;
+
     /* No corresponding surface yet - caching is deferred. */
-    ((guac_rdp_bitmap*) bitmap)->layer = NULL;
+    guac_bitmap->layer = NULL;
 
     /* Start at zero usage */
-    ((guac_rdp_bitmap*) bitmap)->used = 0;
+    guac_bitmap->used = 0;
+
+    /* Not yet cached, and thus not yet in the cache's LRU list */
+    guac_bitmap->pinned = 0;
+    guac_bitmap->next = NULL;
+    guac_bitmap->prev = NULL;
 
     return TRUE;
 
@@ -79,18 +285,15 @@ BOOL guac_rdp_bitmap_paint(rdpContext* context, rdpBitmap* bitmap) {
     guac_client* client = ((rdp_freerdp_context*) context)->client;
     guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
 
-    guac_common_display_layer* buffer = ((guac_rdp_bitmap*) bitmap)->layer;
-
     int width = bitmap->right - bitmap->left + 1;
     int height = bitmap->bottom - bitmap->top + 1;
 
-    /* If not cached, cache if necessary */
-    if (buffer == NULL && ((guac_rdp_bitmap*) bitmap)->used >= 1)
-        guac_rdp_cache_bitmap(context, bitmap);
-
-    /* If cached, retrieve from cache */
-    if (buffer != NULL)
-        guac_common_surface_copy(buffer->surface, 0, 0, width, height,
+    /* If cached (or cached now that it is being used again), retrieve from
+     * cache */
+    if (guac_rdp_bitmap_use(context, bitmap))
+        guac_common_surface_copy(
+                ((guac_rdp_bitmap*) bitmap)->layer->surface,
+                0, 0, width, height,
                 rdp_client->display->default_surface,
                 bitmap->left, bitmap->top);
 
@@ -111,9 +314,6 @@ BOOL guac_rdp_bitmap_paint(rdpContext* context, rdpBitmap* bitmap) {
 
     }
 
-    /* Increment usage counter */
-    ((guac_rdp_bitmap*) bitmap)->used++;
-
     return TRUE;
 
 }
@@ -122,12 +322,20 @@ void guac_rdp_bitmap_free(rdpContext* context, rdpBitmap* bitmap) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
     guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
-    guac_common_display_layer* buffer = ((guac_rdp_bitmap*) bitmap)->layer;
+    guac_rdp_bitmap* guac_bitmap = (guac_rdp_bitmap*) bitmap;
+    guac_common_display_layer* buffer = guac_bitmap->layer;
 
     /* If cached, free buffer */
-    if (buffer != NULL)
+    if (buffer != NULL) {
+
+        if (!guac_bitmap->pinned)
+            guac_rdp_bitmap_cache_unlink(rdp_client->bitmap_cache,
+                    guac_bitmap);
+
         guac_common_display_free_buffer(rdp_client->display, buffer);
 
+    }
+
 #ifndef FREERDP_BITMAP_FREE_FREES_BITMAP
     /* NOTE: Except in FreeRDP 2.0.0-rc0 and earlier, FreeRDP-allocated memory
      * for the rdpBitmap will NOT be automatically released after this free
@@ -155,12 +363,21 @@ BOOL guac_rdp_bitmap_setsurface(rdpContext* context, rdpBitmap* bitmap, BOOL pri
             return TRUE;
         }
 
+        guac_rdp_bitmap* guac_bitmap = (guac_rdp_bitmap*) bitmap;
+
         /* If not available as a surface, make available. */
-        if (((guac_rdp_bitmap*) bitmap)->layer == NULL)
+        if (guac_bitmap->layer == NULL)
             guac_rdp_cache_bitmap(context, bitmap);
 
-        rdp_client->current_surface =
-            ((guac_rdp_bitmap*) bitmap)->layer->surface;
+        /* The buffer will no longer match the original image data, and thus
+         * must not be evicted */
+        if (!guac_bitmap->pinned) {
+            guac_rdp_bitmap_cache_unlink(rdp_client->bitmap_cache,
+                    guac_bitmap);
+            guac_bitmap->pinned = 1;
+        }
+
+        rdp_client->current_surface = guac_bitmap->layer->surface;
 
     }
 
@@ -25,9 +25,17 @@
 
 #include <freerdp/freerdp.h>
 #include <freerdp/graphics.h>
+#include <guacamole/client.h>
 #include <guacamole/layer.h>
+#include <guacamole/timestamp.h>
 #include <winpr/wtypes.h>
 
+/**
+ * The minimum amount of time that must elapse between logged bitmap cache
+ * statistics, in milliseconds.
+ */
+#define GUAC_RDP_BITMAP_CACHE_STATS_INTERVAL 10000
+
 /**
  * Guacamole-specific rdpBitmap data.
  */
@@ -48,13 +56,152 @@ typedef struct guac_rdp_bitmap {
      */
     int used;
 
+    /**
+     * Non-zero if the cached image data of this bitmap may differ from the
+     * image data originally received for the bitmap (the bitmap has been
+     * used as an offscreen drawing surface), or if the bitmap is larger than
+     * the budget of the entire cache, and thus must never be evicted from the
+     * cache, zero otherwise.
+     */
+    int pinned;
+
+    /**
+     * The next most recently used cached bitmap, or NULL if this bitmap is
+     * not cached, is pinned, or is the least recently used bitmap.
+     */
+    struct guac_rdp_bitmap* next;
+
+    /**
+     * The next least recently used cached bitmap, or NULL if this bitmap is
+     * not cached, is pinned, or is the most recently used bitmap.
+     */
+    struct guac_rdp_bitmap* prev;
+
 } guac_rdp_bitmap;
 
+/**
+ * Per-connection policy and state governing which RDP bitmaps are cached in
+ * remote Guacamole buffers. Cached bitmaps which are not pinned are evicted
+ * in least-recently-used order whenever the total size of such bitmaps would
+ * exceed the configured budget.
+ */
+typedef struct guac_rdp_bitmap_cache {
+
+    /**
+     * The guac_client instance handling the relevant RDP connection.
+     */
+    guac_client* client;
+
+    /**
+     * The number of times a bitmap must have been drawn before it will be
+     * cached when drawn again.
+     */
+    int threshold;
+
+    /**
+     * The maximum total size of all cached, unpinned bitmaps, in bytes.
+     */
+    int budget;
+
+    /**
+     * The current total size of all cached, unpinned bitmaps, in bytes.
+     */
+    int size;
+
+    /**
+     * The most recently used cached, unpinned bitmap, or NULL if no such
+     * bitmaps exist.
+     */
+    guac_rdp_bitmap* head;
+
+    /**
+     * The least recently used cached, unpinned bitmap, or NULL if no such
+     * bitmaps exist.
+     */
+    guac_rdp_bitmap* tail;
+
+    /**
+     * The number of bitmap draws which could be satisfied from the cache
+     * since the connection began.
+     */
+    int hits;
+
+    /**
+     * The number of bitmap draws which required sending image data since the
+     * connection began.
+     */
+    int misses;
+
+    /**
+     * The number of bitmaps evicted from the cache to remain within budget
+     * since the connection began.
+     */
+    int evictions;
+
+    /**
+     * The time that cache statistics were last logged.
+     */
+    guac_timestamp last_report;
+
+} guac_rdp_bitmap_cache;
+
+/**
+ * Allocates a new bitmap cache which caches bitmaps according to the given
+ * policy.
+ *
+ * @param client
+ *     The guac_client instance handling the relevant RDP connection.
+ *
+ * @param threshold
+ *     The number of times a bitmap must have been drawn before it will be
+ *     cached when drawn again.
+ *
+ * @param budget
+ *     The maximum total size of all cached bitmaps which may be evicted, in
+ *     bytes.
+ *
+ * @return
+ *     A newly-allocated bitmap cache.
+ */
+guac_rdp_bitmap_cache* guac_rdp_bitmap_cache_alloc(guac_client* client,
+        int threshold, int budget);
+
+/**
+ * Frees the given bitmap cache, logging its final statistics. The buffers of
+ * any bitmaps still cached are not freed; all bitmaps must be freed with
+ * guac_rdp_bitmap_free() prior to invoking this function.
+ *
+ * @param cache
+ *     The bitmap cache to free.
+ */
+void guac_rdp_bitmap_cache_free(guac_rdp_bitmap_cache* cache);
+
+/**
+ * Records that the given bitmap is about to be drawn, caching the bitmap in a
+ * remote Guacamole buffer if required by the caching policy of the current
+ * connection. The bitmap becomes the most recently used cached bitmap.
+ *
+ * @param context
+ *     The rdpContext associated with the current RDP session.
+ *
+ * @param bitmap
+ *     The bitmap about to be drawn.
+ *
+ * @return
+ *     Non-zero if the bitmap is cached and may be drawn by copying from its
+ *     buffer, zero if its image data must be drawn directly.
+ */
+int guac_rdp_bitmap_use(rdpContext* context, rdpBitmap* bitmap);
+
 /**
  * Caches the given bitmap immediately, storing its data in a remote Guacamole
  * buffer. As RDP bitmaps are frequently created, used once, and immediately
  * destroyed, we defer actual remote-side caching of RDP bitmaps until they are
- * used at least once.
+ * used at least once. Other cached bitmaps are evicted as necessary to remain
+ * within the budget of the connection's guac_rdp_bitmap_cache, though the
+ * given bitmap is always cached, regardless of budget. A bitmap larger than
+ * the entire budget evicts nothing and is pinned rather than tracked by the
+ * cache.
  *
  * @param context
  *     The rdpContext associated with the current RDP session.
@@ -27,11 +27,11 @@
 #include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 
-#include <assert.h>
 #include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 /**
@@ -62,6 +62,34 @@ static int guac_rdp_audio_buffer_is_future(const struct timespec* ts) {
 
 }
 
+/**
+ * Returns the number of bytes of converted audio data within the ring buffer
+ * of the given audio buffer which have not yet been flushed. This function
+ * may be safely invoked by either the thread writing to the ring buffer or
+ * the thread flushing it.
+ *
+ * IMPORTANT: Either the guac_rdp_audio_buffer's lock or its ring_lock MUST
+ * already be held when invoking this function.
+ *
+ * @param audio_buffer
+ *     The guac_rdp_audio_buffer to test.
+ *
+ * @return
+ *     The number of bytes of audio data awaiting flush.
+ */
+static int guac_rdp_audio_buffer_used(guac_rdp_audio_buffer* audio_buffer) {
+
+    if (audio_buffer->ring == NULL)
+        return 0;
+
+    int read_offset = __atomic_load_n(&audio_buffer->read_offset, __ATOMIC_ACQUIRE);
+    int write_offset = __atomic_load_n(&audio_buffer->write_offset, __ATOMIC_ACQUIRE);
+
+    return (write_offset - read_offset + audio_buffer->ring_size)
+        % audio_buffer->ring_size;
+
+}
+
 /**
  * Returns whether the given audio buffer may be flushed. An audio buffer may
  * be flushed if the audio buffer is not currently being freed, at least one
@@ -82,7 +110,7 @@ static int guac_rdp_audio_buffer_is_future(const struct timespec* ts) {
 static int guac_rdp_audio_buffer_may_flush(guac_rdp_audio_buffer* audio_buffer) {
     return !audio_buffer->stopping
         && audio_buffer->packet_size > 0
-        && audio_buffer->bytes_written >= audio_buffer->packet_size
+        && guac_rdp_audio_buffer_used(audio_buffer) >= audio_buffer->packet_size
         && !guac_rdp_audio_buffer_is_future(&audio_buffer->next_flush);
 }
 
@@ -149,7 +177,8 @@ static void guac_rdp_audio_buffer_schedule_flush(guac_rdp_audio_buffer* audio_bu
     /* Amortize the additional latency from packet data buffered beyond the
      * desired packet size over each remaining packet such that we gradually
      * approach an effective additional latency of 0 */
-    int packets_remaining = audio_buffer->bytes_written / audio_buffer->packet_size;
+    int packets_remaining = guac_rdp_audio_buffer_used(audio_buffer)
+                          / audio_buffer->packet_size;
     if (packets_remaining > 1)
         delta_nsecs = delta_nsecs * (packets_remaining - 1) / packets_remaining;
 
@@ -187,7 +216,8 @@ static void guac_rdp_audio_buffer_wait(guac_rdp_audio_buffer* audio_buffer) {
         /* If sufficient data exists for a flush, wait until next possible
          * flush OR until some other state change occurs (such as the buffer
          * being closed) */
-        if (audio_buffer->bytes_written && audio_buffer->bytes_written >= audio_buffer->packet_size)
+        int used = guac_rdp_audio_buffer_used(audio_buffer);
+        if (used && used >= audio_buffer->packet_size)
             pthread_cond_timedwait(&audio_buffer->modified, &audio_buffer->lock,
                     &audio_buffer->next_flush);
 
@@ -235,24 +265,43 @@ static void* guac_rdp_audio_buffer_flush_thread(void* data) {
 
         }
 
+        int used = guac_rdp_audio_buffer_used(audio_buffer);
         guac_client_log(audio_buffer->client, GUAC_LOG_TRACE, "Current audio input latency: %i ms (%i bytes waiting in buffer)",
-                guac_rdp_audio_buffer_duration(&audio_buffer->out_format, audio_buffer->bytes_written),
-                audio_buffer->bytes_written);
+                guac_rdp_audio_buffer_duration(&audio_buffer->out_format, used),
+                used);
 
-        /* Only actually invoke if defined */
-        if (audio_buffer->flush_handler) {
+        if (audio_buffer->flush_handler)
             guac_rdp_audio_buffer_schedule_flush(audio_buffer);
-            audio_buffer->flush_handler(audio_buffer,
-                    audio_buffer->packet_size);
-        }
-
-        /* Shift buffer back by one packet */
-        audio_buffer->bytes_written -= audio_buffer->packet_size;
-        memmove(audio_buffer->packet, audio_buffer->packet + audio_buffer->packet_size, audio_buffer->bytes_written);
 
-        pthread_cond_broadcast(&(audio_buffer->modified));
+        /* Hold the ring buffer in place while flushing, but without blocking
+         * further writes, such that audio data continues to be received while
+         * the flush handler waits for the RDP connection */
+        pthread_rwlock_rdlock(&(audio_buffer->ring_lock));
         pthread_mutex_unlock(&(audio_buffer->lock));
 
+        int read_offset = audio_buffer->read_offset;
+        int packet_size = audio_buffer->packet_size;
+
+        /* Copy next packet out of ring buffer, wrapping around if necessary */
+        int length = audio_buffer->ring_size - read_offset;
+        if (length > packet_size)
+            length = packet_size;
+
+        memcpy(audio_buffer->packet, audio_buffer->ring + read_offset, length);
+        memcpy(audio_buffer->packet + length, audio_buffer->ring,
+                packet_size - length);
+
+        /* Release space within ring buffer for further writes */
+        __atomic_store_n(&audio_buffer->read_offset,
+                (read_offset + packet_size) % audio_buffer->ring_size,
+                __ATOMIC_RELEASE);
+
+        /* Only actually invoke if defined */
+        if (audio_buffer->flush_handler)
+            audio_buffer->flush_handler(audio_buffer, packet_size);
+
+        pthread_rwlock_unlock(&(audio_buffer->ring_lock));
+
     }
 
     return NULL;
@@ -265,6 +314,7 @@ guac_rdp_audio_buffer* guac_rdp_audio_buffer_alloc(guac_client* client) {
 
     pthread_mutex_init(&(buffer->lock), NULL);
     pthread_cond_init(&(buffer->modified), NULL);
+    pthread_rwlock_init(&(buffer->ring_lock), NULL);
     buffer->client = client;
 
     /* Begin automated, throttled flush of future data */
@@ -320,6 +370,8 @@ void guac_rdp_audio_buffer_set_stream(guac_rdp_audio_buffer* audio_buffer,
 
     pthread_mutex_lock(&(audio_buffer->lock));
 
+    pthread_rwlock_wrlock(&(audio_buffer->ring_lock));
+
     /* Associate received stream */
     audio_buffer->user = user;
     audio_buffer->stream = stream;
@@ -327,6 +379,12 @@ void guac_rdp_audio_buffer_set_stream(guac_rdp_audio_buffer* audio_buffer,
     audio_buffer->in_format.channels = channels;
     audio_buffer->in_format.bps = bps;
 
+    /* Resample new stream from its beginning */
+    audio_buffer->resample_skip = 0;
+    audio_buffer->resample_error = 0;
+
+    pthread_rwlock_unlock(&(audio_buffer->ring_lock));
+
     /* Acknowledge stream creation (if buffer is ready to receive) */
     guac_rdp_audio_buffer_ack(audio_buffer,
             "OK", GUAC_PROTOCOL_STATUS_SUCCESS);
@@ -347,11 +405,15 @@ void guac_rdp_audio_buffer_set_output(guac_rdp_audio_buffer* audio_buffer,
 
     pthread_mutex_lock(&(audio_buffer->lock));
 
+    pthread_rwlock_wrlock(&(audio_buffer->ring_lock));
+
     /* Set output format */
     audio_buffer->out_format.rate = rate;
     audio_buffer->out_format.channels = channels;
     audio_buffer->out_format.bps = bps;
 
+    pthread_rwlock_unlock(&(audio_buffer->ring_lock));
+
     pthread_cond_broadcast(&(audio_buffer->modified));
     pthread_mutex_unlock(&(audio_buffer->lock));
 
@@ -363,10 +425,15 @@ void guac_rdp_audio_buffer_begin(guac_rdp_audio_buffer* audio_buffer,
 
     pthread_mutex_lock(&(audio_buffer->lock));
 
+    pthread_rwlock_wrlock(&(audio_buffer->ring_lock));
+
     /* Reset buffer state to provided values */
-    audio_buffer->bytes_written = 0;
     audio_buffer->flush_handler = flush_handler;
     audio_buffer->data = data;
+    audio_buffer->read_offset = 0;
+    audio_buffer->write_offset = 0;
+    audio_buffer->resample_skip = 0;
+    audio_buffer->resample_error = 0;
 
     /* Calculate size of each packet in bytes */
     audio_buffer->packet_size = packet_frames
@@ -381,13 +448,24 @@ void guac_rdp_audio_buffer_begin(guac_rdp_audio_buffer* audio_buffer,
     /* Round up to nearest whole packet */
     int ideal_packets = (ideal_size + audio_buffer->packet_size - 1) / audio_buffer->packet_size;
 
-    /* Allocate new buffer */
-    audio_buffer->packet_buffer_size = ideal_packets * audio_buffer->packet_size;
-    audio_buffer->packet = malloc(audio_buffer->packet_buffer_size);
+    /* Allocate new ring buffer, including the additional frame which must
+     * always remain unused */
+    int buffer_size = ideal_packets * audio_buffer->packet_size;
+    free(audio_buffer->ring);
+    audio_buffer->ring_size = buffer_size
+                            + audio_buffer->out_format.channels
+                            * audio_buffer->out_format.bps;
+    audio_buffer->ring = malloc(audio_buffer->ring_size);
+
+    /* Allocate space for the packet being flushed */
+    free(audio_buffer->packet);
+    audio_buffer->packet = malloc(audio_buffer->packet_size);
+
+    pthread_rwlock_unlock(&(audio_buffer->ring_lock));
 
     guac_client_log(audio_buffer->client, GUAC_LOG_DEBUG, "Output buffer for "
-            "audio input is %i bytes (up to %i ms).", audio_buffer->packet_buffer_size,
-            guac_rdp_audio_buffer_duration(&audio_buffer->out_format, audio_buffer->packet_buffer_size));
+            "audio input is %i bytes (up to %i ms).", buffer_size,
+            guac_rdp_audio_buffer_duration(&audio_buffer->out_format, buffer_size));
 
     /* Next flush can occur as soon as data is received */
     clock_gettime(CLOCK_REALTIME, &audio_buffer->next_flush);
@@ -402,149 +480,246 @@ void guac_rdp_audio_buffer_begin(guac_rdp_audio_buffer* audio_buffer,
 }
 
 /**
- * Reads a single sample from the given buffer of data, using the input
- * format defined within the given audio buffer. Each read sample is
- * translated to a signed 16-bit value, even if the input format is 8-bit.
- * The offset into the given buffer will be determined according to the
- * input and output formats, the number of bytes sent thus far, and the
- * number of bytes received (excluding the contents of the buffer).
+ * Reads a single sample from the given frame of audio data, translating the
+ * sample to a signed 16-bit value, even if the sample is 8-bit.
  *
- * IMPORTANT: The guac_rdp_audio_buffer's lock MUST already be held when
+ * @param frame
+ *     The frame of raw PCM audio data from which the sample should be read.
+ *
+ * @param channel
+ *     The channel of the sample within the frame.
+ *
+ * @param bps
+ *     The size of each sample within the frame, in bytes. Accepted audio
+ *     formats are required to be 8- or 16-bit.
+ *
+ * @return
+ *     The sample read, as a signed 16-bit value.
+ */
+static int16_t guac_rdp_audio_buffer_read_sample(const char* frame,
+        int channel, int bps) {
+
+    /* Simply read sample directly if input is 16-bit */
+    if (bps == 2) {
+        int16_t sample;
+        memcpy(&sample, frame + channel * sizeof(sample), sizeof(sample));
+        return sample;
+    }
+
+    /* Translate to 16-bit if input is 8-bit */
+    return ((int8_t) frame[channel]) * 256;
+
+}
+
+/**
+ * Stores a single signed 16-bit sample within the given frame of audio data,
+ * translating the sample to 8-bit if required.
+ *
+ * @param frame
+ *     The frame of raw PCM audio data in which the sample should be stored.
+ *
+ * @param channel
+ *     The channel of the sample within the frame.
+ *
+ * @param bps
+ *     The size of each sample within the frame, in bytes. Accepted audio
+ *     formats are required to be 8- or 16-bit.
+ *
+ * @param sample
+ *     The sample to store.
+ */
+static void guac_rdp_audio_buffer_write_sample(char* frame, int channel,
+        int bps, int16_t sample) {
+
+    /* Store as 16-bit or 8-bit, depending on output format */
+    if (bps == 2)
+        memcpy(frame + channel * sizeof(sample), &sample, sizeof(sample));
+    else
+        frame[channel] = sample >> 8;
+
+}
+
+/**
+ * Converts as many frames of the given buffer of received audio data as
+ * possible from the input format of the given audio buffer to its output
+ * format, storing the converted frames within the given contiguous region of
+ * output. Input frames are mapped to output frames by stepping through the
+ * input using integer arithmetic alone, carrying the fractional part of the
+ * step between calls (and between received buffers) within the audio
+ * buffer's resample_error. If the input and output formats are identical,
+ * frames are copied as-is.
+ *
+ * IMPORTANT: The guac_rdp_audio_buffer's ring_lock MUST already be held when
  * invoking this function.
  *
  * @param audio_buffer
- *     The audio buffer dictating the format of the given data buffer, as
- *     well as the offset from which the sample should be read.
+ *     The audio buffer dictating the input and output formats.
  *
  * @param buffer
- *     The buffer of raw PCM audio data from which the sample should be read.
- *     This buffer MUST NOT contain data already taken into account by the
- *     audio buffer's total_bytes_received counter.
+ *     The buffer of raw PCM audio data received from the user.
  *
- * @param length
- *     The number of bytes within the given buffer of PCM data.
+ * @param frames
+ *     The number of whole frames within the given buffer.
  *
- * @param sample
- *     A pointer to the int16_t in which the read sample should be stored. If
- *     the input format is 8-bit, the sample will be shifted left by 8 bits
- *     to produce a 16-bit sample.
+ * @param position
+ *     A pointer to the index of the next input frame to convert. This will
+ *     be advanced past the frames converted, and may be advanced beyond the
+ *     end of the given buffer if the input is being downsampled.
+ *
+ * @param output
+ *     The region of the ring buffer in which converted frames should be
+ *     stored.
+ *
+ * @param max_frames
+ *     The number of frames that may be stored within the given region.
  *
  * @return
- *     Non-zero if a sample was successfully read, zero if no data remains
- *     within the given buffer that has not already been mapped to an
- *     output sample.
+ *     The number of frames stored within the given region.
  */
-static int guac_rdp_audio_buffer_read_sample(
-        guac_rdp_audio_buffer* audio_buffer, const char* buffer, int length,
-        int16_t* sample) {
+static int guac_rdp_audio_buffer_convert(guac_rdp_audio_buffer* audio_buffer,
+        const char* buffer, int frames, int* position, char* output,
+        int max_frames) {
+
+    const guac_rdp_audio_format* in_format = &audio_buffer->in_format;
+    const guac_rdp_audio_format* out_format = &audio_buffer->out_format;
 
-    int in_bps = audio_buffer->in_format.bps;
-    int in_rate = audio_buffer->in_format.rate;
-    int in_channels = audio_buffer->in_format.channels;
+    int in_frame_size = in_format->channels * in_format->bps;
+    int out_frame_size = out_format->channels * out_format->bps;
 
-    int out_bps = audio_buffer->out_format.bps;
-    int out_rate = audio_buffer->out_format.rate;
-    int out_channels = audio_buffer->out_format.channels;
+    int current = *position;
+    int count = 0;
 
-    /* Calculate position within audio output */
-    int current_sample  = audio_buffer->total_bytes_sent / out_bps;
-    int current_frame   = current_sample / out_channels;
-    int current_channel = current_sample % out_channels;
+    /* Copy frames directly if no conversion is required */
+    if (in_format->rate == out_format->rate
+            && in_format->channels == out_format->channels
+            && in_format->bps == out_format->bps) {
 
-    /* Map output channel to input channel */
-    if (current_channel >= in_channels)
-        current_channel = in_channels - 1;
+        count = frames - current;
+        if (count > max_frames)
+            count = max_frames;
 
-    /* Transform output position to input position */
-    current_frame = (int) current_frame * ((double) in_rate / out_rate);
-    current_sample = current_frame * in_channels + current_channel;
+        memcpy(output, buffer + current * in_frame_size,
+                count * out_frame_size);
 
-    /* Calculate offset within given buffer from absolute input position */
-    int offset = current_sample * in_bps
-               - audio_buffer->total_bytes_received;
+        *position = current + count;
+        return count;
 
-    /* It should be impossible for the offset to ever go negative */
-    assert(offset >= 0);
+    }
 
-    /* Apply offset to buffer */
-    buffer += offset;
-    length -= offset;
+    /* Each output frame advances the input by in_rate / out_rate frames */
+    int step = in_format->rate / out_format->rate;
+    int step_remainder = in_format->rate % out_format->rate;
+    int error = audio_buffer->resample_error;
 
-    /* Read only if sufficient data is present in the given buffer */
-    if (length < in_bps)
-        return 0;
+    while (count < max_frames && current < frames) {
 
-    /* Simply read sample directly if input is 16-bit */
-    if (in_bps == 2) {
-        *sample = *((int16_t*) buffer);
-        return 1;
-    }
+        const char* frame = buffer + current * in_frame_size;
+
+        for (int channel = 0; channel < out_format->channels; channel++) {
+
+            /* Map output channel to input channel */
+            int in_channel = channel;
+            if (in_channel >= in_format->channels)
+                in_channel = in_format->channels - 1;
+
+            int16_t sample = guac_rdp_audio_buffer_read_sample(frame,
+                    in_channel, in_format->bps);
+
+            guac_rdp_audio_buffer_write_sample(output, channel,
+                    out_format->bps, sample);
+
+        }
+
+        output += out_frame_size;
+        count++;
+
+        /* Advance to next input frame */
+        current += step;
+        error += step_remainder;
+        if (error >= out_format->rate) {
+            error -= out_format->rate;
+            current++;
+        }
 
-    /* Translate to 16-bit if input is 8-bit */
-    if (in_bps == 1) {
-        *sample = *buffer << 8;
-        return 1;
     }
 
-    /* Accepted audio formats are required to be 8- or 16-bit */
-    return 0;
+    audio_buffer->resample_error = error;
+    *position = current;
+    return count;
 
 }
 
 void guac_rdp_audio_buffer_write(guac_rdp_audio_buffer* audio_buffer,
         char* buffer, int length) {
 
-    int16_t sample;
-
-    pthread_mutex_lock(&(audio_buffer->lock));
+    pthread_rwlock_rdlock(&(audio_buffer->ring_lock));
 
     guac_client_log(audio_buffer->client, GUAC_LOG_TRACE, "Received %i bytes (%i ms) of audio data",
             length, guac_rdp_audio_buffer_duration(&audio_buffer->in_format, length));
 
     /* Ignore packet if there is no buffer */
-    if (audio_buffer->packet_buffer_size == 0 || audio_buffer->packet == NULL) {
+    if (audio_buffer->ring == NULL) {
         guac_client_log(audio_buffer->client, GUAC_LOG_DEBUG, "Dropped %i "
                 "bytes of received audio data (buffer full or closed).", length);
-        pthread_mutex_unlock(&(audio_buffer->lock));
+        pthread_rwlock_unlock(&(audio_buffer->ring_lock));
         return;
     }
 
-    /* Truncate received samples if exceeding size of buffer */
-    int available = audio_buffer->packet_buffer_size - audio_buffer->bytes_written;
-    if (length > available) {
-        guac_client_log(audio_buffer->client, GUAC_LOG_DEBUG, "Truncating %i "
-                "bytes of received audio data to %i bytes (insufficient space "
-                "in buffer).", length, available);
-        length = available;
-    }
+    int in_frame_size = audio_buffer->in_format.channels
+                      * audio_buffer->in_format.bps;
 
-    int out_bps = audio_buffer->out_format.bps;
+    int out_frame_size = audio_buffer->out_format.channels
+                       * audio_buffer->out_format.bps;
 
-    /* Continuously write packets until no data remains */
-    while (guac_rdp_audio_buffer_read_sample(audio_buffer,
-                buffer, length, &sample) > 0) {
+    int frames = length / in_frame_size;
+    int position = audio_buffer->resample_skip;
 
-        char* current = audio_buffer->packet + audio_buffer->bytes_written;
+    /* Only this thread ever modifies the write offset */
+    int write_offset = audio_buffer->write_offset;
 
-        /* Store as 16-bit or 8-bit, depending on output format */
-        if (out_bps == 2)
-            *((int16_t*) current) = sample;
-        else if (out_bps == 1)
-            *current = sample >> 8;
+    /* Continuously convert frames until no data remains */
+    while (position < frames) {
 
-        /* Accepted audio formats are required to be 8- or 16-bit */
-        else
-            assert(0);
+        /* Determine the space available within the ring buffer, leaving
+         * one frame unused */
+        int available = audio_buffer->ring_size - out_frame_size
+                      - guac_rdp_audio_buffer_used(audio_buffer);
+
+        /* Drop any remaining data if exceeding size of buffer */
+        if (available <= 0) {
+            guac_client_log(audio_buffer->client, GUAC_LOG_DEBUG, "Dropped "
+                    "%i bytes of received audio data (insufficient space in "
+                    "buffer).", (frames - position) * in_frame_size);
+            position = frames;
+            audio_buffer->resample_error = 0;
+            break;
+        }
+
+        /* Convert only into contiguous space */
+        int contiguous = audio_buffer->ring_size - write_offset;
+        if (available > contiguous)
+            available = contiguous;
+
+        int written = guac_rdp_audio_buffer_convert(audio_buffer, buffer,
+                frames, &position, audio_buffer->ring + write_offset,
+                available / out_frame_size);
+
+        write_offset = (write_offset + written * out_frame_size)
+                     % audio_buffer->ring_size;
 
-        /* Update byte counters */
-        audio_buffer->bytes_written += out_bps;
-        audio_buffer->total_bytes_sent += out_bps;
+        /* Publish converted frames to flush thread */
+        __atomic_store_n(&audio_buffer->write_offset, write_offset,
+                __ATOMIC_RELEASE);
 
     } /* end packet write loop */
 
     /* Track current position in audio stream */
-    audio_buffer->total_bytes_received += length;
+    audio_buffer->resample_skip = position - frames;
 
+    pthread_rwlock_unlock(&(audio_buffer->ring_lock));
+
+    /* Wake flush thread */
+    pthread_mutex_lock(&(audio_buffer->lock));
     pthread_cond_broadcast(&(audio_buffer->modified));
     pthread_mutex_unlock(&(audio_buffer->lock));
 
@@ -568,20 +743,27 @@ void guac_rdp_audio_buffer_end(guac_rdp_audio_buffer* audio_buffer) {
     audio_buffer->user = NULL;
     audio_buffer->stream = NULL;
 
+    /* Wait for any in-progress write or flush */
+    pthread_rwlock_wrlock(&(audio_buffer->ring_lock));
+
     /* Reset buffer state */
-    audio_buffer->bytes_written = 0;
     audio_buffer->packet_size = 0;
-    audio_buffer->packet_buffer_size = 0;
     audio_buffer->flush_handler = NULL;
+    audio_buffer->read_offset = 0;
+    audio_buffer->write_offset = 0;
+    audio_buffer->resample_skip = 0;
+    audio_buffer->resample_error = 0;
 
-    /* Reset I/O counters */
-    audio_buffer->total_bytes_sent = 0;
-    audio_buffer->total_bytes_received = 0;
+    /* Free ring buffer and packet (if any) */
+    free(audio_buffer->ring);
+    audio_buffer->ring = NULL;
+    audio_buffer->ring_size = 0;
 
-    /* Free packet (if any) */
     free(audio_buffer->packet);
     audio_buffer->packet = NULL;
 
+    pthread_rwlock_unlock(&(audio_buffer->ring_lock));
+
     pthread_cond_broadcast(&(audio_buffer->modified));
     pthread_mutex_unlock(&(audio_buffer->lock));
 
@@ -600,8 +782,13 @@ void guac_rdp_audio_buffer_free(guac_rdp_audio_buffer* audio_buffer) {
     /* Clean up flush thread */
     pthread_join(audio_buffer->flush_thread, NULL);
 
+    /* Free ring buffer and packet if never ended */
+    free(audio_buffer->ring);
+    free(audio_buffer->packet);
+
     pthread_mutex_destroy(&(audio_buffer->lock));
     pthread_cond_destroy(&(audio_buffer->modified));
+    pthread_rwlock_destroy(&(audio_buffer->ring_lock));
     free(audio_buffer);
 
 }
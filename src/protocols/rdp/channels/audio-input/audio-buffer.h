@@ -37,7 +37,10 @@
 /**
  * A buffer of arbitrary audio data. Received audio data can be written to this
  * buffer, and will automatically be flushed via a given handler once the
- * internal buffer reaches capacity.
+ * internal buffer reaches capacity. Received audio data is converted to the
+ * output format as it is written, and is passed to the thread flushing audio
+ * packets through a single-producer, single-consumer ring buffer, such that
+ * neither receiving nor flushing audio data blocks the other.
  */
 typedef struct guac_rdp_audio_buffer guac_rdp_audio_buffer;
 
@@ -130,34 +133,64 @@ struct guac_rdp_audio_buffer {
 
     /**
      * The size that each audio packet must be, in bytes. The packet buffer
-     * within this structure will be at least this size.
+     * within this structure will be exactly this size.
      */
     int packet_size;
 
     /**
-     * The total number of bytes available within the packet buffer.
+     * Lock which guards the ring buffer and the formats and state used to
+     * fill it. This lock is acquired for reading while audio data is written
+     * to or read from the ring buffer, such that the thread receiving audio
+     * data and the flush thread never wait on each other, and for writing only
+     * while the ring buffer is being allocated, freed, or reconfigured.
      */
-    int packet_buffer_size;
+    pthread_rwlock_t ring_lock;
 
     /**
-     * The number of bytes currently stored within the packet buffer.
+     * Ring buffer of converted audio data awaiting flush, shared by exactly
+     * one writer (the thread receiving audio data from the user) and one
+     * reader (the flush thread). Data is written and read in whole frames, and
+     * one frame of space always remains unused such that a full buffer can be
+     * distinguished from an empty buffer. This will be NULL if no audio
+     * stream has been requested by the RDP server.
      */
-    int bytes_written;
+    char* ring;
 
     /**
-     * The total number of bytes having ever been received by the Guacamole
-     * server for the current audio stream.
+     * The total number of bytes within the ring buffer. This is always a
+     * multiple of the size of a frame in the output format.
      */
-    int total_bytes_received;
+    int ring_size;
 
     /**
-     * The total number of bytes having ever been sent to the RDP server for
-     * the current audio stream.
+     * The offset within the ring buffer of the first byte not yet flushed.
+     * This is updated atomically, and only by the flush thread.
      */
-    int total_bytes_sent;
+    int read_offset;
 
     /**
-     * All audio data being prepared for sending to the AUDIO_INPUT channel.
+     * The offset within the ring buffer at which the next converted frame will
+     * be stored. This is updated atomically, and only by the thread receiving
+     * audio data.
+     */
+    int write_offset;
+
+    /**
+     * The number of input frames which must be skipped at the beginning of the
+     * next block of received audio data to continue resampling where the
+     * previous block left off.
+     */
+    int resample_skip;
+
+    /**
+     * The fractional position within the current input frame of the next
+     * output frame, in units of 1/out_format.rate of an input frame.
+     */
+    int resample_error;
+
+    /**
+     * The contents of the audio packet currently being flushed, copied from
+     * the ring buffer.
      */
     char* packet;
 
@@ -357,8 +357,6 @@ static UINT guac_rdp_cliprdr_format_data_request(CliprdrClientContext* cliprdr,
     guac_client_log(client, GUAC_LOG_TRACE, "CLIPRDR: Received format data request.");
 
     guac_iconv_write* remote_writer;
-    const char* input = clipboard->clipboard->buffer;
-    char* output = malloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
     /* Map requested clipboard format to a guac_iconv writer */
     switch (format_data_request->requestedFormatId) {
@@ -379,31 +377,36 @@ static UINT guac_rdp_cliprdr_format_data_request(CliprdrClientContext* cliprdr,
                     "server has requested a clipboard format which was not "
                     "declared as available. This violates the specification "
                     "for the CLIPRDR channel.");
-            free(output);
             return CHANNEL_RC_OK;
 
     }
 
-    /* Send received clipboard data to the RDP server in the format
-     * requested */
-    BYTE* start = (BYTE*) output;
+    /* Convert received clipboard data to the format requested only now that
+     * the RDP server actually needs it, allocating only as much space as the
+     * converted data requires */
+    int length;
     guac_iconv_read* local_reader = settings->normalize_clipboard ? GUAC_READ_UTF8_NORMALIZED : GUAC_READ_UTF8;
-    guac_iconv(local_reader, &input, clipboard->clipboard->length,
-            remote_writer, &output, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    char* output = guac_common_clipboard_convert(clipboard->clipboard,
+            local_reader, remote_writer, &length);
 
     CLIPRDR_FORMAT_DATA_RESPONSE data_response = {
-        .requestedFormatData = (BYTE*) start,
-        .dataLen = ((BYTE*) output) - start,
-        .msgFlags = CB_RESPONSE_OK
+        .requestedFormatData = (BYTE*) output,
+        .dataLen = output != NULL ? length : 0,
+        .msgFlags = output != NULL ? CB_RESPONSE_OK : CB_RESPONSE_FAIL
     };
 
+    if (output == NULL)
+        guac_client_log(client, GUAC_LOG_WARNING, "Clipboard data could not "
+                "be converted for the RDP server due to insufficient "
+                "memory.");
+
     guac_client_log(client, GUAC_LOG_TRACE, "CLIPRDR: Sending format data response.");
 
     pthread_mutex_lock(&(rdp_client->message_lock));
     UINT result = cliprdr->ClientFormatDataResponse(cliprdr, &data_response);
     pthread_mutex_unlock(&(rdp_client->message_lock));
 
-    free(start);
+    free(output);
     return result;
 
 }
@@ -449,11 +452,7 @@ static UINT guac_rdp_cliprdr_format_data_response(CliprdrClientContext* cliprdr,
         return CHANNEL_RC_OK;
     }
 
-    char received_data[GUAC_COMMON_CLIPBOARD_MAX_LENGTH];
-
     guac_iconv_read* remote_reader;
-    const char* input = (char*) format_data_response->requestedFormatData;
-    char* output = received_data;
 
     /* Find correct source encoding */
     switch (clipboard->requested_format) {
@@ -481,15 +480,20 @@ static UINT guac_rdp_cliprdr_format_data_response(CliprdrClientContext* cliprdr,
 
     }
 
-    /* Convert, store, and forward the clipboard data received from RDP
-     * server */
-    if (guac_iconv(remote_reader, &input, format_data_response->dataLen,
-            GUAC_WRITE_UTF8, &output, sizeof(received_data))) {
-        int length = strnlen(received_data, sizeof(received_data));
-        guac_common_clipboard_reset(clipboard->clipboard, "text/plain");
-        guac_common_clipboard_append(clipboard->clipboard, received_data, length);
-        guac_common_clipboard_send(clipboard->clipboard, client);
-    }
+    /* Convert and store the clipboard data received from RDP server directly
+     * within the clipboard, growing the clipboard only as needed */
+    guac_common_clipboard_reset(clipboard->clipboard, "text/plain");
+    if (guac_common_clipboard_append_text(clipboard->clipboard, remote_reader,
+                (const char*) format_data_response->requestedFormatData,
+                format_data_response->dataLen))
+        guac_client_log(client, GUAC_LOG_WARNING, "Clipboard data received "
+                "from the RDP server has been truncated to %i bytes. The "
+                "maximum size of the clipboard can be raised with the "
+                "\"clipboard-buffer-size\" parameter.",
+                clipboard->clipboard->max_length);
+
+    /* Forward the received clipboard data to all users */
+    guac_common_clipboard_send(clipboard->clipboard, client);
 
     return CHANNEL_RC_OK;
 
@@ -590,12 +594,13 @@ static void guac_rdp_cliprdr_channel_disconnected(rdpContext* context,
 
 }
 
-guac_rdp_clipboard* guac_rdp_clipboard_alloc(guac_client* client) {
+guac_rdp_clipboard* guac_rdp_clipboard_alloc(guac_client* client,
+        int buffer_size) {
 
     /* Allocate clipboard and underlying storage */
     guac_rdp_clipboard* clipboard = calloc(1, sizeof(guac_rdp_clipboard));
     clipboard->client = client;
-    clipboard->clipboard = guac_common_clipboard_alloc();
+    clipboard->clipboard = guac_common_clipboard_alloc(buffer_size);
     clipboard->requested_format = CF_TEXT;
 
     return clipboard;
@@ -661,6 +666,7 @@ int guac_rdp_clipboard_handler(guac_user* user, guac_stream* stream,
     /* Clear any current contents, assigning the mimetype the data which will
      * be received */
     guac_common_clipboard_reset(clipboard->clipboard, mimetype);
+    clipboard->truncated = 0;
     return 0;
 
 }
@@ -678,7 +684,9 @@ int guac_rdp_clipboard_blob_handler(guac_user* user, guac_stream* stream,
         return 0;
 
     /* Append received data to current clipboard contents */
-    guac_common_clipboard_append(clipboard->clipboard, (char*) data, length);
+    if (guac_common_clipboard_append(clipboard->clipboard, (char*) data, length))
+        clipboard->truncated = 1;
+
     return 0;
 
 }
@@ -695,8 +703,13 @@ int guac_rdp_clipboard_end_handler(guac_user* user, guac_stream* stream) {
     if (clipboard == NULL)
         return 0;
 
-    /* Terminate clipboard data with NULL */
-    guac_common_clipboard_append(clipboard->clipboard, "", 1);
+    /* Data is converted and terminated only once requested by the RDP
+     * server, but any truncation is noted now */
+    if (clipboard->truncated)
+        guac_client_log(client, GUAC_LOG_WARNING, "Received clipboard data "
+                "has been truncated to %i bytes. The maximum size of the "
+                "clipboard can be raised with the \"clipboard-buffer-size\" "
+                "parameter.", clipboard->clipboard->max_length);
 
     /* Notify RDP server of new data, if connected */
     if (clipboard->cliprdr != NULL) {
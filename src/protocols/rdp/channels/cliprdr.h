@@ -59,6 +59,13 @@ typedef struct guac_rdp_clipboard {
      */
     UINT requested_format;
 
+    /**
+     * Non-zero if the clipboard data currently being received from a user
+     * has been truncated because it exceeds the maximum size of the
+     * clipboard, zero otherwise.
+     */
+    int truncated;
+
 } guac_rdp_clipboard;
 
 /**
@@ -71,11 +78,16 @@ typedef struct guac_rdp_clipboard {
  *     The guac_client associated with the Guacamole side of the RDP
  *     connection.
  *
+ * @param buffer_size
+ *     The maximum number of bytes of clipboard data to accept, in either
+ *     direction.
+ *
  * @return
  *     A newly-allocated instance of guac_rdp_clipboard which has been
  *     initialized for processing Guacamole clipboard data.
  */
-guac_rdp_clipboard* guac_rdp_clipboard_alloc(guac_client* client);
+guac_rdp_clipboard* guac_rdp_clipboard_alloc(guac_client* client,
+        int buffer_size);
 
 /**
  * Initializes clipboard support for RDP and handling of the CLIPRDR channel.
@@ -29,6 +29,7 @@
 #include <guacamole/client.h>
 #include <guacamole/timestamp.h>
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -281,9 +282,17 @@ int guac_rdp_disp_reconnect_needed(guac_rdp_disp* disp) {
     guac_rdp_client* rdp_client = (guac_rdp_client*) disp->client->data;
 
     /* Do not reconnect if files are open. */
-    if (rdp_client->filesystem != NULL
-            && rdp_client->filesystem->open_files > 0)
-        return 0;
+    guac_rdp_fs* fs = rdp_client->filesystem;
+    if (fs != NULL) {
+
+        pthread_mutex_lock(&(fs->lock));
+        int open_files = fs->open_files;
+        pthread_mutex_unlock(&(fs->lock));
+
+        if (open_files > 0)
+            return 0;
+
+    }
 
     /* Do not reconnect if an active print job is present */
     if (rdp_client->active_job != NULL)
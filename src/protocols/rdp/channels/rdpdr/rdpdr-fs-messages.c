@@ -133,13 +133,12 @@ void guac_rdpdr_fs_process_create(guac_rdp_common_svc* svc,
 
 }
 
-void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
+wStream* guac_rdpdr_fs_read(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
         wStream* input_stream) {
 
     UINT32 length;
     UINT64 offset;
-    char* buffer;
     int bytes_read;
 
     wStream* output_stream;
@@ -149,7 +148,7 @@ void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
         guac_client_log(svc->client, GUAC_LOG_WARNING, "Server Drive Read "
                 "Request PDU does not contain the expected number of bytes. "
                 "Drive redirection may not work as expected.");
-        return;
+        return NULL;
     }
     
     /* Read packet */
@@ -164,34 +163,49 @@ void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
     if (length > GUAC_RDP_MAX_READ_BUFFER)
         length = GUAC_RDP_MAX_READ_BUFFER;
 
-    /* Allocate buffer */
-    buffer = malloc(length);
+    /* Reserve space for the largest possible response, reading directly into
+     * the response following its length field */
+    output_stream = guac_rdpdr_new_io_completion(device,
+            iorequest->completion_id, STATUS_SUCCESS, 4+length);
+    Stream_Seek(output_stream, 4); /* Length (written below) */
 
     /* Attempt read */
     bytes_read = guac_rdp_fs_read((guac_rdp_fs*) device->data,
-            iorequest->file_id, offset, buffer, length);
+            iorequest->file_id, offset, (char*) Stream_Pointer(output_stream),
+            length);
 
-    /* If error, return invalid parameter */
+    /* If error, rewrite status and return no data */
     if (bytes_read < 0) {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, guac_rdp_fs_get_status(bytes_read), 4);
-        Stream_Write_UINT32(output_stream, 0); /* Length */
+        Stream_SetPosition(output_stream, 12);
+        Stream_Write_UINT32(output_stream,
+                guac_rdp_fs_get_status(bytes_read)); /* IoStatus */
+        Stream_Write_UINT32(output_stream, 0);     /* Length */
     }
 
-    /* Otherwise, send bytes read */
+    /* Otherwise, include bytes read */
     else {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, STATUS_SUCCESS, 4+bytes_read);
-        Stream_Write_UINT32(output_stream, bytes_read);  /* Length */
-        Stream_Write(output_stream, buffer, bytes_read); /* ReadData */
+        Stream_SetPosition(output_stream, 16);
+        Stream_Write_UINT32(output_stream, bytes_read); /* Length */
+        Stream_Seek(output_stream, bytes_read);          /* ReadData */
     }
 
-    guac_rdp_common_svc_write(svc, output_stream);
-    free(buffer);
+    return output_stream;
 
 }
 
-void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
+void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
+        guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
+        wStream* input_stream) {
+
+    wStream* output_stream = guac_rdpdr_fs_read(svc, device, iorequest,
+            input_stream);
+
+    if (output_stream != NULL)
+        guac_rdp_common_svc_write(svc, output_stream);
+
+}
+
+wStream* guac_rdpdr_fs_write(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
         wStream* input_stream) {
 
@@ -206,7 +220,7 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
         guac_client_log(svc->client, GUAC_LOG_WARNING, "Server Drive Write "
                 "Request PDU does not contain the expected number of bytes. "
                 "Drive redirection may not work as expected.");
-        return;
+        return NULL;
     }
     
     /* Read packet */
@@ -223,7 +237,7 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
         guac_client_log(svc->client, GUAC_LOG_WARNING, "Server Drive Write "
                 "Request PDU does not contain the expected number of bytes. "
                 "Drive redirection may not work as expected.");
-        return;
+        return NULL;
     }
     
     /* Attempt write */
@@ -246,7 +260,19 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
         Stream_Write_UINT8(output_stream, 0);              /* Padding */
     }
 
-    guac_rdp_common_svc_write(svc, output_stream);
+    return output_stream;
+
+}
+
+void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
+        guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
+        wStream* input_stream) {
+
+    wStream* output_stream = guac_rdpdr_fs_write(svc, device, iorequest,
+            input_stream);
+
+    if (output_stream != NULL)
+        guac_rdp_common_svc_write(svc, output_stream);
 
 }
 
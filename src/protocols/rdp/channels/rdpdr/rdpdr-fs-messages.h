@@ -48,11 +48,72 @@ guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_close;
  */
 guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_read;
 
+/**
+ * Performs the read requested by a Server Drive Read Request, returning the
+ * response without sending it. The data read is placed directly within the
+ * response. This function does not acquire any locks beyond those of the
+ * underlying filesystem, and thus may be invoked from threads other than the
+ * thread handling the RDPDR channel.
+ *
+ * @param svc
+ *     The guac_rdp_common_svc representing the static virtual channel being
+ *     used for RDPDR.
+ *
+ * @param device
+ *     The guac_rdpdr_device of the drive being read.
+ *
+ * @param iorequest
+ *     The contents of the common RDPDR Device I/O Request header of the
+ *     request.
+ *
+ * @param input_stream
+ *     The remaining data within the received PDU, following the common RDPDR
+ *     Device I/O Request header.
+ *
+ * @return
+ *     A newly-allocated stream containing the Device Read Response which
+ *     should be sent, or NULL if the request is malformed and no response
+ *     should be sent.
+ */
+wStream* guac_rdpdr_fs_read(guac_rdp_common_svc* svc,
+        guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
+        wStream* input_stream);
+
 /**
  * Handles a Server Drive Write Request. This request writes to a file.
  */
 guac_rdpdr_device_iorequest_handler guac_rdpdr_fs_process_write;
 
+/**
+ * Performs the write requested by a Server Drive Write Request, returning the
+ * response without sending it. This function does not acquire any locks
+ * beyond those of the underlying filesystem, and thus may be invoked from
+ * threads other than the thread handling the RDPDR channel.
+ *
+ * @param svc
+ *     The guac_rdp_common_svc representing the static virtual channel being
+ *     used for RDPDR.
+ *
+ * @param device
+ *     The guac_rdpdr_device of the drive being written.
+ *
+ * @param iorequest
+ *     The contents of the common RDPDR Device I/O Request header of the
+ *     request.
+ *
+ * @param input_stream
+ *     The remaining data within the received PDU, following the common RDPDR
+ *     Device I/O Request header.
+ *
+ * @return
+ *     A newly-allocated stream containing the Device Write Response which
+ *     should be sent, or NULL if the request is malformed and no response
+ *     should be sent.
+ */
+wStream* guac_rdpdr_fs_write(guac_rdp_common_svc* svc,
+        guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
+        wStream* input_stream);
+
 /**
  * Handles a Server Drive Control Request. This request handles one of any
  * number of Windows FSCTL_* control functions.
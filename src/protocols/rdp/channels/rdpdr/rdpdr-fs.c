@@ -28,12 +28,516 @@
 #include <guacamole/unicode.h>
 #include <winpr/stream.h>
 
+#include <pthread.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/**
+ * The number of milliseconds the I/O worker waits before again attempting to
+ * send completed responses, if responses could not be sent because the RDP
+ * client was busy.
+ */
+#define GUAC_RDPDR_FS_WORKER_RETRY_INTERVAL 5
+
+/**
+ * A read or write request which has been queued for processing by the I/O
+ * worker of a filesystem device, along with its response once processed.
+ */
+typedef struct guac_rdpdr_fs_io_request {
+
+    /**
+     * The common RDPDR Device I/O Request header of the request.
+     */
+    guac_rdpdr_iorequest iorequest;
+
+    /**
+     * A copy of the remaining data within the received PDU, or NULL if the
+     * request has been processed.
+     */
+    wStream* input_stream;
+
+    /**
+     * The response to the request, or NULL if the request has not yet been
+     * processed or no response should be sent.
+     */
+    wStream* output_stream;
+
+    /**
+     * The next request within the same queue, or NULL if this is the last.
+     */
+    struct guac_rdpdr_fs_io_request* next;
+
+} guac_rdpdr_fs_io_request;
+
+/**
+ * A queue of guac_rdpdr_fs_io_request, processed in order.
+ */
+typedef struct guac_rdpdr_fs_io_queue {
+
+    /**
+     * The first request in the queue, or NULL if the queue is empty.
+     */
+    guac_rdpdr_fs_io_request* first;
+
+    /**
+     * The last request in the queue, or NULL if the queue is empty.
+     */
+    guac_rdpdr_fs_io_request* last;
+
+} guac_rdpdr_fs_io_queue;
+
+/**
+ * The state of the thread which performs reads and writes on behalf of a
+ * filesystem device, such that slow storage does not block the RDP client
+ * thread (and, with it, the display). Only one worker exists per device, such
+ * that the server observes the effects of its reads and writes in the order
+ * they were requested. The guac_rdp_fs itself is guarded by its own lock, as
+ * uploads and downloads access the same files from other threads. All other
+ * requests are handled directly, but only once all queued reads and writes
+ * have been processed.
+ *
+ * The RDP client thread holds message_lock while RDPDR requests are handled,
+ * including while waiting for queued reads and writes to be processed. The
+ * worker must therefore never block on message_lock, and instead sends
+ * responses only when message_lock is immediately available, leaving them to
+ * be sent by the RDP client thread otherwise.
+ */
+typedef struct guac_rdpdr_fs_worker {
+
+    /**
+     * The thread processing queued requests.
+     */
+    pthread_t thread;
+
+    /**
+     * Lock which guards all other members of this structure.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever a request is queued, whenever a
+     * request has been processed, and when the worker must stop.
+     */
+    pthread_cond_t modified;
+
+    /**
+     * Requests which have not yet been processed.
+     */
+    guac_rdpdr_fs_io_queue pending;
+
+    /**
+     * Requests which have been processed but whose responses have not yet
+     * been sent.
+     */
+    guac_rdpdr_fs_io_queue completed;
+
+    /**
+     * Non-zero if the worker is currently processing a request which is no
+     * longer within either queue.
+     */
+    int busy;
+
+    /**
+     * Non-zero if the worker must stop.
+     */
+    int stopping;
+
+    /**
+     * The static virtual channel being used for RDPDR.
+     */
+    guac_rdp_common_svc* svc;
+
+    /**
+     * The device whose requests are processed by this worker.
+     */
+    guac_rdpdr_device* device;
+
+} guac_rdpdr_fs_worker;
+
+/**
+ * Adds the given request to the end of the given queue.
+ *
+ * @param queue
+ *     The queue to add the request to.
+ *
+ * @param request
+ *     The request to add.
+ */
+static void guac_rdpdr_fs_io_queue_push(guac_rdpdr_fs_io_queue* queue,
+        guac_rdpdr_fs_io_request* request) {
+
+    request->next = NULL;
+
+    if (queue->last != NULL)
+        queue->last->next = request;
+    else
+        queue->first = request;
+
+    queue->last = request;
+
+}
+
+/**
+ * Removes all requests from the given queue, returning the first. The
+ * remaining requests are accessible through the next pointer of each request.
+ *
+ * @param queue
+ *     The queue to remove all requests from.
+ *
+ * @return
+ *     The first request which was within the queue, or NULL if the queue was
+ *     empty.
+ */
+static guac_rdpdr_fs_io_request* guac_rdpdr_fs_io_queue_take(
+        guac_rdpdr_fs_io_queue* queue) {
+
+    guac_rdpdr_fs_io_request* first = queue->first;
+
+    queue->first = NULL;
+    queue->last = NULL;
+
+    return first;
+
+}
+
+/**
+ * Frees the given requests and any associated streams, without sending any
+ * responses.
+ *
+ * @param request
+ *     The first of the requests to free, as returned by
+ *     guac_rdpdr_fs_io_queue_take(). This may be NULL.
+ */
+static void guac_rdpdr_fs_io_request_free_all(
+        guac_rdpdr_fs_io_request* request) {
+
+    while (request != NULL) {
+
+        guac_rdpdr_fs_io_request* next = request->next;
+
+        if (request->input_stream != NULL)
+            Stream_Free(request->input_stream, 1);
+
+        if (request->output_stream != NULL)
+            Stream_Free(request->output_stream, 1);
+
+        free(request);
+        request = next;
+
+    }
+
+}
+
+/**
+ * Sends the responses of all requests which have been processed by the given
+ * worker. The calling thread must hold message_lock.
+ *
+ * @param worker
+ *     The worker whose completed requests should be sent.
+ */
+static void guac_rdpdr_fs_worker_send(guac_rdpdr_fs_worker* worker) {
+
+    pthread_mutex_lock(&(worker->lock));
+    guac_rdpdr_fs_io_request* request =
+        guac_rdpdr_fs_io_queue_take(&(worker->completed));
+    pthread_mutex_unlock(&(worker->lock));
+
+    /* Responses need not be sent in the order received, as each is
+     * identified by its completion ID */
+    while (request != NULL) {
+
+        guac_rdpdr_fs_io_request* next = request->next;
+
+        /* The stream is freed automatically once written */
+        if (request->output_stream != NULL)
+            guac_rdp_common_svc_write(worker->svc, request->output_stream);
+
+        free(request);
+        request = next;
+
+    }
+
+}
+
+/**
+ * Waits for all reads and writes queued for the given worker to be
+ * processed, sending their responses. This must be invoked by the RDP client
+ * thread before handling any other request.
+ *
+ * @param worker
+ *     The worker to wait for.
+ */
+static void guac_rdpdr_fs_worker_drain(guac_rdpdr_fs_worker* worker) {
+
+    pthread_mutex_lock(&(worker->lock));
+
+    while (worker->pending.first != NULL || worker->busy)
+        pthread_cond_wait(&(worker->modified), &(worker->lock));
+
+    pthread_mutex_unlock(&(worker->lock));
+
+    guac_rdpdr_fs_worker_send(worker);
+
+}
+
+/**
+ * The thread which processes the reads and writes queued for a filesystem
+ * device.
+ *
+ * @param data
+ *     The guac_rdpdr_fs_worker of the device.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdpdr_fs_worker_thread(void* data) {
+
+    guac_rdpdr_fs_worker* worker = (guac_rdpdr_fs_worker*) data;
+    guac_rdp_common_svc* svc = worker->svc;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) svc->client->data;
+
+    pthread_mutex_lock(&(worker->lock));
+
+    while (!worker->stopping) {
+
+        guac_rdpdr_fs_io_request* request = worker->pending.first;
+
+        /* Process next request, if any, without holding the lock */
+        if (request != NULL) {
+
+            worker->pending.first = request->next;
+            if (worker->pending.first == NULL)
+                worker->pending.last = NULL;
+
+            worker->busy = 1;
+            pthread_mutex_unlock(&(worker->lock));
+
+            if (request->iorequest.major_func == IRP_MJ_READ)
+                request->output_stream = guac_rdpdr_fs_read(svc,
+                        worker->device, &(request->iorequest),
+                        request->input_stream);
+            else
+                request->output_stream = guac_rdpdr_fs_write(svc,
+                        worker->device, &(request->iorequest),
+                        request->input_stream);
+
+            Stream_Free(request->input_stream, 1);
+            request->input_stream = NULL;
+
+            pthread_mutex_lock(&(worker->lock));
+            guac_rdpdr_fs_io_queue_push(&(worker->completed), request);
+            worker->busy = 0;
+            pthread_cond_broadcast(&(worker->modified));
+
+            /* Process all requests that have already arrived before
+             * attempting to send anything */
+            if (worker->pending.first != NULL)
+                continue;
+
+        }
+
+        /* Send responses only if the RDP client is not busy, as the RDP
+         * client thread may be waiting on this thread while holding
+         * message_lock */
+        if (worker->completed.first != NULL) {
+
+            pthread_mutex_unlock(&(worker->lock));
+
+            if (pthread_mutex_trylock(&(rdp_client->message_lock)) == 0) {
+                guac_rdpdr_fs_worker_send(worker);
+                pthread_mutex_unlock(&(rdp_client->message_lock));
+            }
+
+            pthread_mutex_lock(&(worker->lock));
+
+        }
+
+        /* Do not wait if requests arrived or stop was requested while
+         * sending */
+        if (worker->stopping || worker->pending.first != NULL)
+            continue;
+
+        /* Retry sending shortly if responses remain unsent */
+        if (worker->completed.first != NULL) {
+
+            /* Calculate absolute timestamp from retry interval */
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            tv.tv_usec += GUAC_RDPDR_FS_WORKER_RETRY_INTERVAL * 1000;
+
+            /* Wrap to next second if necessary */
+            if (tv.tv_usec >= 1000000) {
+                tv.tv_sec++;
+                tv.tv_usec -= 1000000;
+            }
+
+            struct timespec timeout;
+            timeout.tv_sec  = tv.tv_sec;
+            timeout.tv_nsec = tv.tv_usec * 1000;
+
+            pthread_cond_timedwait(&(worker->modified), &(worker->lock),
+                    &timeout);
+
+        }
+
+        /* Otherwise wait for more requests */
+        else
+            pthread_cond_wait(&(worker->modified), &(worker->lock));
+
+    }
+
+    pthread_mutex_unlock(&(worker->lock));
+    return NULL;
+
+}
+
+/**
+ * Queues the given read or write request for processing by the given worker,
+ * copying the remaining data within the received PDU.
+ *
+ * @param worker
+ *     The worker which should process the request.
+ *
+ * @param iorequest
+ *     The common RDPDR Device I/O Request header of the request.
+ *
+ * @param input_stream
+ *     The remaining data within the received PDU, following the common RDPDR
+ *     Device I/O Request header.
+ *
+ * @return
+ *     Zero if the request was queued, non-zero if memory could not be
+ *     allocated for the request.
+ */
+static int guac_rdpdr_fs_worker_queue(guac_rdpdr_fs_worker* worker,
+        guac_rdpdr_iorequest* iorequest, wStream* input_stream) {
+
+    guac_rdpdr_fs_io_request* request =
+        malloc(sizeof(guac_rdpdr_fs_io_request));
+    if (request == NULL)
+        return 1;
+
+    size_t length = Stream_GetRemainingLength(input_stream);
+    request->input_stream = Stream_New(NULL, length > 0 ? length : 1);
+    if (request->input_stream == NULL) {
+        free(request);
+        return 1;
+    }
+
+    Stream_Write(request->input_stream, Stream_Pointer(input_stream), length);
+    Stream_SealLength(request->input_stream);
+    Stream_SetPosition(request->input_stream, 0);
+
+    request->iorequest = *iorequest;
+    request->output_stream = NULL;
+
+    pthread_mutex_lock(&(worker->lock));
+    guac_rdpdr_fs_io_queue_push(&(worker->pending), request);
+    pthread_cond_broadcast(&(worker->modified));
+    pthread_mutex_unlock(&(worker->lock));
+
+    return 0;
+
+}
+
+/**
+ * Creates and starts the I/O worker of the given filesystem device.
+ *
+ * @param svc
+ *     The static virtual channel being used for RDPDR.
+ *
+ * @param device
+ *     The filesystem device whose reads and writes should be processed by
+ *     the new worker.
+ *
+ * @return
+ *     The newly-started worker, or NULL if the worker could not be started.
+ */
+static guac_rdpdr_fs_worker* guac_rdpdr_fs_worker_alloc(
+        guac_rdp_common_svc* svc, guac_rdpdr_device* device) {
+
+    guac_rdpdr_fs_worker* worker = calloc(1, sizeof(guac_rdpdr_fs_worker));
+    if (worker == NULL)
+        return NULL;
+
+    worker->svc = svc;
+    worker->device = device;
+
+    pthread_mutex_init(&(worker->lock), NULL);
+    pthread_cond_init(&(worker->modified), NULL);
+
+    if (pthread_create(&(worker->thread), NULL,
+                guac_rdpdr_fs_worker_thread, worker)) {
+        pthread_cond_destroy(&(worker->modified));
+        pthread_mutex_destroy(&(worker->lock));
+        free(worker);
+        return NULL;
+    }
+
+    return worker;
+
+}
+
+/**
+ * Stops and frees the given I/O worker. Any requests which have not yet been
+ * processed, or whose responses have not yet been sent, are discarded.
+ *
+ * @param worker
+ *     The worker to free.
+ */
+static void guac_rdpdr_fs_worker_free(guac_rdpdr_fs_worker* worker) {
+
+    pthread_mutex_lock(&(worker->lock));
+    worker->stopping = 1;
+    pthread_cond_broadcast(&(worker->modified));
+    pthread_mutex_unlock(&(worker->lock));
+
+    pthread_join(worker->thread, NULL);
+
+    guac_rdpdr_fs_io_request_free_all(
+            guac_rdpdr_fs_io_queue_take(&(worker->pending)));
+    guac_rdpdr_fs_io_request_free_all(
+            guac_rdpdr_fs_io_queue_take(&(worker->completed)));
+
+    pthread_cond_destroy(&(worker->modified));
+    pthread_mutex_destroy(&(worker->lock));
+    free(worker);
+
+}
 
 void guac_rdpdr_device_fs_iorequest_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
         wStream* input_stream) {
 
+    guac_rdpdr_fs_worker* worker = (guac_rdpdr_fs_worker*) device->worker;
+
+    if (worker != NULL) {
+
+        /* Queue reads and writes for processing in the background, sending
+         * any responses which are ready */
+        if (iorequest->major_func == IRP_MJ_READ
+                || iorequest->major_func == IRP_MJ_WRITE) {
+
+            if (!guac_rdpdr_fs_worker_queue(worker, iorequest,
+                        input_stream)) {
+                guac_rdpdr_fs_worker_send(worker);
+                return;
+            }
+
+            /* The request must still be answered, so handle it directly if
+             * it cannot be queued */
+            guac_client_log(svc->client, GUAC_LOG_WARNING, "Unable to queue "
+                    "drive I/O request. Handling request synchronously.");
+
+        }
+
+        /* Handle all other requests (and any reads or writes which could not
+         * be queued) only once all prior reads and writes are complete */
+        guac_rdpdr_fs_worker_drain(worker);
+
+    }
+
     switch (iorequest->major_func) {
 
         /* File open */
@@ -111,6 +615,9 @@ void guac_rdpdr_device_fs_iorequest_handler(guac_rdp_common_svc* svc,
 void guac_rdpdr_device_fs_free_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device) {
 
+    if (device->worker != NULL)
+        guac_rdpdr_fs_worker_free((guac_rdpdr_fs_worker*) device->worker);
+
     Stream_Free(device->device_announce, 1);
     
 }
@@ -150,5 +657,13 @@ void guac_rdpdr_register_fs(guac_rdp_common_svc* svc, char* drive_name) {
     /* Init data */
     device->data = rdp_client->filesystem;
 
+    /* Perform reads and writes in the background, falling back to handling
+     * them directly if the worker cannot be started */
+    device->worker = guac_rdpdr_fs_worker_alloc(svc, device);
+    if (device->worker == NULL)
+        guac_client_log(client, GUAC_LOG_WARNING, "Unable to start drive "
+                "I/O thread. Drive reads and writes will block the RDP "
+                "connection.");
+
 }
 
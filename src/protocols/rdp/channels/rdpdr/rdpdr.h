@@ -164,6 +164,13 @@ struct guac_rdpdr_device {
      */
     void* data;
 
+    /**
+     * Arbitrary state of any thread processing I/O requests for this device
+     * in the background, or NULL if all I/O requests are handled directly.
+     * This is used internally by the handlers for this device.
+     */
+    void* worker;
+
 };
 
 /**
@@ -18,11 +18,15 @@
  */
 
 #include "channels/rdpgfx.h"
+#include "common/display.h"
+#include "common/surface.h"
 #include "plugins/channels.h"
 #include "rdp.h"
 #include "settings.h"
 
+#include <cairo/cairo.h>
 #include <freerdp/client/rdpgfx.h>
+#include <freerdp/codec/color.h>
 #include <freerdp/freerdp.h>
 #include <freerdp/gdi/gfx.h>
 #include <freerdp/event.h>
@@ -31,6 +35,557 @@
 #include <stdlib.h>
 #include <string.h>
 
+guac_rdp_rdpgfx* guac_rdp_rdpgfx_alloc(guac_client* client) {
+
+    guac_rdp_rdpgfx* rdpgfx = calloc(1, sizeof(guac_rdp_rdpgfx));
+    rdpgfx->client = client;
+
+    return rdpgfx;
+
+}
+
+void guac_rdp_rdpgfx_free(guac_rdp_rdpgfx* rdpgfx) {
+    free(rdpgfx->cache);
+    free(rdpgfx);
+}
+
+/**
+ * Returns the guac_rdp_rdpgfx module associated with the given
+ * RdpgfxClientContext, which must have been initialized by
+ * gdi_graphics_pipeline_init().
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @return
+ *     The guac_rdp_rdpgfx module of the relevant guac_rdp_client.
+ */
+static guac_rdp_rdpgfx* guac_rdp_rdpgfx_get(RdpgfxClientContext* context) {
+
+    rdpGdi* gdi = (rdpGdi*) context->custom;
+    guac_client* client = ((rdp_freerdp_context*) gdi->context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
+    return rdp_client->rdpgfx;
+
+}
+
+/**
+ * Returns the display of the RDP connection associated with the given
+ * guac_rdp_rdpgfx module if RDPGFX commands should be mirrored to that
+ * display, or NULL if only FreeRDP should handle RDPGFX commands.
+ *
+ * @param rdpgfx
+ *     The guac_rdp_rdpgfx module associated with the RDPGFX channel.
+ *
+ * @return
+ *     The display to which RDPGFX commands should be mirrored, or NULL if
+ *     RDPGFX commands should not be mirrored.
+ */
+static guac_common_display* guac_rdp_rdpgfx_get_display(
+        guac_rdp_rdpgfx* rdpgfx) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    /* Changes to a display surface which is bound to the GDI framebuffer
+     * cannot be mirrored without also modifying the framebuffer */
+    if (rdp_client->settings->gfx_zero_copy)
+        return NULL;
+
+    return rdp_client->display;
+
+}
+
+/**
+ * Determines the location of the given RDPGFX surface within the output
+ * (the GDI framebuffer, and thus the default surface of the display). Only
+ * surfaces which are mapped to the output without scaling have a location
+ * that can be used by Guacamole instructions.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_id
+ *     The ID of the RDPGFX surface.
+ *
+ * @param x
+ *     Pointer to an int that should receive the X coordinate of the
+ *     upper-left corner of the surface within the output.
+ *
+ * @param y
+ *     Pointer to an int that should receive the Y coordinate of the
+ *     upper-left corner of the surface within the output.
+ *
+ * @param bounds
+ *     Pointer to a RECTANGLE_16 that should receive the area of the surface
+ *     which is mapped to the output, in surface coordinates.
+ *
+ * @return
+ *     Non-zero if the surface is mapped to the output without scaling, zero
+ *     otherwise.
+ */
+static int guac_rdp_rdpgfx_get_output_location(RdpgfxClientContext* context,
+        UINT16 surface_id, int* x, int* y, RECTANGLE_16* bounds) {
+
+    gdiGfxSurface* surface = (gdiGfxSurface*) context->GetSurfaceData(context,
+            surface_id);
+
+    if (surface == NULL || !surface->outputMapped)
+        return 0;
+
+    /* Guacamole instructions cannot reproduce scaling */
+    if (surface->outputTargetWidth != surface->mappedWidth
+            || surface->outputTargetHeight != surface->mappedHeight)
+        return 0;
+
+    *x = surface->outputOriginX;
+    *y = surface->outputOriginY;
+
+    bounds->left = 0;
+    bounds->top = 0;
+    bounds->right = surface->mappedWidth;
+    bounds->bottom = surface->mappedHeight;
+
+    return 1;
+
+}
+
+/**
+ * Constrains the given rectangle to the given bounds, returning whether any
+ * area remains.
+ *
+ * @param rect
+ *     The rectangle to constrain.
+ *
+ * @param bounds
+ *     The bounds to constrain the rectangle to.
+ *
+ * @return
+ *     Non-zero if the constrained rectangle is non-empty, zero otherwise.
+ */
+static int guac_rdp_rdpgfx_constrain(RECTANGLE_16* rect,
+        const RECTANGLE_16* bounds) {
+
+    if (rect->left < bounds->left)     rect->left = bounds->left;
+    if (rect->top < bounds->top)       rect->top = bounds->top;
+    if (rect->right > bounds->right)   rect->right = bounds->right;
+    if (rect->bottom > bounds->bottom) rect->bottom = bounds->bottom;
+
+    return rect->right > rect->left && rect->bottom > rect->top;
+
+}
+
+/**
+ * Frees the Guacamole buffer associated with the given RDPGFX cache slot, if
+ * any.
+ *
+ * @param rdpgfx
+ *     The guac_rdp_rdpgfx module associated with the RDPGFX channel.
+ *
+ * @param display
+ *     The display from which the buffer was allocated.
+ *
+ * @param slot
+ *     The cache slot to clear.
+ */
+static void guac_rdp_rdpgfx_cache_clear(guac_rdp_rdpgfx* rdpgfx,
+        guac_common_display* display, int slot) {
+
+    if (slot >= rdpgfx->cache_size)
+        return;
+
+    guac_common_display_layer* buffer = rdpgfx->cache[slot];
+    if (buffer == NULL)
+        return;
+
+    rdpgfx->cached_pixels -= buffer->surface->width * buffer->surface->height;
+    guac_common_display_free_buffer(display, buffer);
+    rdpgfx->cache[slot] = NULL;
+
+}
+
+/**
+ * Frees all Guacamole buffers associated with RDPGFX cache slots.
+ *
+ * @param rdpgfx
+ *     The guac_rdp_rdpgfx module associated with the RDPGFX channel.
+ *
+ * @param display
+ *     The display from which the buffers were allocated.
+ */
+static void guac_rdp_rdpgfx_cache_clear_all(guac_rdp_rdpgfx* rdpgfx,
+        guac_common_display* display) {
+
+    int slot;
+    for (slot = 0; slot < rdpgfx->cache_size; slot++)
+        guac_rdp_rdpgfx_cache_clear(rdpgfx, display, slot);
+
+}
+
+/**
+ * Grows the cache array of the given RDPGFX module such that it contains at
+ * least the given slot. The array is grown geometrically, up to the maximum
+ * number of slots permitted by GUAC_RDP_RDPGFX_CACHE_SLOTS, with all newly-
+ * allocated slots initialized to NULL.
+ *
+ * @param rdpgfx
+ *     The guac_rdp_rdpgfx module associated with the RDPGFX channel.
+ *
+ * @param slot
+ *     The cache slot which must be contained within the cache array. This
+ *     slot must not exceed GUAC_RDP_RDPGFX_CACHE_SLOTS.
+ *
+ * @return
+ *     Zero if the cache array contains the given slot, non-zero if the array
+ *     could not be grown.
+ */
+static int guac_rdp_rdpgfx_cache_reserve(guac_rdp_rdpgfx* rdpgfx, int slot) {
+
+    if (slot < rdpgfx->cache_size)
+        return 0;
+
+    int new_size = rdpgfx->cache_size ? rdpgfx->cache_size : 64;
+    while (new_size <= slot)
+        new_size *= 2;
+
+    if (new_size > GUAC_RDP_RDPGFX_CACHE_SLOTS + 1)
+        new_size = GUAC_RDP_RDPGFX_CACHE_SLOTS + 1;
+
+    guac_common_display_layer** cache = realloc(rdpgfx->cache,
+            new_size * sizeof(guac_common_display_layer*));
+    if (cache == NULL)
+        return 1;
+
+    memset(cache + rdpgfx->cache_size, 0,
+            (new_size - rdpgfx->cache_size) * sizeof(guac_common_display_layer*));
+
+    rdpgfx->cache = cache;
+    rdpgfx->cache_size = new_size;
+    return 0;
+
+}
+
+/**
+ * Handler for the RDPGFX SolidFill command which, in addition to invoking
+ * the handler provided by FreeRDP's GDI implementation, sends each fill to
+ * the client as a Guacamole "rect" instruction.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param solid_fill
+ *     The received SolidFill command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_solid_fill(RdpgfxClientContext* context,
+        const RDPGFX_SOLID_FILL_PDU* solid_fill) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+
+    UINT status = rdpgfx->SolidFill(context, solid_fill);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    guac_common_display* display = guac_rdp_rdpgfx_get_display(rdpgfx);
+    if (display == NULL)
+        return CHANNEL_RC_OK;
+
+    int x, y;
+    RECTANGLE_16 bounds;
+    if (!guac_rdp_rdpgfx_get_output_location(context, solid_fill->surfaceId,
+                &x, &y, &bounds))
+        return CHANNEL_RC_OK;
+
+    const RDPGFX_COLOR32* color = &solid_fill->fillPixel;
+
+    int i;
+    for (i = 0; i < solid_fill->fillRectCount; i++) {
+
+        RECTANGLE_16 rect = solid_fill->fillRects[i];
+        if (!guac_rdp_rdpgfx_constrain(&rect, &bounds))
+            continue;
+
+        /* Surface pixels are always opaque in the output */
+        guac_common_surface_set(display->default_surface,
+                x + rect.left, y + rect.top,
+                rect.right - rect.left, rect.bottom - rect.top,
+                color->R, color->G, color->B, 0xFF);
+
+    }
+
+    return CHANNEL_RC_OK;
+
+}
+
+/**
+ * Handler for the RDPGFX SurfaceToSurface command which, in addition to
+ * invoking the handler provided by FreeRDP's GDI implementation, sends each
+ * copy to the client as a Guacamole "copy" instruction.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_to_surface
+ *     The received SurfaceToSurface command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_surface_to_surface(RdpgfxClientContext* context,
+        const RDPGFX_SURFACE_TO_SURFACE_PDU* surface_to_surface) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+
+    UINT status = rdpgfx->SurfaceToSurface(context, surface_to_surface);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    guac_common_display* display = guac_rdp_rdpgfx_get_display(rdpgfx);
+    if (display == NULL)
+        return CHANNEL_RC_OK;
+
+    int src_x, src_y, dst_x, dst_y;
+    RECTANGLE_16 src_bounds, dst_bounds;
+    if (!guac_rdp_rdpgfx_get_output_location(context,
+                surface_to_surface->surfaceIdSrc, &src_x, &src_y, &src_bounds)
+        || !guac_rdp_rdpgfx_get_output_location(context,
+                surface_to_surface->surfaceIdDest, &dst_x, &dst_y, &dst_bounds))
+        return CHANNEL_RC_OK;
+
+    RECTANGLE_16 src = surface_to_surface->rectSrc;
+    if (!guac_rdp_rdpgfx_constrain(&src, &src_bounds))
+        return CHANNEL_RC_OK;
+
+    /* Copies are performed in output coordinates, and are clipped by the
+     * default surface */
+    int i;
+    for (i = 0; i < surface_to_surface->destPtsCount; i++) {
+        const RDPGFX_POINT16* point = &surface_to_surface->destPts[i];
+        guac_common_surface_copy(display->default_surface,
+                src_x + src.left, src_y + src.top,
+                src.right - src.left, src.bottom - src.top,
+                display->default_surface,
+                dst_x + point->x + src.left - surface_to_surface->rectSrc.left,
+                dst_y + point->y + src.top - surface_to_surface->rectSrc.top);
+    }
+
+    return CHANNEL_RC_OK;
+
+}
+
+/**
+ * Handler for the RDPGFX SurfaceToCache command which, in addition to
+ * invoking the handler provided by FreeRDP's GDI implementation, copies the
+ * cached region into a Guacamole buffer dedicated to the cache slot, if the
+ * source surface is visible and the total size of all such buffers would not
+ * exceed GUAC_RDP_RDPGFX_CACHE_MAX_PIXELS. The cached region of the default
+ * surface is first brought up to date with the RDPGFX surface, such that the
+ * buffer contains exactly the pixels cached by FreeRDP.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_to_cache
+ *     The received SurfaceToCache command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_surface_to_cache(RdpgfxClientContext* context,
+        const RDPGFX_SURFACE_TO_CACHE_PDU* surface_to_cache) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+
+    UINT status = rdpgfx->SurfaceToCache(context, surface_to_cache);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    guac_common_display* display = guac_rdp_rdpgfx_get_display(rdpgfx);
+    if (display == NULL)
+        return CHANNEL_RC_OK;
+
+    int slot = surface_to_cache->cacheSlot;
+    if (slot > GUAC_RDP_RDPGFX_CACHE_SLOTS)
+        return CHANNEL_RC_OK;
+
+    /* Any previous contents of the slot are now invalid */
+    guac_rdp_rdpgfx_cache_clear(rdpgfx, display, slot);
+
+    int x, y;
+    RECTANGLE_16 bounds;
+    if (!guac_rdp_rdpgfx_get_output_location(context,
+                surface_to_cache->surfaceId, &x, &y, &bounds))
+        return CHANNEL_RC_OK;
+
+    /* Only entire cache entries can be mirrored */
+    RECTANGLE_16 rect = surface_to_cache->rectSrc;
+    if (!guac_rdp_rdpgfx_constrain(&rect, &bounds)
+            || memcmp(&rect, &surface_to_cache->rectSrc, sizeof(rect)) != 0)
+        return CHANNEL_RC_OK;
+
+    int width = rect.right - rect.left;
+    int height = rect.bottom - rect.top;
+
+    /* Leave remaining entries to FreeRDP if out of space */
+    if (rdpgfx->cached_pixels + width * height
+            > GUAC_RDP_RDPGFX_CACHE_MAX_PIXELS
+            || guac_rdp_rdpgfx_cache_reserve(rdpgfx, slot))
+        return CHANNEL_RC_OK;
+
+    /* The cached region may have been modified earlier in the current frame,
+     * in which case the default surface does not yet reflect its contents */
+    gdiGfxSurface* surface = (gdiGfxSurface*) context->GetSurfaceData(context,
+            surface_to_cache->surfaceId);
+
+    if (surface->format == PIXEL_FORMAT_BGRX32
+            || surface->format == PIXEL_FORMAT_BGRA32) {
+
+        cairo_surface_t* image = cairo_image_surface_create_for_data(
+                surface->data + 4 * rect.left + rect.top * surface->scanline,
+                CAIRO_FORMAT_RGB24, width, height, surface->scanline);
+
+        guac_common_surface_draw(display->default_surface,
+                x + rect.left, y + rect.top, image);
+
+        cairo_surface_destroy(image);
+
+    }
+
+    guac_common_display_layer* buffer =
+        guac_common_display_alloc_buffer(display, width, height);
+
+    guac_common_surface_copy(display->default_surface,
+            x + rect.left, y + rect.top, width, height,
+            buffer->surface, 0, 0);
+
+    rdpgfx->cache[slot] = buffer;
+    rdpgfx->cached_pixels += width * height;
+
+    return CHANNEL_RC_OK;
+
+}
+
+/**
+ * Handler for the RDPGFX CacheToSurface command which, in addition to
+ * invoking the handler provided by FreeRDP's GDI implementation, sends each
+ * copy to the client as a Guacamole "copy" instruction from the buffer
+ * dedicated to the cache slot, if any.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param cache_to_surface
+ *     The received CacheToSurface command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_cache_to_surface(RdpgfxClientContext* context,
+        const RDPGFX_CACHE_TO_SURFACE_PDU* cache_to_surface) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+
+    UINT status = rdpgfx->CacheToSurface(context, cache_to_surface);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    guac_common_display* display = guac_rdp_rdpgfx_get_display(rdpgfx);
+    if (display == NULL)
+        return CHANNEL_RC_OK;
+
+    int slot = cache_to_surface->cacheSlot;
+    if (slot >= rdpgfx->cache_size || rdpgfx->cache[slot] == NULL)
+        return CHANNEL_RC_OK;
+
+    int x, y;
+    RECTANGLE_16 bounds;
+    if (!guac_rdp_rdpgfx_get_output_location(context,
+                cache_to_surface->surfaceId, &x, &y, &bounds))
+        return CHANNEL_RC_OK;
+
+    guac_common_surface* cached = rdpgfx->cache[slot]->surface;
+
+    int i;
+    for (i = 0; i < cache_to_surface->destPtsCount; i++) {
+
+        const RDPGFX_POINT16* point = &cache_to_surface->destPts[i];
+
+        RECTANGLE_16 rect = {
+            .left   = point->x,
+            .top    = point->y,
+            .right  = point->x + cached->width,
+            .bottom = point->y + cached->height
+        };
+
+        if (!guac_rdp_rdpgfx_constrain(&rect, &bounds))
+            continue;
+
+        guac_common_surface_copy(cached,
+                rect.left - point->x, rect.top - point->y,
+                rect.right - rect.left, rect.bottom - rect.top,
+                display->default_surface, x + rect.left, y + rect.top);
+
+    }
+
+    return CHANNEL_RC_OK;
+
+}
+
+/**
+ * Handler for the RDPGFX EvictCacheEntry command which, in addition to
+ * invoking the handler provided by FreeRDP's GDI implementation, frees the
+ * buffer dedicated to the cache slot, if any.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param evict_cache_entry
+ *     The received EvictCacheEntry command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_evict_cache_entry(RdpgfxClientContext* context,
+        const RDPGFX_EVICT_CACHE_ENTRY_PDU* evict_cache_entry) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    int slot = evict_cache_entry->cacheSlot;
+    guac_rdp_rdpgfx_cache_clear(rdpgfx, rdp_client->display, slot);
+
+    return rdpgfx->EvictCacheEntry(context, evict_cache_entry);
+
+}
+
+/**
+ * Handler for the RDPGFX ResetGraphics command which, in addition to
+ * invoking the handler provided by FreeRDP's GDI implementation, frees all
+ * buffers dedicated to cache slots, as FreeRDP's cache is also cleared.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param reset_graphics
+ *     The received ResetGraphics command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if successful, an error code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_reset_graphics(RdpgfxClientContext* context,
+        const RDPGFX_RESET_GRAPHICS_PDU* reset_graphics) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    guac_rdp_rdpgfx_cache_clear_all(rdpgfx, rdp_client->display);
+
+    return rdpgfx->ResetGraphics(context, reset_graphics);
+
+}
+
 /**
  * Callback which associates handlers specific to Guacamole with the
  * RdpgfxClientContext instance allocated by FreeRDP to deal with received
@@ -62,12 +617,40 @@ static void guac_rdp_rdpgfx_channel_connected(rdpContext* context,
     RdpgfxClientContext* rdpgfx = (RdpgfxClientContext*) args->pInterface;
     rdpGdi* gdi = context->gdi;
 
-    if (!gdi_graphics_pipeline_init(gdi, rdpgfx))
+    if (!gdi_graphics_pipeline_init(gdi, rdpgfx)) {
         guac_client_log(client, GUAC_LOG_WARNING, "Rendering backend for RDPGFX "
                 "channel could not be loaded. Graphics may not render at all!");
-    else
-        guac_client_log(client, GUAC_LOG_DEBUG, "RDPGFX channel will be used for "
-                "the RDP Graphics Pipeline Extension.");
+        return;
+    }
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "RDPGFX channel will be used for "
+            "the RDP Graphics Pipeline Extension.");
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_rdpgfx* guac_rdpgfx = rdp_client->rdpgfx;
+
+    /* Any cache entries from a previous connection were freed along with
+     * that connection's display */
+    free(guac_rdpgfx->cache);
+    guac_rdpgfx->cache = NULL;
+    guac_rdpgfx->cache_size = 0;
+    guac_rdpgfx->cached_pixels = 0;
+
+    /* Mirror simple commands to the client in addition to rendering them
+     * with FreeRDP's GDI implementation */
+    guac_rdpgfx->SolidFill = rdpgfx->SolidFill;
+    guac_rdpgfx->SurfaceToSurface = rdpgfx->SurfaceToSurface;
+    guac_rdpgfx->SurfaceToCache = rdpgfx->SurfaceToCache;
+    guac_rdpgfx->CacheToSurface = rdpgfx->CacheToSurface;
+    guac_rdpgfx->EvictCacheEntry = rdpgfx->EvictCacheEntry;
+    guac_rdpgfx->ResetGraphics = rdpgfx->ResetGraphics;
+
+    rdpgfx->SolidFill = guac_rdp_rdpgfx_solid_fill;
+    rdpgfx->SurfaceToSurface = guac_rdp_rdpgfx_surface_to_surface;
+    rdpgfx->SurfaceToCache = guac_rdp_rdpgfx_surface_to_cache;
+    rdpgfx->CacheToSurface = guac_rdp_rdpgfx_cache_to_surface;
+    rdpgfx->EvictCacheEntry = guac_rdp_rdpgfx_evict_cache_entry;
+    rdpgfx->ResetGraphics = guac_rdp_rdpgfx_reset_graphics;
 
 }
 
@@ -96,6 +679,10 @@ static void guac_rdp_rdpgfx_channel_disconnected(rdpContext* context,
     if (strcmp(args->name, RDPGFX_DVC_CHANNEL_NAME) != 0)
         return;
 
+    /* Free any buffers mirroring cache entries */
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_rdpgfx_cache_clear_all(rdp_client->rdpgfx, rdp_client->display);
+
     /* Un-init GDI-backed support for the Graphics Pipeline */
     RdpgfxClientContext* rdpgfx = (RdpgfxClientContext*) args->pInterface;
     rdpGdi* gdi = context->gdi;
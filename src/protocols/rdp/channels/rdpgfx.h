@@ -20,19 +20,129 @@
 #ifndef GUAC_RDP_CHANNELS_RDPGFX_H
 #define GUAC_RDP_CHANNELS_RDPGFX_H
 
+#include "common/display.h"
 #include "settings.h"
 
 #include <freerdp/client/rdpgfx.h>
 #include <freerdp/freerdp.h>
 #include <guacamole/client.h>
 
+/**
+ * The number of RDPGFX bitmap cache slots which may be tracked. This is the
+ * maximum number of cache slots permitted by the RDPGFX specification (for
+ * RDPGFX version 8.0 and later).
+ */
+#define GUAC_RDP_RDPGFX_CACHE_SLOTS 25600
+
+/**
+ * The maximum total number of pixels which may be held in Guacamole buffers
+ * representing RDPGFX cache slots at any one time. Cache entries received
+ * once this limit is reached are handled by FreeRDP alone, and their contents
+ * are sent as image data when drawn, as if not cached. At 32 bits per pixel,
+ * this limits the buffers backing the cache to 16 MB per connection.
+ */
+#define GUAC_RDP_RDPGFX_CACHE_MAX_PIXELS (2048 * 2048)
+
+/**
+ * RDPGFX (Graphics Pipeline) module. FreeRDP renders all RDPGFX commands into
+ * its GDI framebuffer, the changed regions of which are then copied into the
+ * default surface at the end of each frame. To avoid re-encoding pixels whose
+ * values are already known to the client, this module additionally mirrors
+ * the RDPGFX SolidFill, SurfaceToSurface, SurfaceToCache and CacheToSurface
+ * commands as Guacamole "rect" and "copy" instructions, such that only pixels
+ * that still differ at the end of the frame need be sent as images.
+ */
+typedef struct guac_rdp_rdpgfx {
+
+    /**
+     * The guac_client instance handling the relevant RDP connection.
+     */
+    guac_client* client;
+
+    /**
+     * The SolidFill handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxSolidFill SolidFill;
+
+    /**
+     * The SurfaceToSurface handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxSurfaceToSurface SurfaceToSurface;
+
+    /**
+     * The SurfaceToCache handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxSurfaceToCache SurfaceToCache;
+
+    /**
+     * The CacheToSurface handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxCacheToSurface CacheToSurface;
+
+    /**
+     * The EvictCacheEntry handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxEvictCacheEntry EvictCacheEntry;
+
+    /**
+     * The ResetGraphics handler assigned by FreeRDP's GDI implementation.
+     */
+    pcRdpgfxResetGraphics ResetGraphics;
+
+    /**
+     * The Guacamole buffer containing the contents of each RDPGFX cache slot,
+     * indexed by slot. Slots which are empty, or whose contents are known
+     * only to FreeRDP, are NULL. This array is grown only as far as the
+     * highest slot actually used by the RDP server, and is NULL if no slots
+     * have yet been used.
+     */
+    guac_common_display_layer** cache;
+
+    /**
+     * The number of entries currently allocated within the cache array. Slots
+     * at or beyond this index are implicitly empty.
+     */
+    int cache_size;
+
+    /**
+     * The total number of pixels within all buffers in the cache array.
+     */
+    int cached_pixels;
+
+} guac_rdp_rdpgfx;
+
+/**
+ * Allocates a new RDPGFX module which will ultimately augment FreeRDP's
+ * handling of the RDP Graphics Pipeline once guac_rdp_rdpgfx_load_plugin() is
+ * invoked.
+ *
+ * @param client
+ *     The guac_client instance handling the relevant RDP connection.
+ *
+ * @return
+ *     A newly-allocated RDPGFX module.
+ */
+guac_rdp_rdpgfx* guac_rdp_rdpgfx_alloc(guac_client* client);
+
+/**
+ * Frees the resources associated with the given RDPGFX module. Any Guacamole
+ * buffers representing cache slots must already have been freed, as happens
+ * automatically when the RDPGFX channel disconnects.
+ *
+ * @param rdpgfx
+ *     The RDPGFX module to free.
+ */
+void guac_rdp_rdpgfx_free(guac_rdp_rdpgfx* rdpgfx);
+
 /**
  * Adds FreeRDP's "rdpgfx" plugin to the list of dynamic virtual channel plugins
  * to be loaded by FreeRDP's "drdynvc" plugin. The context of the plugin will
  * automatically be associated with the guac_rdp_rdpgfx instance pointed to by the
  * current guac_rdp_client. The plugin will only be loaded once the "drdynvc"
  * plugin is loaded. The "rdpgfx" plugin ultimately adds support for the RDP
- * Graphics Pipeline Extension.
+ * Graphics Pipeline Extension. Unless the display surface is bound directly
+ * to the GDI framebuffer, simple RDPGFX commands are additionally mirrored to
+ * the client by the guac_rdp_rdpgfx module of the current guac_rdp_client.
  *
  * If failures occur, messages noting the specifics of those failures will be
  * logged.
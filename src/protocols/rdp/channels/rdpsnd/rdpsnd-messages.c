@@ -337,12 +337,12 @@ void guac_rdpsnd_wave_handler(guac_rdp_common_svc* svc,
     /* Copy over first four bytes */
     memcpy(buffer, rdpsnd->initial_wave_data, 4);
 
-    /* Write rest of audio packet */
-    if (audio != NULL) {
+    /* Write rest of audio packet, leaving the audio stream to decide when
+     * to send accumulated audio (any partial packet is sent automatically if
+     * no further wave data follows) */
+    if (audio != NULL)
         guac_audio_stream_write_pcm(audio, buffer,
                 rdpsnd->incoming_wave_size + 4);
-        guac_audio_stream_flush(audio);
-    }
 
     /* Write Wave Confirmation PDU */
     Stream_Write_UINT8(output_stream, SNDC_WAVECONFIRM);
@@ -363,7 +363,11 @@ void guac_rdpsnd_wave_handler(guac_rdp_common_svc* svc,
 void guac_rdpsnd_close_handler(guac_rdp_common_svc* svc,
         wStream* input_stream, guac_rdpsnd_pdu_header* header) {
 
-    /* Do nothing */
+    guac_rdp_client* rdp_client = (guac_rdp_client*) svc->client->data;
+
+    /* Send any remaining audio, as no further audio is expected */
+    if (rdp_client->audio != NULL)
+        guac_audio_stream_flush(rdp_client->audio);
 
 }
 
@@ -21,6 +21,7 @@
 #include "channels/audio-input/audio-buffer.h"
 #include "channels/cliprdr.h"
 #include "channels/disp.h"
+#include "common/list.h"
 #include "config.h"
 #include "fs.h"
 #include "log.h"
@@ -141,15 +142,18 @@ int guac_client_init(guac_client* client, int argc, char** argv) {
     guac_rdp_client* rdp_client = calloc(1, sizeof(guac_rdp_client));
     client->data = rdp_client;
 
-    /* Init clipboard */
-    rdp_client->clipboard = guac_rdp_clipboard_alloc(client);
-
     /* Init display update module */
     rdp_client->disp = guac_rdp_disp_alloc(client);
 
     /* Init multi-touch support module (RDPEI) */
     rdp_client->rdpei = guac_rdp_rdpei_alloc(client);
 
+    /* Init Graphics Pipeline support module (RDPGFX) */
+    rdp_client->rdpgfx = guac_rdp_rdpgfx_alloc(client);
+
+    /* Init list of uploads in progress */
+    rdp_client->uploads = guac_common_list_alloc();
+
     /* Redirect FreeRDP log messages to guac_client_log() */
     guac_rdp_redirect_wlog(client);
 
@@ -195,10 +199,16 @@ int guac_rdp_client_free_handler(guac_client* client) {
     /* Free multi-touch support module (RDPEI) */
     guac_rdp_rdpei_free(rdp_client->rdpei);
 
+    /* Free Graphics Pipeline support module (RDPGFX) */
+    guac_rdp_rdpgfx_free(rdp_client->rdpgfx);
+
     /* Clean up filesystem, if allocated */
     if (rdp_client->filesystem != NULL)
         guac_rdp_fs_free(rdp_client->filesystem);
 
+    /* All uploads are aborted as their users leave */
+    guac_common_list_free(rdp_client->uploads);
+
     /* End active print job, if any */
     guac_rdp_print_job* job = (guac_rdp_print_job*) rdp_client->active_job;
     if (job != NULL) {
@@ -17,7 +17,7 @@
  * under the License.
  */
 
-#include "common/json.h"
+#include "common/download.h"
 #include "download.h"
 #include "fs.h"
 #include "ls.h"
@@ -28,7 +28,6 @@
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
 #include <guacamole/stream.h>
-#include <guacamole/string.h>
 #include <guacamole/user.h>
 #include <winpr/file.h>
 #include <winpr/nt.h>
@@ -36,61 +35,79 @@
 
 #include <stdlib.h>
 
-int guac_rdp_download_ack_handler(guac_user* user, guac_stream* stream,
-        char* message, guac_protocol_status status) {
+int guac_rdp_download_read_handler(guac_user* user, void* data,
+        char* buffer, int length) {
 
     guac_client* client = user->client;
     guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
-    guac_rdp_download_status* download_status = (guac_rdp_download_status*) stream->data;
+    guac_rdp_download_status* download_status =
+        (guac_rdp_download_status*) data;
 
-    /* Get filesystem, return error if no filesystem */
+    /* Fail if filesystem has been unloaded */
     guac_rdp_fs* fs = rdp_client->filesystem;
-    if (fs == NULL) {
-        guac_protocol_send_ack(user->socket, stream, "FAIL (NO FS)",
-                GUAC_PROTOCOL_STATUS_SERVER_ERROR);
-        guac_socket_flush(user->socket);
-        return 0;
-    }
+    if (fs == NULL)
+        return -1;
 
-    /* If successful, read data */
-    if (status == GUAC_PROTOCOL_STATUS_SUCCESS) {
-
-        /* Attempt read into buffer */
-        char buffer[4096];
-        int bytes_read = guac_rdp_fs_read(fs,
-                download_status->file_id,
-                download_status->offset, buffer, sizeof(buffer));
-
-        /* If bytes read, send as blob */
-        if (bytes_read > 0) {
-            download_status->offset += bytes_read;
-            guac_protocol_send_blob(user->socket, stream,
-                    buffer, bytes_read);
-        }
-
-        /* If EOF, send end */
-        else if (bytes_read == 0) {
-            guac_protocol_send_end(user->socket, stream);
-            guac_user_free_stream(user, stream);
-            free(download_status);
-        }
-
-        /* Otherwise, fail stream */
-        else {
-            guac_user_log(user, GUAC_LOG_ERROR,
-                    "Error reading file for download");
-            guac_protocol_send_end(user->socket, stream);
-            guac_user_free_stream(user, stream);
-            free(download_status);
-        }
+    int bytes_read = guac_rdp_fs_read(fs, download_status->file_id,
+            download_status->offset, buffer, length);
 
-        guac_socket_flush(user->socket);
+    if (bytes_read > 0)
+        download_status->offset += bytes_read;
 
-    }
+    return bytes_read;
 
-    /* Otherwise, return stream to user */
-    else
+}
+
+void guac_rdp_download_end_handler(guac_user* user, void* data,
+        int success) {
+
+    guac_client* client = user->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_download_status* download_status =
+        (guac_rdp_download_status*) data;
+
+    /* Close file if filesystem is still loaded */
+    guac_rdp_fs* fs = rdp_client->filesystem;
+    if (fs != NULL)
+        guac_rdp_fs_close(fs, download_status->file_id);
+
+    free(download_status);
+
+}
+
+/**
+ * Prepares the given stream to send the contents of the file having the
+ * given ID once the stream has been announced to the user.
+ *
+ * @param user
+ *     The user that will receive the file.
+ *
+ * @param stream
+ *     The stream over which the file should be sent.
+ *
+ * @param file_id
+ *     The ID of the open file to send.
+ *
+ * @return
+ *     Zero on success, non-zero if the download could not be prepared, in
+ *     which case the stream has been freed.
+ */
+static int guac_rdp_download_begin(guac_user* user, guac_stream* stream,
+        int file_id) {
+
+    guac_rdp_download_status* download_status =
+        malloc(sizeof(guac_rdp_download_status));
+    download_status->file_id = file_id;
+    download_status->offset = 0;
+
+    if (guac_common_download_begin(user, stream,
+                GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW,
+                guac_rdp_download_read_handler,
+                guac_rdp_download_end_handler, download_status)) {
+        guac_rdp_download_end_handler(user, download_status, 0);
         guac_user_free_stream(user, stream);
+        return 1;
+    }
 
     return 0;
 
@@ -127,21 +144,10 @@ int guac_rdp_download_get_handler(guac_user* user, guac_object* object,
     /* If directory, send contents of directory */
     if (file->attributes & FILE_ATTRIBUTE_DIRECTORY) {
 
-        /* Create stream data */
-        guac_rdp_ls_status* ls_status = malloc(sizeof(guac_rdp_ls_status));
-        ls_status->fs = fs;
-        ls_status->file_id = file_id;
-        guac_strlcpy(ls_status->directory_name, name,
-                sizeof(ls_status->directory_name));
-
         /* Allocate stream for body */
         guac_stream* stream = guac_user_alloc_stream(user);
-        stream->ack_handler = guac_rdp_ls_ack_handler;
-        stream->data = ls_status;
-
-        /* Init JSON object state */
-        guac_common_json_begin_object(user, stream,
-                &ls_status->json_state);
+        if (guac_rdp_ls_begin(user, stream, fs, file_id, name))
+            return 0;
 
         /* Associate new stream with get request */
         guac_protocol_send_body(user->socket, object, stream,
@@ -152,15 +158,10 @@ int guac_rdp_download_get_handler(guac_user* user, guac_object* object,
     /* Otherwise, send file contents if downloads are allowed */
     else if (!fs->disable_download) {
 
-        /* Create stream data */
-        guac_rdp_download_status* download_status = malloc(sizeof(guac_rdp_download_status));
-        download_status->file_id = file_id;
-        download_status->offset = 0;
-
         /* Allocate stream for body */
         guac_stream* stream = guac_user_alloc_stream(user);
-        stream->data = download_status;
-        stream->ack_handler = guac_rdp_download_ack_handler;
+        if (guac_rdp_download_begin(user, stream, file_id))
+            return 0;
 
         /* Associate new stream with get request */
         guac_protocol_send_body(user->socket, object, stream,
@@ -209,11 +210,8 @@ void* guac_rdp_download_to_user(guac_user* user, void* data) {
 
         /* Associate stream with transfer status */
         guac_stream* stream = guac_user_alloc_stream(user);
-        guac_rdp_download_status* download_status = malloc(sizeof(guac_rdp_download_status));
-        stream->data = download_status;
-        stream->ack_handler = guac_rdp_download_ack_handler;
-        download_status->file_id = file_id;
-        download_status->offset = 0;
+        if (guac_rdp_download_begin(user, stream, file_id))
+            return NULL;
 
         guac_user_log(user, GUAC_LOG_DEBUG, "%s: Initiating download "
                 "of \"%s\"", __func__, path);
@@ -20,7 +20,7 @@
 #ifndef GUAC_RDP_DOWNLOAD_H
 #define GUAC_RDP_DOWNLOAD_H
 
-#include "common/json.h"
+#include "common/download.h"
 
 #include <guacamole/protocol.h>
 #include <guacamole/stream.h>
@@ -46,9 +46,17 @@ typedef struct guac_rdp_download_status {
 } guac_rdp_download_status;
 
 /**
- * Handler for acknowledgements of receipt of data related to file downloads.
+ * Handler which reads the next chunk of a file being downloaded. The data
+ * associated with the download must be a guac_rdp_download_status, which is
+ * updated with the new position within the file.
  */
-guac_user_ack_handler guac_rdp_download_ack_handler;
+guac_common_download_read_handler guac_rdp_download_read_handler;
+
+/**
+ * Handler which closes a downloaded file and frees its associated
+ * guac_rdp_download_status once the download has ended.
+ */
+guac_common_download_end_handler guac_rdp_download_end_handler;
 
 /**
  * Handler for get messages. In context of downloads and the filesystem exposed
@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include "common/listing.h"
 #include "fs.h"
 #include "download.h"
 #include "upload.h"
@@ -35,6 +36,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <fnmatch.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -67,12 +69,37 @@ guac_rdp_fs* guac_rdp_fs_alloc(guac_client* client, const char* drive_path,
     fs->open_files = 0;
     fs->disable_download = disable_download;
     fs->disable_upload = disable_upload;
+    fs->listing_cache = guac_common_listing_cache_alloc();
+    pthread_mutex_init(&(fs->lock), NULL);
+    pthread_cond_init(&(fs->prefetch_modified), NULL);
+    fs->prefetch_length = 0;
+    fs->prefetch_started = 0;
+    fs->prefetch_stopping = 0;
+
+    /* No files are yet open */
+    for (int i = 0; i < GUAC_RDP_FS_MAX_FILES; i++) {
+        fs->files[i].fd = -1;
+        fs->files[i].read_ahead_generation = 0;
+    }
 
     return fs;
 
 }
 
 void guac_rdp_fs_free(guac_rdp_fs* fs) {
+
+    /* Stop prefetching directory listings */
+    pthread_mutex_lock(&(fs->lock));
+    fs->prefetch_stopping = 1;
+    pthread_cond_broadcast(&(fs->prefetch_modified));
+    pthread_mutex_unlock(&(fs->lock));
+
+    if (fs->prefetch_started)
+        pthread_join(fs->prefetch_thread, NULL);
+
+    pthread_cond_destroy(&(fs->prefetch_modified));
+    pthread_mutex_destroy(&(fs->lock));
+    guac_common_listing_cache_free(fs->listing_cache);
     guac_pool_free(fs->file_id_pool);
     free(fs->drive_path);
     free(fs);
@@ -230,7 +257,11 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
             create_disposition, create_options);
 
     /* If no files available, return too many open */
-    if (fs->open_files >= GUAC_RDP_FS_MAX_FILES) {
+    pthread_mutex_lock(&(fs->lock));
+    int open_files = fs->open_files;
+    pthread_mutex_unlock(&(fs->lock));
+
+    if (open_files >= GUAC_RDP_FS_MAX_FILES) {
         guac_client_log(fs->client, GUAC_LOG_DEBUG,
                 "%s: Too many open files.",
                 __func__, path);
@@ -359,6 +390,21 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
         return guac_rdp_fs_get_errorcode(errno);
     }
 
+    /* Attempt to pull file information */
+    int stat_failed = fstat(fd, &file_stat);
+
+    pthread_mutex_lock(&(fs->lock));
+
+    /* Other files may have been opened since the check above */
+    if (fs->open_files >= GUAC_RDP_FS_MAX_FILES) {
+        pthread_mutex_unlock(&(fs->lock));
+        close(fd);
+        guac_client_log(fs->client, GUAC_LOG_DEBUG,
+                "%s: Too many open files.",
+                __func__, path);
+        return GUAC_RDP_FS_ENFILE;
+    }
+
     /* Get file ID, init file */
     file_id = guac_pool_next_int(fs->file_id_pool);
     file = &(fs->files[file_id]);
@@ -369,15 +415,17 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
     file->absolute_path = strdup(normalized_path);
     file->real_path = strdup(real_path);
     file->bytes_written = 0;
+    file->read_ahead = NULL;
+    file->read_ahead_size = 0;
+    file->read_ahead_offset = 0;
+    file->read_ahead_length = 0;
+    file->next_read_offset = UINT64_MAX;
 
-    guac_client_log(fs->client, GUAC_LOG_DEBUG,
-            "%s: Opened \"%s\" as file_id=%i",
-            __func__, normalized_path, file_id);
-
-    /* Attempt to pull file information */
-    if (fstat(fd, &file_stat) == 0) {
+    /* Load identity, size and times, if available */
+    if (!stat_failed) {
 
-        /* Load size and times */
+        file->device = file_stat.st_dev;
+        file->inode = file_stat.st_ino;
         file->size  = file_stat.st_size;
         file->ctime = WINDOWS_TIME(file_stat.st_ctime);
         file->mtime = WINDOWS_TIME(file_stat.st_mtime);
@@ -395,6 +443,8 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
     else {
 
         /* Init information to 0, lacking any alternative */
+        file->device = 0;
+        file->inode = 0;
         file->size  = 0;
         file->ctime = 0;
         file->mtime = 0;
@@ -405,6 +455,19 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
 
     fs->open_files++;
 
+    pthread_mutex_unlock(&(fs->lock));
+
+    guac_client_log(fs->client, GUAC_LOG_DEBUG,
+            "%s: Opened \"%s\" as file_id=%i",
+            __func__, normalized_path, file_id);
+
+    /* Listing of containing directory may differ if file may have been
+     * created */
+    if (create_disposition != FILE_OPEN
+            && create_disposition != FILE_OVERWRITE)
+        guac_common_listing_cache_invalidate(fs->listing_cache,
+                normalized_path);
+
     return file_id;
 
 }
@@ -421,18 +484,163 @@ int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
-    /* Attempt read */
-    lseek(file->fd, offset, SEEK_SET);
-    bytes_read = read(file->fd, buffer, length);
+    pthread_mutex_lock(&(fs->lock));
 
-    /* Translate errno on error */
-    if (bytes_read < 0)
-        return guac_rdp_fs_get_errorcode(errno);
+    int fd = file->fd;
+    unsigned int generation = file->read_ahead_generation;
+
+    /* Data read ahead is useful only while reads remain sequential */
+    if (offset != file->next_read_offset) {
+        free(file->read_ahead);
+        file->read_ahead = NULL;
+        file->read_ahead_size = 0;
+        file->read_ahead_length = 0;
+    }
+
+    /* Otherwise, if the data read ahead has been exhausted, read further
+     * ahead, doubling the amount read ahead each time */
+    else if (offset < file->read_ahead_offset
+            || offset + length > file->read_ahead_offset
+                               + file->read_ahead_length) {
+
+        int size = GUAC_RDP_FS_READ_AHEAD_MIN_SIZE;
+        if (file->read_ahead_size > 0)
+            size = file->read_ahead_size * 2;
+
+        if (size > GUAC_RDP_FS_READ_AHEAD_MAX_SIZE)
+            size = GUAC_RDP_FS_READ_AHEAD_MAX_SIZE;
+
+        /* Reads as large as the read-ahead buffer gain nothing from it */
+        if (length < size) {
+
+            /* Take ownership of the read-ahead buffer while reading into it
+             * without the lock, such that the buffer cannot be freed or
+             * refilled concurrently */
+            char* read_ahead = file->read_ahead;
+            int read_ahead_size = file->read_ahead_size;
+            file->read_ahead = NULL;
+            file->read_ahead_size = 0;
+            file->read_ahead_length = 0;
+
+            pthread_mutex_unlock(&(fs->lock));
+
+            if (size != read_ahead_size) {
+                char* resized = realloc(read_ahead, size);
+                if (resized != NULL) {
+                    read_ahead = resized;
+                    read_ahead_size = size;
+                }
+            }
+
+            int bytes_read_ahead = -1;
+            if (read_ahead != NULL)
+                bytes_read_ahead = pread(fd, read_ahead, read_ahead_size,
+                        offset);
+
+            /* Translate errno on error */
+            int error = errno;
+
+            pthread_mutex_lock(&(fs->lock));
+
+            /* Keep the data read ahead only if the file has been neither
+             * modified nor closed in the meantime */
+            if (file->read_ahead_generation == generation
+                    && file->read_ahead == NULL) {
+                file->read_ahead = read_ahead;
+                file->read_ahead_size = read_ahead_size;
+                file->read_ahead_offset = offset;
+                file->read_ahead_length =
+                    bytes_read_ahead > 0 ? bytes_read_ahead : 0;
+            }
+            else
+                free(read_ahead);
+
+            if (read_ahead != NULL && bytes_read_ahead < 0) {
+                pthread_mutex_unlock(&(fs->lock));
+                return guac_rdp_fs_get_errorcode(error);
+            }
+
+        }
+
+    }
 
+    /* Serve read from data read ahead, if possible. If the read-ahead buffer
+     * was just refilled and is short, the end of the file has been reached,
+     * and the read is also short. */
+    if (file->read_ahead != NULL && offset >= file->read_ahead_offset
+            && offset < file->read_ahead_offset + file->read_ahead_length) {
+
+        uint64_t available = file->read_ahead_offset
+                           + file->read_ahead_length - offset;
+
+        bytes_read = length;
+        if (bytes_read > available)
+            bytes_read = available;
+
+        memcpy(buffer, file->read_ahead + (offset - file->read_ahead_offset),
+                bytes_read);
+
+    }
+
+    /* Otherwise, read directly without holding the lock */
+    else {
+
+        pthread_mutex_unlock(&(fs->lock));
+        bytes_read = pread(fd, buffer, length, offset);
+
+        /* Translate errno on error */
+        if (bytes_read < 0)
+            return guac_rdp_fs_get_errorcode(errno);
+
+        pthread_mutex_lock(&(fs->lock));
+
+    }
+
+    /* Track the end of this read unless the file has since been modified or
+     * closed */
+    if (file->read_ahead_generation == generation)
+        file->next_read_offset = offset + bytes_read;
+
+    pthread_mutex_unlock(&(fs->lock));
     return bytes_read;
 
 }
 
+/**
+ * Discards all data read ahead for every open file which refers to the same
+ * underlying local file as the given file, including the given file itself.
+ * Data read ahead must be discarded in this way whenever the underlying file
+ * is modified, as the file may be open multiple times (for example, by the RDP
+ * server while an upload writes to the same file). Any read ahead which is in
+ * progress for those files is likewise discarded once complete.
+ *
+ * IMPORTANT: The lock of the filesystem MUST already be held when invoking
+ * this function.
+ *
+ * @param fs
+ *     The filesystem containing the given file.
+ *
+ * @param file
+ *     The file whose underlying local file has been or is about to be
+ *     modified.
+ */
+static void guac_rdp_fs_discard_read_ahead(guac_rdp_fs* fs,
+        guac_rdp_fs_file* file) {
+
+    for (int i = 0; i < GUAC_RDP_FS_MAX_FILES; i++) {
+
+        guac_rdp_fs_file* current = &(fs->files[i]);
+        if (current == file || (current->fd != -1
+                    && current->device == file->device
+                    && current->inode == file->inode)) {
+            current->read_ahead_length = 0;
+            current->read_ahead_generation++;
+        }
+
+    }
+
+}
+
 int guac_rdp_fs_write(guac_rdp_fs* fs, int file_id, uint64_t offset,
         void* buffer, int length) {
 
@@ -445,15 +653,25 @@ int guac_rdp_fs_write(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
+    pthread_mutex_lock(&(fs->lock));
+    int fd = file->fd;
+    pthread_mutex_unlock(&(fs->lock));
+
     /* Attempt write */
-    lseek(file->fd, offset, SEEK_SET);
-    bytes_written = write(file->fd, buffer, length);
+    bytes_written = pwrite(fd, buffer, length, offset);
 
     /* Translate errno on error */
     if (bytes_written < 0)
         return guac_rdp_fs_get_errorcode(errno);
 
+    pthread_mutex_lock(&(fs->lock));
+
+    /* Data read ahead, or being read ahead, may no longer match the file */
+    guac_rdp_fs_discard_read_ahead(fs, file);
+
     file->bytes_written += bytes_written;
+    pthread_mutex_unlock(&(fs->lock));
+
     return bytes_written;
 
 }
@@ -494,6 +712,12 @@ int guac_rdp_fs_rename(guac_rdp_fs* fs, int file_id,
         return guac_rdp_fs_get_errorcode(errno);
     }
 
+    /* Listings of both the old and new containing directories differ */
+    guac_common_listing_cache_invalidate(fs->listing_cache,
+            file->absolute_path);
+    guac_common_listing_cache_invalidate(fs->listing_cache,
+            normalized_path);
+
     return 0;
 
 }
@@ -524,6 +748,10 @@ int guac_rdp_fs_delete(guac_rdp_fs* fs, int file_id) {
         return guac_rdp_fs_get_errorcode(errno);
     }
 
+    /* Listing of containing directory differs */
+    guac_common_listing_cache_invalidate(fs->listing_cache,
+            file->absolute_path);
+
     return 0;
 
 }
@@ -546,6 +774,11 @@ int guac_rdp_fs_truncate(guac_rdp_fs* fs, int file_id, int length) {
         return guac_rdp_fs_get_errorcode(errno);
     }
 
+    /* Data read ahead, or being read ahead, may no longer match the file */
+    pthread_mutex_lock(&(fs->lock));
+    guac_rdp_fs_discard_read_ahead(fs, file);
+    pthread_mutex_unlock(&(fs->lock));
+
     return 0;
 
 }
@@ -560,18 +793,24 @@ void guac_rdp_fs_close(guac_rdp_fs* fs, int file_id) {
         return;
     }
 
-    file = &(fs->files[file_id]);
-
     guac_client_log(fs->client, GUAC_LOG_DEBUG,
             "%s: Closed \"%s\" (file_id=%i)",
             __func__, file->absolute_path, file_id);
 
+    pthread_mutex_lock(&(fs->lock));
+
     /* Close directory, if open */
     if (file->dir != NULL)
         closedir(file->dir);
 
     /* Close file */
     close(file->fd);
+    file->fd = -1;
+
+    /* Free any data read ahead, discarding any read ahead in progress */
+    free(file->read_ahead);
+    file->read_ahead = NULL;
+    file->read_ahead_generation++;
 
     /* Free name */
     free(file->absolute_path);
@@ -581,6 +820,8 @@ void guac_rdp_fs_close(guac_rdp_fs* fs, int file_id) {
     guac_pool_free_int(fs->file_id_pool, file_id);
     fs->open_files--;
 
+    pthread_mutex_unlock(&(fs->lock));
+
 }
 
 const char* guac_rdp_fs_read_dir(guac_rdp_fs* fs, int file_id) {
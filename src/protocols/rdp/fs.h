@@ -31,13 +31,17 @@
  * @file fs.h 
  */
 
+#include "common/listing.h"
+
 #include <guacamole/client.h>
 #include <guacamole/object.h>
 #include <guacamole/pool.h>
 #include <guacamole/user.h>
 
 #include <dirent.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 /**
  * The maximum number of file IDs to provide.
@@ -49,6 +53,29 @@
  */
 #define GUAC_RDP_FS_MAX_PATH 4096
 
+/**
+ * The number of bytes initially read ahead once reads of a file are known to
+ * be sequential (a read has continued where the previous read of the same
+ * file ended). Reads which continue a sequential run are served from the
+ * data read ahead, such that small sequential reads by the RDP server result
+ * in few, large reads of the underlying file.
+ */
+#define GUAC_RDP_FS_READ_AHEAD_MIN_SIZE 65536
+
+/**
+ * The maximum number of bytes read ahead of sequential reads of a file. The
+ * amount of data read ahead doubles each time the data already read ahead
+ * is exhausted, up to this limit.
+ */
+#define GUAC_RDP_FS_READ_AHEAD_MAX_SIZE 1048576
+
+/**
+ * The maximum number of directories which may be awaiting prefetch at any one
+ * time. Further directories are not prefetched until the prefetch thread has
+ * caught up.
+ */
+#define GUAC_RDP_FS_PREFETCH_QUEUE_SIZE 8
+
 /**
  * The maximum number of directories a path may contain.
  */
@@ -135,10 +162,23 @@ typedef struct guac_rdp_fs_file {
     char* real_path;
 
     /**
-     * Associated local file descriptor.
+     * Associated local file descriptor, or -1 if this file is not open.
      */
     int fd;
 
+    /**
+     * The ID of the device containing the underlying local file, as returned
+     * by fstat() when the file was opened. Together with inode, this
+     * identifies other open files referring to the same underlying file.
+     */
+    dev_t device;
+
+    /**
+     * The inode number of the underlying local file, as returned by fstat()
+     * when the file was opened.
+     */
+    ino_t inode;
+
     /**
      * Associated directory stream, if any. This field only applies
      * if the file is being used as a directory.
@@ -180,6 +220,47 @@ typedef struct guac_rdp_fs_file {
      */
     uint64_t bytes_written;
 
+    /**
+     * Data read ahead of the most recent sequential read, or NULL if reads of
+     * this file are not currently sequential. This buffer is
+     * read_ahead_size bytes, and is freed as soon as a read does not continue
+     * the previous read, or when the file is closed.
+     */
+    char* read_ahead;
+
+    /**
+     * The size of the read_ahead buffer, in bytes, or zero if no buffer is
+     * allocated.
+     */
+    int read_ahead_size;
+
+    /**
+     * The offset within the file of the first byte within read_ahead.
+     */
+    uint64_t read_ahead_offset;
+
+    /**
+     * The number of bytes of read_ahead which contain data read from the file.
+     * Writes to the file through any open file referring to the same
+     * underlying file discard all data read ahead.
+     */
+    int read_ahead_length;
+
+    /**
+     * The offset immediately following the most recent read of this file, or
+     * UINT64_MAX if the file has not yet been read. Reads beginning at this
+     * offset are considered sequential.
+     */
+    uint64_t next_read_offset;
+
+    /**
+     * Counter which is incremented whenever data read ahead for this file is
+     * discarded or the file is closed. Reads which read ahead without holding
+     * the filesystem lock keep their data only if this counter is unchanged
+     * once the read completes.
+     */
+    unsigned int read_ahead_generation;
+
 } guac_rdp_fs_file;
 
 /**
@@ -222,6 +303,58 @@ typedef struct guac_rdp_fs {
      */
     int disable_upload;
 
+    /**
+     * Recently-read directory listings, keyed by the normalized absolute path
+     * of each directory. Listings are invalidated as files are created,
+     * deleted, or renamed through this filesystem.
+     */
+    guac_common_listing_cache* listing_cache;
+
+    /**
+     * Lock which guards the file table, including the number of open files,
+     * the file ID pool, and the read-ahead state of each file, as well as the
+     * prefetch queue. Files may be read and written concurrently by the
+     * RDPDR worker, uploads, downloads, and the prefetch thread, and this
+     * lock must be held whenever any of that state is accessed.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * The absolute paths of the directories whose listings should be read
+     * into listing_cache by the prefetch thread, in the order they should be
+     * read.
+     */
+    char prefetch_queue[GUAC_RDP_FS_PREFETCH_QUEUE_SIZE][GUAC_RDP_FS_MAX_PATH];
+
+    /**
+     * The number of paths within prefetch_queue.
+     */
+    int prefetch_length;
+
+    /**
+     * Non-zero if the prefetch thread has been started, zero otherwise. The
+     * prefetch thread is started only once a directory is first queued for
+     * prefetch.
+     */
+    int prefetch_started;
+
+    /**
+     * Non-zero if the prefetch thread should stop as soon as possible, zero
+     * otherwise.
+     */
+    int prefetch_stopping;
+
+    /**
+     * Condition which is signalled whenever a directory is queued for
+     * prefetch or the prefetch thread is asked to stop.
+     */
+    pthread_cond_t prefetch_modified;
+
+    /**
+     * The thread which reads the listings of queued directories.
+     */
+    pthread_t prefetch_thread;
+
 } guac_rdp_fs;
 
 /**
@@ -412,7 +545,10 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
 /**
  * Reads up to the given length of bytes from the given offset within the
  * file having the given ID. Returns the number of bytes read, zero on EOF,
- * and an error code if an error occurs.
+ * and an error code if an error occurs. Sequential reads are served from
+ * data read ahead of the previous read where possible. As reads do not depend
+ * on any file position, reads of different files may safely occur from
+ * different threads.
  *
  * @param fs
  *     The filesystem containing the file from which data is to be read.
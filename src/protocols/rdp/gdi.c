@@ -269,12 +269,9 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
         /* If operation is just SRC, simply copy */
         case 0xCC: 
 
-            /* If not cached, cache if necessary */
-            if (bitmap->layer == NULL && bitmap->used >= 1)
-                guac_rdp_cache_bitmap(context, memblt->bitmap);
-
-            /* If not cached, send as PNG */
-            if (bitmap->layer == NULL) {
+            /* If not cached (even after caching if necessary), send as
+             * PNG */
+            if (!guac_rdp_bitmap_use(context, memblt->bitmap)) {
                 if (memblt->bitmap->data != NULL) {
 
                     /* Create surface from image data */
@@ -296,9 +293,6 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
                 guac_common_surface_copy(bitmap->layer->surface,
                         x_src, y_src, w, h, current_surface, x, y);
 
-            /* Increment usage counter */
-            ((guac_rdp_bitmap*) bitmap)->used++;
-
             break;
 
         /* If whiteness, send white rectangle */
@@ -311,7 +305,7 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
         default:
 
             /* If not available as a surface, make available. */
-            if (bitmap->layer == NULL)
+            if (!guac_rdp_bitmap_use(context, memblt->bitmap))
                 guac_rdp_cache_bitmap(context, memblt->bitmap);
 
             guac_common_surface_transfer(bitmap->layer->surface,
@@ -319,9 +313,6 @@ BOOL guac_rdp_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt) {
                     guac_rdp_rop3_transfer_function(client, memblt->bRop),
                     current_surface, x, y);
 
-            /* Increment usage counter */
-            ((guac_rdp_bitmap*) bitmap)->used++;
-
     }
 
     return TRUE;
@@ -458,13 +449,34 @@ BOOL guac_rdp_gdi_end_paint(rdpContext* context) {
     UINT32 w = gdi->primary->hdc->hwnd->invalid->w;
     UINT32 h = gdi->primary->hdc->hwnd->invalid->h;
 
+    guac_common_surface* default_surface = rdp_client->display->default_surface;
+
+    /* Use GDI framebuffer directly if allowed, binding (or rebinding after
+     * resize) as necessary */
+    if (rdp_client->settings->gfx_zero_copy) {
+
+        if (default_surface->buffer != gdi->primary_buffer)
+            guac_common_surface_bind(default_surface, gdi->primary_buffer,
+                    gdi->stride, gdi->width, gdi->height, 1);
+
+        guac_common_surface_invalidate(default_surface, x, y, w, h);
+
+        /* Next frame */
+        if (gdi->inGfxFrame) {
+            guac_rdp_gdi_mark_frame(context, 0);
+        }
+
+        return TRUE;
+
+    }
+
     /* Create surface from image data */
     cairo_surface_t* surface = cairo_image_surface_create_for_data(
         gdi->primary_buffer + 4*x + y*gdi->stride,
         CAIRO_FORMAT_RGB24, w, h, gdi->stride);
 
     /* Send surface to buffer */
-    guac_common_surface_draw(rdp_client->display->default_surface, x, y, surface);
+    guac_common_surface_draw(default_surface, x, y, surface);
 
     /* Free surface */
     cairo_surface_destroy(surface);
@@ -17,107 +17,377 @@
  * under the License.
  */
 
+#include "common/listing.h"
 #include "fs.h"
 #include "ls.h"
 
 #include <guacamole/client.h>
-#include <guacamole/protocol.h>
-#include <guacamole/socket.h>
+#include <guacamole/string.h>
 #include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 #include <winpr/file.h>
 #include <winpr/nt.h>
 #include <winpr/shell.h>
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
-int guac_rdp_ls_ack_handler(guac_user* user, guac_stream* stream,
-        char* message, guac_protocol_status status) {
+/**
+ * Reads the next entry of the given open directory, adding that entry to the
+ * given listing unless it is the current or parent directory or cannot be
+ * opened.
+ *
+ * @param fs
+ *     The filesystem containing the directory.
+ *
+ * @param file_id
+ *     The file ID of the open directory.
+ *
+ * @param directory_name
+ *     The absolute path of the directory, which is used as the basis of each
+ *     path within the listing.
+ *
+ * @param listing
+ *     The directory listing being read.
+ *
+ * @param absolute_path
+ *     A buffer of at least GUAC_RDP_FS_MAX_PATH bytes which receives the
+ *     absolute path of the entry read, if that entry was added to the
+ *     listing.
+ *
+ * @param directory
+ *     Storage for a flag which is set to non-zero if the entry read was
+ *     added to the listing and is a directory, or to zero otherwise.
+ *
+ * @return
+ *     Non-zero if an entry was read, zero if no entries remain.
+ */
+static int guac_rdp_ls_read_entry(guac_rdp_fs* fs, int file_id,
+        const char* directory_name, guac_common_listing* listing,
+        char* absolute_path, int* directory) {
+
+    *directory = 0;
+
+    /* Stop once no directory entries remain */
+    const char* filename = guac_rdp_fs_read_dir(fs, file_id);
+    if (filename == NULL)
+        return 0;
+
+    /* Skip current and parent directory entries */
+    if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
+        return 1;
+
+    /* Concatenate into absolute path - skip if invalid */
+    if (!guac_rdp_fs_append_filename(absolute_path, directory_name,
+                filename)) {
+
+        guac_client_log(fs->client, GUAC_LOG_DEBUG,
+                "Skipping filename \"%s\" - filename is invalid or "
+                "resulting path is too long", filename);
+
+        return 1;
+    }
+
+    /* Attempt to open file to determine type */
+    int entry_id = guac_rdp_fs_open(fs, absolute_path,
+            GENERIC_READ, 0, FILE_OPEN, 0);
+    if (entry_id < 0)
+        return 1;
+
+    /* Get opened file */
+    guac_rdp_fs_file* file = guac_rdp_fs_get_file(fs, entry_id);
+    if (file == NULL) {
+        guac_client_log(fs->client, GUAC_LOG_DEBUG, "%s: Successful open "
+                "produced bad file_id: %i", __func__, entry_id);
+        return 1;
+    }
+
+    /* Determine mimetype */
+    const char* mimetype;
+    if (file->attributes & FILE_ATTRIBUTE_DIRECTORY) {
+        mimetype = GUAC_USER_STREAM_INDEX_MIMETYPE;
+        *directory = 1;
+    }
+    else
+        mimetype = "application/octet-stream";
+
+    guac_common_listing_add(listing, absolute_path, mimetype);
+    guac_rdp_fs_close(fs, entry_id);
+
+    return 1;
+
+}
+
+/**
+ * Listing entry handler which reads the next entry of the directory being
+ * listed, adding that entry to the listing unless it is the current or
+ * parent directory or cannot be opened. The first GUAC_RDP_LS_PREFETCH_MAX
+ * child directories read are noted for prefetch.
+ *
+ * @param user
+ *     The user requesting the directory listing.
+ *
+ * @param data
+ *     The guac_rdp_ls_status of the directory being listed.
+ *
+ * @param listing
+ *     The directory listing being read.
+ *
+ * @return
+ *     Non-zero if an entry was read, zero if no entries remain.
+ */
+static int guac_rdp_ls_entry_handler(guac_user* user, void* data,
+        guac_common_listing* listing) {
 
-    int blob_written = 0;
-    const char* filename;
+    guac_rdp_ls_status* ls_status = (guac_rdp_ls_status*) data;
 
-    guac_rdp_ls_status* ls_status = (guac_rdp_ls_status*) stream->data;
+    char absolute_path[GUAC_RDP_FS_MAX_PATH];
+    int directory;
 
-    /* If unsuccessful, free stream and abort */
-    if (status != GUAC_PROTOCOL_STATUS_SUCCESS) {
-        guac_rdp_fs_close(ls_status->fs, ls_status->file_id);
-        guac_user_free_stream(user, stream);
-        free(ls_status);
+    if (!guac_rdp_ls_read_entry(ls_status->fs, ls_status->file_id,
+                ls_status->directory_name, listing, absolute_path,
+                &directory)) {
+        ls_status->complete = 1;
         return 0;
     }
 
-    /* While directory entries remain */
-    while ((filename = guac_rdp_fs_read_dir(ls_status->fs,
-                    ls_status->file_id)) != NULL
-            && !blob_written) {
+    /* Note child directories for prefetch */
+    if (directory && ls_status->prefetch_count < GUAC_RDP_LS_PREFETCH_MAX)
+        guac_strlcpy(ls_status->prefetch[ls_status->prefetch_count++],
+                absolute_path, GUAC_RDP_FS_MAX_PATH);
 
-        char absolute_path[GUAC_RDP_FS_MAX_PATH];
+    return 1;
 
-        /* Skip current and parent directory entries */
-        if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
-            continue;
+}
 
-        /* Concatenate into absolute path - skip if invalid */
-        if (!guac_rdp_fs_append_filename(absolute_path,
-                    ls_status->directory_name, filename)) {
+/**
+ * Listing free handler which closes the directory that was being listed,
+ * queues any child directories noted for prefetch if the directory was read
+ * in full, and frees its guac_rdp_ls_status.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param data
+ *     The guac_rdp_ls_status of the directory that was being listed.
+ */
+static void guac_rdp_ls_free_handler(guac_user* user, void* data) {
 
-            guac_user_log(user, GUAC_LOG_DEBUG,
-                    "Skipping filename \"%s\" - filename is invalid or "
-                    "resulting path is too long", filename);
+    guac_rdp_ls_status* ls_status = (guac_rdp_ls_status*) data;
 
-            continue;
-        }
+    guac_rdp_fs_close(ls_status->fs, ls_status->file_id);
 
-        /* Attempt to open file to determine type */
-        int file_id = guac_rdp_fs_open(ls_status->fs, absolute_path,
-                GENERIC_READ, 0, FILE_OPEN, 0);
-        if (file_id < 0)
-            continue;
-
-        /* Get opened file */
-        guac_rdp_fs_file* file = guac_rdp_fs_get_file(ls_status->fs, file_id);
-        if (file == NULL) {
-            guac_user_log(user, GUAC_LOG_DEBUG, "%s: Successful open produced "
-                    "bad file_id: %i", __func__, file_id);
-            return 0;
-        }
+    /* Prefetch child directories only once their parent has been read */
+    if (ls_status->complete) {
+        for (int i = 0; i < ls_status->prefetch_count; i++)
+            guac_rdp_ls_prefetch(ls_status->fs, ls_status->prefetch[i]);
+    }
+
+    free(ls_status);
+
+}
+
+int guac_rdp_ls_begin(guac_user* user, guac_stream* stream, guac_rdp_fs* fs,
+        int file_id, const char* name) {
+
+    guac_rdp_fs_file* directory = guac_rdp_fs_get_file(fs, file_id);
+    if (directory == NULL)
+        return 1;
+
+    /* Send cached listing if the directory was recently read */
+    guac_common_listing* listing = guac_common_listing_cache_get(
+            fs->listing_cache, directory->absolute_path,
+            guac_timestamp_current());
+
+    if (listing != NULL) {
+        guac_rdp_fs_close(fs, file_id);
+        return guac_common_listing_send(user, stream, listing);
+    }
+
+    /* Otherwise, read the directory as its listing is sent */
+    guac_rdp_ls_status* ls_status = malloc(sizeof(guac_rdp_ls_status));
+    ls_status->fs = fs;
+    ls_status->file_id = file_id;
+    ls_status->complete = 0;
+    ls_status->prefetch_count = 0;
+    int length = guac_strlcpy(ls_status->directory_name, name,
+            sizeof(ls_status->directory_name));
+
+    /* Bail out if directory name is too long to store */
+    if (length >= sizeof(ls_status->directory_name)) {
+        guac_user_log(user, GUAC_LOG_INFO, "Unable to read directory "
+                "\"%s\": Path too long", name);
+        guac_rdp_ls_free_handler(user, ls_status);
+        return 1;
+    }
+
+    return guac_common_listing_stream(user, stream, fs->listing_cache,
+            directory->absolute_path, guac_rdp_ls_entry_handler,
+            guac_rdp_ls_free_handler, ls_status);
+
+}
+
+/**
+ * Returns whether the prefetch thread of the given filesystem has been asked
+ * to stop.
+ *
+ * @param fs
+ *     The filesystem whose prefetch thread should be checked.
+ *
+ * @return
+ *     Non-zero if the prefetch thread should stop, zero otherwise.
+ */
+static int guac_rdp_ls_prefetch_stopping(guac_rdp_fs* fs) {
+
+    pthread_mutex_lock(&(fs->lock));
+    int stopping = fs->prefetch_stopping;
+    pthread_mutex_unlock(&(fs->lock));
+
+    return stopping;
+
+}
 
-        /* Determine mimetype */
-        const char* mimetype;
-        if (file->attributes & FILE_ATTRIBUTE_DIRECTORY)
-            mimetype = GUAC_USER_STREAM_INDEX_MIMETYPE;
-        else
-            mimetype = "application/octet-stream";
+/**
+ * Reads the listing of the directory having the given path into the listing
+ * cache of the given filesystem, unless a listing of that directory is
+ * already cached. Reading is abandoned if the prefetch thread is asked to
+ * stop.
+ *
+ * @param fs
+ *     The filesystem containing the directory.
+ *
+ * @param path
+ *     The absolute path of the directory.
+ */
+static void guac_rdp_ls_prefetch_directory(guac_rdp_fs* fs,
+        const char* path) {
+
+    int file_id = guac_rdp_fs_open(fs, path, GENERIC_READ, 0, FILE_OPEN, 0);
+    if (file_id < 0)
+        return;
+
+    guac_rdp_fs_file* directory = guac_rdp_fs_get_file(fs, file_id);
+
+    /* Do not read directories whose listings are already cached */
+    guac_common_listing* listing = guac_common_listing_cache_get(
+            fs->listing_cache, directory->absolute_path,
+            guac_timestamp_current());
 
-        /* Write entry */
-        blob_written |= guac_common_json_write_property(user, stream,
-                &ls_status->json_state, absolute_path, mimetype);
+    if (listing != NULL) {
+        guac_common_listing_free(listing);
+        guac_rdp_fs_close(fs, file_id);
+        return;
+    }
+
+    listing = guac_common_listing_alloc();
+
+    char absolute_path[GUAC_RDP_FS_MAX_PATH];
+    int child_directory;
 
-        guac_rdp_fs_close(ls_status->fs, file_id);
+    /* Read the entire directory */
+    while (guac_rdp_ls_read_entry(fs, file_id, path, listing, absolute_path,
+                &child_directory)) {
+
+        if (guac_rdp_ls_prefetch_stopping(fs)) {
+            guac_common_listing_free(listing);
+            guac_rdp_fs_close(fs, file_id);
+            return;
+        }
 
     }
 
-    /* Complete JSON and cleanup at end of directory */
-    if (filename == NULL) {
+    guac_common_listing_end(listing);
+    guac_common_listing_cache_put(fs->listing_cache,
+            directory->absolute_path, listing, guac_timestamp_current());
+
+    guac_client_log(fs->client, GUAC_LOG_DEBUG, "Prefetched listing of "
+            "directory \"%s\" (%i entries).", path, listing->entries);
 
-        /* Complete JSON object */
-        guac_common_json_end_object(user, stream, &ls_status->json_state);
-        guac_common_json_flush(user, stream, &ls_status->json_state);
+    guac_common_listing_free(listing);
+    guac_rdp_fs_close(fs, file_id);
 
-        /* Clean up resources */
-        guac_rdp_fs_close(ls_status->fs, ls_status->file_id);
-        free(ls_status);
+}
+
+/**
+ * Thread which reads the listings of the directories queued for prefetch with
+ * guac_rdp_ls_prefetch(), in the order they were queued, running until
+ * guac_rdp_fs_free() requests that it stop.
+ *
+ * @param data
+ *     A pointer to the guac_rdp_fs whose queued directories should be read.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdp_ls_prefetch_thread(void* data) {
+
+    guac_rdp_fs* fs = (guac_rdp_fs*) data;
+    char path[GUAC_RDP_FS_MAX_PATH];
 
-        /* Signal of stream */
-        guac_protocol_send_end(user->socket, stream);
-        guac_user_free_stream(user, stream);
+    pthread_mutex_lock(&(fs->lock));
+
+    for (;;) {
+
+        /* Wait for a directory to prefetch or a request to stop */
+        while (fs->prefetch_length == 0 && !fs->prefetch_stopping)
+            pthread_cond_wait(&(fs->prefetch_modified), &(fs->lock));
+
+        if (fs->prefetch_stopping)
+            break;
+
+        /* Take the oldest queued directory */
+        guac_strlcpy(path, fs->prefetch_queue[0], sizeof(path));
+        fs->prefetch_length--;
+        memmove(fs->prefetch_queue[0], fs->prefetch_queue[1],
+                fs->prefetch_length * sizeof(fs->prefetch_queue[0]));
+
+        /* Read directory without holding the lock, as reading the directory
+         * itself acquires the lock */
+        pthread_mutex_unlock(&(fs->lock));
+        guac_rdp_ls_prefetch_directory(fs, path);
+        pthread_mutex_lock(&(fs->lock));
 
     }
 
-    guac_socket_flush(user->socket);
-    return 0;
+    pthread_mutex_unlock(&(fs->lock));
+    return NULL;
 
 }
 
+void guac_rdp_ls_prefetch(guac_rdp_fs* fs, const char* path) {
+
+    pthread_mutex_lock(&(fs->lock));
+
+    /* Drop requests which cannot be queued */
+    if (fs->prefetch_stopping
+            || fs->prefetch_length == GUAC_RDP_FS_PREFETCH_QUEUE_SIZE) {
+        pthread_mutex_unlock(&(fs->lock));
+        return;
+    }
+
+    /* Start prefetch thread upon first use */
+    if (!fs->prefetch_started) {
+
+        if (pthread_create(&(fs->prefetch_thread), NULL,
+                    guac_rdp_ls_prefetch_thread, fs)) {
+            guac_client_log(fs->client, GUAC_LOG_WARNING, "Unable to start "
+                    "directory prefetch thread. Directories will not be "
+                    "prefetched.");
+            fs->prefetch_stopping = 1;
+            pthread_mutex_unlock(&(fs->lock));
+            return;
+        }
+
+        fs->prefetch_started = 1;
+
+    }
+
+    guac_strlcpy(fs->prefetch_queue[fs->prefetch_length++], path,
+            GUAC_RDP_FS_MAX_PATH);
+    pthread_cond_signal(&(fs->prefetch_modified));
+
+    pthread_mutex_unlock(&(fs->lock));
+
+}
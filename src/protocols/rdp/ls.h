@@ -20,14 +20,16 @@
 #ifndef GUAC_RDP_LS_H
 #define GUAC_RDP_LS_H
 
-#include "common/json.h"
 #include "fs.h"
 
-#include <guacamole/protocol.h>
 #include <guacamole/stream.h>
 #include <guacamole/user.h>
 
-#include <stdint.h>
+/**
+ * The maximum number of child directories of a listed directory whose own
+ * listings are prefetched once that directory has been read in full.
+ */
+#define GUAC_RDP_LS_PREFETCH_MAX 8
 
 /**
  * The current state of a directory listing operation.
@@ -45,22 +47,79 @@ typedef struct guac_rdp_ls_status {
     int file_id;
 
     /**
-     * The absolute path of the directory being listed.
+     * The absolute path of the directory being listed, as requested by the
+     * user, which is used as the basis of each path within the listing.
      */
     char directory_name[GUAC_RDP_FS_MAX_PATH];
 
     /**
-     * The current state of the JSON directory object being written.
+     * Non-zero if the directory has been read in full, zero otherwise.
+     */
+    int complete;
+
+    /**
+     * The absolute paths of the first GUAC_RDP_LS_PREFETCH_MAX child
+     * directories encountered while reading the directory, which are queued
+     * for prefetch once the directory has been read in full.
      */
-    guac_common_json_state json_state;
+    char prefetch[GUAC_RDP_LS_PREFETCH_MAX][GUAC_RDP_FS_MAX_PATH];
+
+    /**
+     * The number of paths within prefetch.
+     */
+    int prefetch_count;
 
 } guac_rdp_ls_status;
 
 /**
- * Handler for ack messages received due to receipt of a "body" or "blob"
- * instruction associated with a directory list operation.
+ * Begins sending the contents of the given open directory as a JSON directory
+ * listing over the given stream, reusing a recently-read listing of the same
+ * directory if one is cached. Otherwise, the directory is read only as its
+ * listing is sent, and the listing is cached once complete. The stream must
+ * not yet have been announced to the user, and the caller must announce the
+ * stream (with a "body" instruction) after this function returns
+ * successfully. The directory is closed automatically. Once a directory has
+ * been read in full, the listings of its first GUAC_RDP_LS_PREFETCH_MAX child
+ * directories are read into the cache in the background with
+ * guac_rdp_ls_prefetch(), such that navigating into those directories is
+ * fast.
+ *
+ * @param user
+ *     The user that requested the directory listing.
+ *
+ * @param stream
+ *     The stream over which the directory listing should be sent.
+ *
+ * @param fs
+ *     The filesystem containing the directory.
+ *
+ * @param file_id
+ *     The file ID of the directory, as returned by guac_rdp_fs_open().
+ *
+ * @param name
+ *     The absolute path of the directory, as requested by the user, which is
+ *     used as the basis of each path within the listing.
+ *
+ * @return
+ *     Zero if sending of the listing was prepared successfully, non-zero
+ *     otherwise.
+ */
+int guac_rdp_ls_begin(guac_user* user, guac_stream* stream, guac_rdp_fs* fs,
+        int file_id, const char* name);
+
+/**
+ * Queues the directory having the given path for prefetch, such that its
+ * listing is read into the listing cache of the given filesystem by a
+ * background thread dedicated to that filesystem. The thread is started if
+ * it is not already running, and runs until the filesystem is freed. If the
+ * prefetch queue is full, the directory is not prefetched.
+ *
+ * @param fs
+ *     The filesystem containing the directory.
+ *
+ * @param path
+ *     The absolute path of the directory to prefetch.
  */
-guac_user_ack_handler guac_rdp_ls_ack_handler;
+void guac_rdp_ls_prefetch(guac_rdp_fs* fs, const char* path);
 
 #endif
-
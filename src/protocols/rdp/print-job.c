@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include "common/download.h"
 #include "print-job.h"
 #include "rdp.h"
 
@@ -24,11 +25,13 @@
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
 #include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -56,8 +59,8 @@ char* const guac_rdp_pdf_filter_command[] = {
 };
 
 /**
- * Updates the state of the given print job. Any threads currently blocked by a
- * call to guac_rdp_print_job_wait_for_ack() will be unblocked.
+ * Updates the state of the given print job. Any threads currently blocked
+ * waiting for the state of the print job to change will be unblocked.
  *
  * @param job
  *     The print job whose state should be updated.
@@ -72,41 +75,66 @@ static void guac_rdp_print_job_set_state(guac_rdp_print_job* job,
 
     /* Update stream state, signalling modification */
     job->state = state;
-    pthread_cond_signal(&(job->state_modified));
+    pthread_cond_broadcast(&(job->state_modified));
 
     pthread_mutex_unlock(&(job->state_lock));
 
 }
 
 /**
- * Suspends execution of the current thread until the state of the given print
- * job is not GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK. If the state of the print
- * job is GUAC_RDP_PRINT_JOB_ACK_RECEIVED, the state is automatically reset
- * back to GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK prior to returning.
+ * Suspends execution of the current thread until the Guacamole client has
+ * acknowledged creation of the print stream and the flow control window of
+ * the given print job allows at least one more blob to be sent, or until the
+ * print stream is closed.
  *
  * @param job
  *     The print job to wait for.
  *
  * @return
- *     Zero if the state of the print job is GUAC_RDP_PRINT_JOB_CLOSED,
- *     non-zero if the state was GUAC_RDP_PRINT_JOB_ACK_RECEIVED and has been
- *     automatically reset to GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK.
+ *     The number of blobs which may now be sent, or zero if the state of the
+ *     print job is GUAC_RDP_PRINT_JOB_CLOSED.
  */
-static int guac_rdp_print_job_wait_for_ack(guac_rdp_print_job* job) {
+static int guac_rdp_print_job_wait_for_window(guac_rdp_print_job* job) {
+
+    int available = 0;
 
-    /* Wait for ack if stream open and not yet received */
     pthread_mutex_lock(&(job->state_lock));
-    if (job->state == GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK)
+
+    /* Wait for ack if stream open and window is full or not yet open */
+    while (job->state != GUAC_RDP_PRINT_JOB_CLOSED) {
+
+        if (job->state == GUAC_RDP_PRINT_JOB_ACK_RECEIVED) {
+            available = guac_common_download_window_available(&job->window);
+            if (available > 0)
+                break;
+        }
+
         pthread_cond_wait(&job->state_modified, &job->state_lock);
 
-    /* Reset state if ack received */
-    int got_ack = (job->state == GUAC_RDP_PRINT_JOB_ACK_RECEIVED);
-    if (got_ack)
-        job->state = GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK;
+    }
+
+    pthread_mutex_unlock(&(job->state_lock));
+    return available;
+
+}
+
+/**
+ * Suspends execution of the current thread until all blobs sent along the
+ * print stream of the given print job have been acknowledged, or until the
+ * print stream is closed.
+ *
+ * @param job
+ *     The print job to wait for.
+ */
+static void guac_rdp_print_job_wait_for_acks(guac_rdp_print_job* job) {
+
+    pthread_mutex_lock(&(job->state_lock));
+
+    while (job->state == GUAC_RDP_PRINT_JOB_ACK_RECEIVED
+            && job->window.in_flight > 0)
+        pthread_cond_wait(&job->state_modified, &job->state_lock);
 
-    /* Return whether ack was successfully received */
     pthread_mutex_unlock(&(job->state_lock));
-    return got_ack;
 
 }
 
@@ -147,12 +175,14 @@ static void* guac_rdp_print_job_begin_stream(guac_user* user, void* data) {
 }
 
 /**
- * Sends a "blob" instruction to the given user containing the provided data
- * along the stream associated with the provided print job. If the given user
- * no longer exists, the print stream will be automatically terminated.
+ * Sends the provided data to the given user as "blob" instructions along the
+ * stream associated with the provided print job, splitting the data into as
+ * many blobs as required. Each blob is recorded within the flow control
+ * window of the print job. If the given user no longer exists, the print
+ * stream will be automatically terminated.
  *
  * @param user
- *     The user receiving the "blob" instruction.
+ *     The user receiving the "blob" instructions.
  *
  * @param data
  *     A pointer to an guac_rdp_print_blob structure containing the data to
@@ -167,7 +197,7 @@ static void* guac_rdp_print_job_send_blob(guac_user* user, void* data) {
     guac_rdp_print_blob* blob = (guac_rdp_print_blob*) data;
     guac_rdp_print_job* job = blob->job;
 
-    guac_client_log(job->client, GUAC_LOG_DEBUG, "Sending %i byte(s) "
+    guac_client_log(job->client, GUAC_LOG_TRACE, "Sending %i byte(s) "
             "of filtered output.", blob->length);
 
     /* Kill job and do nothing if user no longer exists */
@@ -176,9 +206,30 @@ static void* guac_rdp_print_job_send_blob(guac_user* user, void* data) {
         return NULL;
     }
 
-    /* Send single blob of print data */
-    guac_protocol_send_blob(user->socket, job->stream,
-            blob->buffer, blob->length);
+    char* buffer = blob->buffer;
+    int length = blob->length;
+
+    while (length > 0) {
+
+        int blob_length = length;
+        if (blob_length > GUAC_PROTOCOL_BLOB_MAX_LENGTH)
+            blob_length = GUAC_PROTOCOL_BLOB_MAX_LENGTH;
+
+        /* Record blob before sending, such that its ack cannot be received
+         * before the blob is accounted for */
+        pthread_mutex_lock(&(job->state_lock));
+        guac_common_download_window_sent(&job->window,
+                guac_timestamp_current());
+        pthread_mutex_unlock(&(job->state_lock));
+
+        /* Send single blob of print data */
+        guac_protocol_send_blob(user->socket, job->stream,
+                buffer, blob_length);
+
+        buffer += blob_length;
+        length -= blob_length;
+
+    }
 
     guac_socket_flush(user->socket);
     return NULL;
@@ -223,9 +274,9 @@ static void* guac_rdp_print_job_end_stream(guac_user* user, void* data) {
 }
 
 /**
- * Handler for "ack" messages received in response to printed data. Additional
- * data will be sent as a result or, if no data remains, the stream will be
- * terminated. It is required that the data pointer of the provided stream be
+ * Handler for "ack" messages received in response to printed data. Each
+ * successful "ack" opens the flow control window of the print job further,
+ * allowing additional data to be sent. It is required that the data pointer of the provided stream be
  * set to the file descriptor from which the printed data should be read.
  *
  * @param user
@@ -253,9 +304,23 @@ static int guac_rdp_print_filter_ack_handler(guac_user* user,
 
     guac_rdp_print_job* job = (guac_rdp_print_job*) stream->data;
 
-    /* Update state for successful acks */
-    if (status == GUAC_PROTOCOL_STATUS_SUCCESS)
-        guac_rdp_print_job_set_state(job, GUAC_RDP_PRINT_JOB_ACK_RECEIVED);
+    /* Update state and window for successful acks */
+    if (status == GUAC_PROTOCOL_STATUS_SUCCESS) {
+
+        pthread_mutex_lock(&(job->state_lock));
+
+        /* The first ack acknowledges the stream itself, and is otherwise
+         * ignored by the window */
+        if (job->state != GUAC_RDP_PRINT_JOB_CLOSED) {
+            job->state = GUAC_RDP_PRINT_JOB_ACK_RECEIVED;
+            guac_common_download_window_acked(&job->window,
+                    guac_timestamp_current());
+        }
+
+        pthread_cond_broadcast(&(job->state_modified));
+        pthread_mutex_unlock(&(job->state_lock));
+
+    }
 
     /* Terminate stream if ack signals an error */
     else {
@@ -378,63 +443,233 @@ static pid_t guac_rdp_create_filter_process(guac_client* client,
 }
 
 /**
- * Thread which continuously reads from the output file descriptor associated
- * with the given print job, writing filtered PDF output to the associated
- * Guacamole stream, and terminating only after the print job has completed
- * processing or the associated Guacamole stream has closed.
+ * Thread which continuously copies the output of the filter process of the
+ * given print job to its spool file, terminating once the filter process has
+ * closed its output or the output can no longer be spooled.
  *
  * @param data
- *     A pointer to the guac_rdp_print_job representing the print job that
- *     should be read.
+ *     A pointer to the guac_rdp_print_job representing the print job whose
+ *     output should be spooled.
  *
  * @return
  *     Always NULL.
  */
-static void* guac_rdp_print_job_output_thread(void* data) {
+static void* guac_rdp_print_job_spool_thread(void* data) {
 
     int length;
-    char buffer[6048];
+    char buffer[GUAC_RDP_PRINT_JOB_CHUNK_SIZE];
 
     guac_rdp_print_job* job = (guac_rdp_print_job*) data;
-    guac_client_log(job->client, GUAC_LOG_DEBUG, "Reading output from filter "
-            "process...");
 
     /* Read continuously while data remains */
     while ((length = read(job->output_fd, buffer, sizeof(buffer))) > 0) {
 
-        /* Wait for client to be ready for blob */
-        if (guac_rdp_print_job_wait_for_ack(job)) {
+        /* Append all data read to the spool file */
+        char* current = buffer;
+        int remaining = length;
+        while (remaining > 0) {
 
-            guac_rdp_print_blob blob = {
-                .job    = job,
-                .buffer = buffer,
-                .length = length
-            };
+            int written = write(job->spool_fd, current, remaining);
+            if (written < 0)
+                break;
 
-            /* Write a single blob of output */
-            guac_client_for_user(job->client, job->user,
-                    guac_rdp_print_job_send_blob, &blob);
+            current += written;
+            remaining -= written;
 
         }
 
+        /* Abort entirely if output cannot be spooled */
+        if (remaining > 0) {
+            guac_client_log(job->client, GUAC_LOG_ERROR, "Error spooling "
+                    "output of filter: %s", strerror(errno));
+            guac_rdp_print_job_kill(job);
+            break;
+        }
+
+        /* Signal availability of newly-spooled data */
+        pthread_mutex_lock(&(job->state_lock));
+        job->spool_length += length;
+        pthread_cond_broadcast(&(job->state_modified));
+        pthread_mutex_unlock(&(job->state_lock));
+
+    }
+
+    /* Warn of read errors */
+    if (length < 0)
+        guac_client_log(job->client, GUAC_LOG_ERROR,
+                "Error reading from filter: %s", strerror(errno));
+
+    /* No further data will be spooled */
+    pthread_mutex_lock(&(job->state_lock));
+    job->spool_complete = 1;
+    pthread_cond_broadcast(&(job->state_modified));
+    pthread_mutex_unlock(&(job->state_lock));
+
+    return NULL;
+
+}
+
+/**
+ * Reads the next chunk of filtered output of the given print job, reading
+ * from the spool file if the output is being spooled, and directly from the
+ * filter process otherwise. If the output is being spooled, this function
+ * blocks until data is available, all output has been spooled, or the print
+ * stream is closed.
+ *
+ * @param job
+ *     The print job whose output should be read.
+ *
+ * @param buffer
+ *     The buffer into which the output should be read.
+ *
+ * @param length
+ *     The maximum number of bytes to read.
+ *
+ * @param offset
+ *     The number of bytes of output read thus far.
+ *
+ * @return
+ *     The number of bytes read, zero if no further output remains or the
+ *     print stream is closed, or a negative value if an error occurs.
+ */
+static int guac_rdp_print_job_read_output(guac_rdp_print_job* job,
+        char* buffer, int length, off_t offset) {
+
+    /* Read directly from filter if not spooling */
+    if (job->spool_fd == -1)
+        return read(job->output_fd, buffer, length);
+
+    pthread_mutex_lock(&(job->state_lock));
+
+    /* Wait for further output to be spooled */
+    while (job->spool_length <= offset && !job->spool_complete
+            && job->state != GUAC_RDP_PRINT_JOB_CLOSED)
+        pthread_cond_wait(&job->state_modified, &job->state_lock);
+
+    off_t available = job->spool_length - offset;
+    if (job->state == GUAC_RDP_PRINT_JOB_CLOSED)
+        available = 0;
+
+    pthread_mutex_unlock(&(job->state_lock));
+
+    if (available <= 0)
+        return 0;
+
+    if (available < length)
+        length = available;
+
+    return pread(job->spool_fd, buffer, length, offset);
+
+}
+
+/**
+ * Sends the given chunk of filtered output along the print stream of the
+ * given print job, waiting as necessary for the flow control window of the
+ * print job to allow each group of blobs to be sent.
+ *
+ * @param job
+ *     The print job whose output is being sent.
+ *
+ * @param buffer
+ *     The output to send.
+ *
+ * @param length
+ *     The number of bytes of output to send.
+ *
+ * @return
+ *     Non-zero if all output was sent, zero if the print stream was closed.
+ */
+static int guac_rdp_print_job_send_chunk(guac_rdp_print_job* job,
+        char* buffer, int length) {
+
+    while (length > 0) {
+
+        /* Wait for client to be ready for more blobs */
+        int blobs = guac_rdp_print_job_wait_for_window(job);
+        if (blobs == 0)
+            return 0;
+
+        /* Send as many blobs as the window allows at once */
+        int chunk_length = length;
+        if (chunk_length > blobs * GUAC_PROTOCOL_BLOB_MAX_LENGTH)
+            chunk_length = blobs * GUAC_PROTOCOL_BLOB_MAX_LENGTH;
+
+        guac_rdp_print_blob blob = {
+            .job    = job,
+            .buffer = buffer,
+            .length = chunk_length
+        };
+
+        guac_client_for_user(job->client, job->user,
+                guac_rdp_print_job_send_blob, &blob);
+
+        buffer += chunk_length;
+        length -= chunk_length;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Thread which continuously reads the filtered output of the given print job,
+ * writing that output to the associated Guacamole stream, and terminating
+ * only after the print job has completed processing or the associated
+ * Guacamole stream has closed.
+ *
+ * @param data
+ *     A pointer to the guac_rdp_print_job representing the print job that
+ *     should be read.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdp_print_job_output_thread(void* data) {
+
+    int length;
+    off_t offset = 0;
+    char buffer[GUAC_RDP_PRINT_JOB_CHUNK_SIZE];
+
+    guac_rdp_print_job* job = (guac_rdp_print_job*) data;
+    guac_client_log(job->client, GUAC_LOG_DEBUG, "Reading output from filter "
+            "process...");
+
+    /* Read continuously while data remains */
+    while ((length = guac_rdp_print_job_read_output(job, buffer,
+                    sizeof(buffer), offset)) > 0) {
+
         /* Abort if stream is closed */
-        else {
+        if (!guac_rdp_print_job_send_chunk(job, buffer, length)) {
             guac_client_log(job->client, GUAC_LOG_DEBUG, "Print stream "
                     "explicitly aborted.");
             break;
         }
 
+        offset += length;
+
     }
 
     /* Warn of read errors */
     if (length < 0)
         guac_client_log(job->client, GUAC_LOG_ERROR,
-                "Error reading from filter: %s", strerror(errno));
+                "Error reading filtered output: %s", strerror(errno));
+
+    /* End stream only once all blobs are acknowledged, as the stream index
+     * may be reused as soon as the stream is freed */
+    guac_rdp_print_job_wait_for_acks(job);
 
     /* Terminate stream */
     guac_client_for_user(job->client, job->user,
             guac_rdp_print_job_end_stream, job);
 
+    /* Wait for spooling to finish (the filter process will have terminated
+     * or been killed by this point) */
+    if (job->spool_fd != -1) {
+        pthread_join(job->spool_thread, NULL);
+        close(job->spool_fd);
+    }
+
     /* Ensure all associated file descriptors are closed */
     close(job->input_fd);
     close(job->output_fd);
@@ -444,6 +679,50 @@ static void* guac_rdp_print_job_output_thread(void* data) {
 
 }
 
+/**
+ * Creates the temporary file to which the output of the filter process of a
+ * print job will be spooled. The file is unlinked immediately, such that it
+ * is removed automatically once closed.
+ *
+ * @param client
+ *     The guac_client associated with the print job.
+ *
+ * @return
+ *     The file descriptor of the spool file, or -1 if the spool file could
+ *     not be created.
+ */
+static int guac_rdp_print_job_create_spool(guac_client* client) {
+
+    char path[PATH_MAX];
+
+    /* Spool within the temporary directory configured for guacd, if any */
+    const char* tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL || tmpdir[0] == '\0')
+        tmpdir = GUAC_RDP_PRINT_JOB_DEFAULT_TMPDIR;
+
+    int length = snprintf(path, sizeof(path), "%s/%s", tmpdir,
+            GUAC_RDP_PRINT_JOB_SPOOL_TEMPLATE);
+
+    if (length < 0 || length >= (int) sizeof(path)) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Unable to create spool "
+                "file for print job (output will not be spooled): Path of "
+                "temporary directory \"%s\" is too long.", tmpdir);
+        return -1;
+    }
+
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Unable to create spool "
+                "file for print job (output will not be spooled): %s",
+                strerror(errno));
+        return -1;
+    }
+
+    unlink(path);
+    return fd;
+
+}
+
 void* guac_rdp_print_job_alloc(guac_user* user, void* data) {
 
     /* Allocate nothing if user does not exist */
@@ -486,9 +765,21 @@ void* guac_rdp_print_job_alloc(guac_user* user, void* data) {
 
     /* Init stream state signal and lock */
     job->state = GUAC_RDP_PRINT_JOB_WAITING_FOR_ACK;
+    guac_common_download_window_init(&job->window,
+            GUAC_COMMON_DOWNLOAD_DEFAULT_MAX_WINDOW);
     pthread_cond_init(&job->state_modified, NULL);
     pthread_mutex_init(&job->state_lock, NULL);
 
+    /* Spool filter output, if possible, such that the filter process need
+     * not wait for the user to receive data */
+    job->spool_fd = guac_rdp_print_job_create_spool(job->client);
+    job->spool_length = 0;
+    job->spool_complete = 0;
+
+    if (job->spool_fd != -1)
+        pthread_create(&job->spool_thread, NULL,
+                guac_rdp_print_job_spool_thread, job);
+
     /* Start output thread */
     pthread_create(&job->output_thread, NULL,
             guac_rdp_print_job_output_thread, job);
@@ -20,11 +20,16 @@
 #ifndef GUAC_RDP_PRINT_JOB_H
 #define GUAC_RDP_PRINT_JOB_H
 
+#include "common/download.h"
+
 #include <guacamole/client.h>
 #include <guacamole/stream.h>
 #include <guacamole/user.h>
 
+#include <limits.h>
 #include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
 #include <unistd.h>
 
 /**
@@ -45,6 +50,32 @@
  */
 #define GUAC_RDP_PRINT_JOB_TITLE_SEARCH_LENGTH 2048
 
+/**
+ * The number of bytes of filtered output read at once, both from the filter
+ * process and from the spool file. Each chunk is sent as as many blobs as the
+ * flow control window allows.
+ */
+#define GUAC_RDP_PRINT_JOB_CHUNK_SIZE 65536
+
+/**
+ * The template of the filename of the temporary file used to spool the
+ * filtered output of a print job, as accepted by mkstemp(). The file is
+ * created within the directory specified by the TMPDIR environment variable,
+ * or GUAC_RDP_PRINT_JOB_DEFAULT_TMPDIR if TMPDIR is not set, and is unlinked
+ * as soon as it is created.
+ */
+#define GUAC_RDP_PRINT_JOB_SPOOL_TEMPLATE "guacprint.XXXXXX"
+
+/**
+ * The directory within which print job output is spooled if the TMPDIR
+ * environment variable is not set.
+ */
+#ifdef P_tmpdir
+#define GUAC_RDP_PRINT_JOB_DEFAULT_TMPDIR P_tmpdir
+#else
+#define GUAC_RDP_PRINT_JOB_DEFAULT_TMPDIR "/tmp"
+#endif
+
 /**
  * The current state of an RDP print job.
  */
@@ -59,8 +90,8 @@ typedef enum guac_rdp_print_job_state {
     /**
      * The print stream has been opened with the Guacamole client, and the
      * client has responded with an "ack", confirming that it is ready to
-     * receive data (or that data has been received and it is ready to receive
-     * more).
+     * receive data. Data is sent as the flow control window of the print job
+     * allows.
      */
     GUAC_RDP_PRINT_JOB_ACK_RECEIVED,
 
@@ -118,21 +149,25 @@ typedef struct guac_rdp_print_job {
 
     /**
      * The current state of the print stream, dependent on whether the client
-     * has acknowledged creation of the stream, whether the client has
-     * acknowledged receipt of data along the steam, and whether the print
-     * stream itself has closed.
+     * has acknowledged creation of the stream and whether the print stream
+     * itself has closed.
      */
     guac_rdp_print_job_state state;
 
     /**
-     * Lock which is acquired prior to modifying the state property or waiting
-     * on the state_modified conditional.
+     * Flow control state for the blobs sent along the print stream.
+     */
+    guac_common_download_window window;
+
+    /**
+     * Lock which is acquired prior to modifying the state, window, or spool
+     * properties or waiting on the state_modified conditional.
      */
     pthread_mutex_t state_lock;
 
     /**
-     * Conditional which signals modification to the state property of this
-     * structure.
+     * Conditional which signals modification to the state, window, or spool
+     * properties of this structure.
      */
     pthread_cond_t state_modified;
 
@@ -141,6 +176,32 @@ typedef struct guac_rdp_print_job {
      */
     pthread_t output_thread;
 
+    /**
+     * File descriptor of the unlinked temporary file to which the output of
+     * the filter process is spooled, such that the filter process never waits
+     * for the Guacamole client to receive data, or -1 if the output is being
+     * read directly from the filter process.
+     */
+    int spool_fd;
+
+    /**
+     * Thread which copies the output of the filter process to the spool file.
+     * This thread runs only if spool_fd is not -1.
+     */
+    pthread_t spool_thread;
+
+    /**
+     * The number of bytes of filtered output written to the spool file thus
+     * far.
+     */
+    off_t spool_length;
+
+    /**
+     * Whether all output of the filter process has been written to the spool
+     * file.
+     */
+    int spool_complete;
+
     /**
      * The number of bytes received in the current print job.
      */
@@ -149,7 +210,7 @@ typedef struct guac_rdp_print_job {
 } guac_rdp_print_job;
 
 /**
- * A blob of print data being sent to the Guacamole user.
+ * A chunk of print data being sent to the Guacamole user as one or more blobs.
  */
 typedef struct guac_rdp_print_blob {
 
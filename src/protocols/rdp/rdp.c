@@ -489,8 +489,15 @@ static int guac_rdp_handle_connection(guac_client* client) {
      * heuristics) */
     guac_common_display_set_lossless(rdp_client->display, settings->lossless);
 
+    /* Stream rapidly-updating regions as video only if requested */
+    guac_common_display_set_video(rdp_client->display, settings->video_streaming);
+
     rdp_client->current_surface = rdp_client->display->default_surface;
 
+    /* Cache bitmaps within the display according to configured policy */
+    rdp_client->bitmap_cache = guac_rdp_bitmap_cache_alloc(client,
+            settings->bitmap_cache_threshold, settings->bitmap_cache_budget);
+
     rdp_client->available_svc = guac_common_list_alloc();
 
     /* Init client */
@@ -641,6 +648,9 @@ static int guac_rdp_handle_connection(guac_client* client) {
     freerdp_disconnect(rdp_inst);
     pthread_mutex_unlock(&(rdp_client->message_lock));
 
+    /* Stop using GDI framebuffer directly before it is freed */
+    guac_common_surface_unbind(rdp_client->display->default_surface);
+
     /* Clean up FreeRDP internal GDI implementation */
     gdi_free(rdp_inst);
 
@@ -659,6 +669,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
     guac_rdp_keyboard_free(rdp_client->keyboard);
     rdp_client->keyboard = NULL;
 
+    /* Free bitmap cache (all bitmaps have been freed along with FreeRDP) */
+    guac_rdp_bitmap_cache_free(rdp_client->bitmap_cache);
+    rdp_client->bitmap_cache = NULL;
+
     /* Free display */
     guac_common_display_free(rdp_client->display);
     rdp_client->display = NULL;
@@ -20,10 +20,12 @@
 #ifndef GUAC_RDP_H
 #define GUAC_RDP_H
 
+#include "bitmap.h"
 #include "channels/audio-input/audio-buffer.h"
 #include "channels/cliprdr.h"
 #include "channels/disp.h"
 #include "channels/rdpei.h"
+#include "channels/rdpgfx.h"
 #include "common/clipboard.h"
 #include "common/display.h"
 #include "common/list.h"
@@ -85,6 +87,12 @@ typedef struct guac_rdp_client {
      */
     guac_common_display* display;
 
+    /**
+     * Policy and state governing which bitmaps are cached within remote
+     * Guacamole buffers.
+     */
+    guac_rdp_bitmap_cache* bitmap_cache;
+
     /**
      * The surface that GDI operations should draw to. RDP messages exist which
      * change this surface to allow drawing to occur off-screen.
@@ -134,6 +142,12 @@ typedef struct guac_rdp_client {
      */
     guac_rdp_fs* filesystem;
 
+    /**
+     * All uploads to the shared filesystem which are currently in progress,
+     * as guac_rdp_upload_status structures.
+     */
+    guac_common_list* uploads;
+
     /**
      * The currently-active print job, or NULL if no print job is active.
      */
@@ -172,6 +186,11 @@ typedef struct guac_rdp_client {
      */
     guac_rdp_rdpei* rdpei;
 
+    /**
+     * Graphics Pipeline support module (RDPGFX).
+     */
+    guac_rdp_rdpgfx* rdpgfx;
+
     /**
      * List of all available static virtual channels.
      */
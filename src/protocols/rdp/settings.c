@@ -18,6 +18,7 @@
  */
 
 #include "argv.h"
+#include "common/clipboard.h"
 #include "common/defaults.h"
 #include "common/string.h"
 #include "config.h"
@@ -89,9 +90,12 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
     "enable-desktop-composition",
     "enable-menu-animations",
     "disable-bitmap-caching",
+    "bitmap-cache-threshold",
+    "bitmap-cache-budget",
     "disable-offscreen-caching",
     "disable-glyph-caching",
     "disable-gfx",
+    "enable-gfx-zero-copy",
     "preconnection-id",
     "preconnection-blob",
     "timezone",
@@ -143,6 +147,8 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
 
     "force-lossless",
     "normalize-clipboard",
+    "enable-video-streaming",
+    "clipboard-buffer-size",
     NULL
 };
 
@@ -371,6 +377,21 @@ enum RDP_ARGS_IDX {
      */
     IDX_DISABLE_BITMAP_CACHING,
 
+    /**
+     * The number of times a bitmap must be drawn before it is cached within a
+     * Guacamole buffer (and thus within the memory of the client) when drawn
+     * again. If omitted, GUAC_RDP_DEFAULT_BITMAP_CACHE_THRESHOLD is used.
+     */
+    IDX_BITMAP_CACHE_THRESHOLD,
+
+    /**
+     * The maximum total size of all bitmaps cached within Guacamole buffers,
+     * in megabytes, beyond which the least recently used bitmaps are evicted.
+     * Bitmaps used as offscreen drawing surfaces are not counted. If omitted,
+     * GUAC_RDP_DEFAULT_BITMAP_CACHE_BUDGET is used.
+     */
+    IDX_BITMAP_CACHE_BUDGET,
+
     /**
      * "true" if the offscreen caching should be disabled, false if offscreen
      * caching should remain enabled.
@@ -390,6 +411,16 @@ enum RDP_ARGS_IDX {
      */
     IDX_DISABLE_GFX,
 
+    /**
+     * "true" if the display surface should use the framebuffer maintained by
+     * FreeRDP for the RDP Graphics Pipeline Extension directly, rather than
+     * copying each update into a separate buffer, "false" or blank otherwise.
+     * Avoiding the copy reduces CPU and memory usage, but users joining a
+     * shared connection may briefly see partially-drawn frames, and every
+     * updated region is re-encoded in full even if only part of it changed.
+     */
+    IDX_ENABLE_GFX_ZERO_COPY,
+
     /**
      * The preconnection ID to send within the preconnection PDU when
      * initiating an RDP connection, if any.
@@ -677,6 +708,20 @@ enum RDP_ARGS_IDX {
      */
     IDX_NORMALIZE_CLIPBOARD,
 
+    /**
+     * "true" if rapidly-updating regions of the display may be streamed to
+     * users as video, "false" or blank otherwise. Video is only used if all
+     * connected users support it.
+     */
+    IDX_ENABLE_VIDEO_STREAMING,
+
+    /**
+     * The maximum number of bytes of clipboard data to accept in either
+     * direction. Larger clipboard data is truncated. If omitted,
+     * GUAC_COMMON_CLIPBOARD_MAX_LENGTH is used.
+     */
+    IDX_CLIPBOARD_BUFFER_SIZE,
+
     RDP_ARGS_COUNT
 };
 
@@ -837,6 +882,11 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, 0);
 
+    /* Video streaming */
+    settings->video_streaming =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_ENABLE_VIDEO_STREAMING, 0);
+
     /* Domain */
     settings->domain =
         guac_user_parse_args_string(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -919,6 +969,35 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_DISABLE_BITMAP_CACHING, 0);
 
+    /* Bitmap cache promotion threshold */
+    settings->bitmap_cache_threshold =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_BITMAP_CACHE_THRESHOLD,
+                GUAC_RDP_DEFAULT_BITMAP_CACHE_THRESHOLD);
+
+    if (settings->bitmap_cache_threshold < 0) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Bitmap cache threshold "
+                "cannot be negative. Using default threshold.");
+        settings->bitmap_cache_threshold =
+            GUAC_RDP_DEFAULT_BITMAP_CACHE_THRESHOLD;
+    }
+
+    /* Bitmap cache memory budget (parsed in megabytes) */
+    int bitmap_cache_budget =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_BITMAP_CACHE_BUDGET,
+                GUAC_RDP_DEFAULT_BITMAP_CACHE_BUDGET);
+
+    if (bitmap_cache_budget < 0
+            || bitmap_cache_budget > GUAC_RDP_MAX_BITMAP_CACHE_BUDGET) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Bitmap cache budget must be "
+                "between 0 and %i megabytes. Using default budget.",
+                GUAC_RDP_MAX_BITMAP_CACHE_BUDGET);
+        bitmap_cache_budget = GUAC_RDP_DEFAULT_BITMAP_CACHE_BUDGET;
+    }
+
+    settings->bitmap_cache_budget = bitmap_cache_budget * 1024 * 1024;
+
     settings->disable_offscreen_caching =
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_DISABLE_OFFSCREEN_CACHING, 0);
@@ -1163,6 +1242,11 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         !guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_DISABLE_GFX, 0);
 
+    /* Direct use of RDP Graphics Pipeline framebuffer */
+    settings->gfx_zero_copy =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_ENABLE_GFX_ZERO_COPY, 0);
+
     /* Session color depth */
     settings->color_depth =
         guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -1246,6 +1330,21 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         settings->clipboard_crlf = 0;
     }
 
+    /* Maximum clipboard size */
+    settings->clipboard_buffer_size =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_CLIPBOARD_BUFFER_SIZE, GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+
+    if (settings->clipboard_buffer_size < GUAC_COMMON_CLIPBOARD_MAX_LENGTH
+            || settings->clipboard_buffer_size
+                > GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Clipboard buffer size must be "
+                "between %i and %i bytes. Using default size.",
+                GUAC_COMMON_CLIPBOARD_MAX_LENGTH,
+                GUAC_COMMON_CLIPBOARD_MAX_BUFFER_SIZE);
+        settings->clipboard_buffer_size = GUAC_COMMON_CLIPBOARD_MAX_LENGTH;
+    }
+
 
     /* Parse Wake-on-LAN (WoL) settings */
     settings->wol_send_packet =
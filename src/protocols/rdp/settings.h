@@ -68,6 +68,24 @@
  */
 #define GUAC_RDP_DEFAULT_RECORDING_NAME "recording"
 
+/**
+ * The default number of times a bitmap must be drawn before it is cached
+ * within a Guacamole buffer when drawn again.
+ */
+#define GUAC_RDP_DEFAULT_BITMAP_CACHE_THRESHOLD 1
+
+/**
+ * The default maximum total size of all bitmaps cached within Guacamole
+ * buffers, in megabytes.
+ */
+#define GUAC_RDP_DEFAULT_BITMAP_CACHE_BUDGET 32
+
+/**
+ * The largest permitted maximum total size of all bitmaps cached within
+ * Guacamole buffers, in megabytes.
+ */
+#define GUAC_RDP_MAX_BITMAP_CACHE_BUDGET 1024
+
 /**
  * The number of entries contained within the OrderSupport BYTE array
  * referenced by the rdpSettings structure. This value is defined by the RDP
@@ -203,6 +221,12 @@ typedef struct guac_rdp_settings {
      */
     int lossless;
 
+    /**
+     * Whether rapidly-updating regions of the display may be streamed to
+     * users as video.
+     */
+    int video_streaming;
+
     /**
      * Whether audio is enabled.
      */
@@ -341,6 +365,12 @@ typedef struct guac_rdp_settings {
      */
     int clipboard_crlf;
 
+    /**
+     * The maximum number of bytes of clipboard data to accept in either
+     * direction.
+     */
+    int clipboard_buffer_size;
+
     /**
      * Whether the desktop wallpaper should be visible. If unset, the desktop
      * wallpaper will be hidden, reducing the amount of bandwidth required.
@@ -388,6 +418,18 @@ typedef struct guac_rdp_settings {
      */
     int disable_bitmap_caching;
 
+    /**
+     * The number of times a bitmap must be drawn before it is cached within
+     * a Guacamole buffer when drawn again.
+     */
+    int bitmap_cache_threshold;
+
+    /**
+     * The maximum total size of all bitmaps cached within Guacamole buffers
+     * which may be evicted to make room for other bitmaps, in bytes.
+     */
+    int bitmap_cache_budget;
+
     /**
      * Whether offscreen caching should be disabled. By default it is
      * enabled - this allows users to explicitly disable it.
@@ -562,6 +604,13 @@ typedef struct guac_rdp_settings {
      */
     int enable_gfx;
 
+    /**
+     * Whether the display surface should be backed directly by the GDI
+     * framebuffer maintained by FreeRDP when the RDP Graphics Pipeline
+     * Extension is in use, rather than by a copy of that framebuffer.
+     */
+    int gfx_zero_copy;
+
     /**
      * Whether multi-touch support is enabled.
      */
@@ -0,0 +1,354 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "fs.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <winpr/file.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of the test file, in bytes. This is large enough that reading the
+ * entire file sequentially requires the read-ahead buffer to grow to its
+ * maximum size.
+ */
+#define TEST_FILE_SIZE (4 * GUAC_RDP_FS_READ_AHEAD_MAX_SIZE)
+
+/**
+ * The number of bytes read by each read of the test file.
+ */
+#define TEST_READ_SIZE 4096
+
+/**
+ * Returns the value of the byte at the given offset within the test file.
+ *
+ * @param offset
+ *     The offset of the byte within the test file.
+ *
+ * @return
+ *     The value of the byte at the given offset.
+ */
+static char test_byte(int offset) {
+    return (char) ((offset * 7) ^ (offset >> 12));
+}
+
+/**
+ * Allocates a guac_rdp_fs within a new temporary directory containing a
+ * single test file, "\test.bin", of TEST_FILE_SIZE bytes.
+ *
+ * @param client
+ *     The guac_client to associate with the new filesystem.
+ *
+ * @param drive_path
+ *     A buffer of at least 32 bytes which receives the path of the new
+ *     temporary directory.
+ *
+ * @return
+ *     The newly-allocated filesystem.
+ */
+static guac_rdp_fs* test_fs_alloc(guac_client* client, char* drive_path) {
+
+    strcpy(drive_path, "/tmp/guac-test-fs.XXXXXX");
+    char* created = mkdtemp(drive_path);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(created);
+
+    guac_rdp_fs* fs = guac_rdp_fs_alloc(client, drive_path, 0, 0, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fs);
+
+    char* data = malloc(TEST_FILE_SIZE);
+    for (int i = 0; i < TEST_FILE_SIZE; i++)
+        data[i] = test_byte(i);
+
+    int file_id = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_WRITE, 0,
+            FILE_CREATE, 0);
+    CU_ASSERT_FATAL(file_id >= 0);
+    CU_ASSERT_EQUAL(guac_rdp_fs_write(fs, file_id, 0, data, TEST_FILE_SIZE),
+            TEST_FILE_SIZE);
+    guac_rdp_fs_close(fs, file_id);
+
+    free(data);
+    return fs;
+
+}
+
+/**
+ * Frees the given guac_rdp_fs, removing the test file and temporary
+ * directory created by test_fs_alloc().
+ *
+ * @param fs
+ *     The filesystem to free.
+ *
+ * @param drive_path
+ *     The path of the temporary directory containing the filesystem.
+ */
+static void test_fs_free(guac_rdp_fs* fs, const char* drive_path) {
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/test.bin", drive_path);
+
+    guac_rdp_fs_free(fs);
+    unlink(path);
+    rmdir(drive_path);
+
+}
+
+/**
+ * Verifies that the given buffer contains the contents of the test file at
+ * the given offset.
+ *
+ * @param buffer
+ *     The buffer to verify.
+ *
+ * @param offset
+ *     The offset within the test file that the buffer was read from.
+ *
+ * @param length
+ *     The number of bytes within the buffer.
+ *
+ * @return
+ *     Non-zero if the buffer matches the test file, zero otherwise.
+ */
+static int test_data_matches(const char* buffer, int offset, int length) {
+
+    for (int i = 0; i < length; i++) {
+        if (buffer[i] != test_byte(offset + i))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Test which verifies that data is read ahead only once reads are sequential,
+ * that the amount read ahead grows as sequential reads continue, and that the
+ * data read ahead is released once reads are no longer sequential.
+ */
+void test_fs__read_ahead_sequential() {
+
+    char drive_path[32];
+    char buffer[TEST_READ_SIZE];
+
+    guac_client* client = guac_client_alloc();
+    guac_rdp_fs* fs = test_fs_alloc(client, drive_path);
+
+    int file_id = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_READ, 0,
+            FILE_OPEN, 0);
+    CU_ASSERT_FATAL(file_id >= 0);
+    guac_rdp_fs_file* file = guac_rdp_fs_get_file(fs, file_id);
+
+    /* The first read of a file is not yet known to be sequential */
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, file_id, 0, buffer,
+                TEST_READ_SIZE), TEST_READ_SIZE);
+    CU_ASSERT(test_data_matches(buffer, 0, TEST_READ_SIZE));
+    CU_ASSERT_PTR_NULL(file->read_ahead);
+
+    /* Subsequent reads continuing the first should read ahead, with the
+     * amount read ahead eventually growing to the maximum */
+    int offset;
+    for (offset = TEST_READ_SIZE; offset < TEST_FILE_SIZE;
+            offset += TEST_READ_SIZE) {
+
+        CU_ASSERT_EQUAL_FATAL(guac_rdp_fs_read(fs, file_id, offset, buffer,
+                    TEST_READ_SIZE), TEST_READ_SIZE);
+        CU_ASSERT_FATAL(test_data_matches(buffer, offset, TEST_READ_SIZE));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(file->read_ahead);
+
+        if (offset == TEST_READ_SIZE)
+            CU_ASSERT_EQUAL(file->read_ahead_size,
+                    GUAC_RDP_FS_READ_AHEAD_MIN_SIZE);
+
+    }
+
+    CU_ASSERT_EQUAL(file->read_ahead_size, GUAC_RDP_FS_READ_AHEAD_MAX_SIZE);
+
+    /* Reads past the end of the file should be empty */
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, file_id, offset, buffer,
+                TEST_READ_SIZE), 0);
+
+    /* A read which does not continue the previous read ends read-ahead */
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, file_id, 12345, buffer,
+                TEST_READ_SIZE), TEST_READ_SIZE);
+    CU_ASSERT(test_data_matches(buffer, 12345, TEST_READ_SIZE));
+    CU_ASSERT_PTR_NULL(file->read_ahead);
+    CU_ASSERT_EQUAL(file->read_ahead_size, 0);
+
+    guac_rdp_fs_close(fs, file_id);
+    test_fs_free(fs, drive_path);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that writes to a file through one file ID discard any
+ * data read ahead through other file IDs referring to the same file.
+ */
+void test_fs__read_ahead_invalidate() {
+
+    char drive_path[32];
+    char buffer[TEST_READ_SIZE];
+    char modified[TEST_READ_SIZE];
+
+    guac_client* client = guac_client_alloc();
+    guac_rdp_fs* fs = test_fs_alloc(client, drive_path);
+
+    int reader = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_READ, 0,
+            FILE_OPEN, 0);
+    CU_ASSERT_FATAL(reader >= 0);
+
+    int writer = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_WRITE, 0,
+            FILE_OPEN, 0);
+    CU_ASSERT_FATAL(writer >= 0);
+
+    /* Begin reading ahead */
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, reader, 0, buffer,
+                TEST_READ_SIZE), TEST_READ_SIZE);
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, reader, TEST_READ_SIZE, buffer,
+                TEST_READ_SIZE), TEST_READ_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(guac_rdp_fs_get_file(fs, reader)->read_ahead);
+
+    /* Overwrite data which has already been read ahead */
+    memset(modified, 'X', sizeof(modified));
+    CU_ASSERT_EQUAL(guac_rdp_fs_write(fs, writer, 2 * TEST_READ_SIZE,
+                modified, TEST_READ_SIZE), TEST_READ_SIZE);
+
+    /* The next sequential read must reflect the write */
+    CU_ASSERT_EQUAL(guac_rdp_fs_read(fs, reader, 2 * TEST_READ_SIZE, buffer,
+                TEST_READ_SIZE), TEST_READ_SIZE);
+    CU_ASSERT(memcmp(buffer, modified, TEST_READ_SIZE) == 0);
+
+    guac_rdp_fs_close(fs, writer);
+    guac_rdp_fs_close(fs, reader);
+    test_fs_free(fs, drive_path);
+    guac_client_free(client);
+
+}
+
+/**
+ * The value written to every byte of the test file by
+ * test_fs_overwrite_thread().
+ */
+#define TEST_OVERWRITE_BYTE 'Y'
+
+/**
+ * The arguments of test_fs_overwrite_thread().
+ */
+typedef struct test_fs_overwrite_args {
+
+    /**
+     * The filesystem containing the file to overwrite.
+     */
+    guac_rdp_fs* fs;
+
+    /**
+     * The ID of the file to overwrite.
+     */
+    int file_id;
+
+} test_fs_overwrite_args;
+
+/**
+ * Thread which overwrites the entire test file with TEST_OVERWRITE_BYTE,
+ * TEST_READ_SIZE bytes at a time, much as an upload writes to a file from its
+ * own writer thread.
+ *
+ * @param data
+ *     A pointer to the test_fs_overwrite_args describing the file to
+ *     overwrite.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* test_fs_overwrite_thread(void* data) {
+
+    test_fs_overwrite_args* args = (test_fs_overwrite_args*) data;
+
+    char modified[TEST_READ_SIZE];
+    memset(modified, TEST_OVERWRITE_BYTE, sizeof(modified));
+
+    for (int offset = 0; offset < TEST_FILE_SIZE; offset += TEST_READ_SIZE)
+        guac_rdp_fs_write(args->fs, args->file_id, offset, modified,
+                TEST_READ_SIZE);
+
+    return NULL;
+
+}
+
+/**
+ * Test which verifies that data read ahead while another thread writes to the
+ * same file is not retained once the write completes, such that reads
+ * following the write always reflect its contents.
+ */
+void test_fs__read_ahead_concurrent() {
+
+    char drive_path[32];
+    char buffer[TEST_READ_SIZE];
+
+    guac_client* client = guac_client_alloc();
+    guac_rdp_fs* fs = test_fs_alloc(client, drive_path);
+
+    int reader = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_READ, 0,
+            FILE_OPEN, 0);
+    CU_ASSERT_FATAL(reader >= 0);
+
+    int writer = guac_rdp_fs_open(fs, "\\test.bin", GENERIC_WRITE, 0,
+            FILE_OPEN, 0);
+    CU_ASSERT_FATAL(writer >= 0);
+
+    test_fs_overwrite_args args = {
+        .fs = fs,
+        .file_id = writer
+    };
+
+    pthread_t overwrite_thread;
+    CU_ASSERT_EQUAL_FATAL(pthread_create(&overwrite_thread, NULL,
+                test_fs_overwrite_thread, &args), 0);
+
+    /* Read the first half of the file sequentially while it is overwritten,
+     * reading ahead throughout */
+    int offset;
+    for (offset = 0; offset < TEST_FILE_SIZE / 2; offset += TEST_READ_SIZE)
+        CU_ASSERT_EQUAL_FATAL(guac_rdp_fs_read(fs, reader, offset, buffer,
+                    TEST_READ_SIZE), TEST_READ_SIZE);
+
+    pthread_join(overwrite_thread, NULL);
+
+    /* Continuing to read sequentially must reflect the completed write */
+    for (; offset < TEST_FILE_SIZE; offset += TEST_READ_SIZE) {
+
+        CU_ASSERT_EQUAL_FATAL(guac_rdp_fs_read(fs, reader, offset, buffer,
+                    TEST_READ_SIZE), TEST_READ_SIZE);
+
+        for (int i = 0; i < TEST_READ_SIZE; i++)
+            CU_ASSERT_EQUAL_FATAL(buffer[i], TEST_OVERWRITE_BYTE);
+
+    }
+
+    guac_rdp_fs_close(fs, writer);
+    guac_rdp_fs_close(fs, reader);
+    test_fs_free(fs, drive_path);
+    guac_client_free(client);
+
+}
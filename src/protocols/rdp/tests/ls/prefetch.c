@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/listing.h"
+#include "fs.h"
+#include "ls.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The number of files created within the directory prefetched by the test.
+ */
+#define TEST_FILE_COUNT 10
+
+/**
+ * The maximum amount of time to wait for a directory to be prefetched, in
+ * milliseconds.
+ */
+#define TEST_PREFETCH_TIMEOUT 5000
+
+/**
+ * Test which verifies that guac_rdp_ls_prefetch() reads the listing of the
+ * given directory into the listing cache in the background, and that a
+ * filesystem can be freed while directories remain queued for prefetch.
+ */
+void test_ls__prefetch() {
+
+    char drive_path[32];
+    char path[64];
+
+    strcpy(drive_path, "/tmp/guac-test-ls.XXXXXX");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(drive_path));
+
+    /* Create a directory containing several files */
+    snprintf(path, sizeof(path), "%s/dir", drive_path);
+    CU_ASSERT_EQUAL_FATAL(mkdir(path, 0700), 0);
+
+    for (int i = 0; i < TEST_FILE_COUNT; i++) {
+        snprintf(path, sizeof(path), "%s/dir/file%i", drive_path, i);
+        FILE* file = fopen(path, "w");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+        fclose(file);
+    }
+
+    guac_client* client = guac_client_alloc();
+    guac_rdp_fs* fs = guac_rdp_fs_alloc(client, drive_path, 0, 0, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fs);
+
+    guac_rdp_ls_prefetch(fs, "\\dir");
+
+    /* Wait for the listing to appear within the cache */
+    guac_common_listing* listing = NULL;
+    guac_timestamp start = guac_timestamp_current();
+    while (listing == NULL
+            && guac_timestamp_current() - start < TEST_PREFETCH_TIMEOUT) {
+        listing = guac_common_listing_cache_get(fs->listing_cache, "\\dir",
+                guac_timestamp_current());
+        if (listing == NULL)
+            usleep(1000);
+    }
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(listing);
+    CU_ASSERT_EQUAL(listing->entries, TEST_FILE_COUNT);
+    CU_ASSERT_PTR_NOT_NULL(strstr(listing->json, "file0"));
+    guac_common_listing_free(listing);
+
+    /* Freeing the filesystem must stop prefetch even if directories remain
+     * queued */
+    for (int i = 0; i < GUAC_RDP_FS_PREFETCH_QUEUE_SIZE; i++)
+        guac_rdp_ls_prefetch(fs, "\\");
+
+    guac_rdp_fs_free(fs);
+    guac_client_free(client);
+
+    for (int i = 0; i < TEST_FILE_COUNT; i++) {
+        snprintf(path, sizeof(path), "%s/dir/file%i", drive_path, i);
+        unlink(path);
+    }
+
+    snprintf(path, sizeof(path), "%s/dir", drive_path);
+    rmdir(path);
+    rmdir(drive_path);
+
+}
+
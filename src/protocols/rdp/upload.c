@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include "common/list.h"
 #include "fs.h"
 #include "rdp.h"
 #include "upload.h"
@@ -29,7 +30,9 @@
 #include <guacamole/user.h>
 #include <winpr/nt.h>
 
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * Writes the given filename to the given upload path, sanitizing the filename
@@ -69,6 +72,272 @@ static void __generate_upload_path(const char* filename, char* path) {
 
 }
 
+/**
+ * Thread which writes each block of data handed to it by
+ * guac_rdp_upload_flush() to the file of the given upload, running until
+ * guac_rdp_upload_free() requests that it stop. The file may be open through
+ * the same guac_rdp_fs by the RDP server at the same time; writing through
+ * guac_rdp_fs_write() from this thread is safe only because the guac_rdp_fs
+ * guards its file table and read-ahead state with its own lock.
+ *
+ * @param data
+ *     A pointer to the guac_rdp_upload_status of the upload whose data
+ *     should be written.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdp_upload_writer_thread(void* data) {
+
+    guac_rdp_upload_status* upload_status = (guac_rdp_upload_status*) data;
+
+    pthread_mutex_lock(&(upload_status->lock));
+
+    for (;;) {
+
+        /* Wait for data to write or a request to stop */
+        while (upload_status->pending_length == 0 && !upload_status->stopping)
+            pthread_cond_wait(&(upload_status->modified),
+                    &(upload_status->lock));
+
+        /* Stop only once all data has been written */
+        if (upload_status->pending_length == 0)
+            break;
+
+        char* buffer = upload_status->pending;
+        int length = upload_status->pending_length;
+        uint64_t offset = upload_status->pending_offset;
+        int failed = 0;
+
+        /* The pending buffer is not modified until the write completes */
+        pthread_mutex_unlock(&(upload_status->lock));
+
+        /* Write entire block */
+        while (length > 0) {
+
+            /* Attempt write */
+            int bytes_written = guac_rdp_fs_write(upload_status->fs,
+                    upload_status->file_id, offset, buffer, length);
+
+            /* On error, abort */
+            if (bytes_written < 0) {
+                failed = 1;
+                break;
+            }
+
+            /* Update counters */
+            offset += bytes_written;
+            buffer += bytes_written;
+            length -= bytes_written;
+
+        }
+
+        /* Mark pending buffer as free */
+        pthread_mutex_lock(&(upload_status->lock));
+        upload_status->pending_length = 0;
+        upload_status->pending_failed |= failed;
+        pthread_cond_broadcast(&(upload_status->modified));
+
+    }
+
+    pthread_mutex_unlock(&(upload_status->lock));
+    return NULL;
+
+}
+
+/**
+ * Waits for the writer thread of the given upload to finish writing any
+ * pending data, updating the failure state of the upload accordingly. The
+ * lock of the upload must be held by the current thread.
+ *
+ * @param upload_status
+ *     The upload whose pending data should be waited for.
+ */
+static void guac_rdp_upload_wait(guac_rdp_upload_status* upload_status) {
+
+    while (upload_status->pending_length > 0)
+        pthread_cond_wait(&(upload_status->modified), &(upload_status->lock));
+
+    if (upload_status->pending_failed)
+        upload_status->failed = 1;
+
+}
+
+/**
+ * Hands all data buffered within the given upload to its writer thread,
+ * first waiting for any previous write to complete. The buffer of received
+ * data and the buffer being written are swapped, such that further data can
+ * be received while the write occurs.
+ *
+ * @param upload_status
+ *     The upload whose buffered data should be written.
+ *
+ * @return
+ *     Zero if the data was handed to the writer thread successfully,
+ *     non-zero if a previous write failed.
+ */
+static int guac_rdp_upload_flush(guac_rdp_upload_status* upload_status) {
+
+    pthread_mutex_lock(&(upload_status->lock));
+
+    guac_rdp_upload_wait(upload_status);
+    if (upload_status->failed || upload_status->length == 0) {
+        pthread_mutex_unlock(&(upload_status->lock));
+        return upload_status->failed;
+    }
+
+    /* Swap buffers, writing the data received thus far */
+    char* pending = upload_status->pending;
+    upload_status->pending = upload_status->buffer;
+    upload_status->pending_length = upload_status->length;
+    upload_status->pending_offset = upload_status->offset;
+
+    upload_status->buffer = pending;
+    upload_status->offset += upload_status->length;
+    upload_status->length = 0;
+
+    pthread_cond_broadcast(&(upload_status->modified));
+    pthread_mutex_unlock(&(upload_status->lock));
+    return 0;
+
+}
+
+/**
+ * Writes any data remaining within the given upload, stops its writer
+ * thread, and closes the file being written. The upload is removed from the
+ * list of active uploads of the given RDP client if the caller has not
+ * already done so, and all memory associated with the upload is freed.
+ *
+ * @param rdp_client
+ *     The RDP client associated with the upload.
+ *
+ * @param upload_status
+ *     The upload to free.
+ *
+ * @param remove
+ *     Non-zero if the upload should be removed from the list of active
+ *     uploads, zero if the caller has already removed the upload while
+ *     holding the lock of that list.
+ *
+ * @return
+ *     Zero if all data received for the upload was written successfully,
+ *     non-zero otherwise.
+ */
+static int guac_rdp_upload_free(guac_rdp_client* rdp_client,
+        guac_rdp_upload_status* upload_status, int remove) {
+
+    /* Remove from list of active uploads */
+    if (remove) {
+        guac_common_list_lock(rdp_client->uploads);
+        guac_common_list_element* current = rdp_client->uploads->head;
+        while (current != NULL) {
+            if (current->data == upload_status) {
+                guac_common_list_remove(rdp_client->uploads, current);
+                break;
+            }
+            current = current->next;
+        }
+        guac_common_list_unlock(rdp_client->uploads);
+    }
+
+    /* Write any remaining data */
+    guac_rdp_upload_flush(upload_status);
+
+    /* Stop writer thread once all data is written */
+    pthread_mutex_lock(&(upload_status->lock));
+    upload_status->stopping = 1;
+    pthread_cond_broadcast(&(upload_status->modified));
+    pthread_mutex_unlock(&(upload_status->lock));
+    pthread_join(upload_status->writer, NULL);
+
+    if (upload_status->pending_failed)
+        upload_status->failed = 1;
+
+    /* Close file */
+    guac_rdp_fs_close(upload_status->fs, upload_status->file_id);
+
+    int failed = upload_status->failed;
+
+    pthread_cond_destroy(&(upload_status->modified));
+    pthread_mutex_destroy(&(upload_status->lock));
+    free(upload_status->buffer);
+    free(upload_status->pending);
+    free(upload_status);
+
+    return failed;
+
+}
+
+/**
+ * Associates the given stream with a new upload of data to the file having
+ * the given ID, starting the writer thread of the upload and setting the
+ * stream handlers which receive the uploaded data. If the upload cannot be
+ * started, the file is closed.
+ *
+ * @param user
+ *     The user that is uploading the file.
+ *
+ * @param stream
+ *     The stream over which data will be received.
+ *
+ * @param fs
+ *     The filesystem containing the file being written.
+ *
+ * @param file_id
+ *     The ID of the open file to which data should be written.
+ *
+ * @return
+ *     Zero if the upload was started successfully, non-zero otherwise.
+ */
+static int guac_rdp_upload_begin(guac_user* user, guac_stream* stream,
+        guac_rdp_fs* fs, int file_id) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) user->client->data;
+
+    /* Init upload status */
+    guac_rdp_upload_status* upload_status = malloc(sizeof(guac_rdp_upload_status));
+    upload_status->offset = 0;
+    upload_status->file_id = file_id;
+    upload_status->buffer = malloc(GUAC_RDP_UPLOAD_BUFFER_SIZE);
+    upload_status->length = 0;
+    upload_status->failed = 0;
+    upload_status->fs = fs;
+    upload_status->user = user;
+    upload_status->pending = malloc(GUAC_RDP_UPLOAD_BUFFER_SIZE);
+    upload_status->pending_length = 0;
+    upload_status->pending_offset = 0;
+    upload_status->pending_failed = 0;
+    upload_status->stopping = 0;
+
+    pthread_mutex_init(&(upload_status->lock), NULL);
+    pthread_cond_init(&(upload_status->modified), NULL);
+
+    /* Start writer thread, which runs until the upload ends */
+    if (pthread_create(&(upload_status->writer), NULL,
+                guac_rdp_upload_writer_thread, upload_status)) {
+        guac_user_log(user, GUAC_LOG_ERROR, "Unable to start writer thread "
+                "for upload.");
+        guac_rdp_fs_close(fs, file_id);
+        pthread_cond_destroy(&(upload_status->modified));
+        pthread_mutex_destroy(&(upload_status->lock));
+        free(upload_status->buffer);
+        free(upload_status->pending);
+        free(upload_status);
+        return 1;
+    }
+
+    /* Track upload until it ends or its user leaves */
+    guac_common_list_lock(rdp_client->uploads);
+    guac_common_list_add(rdp_client->uploads, upload_status);
+    guac_common_list_unlock(rdp_client->uploads);
+
+    stream->data = upload_status;
+    stream->blob_handler = guac_rdp_upload_blob_handler;
+    stream->end_handler = guac_rdp_upload_end_handler;
+    return 0;
+
+}
+
 int guac_rdp_upload_file_handler(guac_user* user, guac_stream* stream,
         char* mimetype, char* filename) {
 
@@ -112,13 +381,13 @@ int guac_rdp_upload_file_handler(guac_user* user, guac_stream* stream,
         return 0;
     }
 
-    /* Init upload status */
-    guac_rdp_upload_status* upload_status = malloc(sizeof(guac_rdp_upload_status));
-    upload_status->offset = 0;
-    upload_status->file_id = file_id;
-    stream->data = upload_status;
-    stream->blob_handler = guac_rdp_upload_blob_handler;
-    stream->end_handler = guac_rdp_upload_end_handler;
+    /* Receive file data via stream */
+    if (guac_rdp_upload_begin(user, stream, fs, file_id)) {
+        guac_protocol_send_ack(user->socket, stream, "FAIL (CANNOT BEGIN)",
+                GUAC_PROTOCOL_STATUS_SERVER_ERROR);
+        guac_socket_flush(user->socket);
+        return 0;
+    }
 
     guac_protocol_send_ack(user->socket, stream, "OK (STREAM BEGIN)",
             GUAC_PROTOCOL_STATUS_SUCCESS);
@@ -130,7 +399,6 @@ int guac_rdp_upload_file_handler(guac_user* user, guac_stream* stream,
 int guac_rdp_upload_blob_handler(guac_user* user, guac_stream* stream,
         void* data, int length) {
 
-    int bytes_written;
     guac_rdp_upload_status* upload_status = (guac_rdp_upload_status*) stream->data;
 
     /* Get filesystem, return error if no filesystem */
@@ -144,29 +412,33 @@ int guac_rdp_upload_blob_handler(guac_user* user, guac_stream* stream,
         return 0;
     }
 
-    /* Write entire block */
-    while (length > 0) {
+    /* Buffer entire block, writing each buffer as it fills */
+    while (length > 0 && !upload_status->failed) {
 
-        /* Attempt write */
-        bytes_written = guac_rdp_fs_write(fs, upload_status->file_id,
-                upload_status->offset, data, length);
+        int available = GUAC_RDP_UPLOAD_BUFFER_SIZE - upload_status->length;
+        if (available > length)
+            available = length;
 
-        /* On error, abort */
-        if (bytes_written < 0) {
-            guac_protocol_send_ack(user->socket, stream,
-                    "FAIL (BAD WRITE)",
-                    GUAC_PROTOCOL_STATUS_CLIENT_FORBIDDEN);
-            guac_socket_flush(user->socket);
-            return 0;
-        }
+        memcpy(upload_status->buffer + upload_status->length, data, available);
+        upload_status->length += available;
+        data += available;
+        length -= available;
 
-        /* Update counters */
-        upload_status->offset += bytes_written;
-        data += bytes_written;
-        length -= bytes_written;
+        if (upload_status->length == GUAC_RDP_UPLOAD_BUFFER_SIZE)
+            guac_rdp_upload_flush(upload_status);
 
     }
 
+    /* On error, abort */
+    if (upload_status->failed) {
+        guac_protocol_send_ack(user->socket, stream,
+                "FAIL (BAD WRITE)",
+                GUAC_PROTOCOL_STATUS_CLIENT_FORBIDDEN);
+        guac_socket_flush(user->socket);
+        return 0;
+    }
+
+    /* Acknowledge data as soon as it is buffered */
     guac_protocol_send_ack(user->socket, stream, "OK (DATA RECEIVED)",
             GUAC_PROTOCOL_STATUS_SUCCESS);
     guac_socket_flush(user->socket);
@@ -180,24 +452,19 @@ int guac_rdp_upload_end_handler(guac_user* user, guac_stream* stream) {
     guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
     guac_rdp_upload_status* upload_status = (guac_rdp_upload_status*) stream->data;
 
-    /* Get filesystem, return error if no filesystem */
-    guac_rdp_fs* fs = rdp_client->filesystem;
-    if (fs == NULL) {
-        guac_protocol_send_ack(user->socket, stream, "FAIL (NO FS)",
-                GUAC_PROTOCOL_STATUS_SERVER_ERROR);
-        guac_socket_flush(user->socket);
-        return 0;
-    }
+    /* Write any remaining data, waiting for all writes to complete before
+     * closing the file */
+    int failed = guac_rdp_upload_free(rdp_client, upload_status, 1);
 
-    /* Close file */
-    guac_rdp_fs_close(fs, upload_status->file_id);
+    /* Acknowledge stream end, noting any failed writes */
+    if (failed)
+        guac_protocol_send_ack(user->socket, stream, "FAIL (BAD WRITE)",
+                GUAC_PROTOCOL_STATUS_CLIENT_FORBIDDEN);
+    else
+        guac_protocol_send_ack(user->socket, stream, "OK (STREAM END)",
+                GUAC_PROTOCOL_STATUS_SUCCESS);
 
-    /* Acknowledge stream end */
-    guac_protocol_send_ack(user->socket, stream, "OK (STREAM END)",
-            GUAC_PROTOCOL_STATUS_SUCCESS);
     guac_socket_flush(user->socket);
-
-    free(upload_status);
     return 0;
 
 }
@@ -241,15 +508,13 @@ int guac_rdp_upload_put_handler(guac_user* user, guac_object* object,
         return 0;
     }
 
-    /* Init upload stream data */
-    guac_rdp_upload_status* upload_status = malloc(sizeof(guac_rdp_upload_status));
-    upload_status->offset = 0;
-    upload_status->file_id = file_id;
-
-    /* Allocate stream, init for file upload */
-    stream->data = upload_status;
-    stream->blob_handler = guac_rdp_upload_blob_handler;
-    stream->end_handler = guac_rdp_upload_end_handler;
+    /* Init stream for file upload */
+    if (guac_rdp_upload_begin(user, stream, fs, file_id)) {
+        guac_protocol_send_ack(user->socket, stream, "FAIL (CANNOT BEGIN)",
+                GUAC_PROTOCOL_STATUS_SERVER_ERROR);
+        guac_socket_flush(user->socket);
+        return 0;
+    }
 
     /* Acknowledge stream creation */
     guac_protocol_send_ack(user->socket, stream, "OK (STREAM BEGIN)",
@@ -258,3 +523,31 @@ int guac_rdp_upload_put_handler(guac_user* user, guac_object* object,
     return 0;
 }
 
+void guac_rdp_upload_abort_all(guac_client* client, guac_user* user) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
+    guac_common_list_lock(rdp_client->uploads);
+
+    /* Abort each upload started by the given user */
+    guac_common_list_element* current = rdp_client->uploads->head;
+    while (current != NULL) {
+
+        guac_common_list_element* next = current->next;
+        guac_rdp_upload_status* upload_status =
+            (guac_rdp_upload_status*) current->data;
+
+        if (upload_status->user == user) {
+            guac_user_log(user, GUAC_LOG_DEBUG, "Aborting upload which was "
+                    "not ended before the user left.");
+            guac_common_list_remove(rdp_client->uploads, current);
+            guac_rdp_upload_free(rdp_client, upload_status, 0);
+        }
+
+        current = next;
+
+    }
+
+    guac_common_list_unlock(rdp_client->uploads);
+
+}
@@ -20,22 +20,35 @@
 #ifndef GUAC_RDP_UPLOAD_H
 #define GUAC_RDP_UPLOAD_H
 
-#include "common/json.h"
+#include "fs.h"
 
+#include <guacamole/client.h>
 #include <guacamole/protocol.h>
 #include <guacamole/stream.h>
 #include <guacamole/user.h>
 
+#include <pthread.h>
 #include <stdint.h>
 
 /**
- * Structure which represents the current state of an upload.
+ * The number of bytes of uploaded data to collect before writing to the
+ * destination file. Data is always written in whole buffers of this size,
+ * aside from the final write of an upload, such that each write begins at an
+ * offset which is a multiple of this size.
+ */
+#define GUAC_RDP_UPLOAD_BUFFER_SIZE 262144
+
+/**
+ * Structure which represents the current state of an upload. Received data is
+ * collected within one buffer while the previous buffer is written to the
+ * destination file by a writer thread dedicated to the upload, which runs for
+ * the lifetime of the upload.
  */
 typedef struct guac_rdp_upload_status {
 
     /**
-     * The overall offset within the file that the next write should
-     * occur at.
+     * The overall offset within the file that the contents of buffer should
+     * be written at.
      */
     uint64_t offset;
 
@@ -44,6 +57,80 @@ typedef struct guac_rdp_upload_status {
      */
     int file_id;
 
+    /**
+     * Data received but not yet handed to the writer thread.
+     */
+    char* buffer;
+
+    /**
+     * The number of bytes of data within buffer.
+     */
+    int length;
+
+    /**
+     * Non-zero if a write to the file has failed, in which case all further
+     * data is rejected. Failures of the writer thread are only reflected here
+     * once the data that thread was writing has been waited for.
+     */
+    int failed;
+
+    /**
+     * The filesystem containing the file being written.
+     */
+    guac_rdp_fs* fs;
+
+    /**
+     * The user that started the upload.
+     */
+    guac_user* user;
+
+    /**
+     * Data being written to the file by the writer thread. This buffer is
+     * owned by the writer thread while pending_length is non-zero.
+     */
+    char* pending;
+
+    /**
+     * The number of bytes of data within pending that have not yet been
+     * written, or zero if the writer thread is idle.
+     */
+    int pending_length;
+
+    /**
+     * The overall offset within the file that the contents of pending are
+     * being written at.
+     */
+    uint64_t pending_offset;
+
+    /**
+     * Non-zero if the writer thread failed to write the contents of pending.
+     */
+    int pending_failed;
+
+    /**
+     * Non-zero if the writer thread should stop once all pending data has
+     * been written.
+     */
+    int stopping;
+
+    /**
+     * Lock which guards all pending_* members and stopping, which are shared
+     * with the writer thread.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever pending data is handed to the
+     * writer thread, pending data has been written, or the writer thread has
+     * been asked to stop.
+     */
+    pthread_cond_t modified;
+
+    /**
+     * Thread which writes the contents of pending to the file.
+     */
+    pthread_t writer;
+
 } guac_rdp_upload_status;
 
 /**
@@ -68,5 +155,20 @@ guac_user_end_handler guac_rdp_upload_end_handler;
  */
 guac_user_put_handler guac_rdp_upload_put_handler;
 
+/**
+ * Aborts all uploads started by the given user which have not yet ended,
+ * closing the files being written and stopping their writer threads. This
+ * function must be invoked when a user leaves, as the streams of that user
+ * will never receive the end instructions that would otherwise free the
+ * resources of their uploads.
+ *
+ * @param client
+ *     The guac_client associated with the RDP connection.
+ *
+ * @param user
+ *     The user whose uploads should be aborted.
+ */
+void guac_rdp_upload_abort_all(guac_client* client, guac_user* user);
+
 #endif
 
@@ -68,6 +68,10 @@ int guac_rdp_user_join_handler(guac_user* user, int argc, char** argv) {
         /* Store owner's settings at client level */
         rdp_client->settings = settings;
 
+        /* Init clipboard, sized according to the owner's settings */
+        rdp_client->clipboard = guac_rdp_clipboard_alloc(user->client,
+                settings->clipboard_buffer_size);
+
         /* Start client thread */
         if (pthread_create(&rdp_client->client_thread, NULL,
                     guac_rdp_client_thread, user->client)) {
@@ -168,6 +172,9 @@ int guac_rdp_user_leave_handler(guac_user* user) {
     /* Update shared cursor state */
     guac_common_cursor_remove_user(rdp_client->display->cursor, user);
 
+    /* Abort any uploads the user did not end */
+    guac_rdp_upload_abort_all(user->client, user);
+
     /* Free settings if not owner (owner settings will be freed with client) */
     if (!user->owner) {
         guac_rdp_settings* settings = (guac_rdp_settings*) user->data;
@@ -54,6 +54,24 @@ int guac_ssh_argv_callback(guac_user* user, const char* mimetype,
                     ssh_client->settings->resolution);
     }
 
+    /* Search scrollback, leaving terminal dimensions untouched */
+    else if (strcmp(name, GUAC_SSH_ARGV_SEARCH) == 0) {
+
+        /* Reply with the row of the match, or with an empty value if there
+         * are no further matches */
+        char result[64] = "";
+        int row;
+        if (!guac_terminal_search(terminal, value, &row))
+            snprintf(result, sizeof(result), "%i", row);
+
+        guac_user_stream_argv(user, user->socket, "text/plain",
+                GUAC_SSH_ARGV_SEARCH, result);
+        guac_socket_flush(user->socket);
+
+        return 0;
+
+    }
+
     /* Update SSH pty size if connected */
     int term_width = guac_terminal_get_columns(terminal);
     int term_height = guac_terminal_get_rows(terminal);
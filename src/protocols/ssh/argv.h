@@ -44,6 +44,16 @@
  */
 #define GUAC_SSH_ARGV_FONT_SIZE "font-size"
 
+/**
+ * The name of the parameter that requests a search of the terminal
+ * scrollback for the given text. Each value received scrolls the terminal to
+ * the next older match, if any. The requesting user is sent a value for this
+ * same parameter in reply, containing the row of the match (where row 0 is the
+ * top-most row of the terminal and rows within the scrollback are negative),
+ * or an empty value if there are no further matches.
+ */
+#define GUAC_SSH_ARGV_SEARCH "terminal-search"
+
 /**
  * Handles a received argument value from a Guacamole "argv" instruction,
  * updating the given connection parameter.
@@ -53,6 +53,7 @@ int guac_client_init(guac_client* client) {
     guac_argv_register(GUAC_SSH_ARGV_COLOR_SCHEME, guac_ssh_argv_callback, NULL, GUAC_ARGV_OPTION_ECHO);
     guac_argv_register(GUAC_SSH_ARGV_FONT_NAME, guac_ssh_argv_callback, NULL, GUAC_ARGV_OPTION_ECHO);
     guac_argv_register(GUAC_SSH_ARGV_FONT_SIZE, guac_ssh_argv_callback, NULL, GUAC_ARGV_OPTION_ECHO);
+    guac_argv_register(GUAC_SSH_ARGV_SEARCH, guac_ssh_argv_callback, NULL, 0);
 
     /* Set locale and warn if not UTF-8 */
     setlocale(LC_CTYPE, "");
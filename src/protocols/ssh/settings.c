@@ -55,6 +55,7 @@ const char* GUAC_SSH_CLIENT_ARGS[] = {
     "typescript-path",
     "typescript-name",
     "create-typescript-path",
+    "compress-typescript",
     "recording-path",
     "recording-name",
     "recording-exclude-output",
@@ -66,6 +67,7 @@ const char* GUAC_SSH_CLIENT_ARGS[] = {
     "backspace",
     "terminal-type",
     "scrollback",
+    "frame-policy",
     "locale",
     "timezone",
     "disable-copy",
@@ -190,6 +192,12 @@ enum SSH_ARGS_IDX {
      */
     IDX_CREATE_TYPESCRIPT_PATH,
 
+    /**
+     * Whether the typescript data file should be compressed with gzip. The
+     * timing file is never compressed.
+     */
+    IDX_COMPRESS_TYPESCRIPT,
+
     /**
      * The full absolute path to the directory in which screen recordings
      * should be written.
@@ -265,6 +273,14 @@ enum SSH_ARGS_IDX {
      */
     IDX_SCROLLBACK,
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     * This may be either "adaptive" (the default), where frames are as short
+     * as possible for interactive output and grow longer under sustained
+     * output, or "fixed", where frame duration does not vary.
+     */
+    IDX_FRAME_POLICY,
+
     /**
      * The locale that should be forwarded to the remote system via the LANG
      * environment variable. By default, no locale is forwarded. This setting
@@ -378,6 +394,20 @@ guac_ssh_settings* guac_ssh_parse_args(guac_user* user,
         guac_user_parse_args_int(user, GUAC_SSH_CLIENT_ARGS, argv,
                 IDX_SCROLLBACK, GUAC_TERMINAL_DEFAULT_MAX_SCROLLBACK);
 
+    /* Use fixed frame durations if requested */
+    if (strcmp(argv[IDX_FRAME_POLICY], "fixed") == 0)
+        settings->frame_policy = GUAC_TERMINAL_FRAME_POLICY_FIXED;
+
+    /* Use adaptive frame durations by default */
+    else {
+        if (argv[IDX_FRAME_POLICY][0] != '\0'
+                && strcmp(argv[IDX_FRAME_POLICY], "adaptive") != 0)
+            guac_user_log(user, GUAC_LOG_WARNING, "Invalid frame policy: "
+                    "\"%s\". Using adaptive frame policy.",
+                    argv[IDX_FRAME_POLICY]);
+        settings->frame_policy = GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE;
+    }
+
     /* Read font name */
     settings->font_name =
         guac_user_parse_args_string(user, GUAC_SSH_CLIENT_ARGS, argv,
@@ -454,6 +484,11 @@ guac_ssh_settings* guac_ssh_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_SSH_CLIENT_ARGS, argv,
                 IDX_CREATE_TYPESCRIPT_PATH, false);
 
+    /* Parse typescript compression flag */
+    settings->compress_typescript =
+        guac_user_parse_args_boolean(user, GUAC_SSH_CLIENT_ARGS, argv,
+                IDX_COMPRESS_TYPESCRIPT, false);
+
     /* Read recording path */
     settings->recording_path =
         guac_user_parse_args_string(user, GUAC_SSH_CLIENT_ARGS, argv,
@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include "terminal/terminal.h"
+
 #include <guacamole/user.h>
 
 #include <stdbool.h>
@@ -109,6 +111,11 @@ typedef struct guac_ssh_settings {
      */
     int max_scrollback;
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     */
+    guac_terminal_frame_policy frame_policy;
+
     /**
      * The name of the font to use for display rendering.
      */
@@ -202,6 +209,11 @@ typedef struct guac_ssh_settings {
      */
     bool create_typescript_path;
 
+    /**
+     * Whether the typescript data file should be written as a gzip stream.
+     */
+    bool compress_typescript;
+
     /**
      * The path in which the screen recording should be saved, if enabled. If
      * no screen recording should be saved, this will be NULL.
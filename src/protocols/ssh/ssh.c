@@ -251,6 +251,7 @@ void* ssh_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->frame_policy = settings->frame_policy;
 
     /* Create terminal */
     ssh_client->term = guac_terminal_create(client, options);
@@ -273,7 +274,8 @@ void* ssh_client_thread(void* data) {
         guac_terminal_create_typescript(ssh_client->term,
                 settings->typescript_path,
                 settings->typescript_name,
-                settings->create_typescript_path);
+                settings->create_typescript_path,
+                settings->compress_typescript);
     }
 
     /* Get user and credentials */
@@ -53,6 +53,24 @@ int guac_telnet_argv_callback(guac_user* user, const char* mimetype,
                     telnet_client->settings->resolution);
     }
 
+    /* Search scrollback, leaving terminal dimensions untouched */
+    else if (strcmp(name, GUAC_TELNET_ARGV_SEARCH) == 0) {
+
+        /* Reply with the row of the match, or with an empty value if there
+         * are no further matches */
+        char result[64] = "";
+        int row;
+        if (!guac_terminal_search(terminal, value, &row))
+            snprintf(result, sizeof(result), "%i", row);
+
+        guac_user_stream_argv(user, user->socket, "text/plain",
+                GUAC_TELNET_ARGV_SEARCH, result);
+        guac_socket_flush(user->socket);
+
+        return 0;
+
+    }
+
     /* Update terminal window size if connected */
     if (telnet_client->telnet != NULL && telnet_client->naws_enabled)
         guac_telnet_send_naws(telnet_client->telnet,
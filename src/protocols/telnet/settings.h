@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include "terminal/terminal.h"
+
 #include <guacamole/user.h>
 
 #include <sys/types.h>
@@ -124,6 +126,11 @@ typedef struct guac_telnet_settings {
      */
     int max_scrollback;
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     */
+    guac_terminal_frame_policy frame_policy;
+
     /**
      * The name of the font to use for display rendering.
      */
@@ -185,6 +192,11 @@ typedef struct guac_telnet_settings {
      */
     bool create_typescript_path;
 
+    /**
+     * Whether the typescript data file should be written as a gzip stream.
+     */
+    bool compress_typescript;
+
     /**
      * The path in which the screen recording should be saved, if enabled. If
      * no screen recording should be saved, this will be NULL.
@@ -599,6 +599,7 @@ void* guac_telnet_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->frame_policy = settings->frame_policy;
 
     /* Create terminal */
     telnet_client->term = guac_terminal_create(client, options);
@@ -622,7 +623,8 @@ void* guac_telnet_client_thread(void* data) {
         guac_terminal_create_typescript(telnet_client->term,
                 settings->typescript_path,
                 settings->typescript_name,
-                settings->create_typescript_path);
+                settings->create_typescript_path,
+                settings->compress_typescript);
     }
 
     /* Open telnet session */
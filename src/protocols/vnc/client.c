@@ -55,7 +55,8 @@ int guac_client_init(guac_client* client) {
 #endif
 
     /* Init clipboard */
-    vnc_client->clipboard = guac_common_clipboard_alloc();
+    vnc_client->clipboard =
+        guac_common_clipboard_alloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
 
     /* Set handlers */
     client->join_handler = guac_vnc_user_join_handler;
@@ -136,6 +137,12 @@ int guac_vnc_client_free_handler(guac_client* client) {
     if (vnc_client->display != NULL)
         guac_common_display_free(vnc_client->display);
 
+    /* Free pixel format conversion state */
+    if (vnc_client->converter != NULL)
+        guac_common_pixel_converter_free(vnc_client->converter);
+
+    free(vnc_client->update_buffer);
+
 #ifdef ENABLE_PULSE
     /* If audio enabled, stop streaming */
     if (vnc_client->audio)
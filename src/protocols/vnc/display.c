@@ -21,6 +21,7 @@
 
 #include "client.h"
 #include "common/iconv.h"
+#include "common/pixel-format.h"
 #include "common/surface.h"
 #include "vnc.h"
 
@@ -41,20 +42,68 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <syslog.h>
 
+/**
+ * Returns a converter for the current pixel format of the VNC framebuffer,
+ * reusing the previously-selected converter unless the pixel format has
+ * changed.
+ *
+ * @param client
+ *     The rfbClient associated with the VNC connection.
+ *
+ * @return
+ *     A converter for the current pixel format of the VNC framebuffer, or
+ *     NULL if that pixel format is not supported.
+ */
+static guac_common_pixel_converter* guac_vnc_get_converter(
+        rfbClient* client) {
+
+    guac_client* gc = rfbClientGetClientData(client, GUAC_VNC_CLIENT_KEY);
+    guac_vnc_client* vnc_client = (guac_vnc_client*) gc->data;
+
+    guac_common_pixel_format format = {
+        .bits_per_pixel = client->format.bitsPerPixel,
+        .red_shift      = client->format.redShift,
+        .green_shift    = client->format.greenShift,
+        .blue_shift     = client->format.blueShift,
+        .red_max        = client->format.redMax,
+        .green_max      = client->format.greenMax,
+        .blue_max       = client->format.blueMax,
+        .swap_red_blue  = vnc_client->settings->swap_red_blue
+    };
+
+    /* Reuse existing converter if format is unchanged */
+    guac_common_pixel_converter* converter = vnc_client->converter;
+    if (converter != NULL && guac_common_pixel_format_equals(
+                guac_common_pixel_converter_get_format(converter), &format))
+        return converter;
+
+    if (converter != NULL)
+        guac_common_pixel_converter_free(converter);
+
+    converter = guac_common_pixel_converter_alloc(&format);
+    if (converter == NULL)
+        guac_client_log(gc, GUAC_LOG_WARNING, "Unsupported VNC pixel format "
+                "(%i bits per pixel). Display updates will be ignored.",
+                format.bits_per_pixel);
+
+    vnc_client->converter = converter;
+    return converter;
+
+}
+
 void guac_vnc_update(rfbClient* client, int x, int y, int w, int h) {
 
     guac_client* gc = rfbClientGetClientData(client, GUAC_VNC_CLIENT_KEY);
     guac_vnc_client* vnc_client = (guac_vnc_client*) gc->data;
 
-    int dx, dy;
+    int dy;
 
     /* Cairo image buffer */
     int stride;
     unsigned char* buffer;
-    unsigned char* buffer_row_current;
-    cairo_surface_t* surface;
 
     /* VNC framebuffer */
     unsigned int bpp;
@@ -67,74 +116,60 @@ void guac_vnc_update(rfbClient* client, int x, int y, int w, int h) {
         return;
     }
 
-    /* Init Cairo buffer */
-    stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, w);
-    buffer = malloc(h*stride);
-    buffer_row_current = buffer;
+    guac_common_surface* surface = vnc_client->display->default_surface;
+
+    /* If the framebuffer is shared with the default surface, the update has
+     * already been written and need only be marked as damaged */
+    if (surface->bound && surface->buffer == client->frameBuffer) {
+        guac_common_surface_invalidate(surface, x, y, w, h);
+        return;
+    }
+
+    guac_common_pixel_converter* converter = guac_vnc_get_converter(client);
+    if (converter == NULL)
+        return;
 
     bpp = client->format.bitsPerPixel/8;
     fb_stride = bpp * client->width;
     fb_row_current = client->frameBuffer + (y * fb_stride) + (x * bpp);
 
-    /* Copy image data from VNC client to PNG */
-    for (dy = y; dy<y+h; dy++) {
-
-        unsigned int*  buffer_current;
-        unsigned char* fb_current;
-        
-        /* Get current buffer row, advance to next */
-        buffer_current      = (unsigned int*) buffer_row_current;
-        buffer_row_current += stride;
-
-        /* Get current framebuffer row, advance to next */
-        fb_current      = fb_row_current;
-        fb_row_current += fb_stride;
-
-        for (dx = x; dx<x+w; dx++) {
-
-            unsigned char red, green, blue;
-            unsigned int v;
-
-            switch (bpp) {
-                case 4:
-                    v = *((uint32_t*)  fb_current);
-                    break;
-
-                case 2:
-                    v = *((uint16_t*) fb_current);
-                    break;
+    /* Use framebuffer directly if no conversion is necessary */
+    if (guac_common_pixel_converter_is_identity(converter)) {
+        buffer = fb_row_current;
+        stride = fb_stride;
+    }
 
-                default:
-                    v = *((uint8_t*)  fb_current);
-            }
+    /* Otherwise, convert image data from VNC client into reusable buffer */
+    else {
 
-            /* Translate value to RGB */
-            red   = (v >> client->format.redShift)   * 0x100 / (client->format.redMax  + 1);
-            green = (v >> client->format.greenShift) * 0x100 / (client->format.greenMax+ 1);
-            blue  = (v >> client->format.blueShift)  * 0x100 / (client->format.blueMax + 1);
+        stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, w);
 
-            /* Output RGB */
-            if (vnc_client->settings->swap_red_blue)
-                *(buffer_current++) = (blue << 16) | (green << 8) | red;
-            else
-                *(buffer_current++) = (red  << 16) | (green << 8) | blue;
+        /* Grow buffer if necessary */
+        if (vnc_client->update_buffer_size < h*stride) {
+            free(vnc_client->update_buffer);
+            vnc_client->update_buffer = malloc(h*stride);
+            vnc_client->update_buffer_size = h*stride;
+        }
 
-            fb_current += bpp;
+        buffer = vnc_client->update_buffer;
 
+        for (dy = 0; dy < h; dy++) {
+            guac_common_pixel_convert_row(converter,
+                    (uint32_t*) (buffer + dy*stride), fb_row_current, w);
+            fb_row_current += fb_stride;
         }
+
     }
 
     /* Create surface from decoded buffer */
-    surface = cairo_image_surface_create_for_data(buffer, CAIRO_FORMAT_RGB24,
-            w, h, stride);
+    cairo_surface_t* image = cairo_image_surface_create_for_data(buffer,
+            CAIRO_FORMAT_RGB24, w, h, stride);
 
     /* Draw directly to default layer */
-    guac_common_surface_draw(vnc_client->display->default_surface,
-            x, y, surface);
+    guac_common_surface_draw(surface, x, y, image);
 
     /* Free surface */
-    cairo_surface_destroy(surface);
-    free(buffer);
+    cairo_surface_destroy(image);
 
 }
 
@@ -191,17 +226,59 @@ void guac_vnc_set_pixel_format(rfbClient* client, int color_depth) {
     }
 }
 
+void guac_vnc_bind_framebuffer(rfbClient* rfb_client) {
+
+    guac_client* gc = rfbClientGetClientData(rfb_client, GUAC_VNC_CLIENT_KEY);
+    guac_vnc_client* vnc_client = (guac_vnc_client*) gc->data;
+    guac_common_surface* surface = vnc_client->display->default_surface;
+
+    if (rfb_client->frameBuffer == NULL)
+        return;
+
+    /* Memory can be shared only if the framebuffer is already in the format
+     * of the surface */
+    guac_common_pixel_converter* converter = guac_vnc_get_converter(rfb_client);
+    if (converter == NULL || !guac_common_pixel_converter_is_identity(converter))
+        return;
+
+    int width = rfb_client->width;
+    int height = rfb_client->height;
+    int fb_stride = width * 4;
+
+    /* The framebuffer has only just been allocated and is uninitialized, so
+     * carry over whatever the surface currently contains */
+    if (surface->width == width && surface->height == height) {
+        int y;
+        for (y = 0; y < height; y++)
+            memcpy(rfb_client->frameBuffer + y * fb_stride,
+                    surface->buffer + y * surface->stride, fb_stride);
+    }
+
+    guac_common_surface_bind(surface, rfb_client->frameBuffer, fb_stride,
+            width, height, 1);
+
+}
+
 rfbBool guac_vnc_malloc_framebuffer(rfbClient* rfb_client) {
 
     guac_client* gc = rfbClientGetClientData(rfb_client, GUAC_VNC_CLIENT_KEY);
     guac_vnc_client* vnc_client = (guac_vnc_client*) gc->data;
 
-    /* Resize surface */
-    if (vnc_client->display != NULL)
+    /* Resize surface, first giving it its own copy of any framebuffer it
+     * shares, as the original proc will free that framebuffer */
+    if (vnc_client->display != NULL) {
+        guac_common_surface_unbind(vnc_client->display->default_surface);
         guac_common_surface_resize(vnc_client->display->default_surface,
                 rfb_client->width, rfb_client->height);
+    }
 
     /* Use original, wrapped proc */
-    return vnc_client->rfb_MallocFrameBuffer(rfb_client);
+    rfbBool result = vnc_client->rfb_MallocFrameBuffer(rfb_client);
+
+    /* Share the new framebuffer with the surface, if possible */
+    if (result && vnc_client->display != NULL)
+        guac_vnc_bind_framebuffer(rfb_client);
+
+    return result;
 }
 
@@ -100,9 +100,26 @@ void guac_vnc_copyrect(rfbClient* client, int src_x, int src_y, int w, int h,
  */
 void guac_vnc_set_pixel_format(rfbClient* client, int color_depth);
 
+/**
+ * Shares the VNC framebuffer with the default surface of the display, such
+ * that updates from the VNC server are written directly into the surface and
+ * need only be marked as damaged. The current contents of the surface are
+ * copied into the framebuffer. If the pixel format of the framebuffer differs
+ * from that of the surface, this function has no effect, and updates are
+ * converted and drawn to the surface as they are received.
+ *
+ * @param rfb_client
+ *     The VNC client associated with the VNC session whose framebuffer
+ *     should be shared. The display of that session must already be
+ *     allocated.
+ */
+void guac_vnc_bind_framebuffer(rfbClient* rfb_client);
+
 /**
  * Overridden implementation of the rfb_MallocFrameBuffer function invoked by
  * libVNCServer when the display is being resized (or initially allocated).
+ * If the display has already been allocated, the default surface is resized
+ * to match, and the new framebuffer is shared with that surface if possible.
  *
  * @param client
  *     The VNC client associated with the VNC session whose display needs to be
@@ -93,6 +93,7 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "wol-wait-time",
 
     "force-lossless",
+    "enable-video-streaming",
     NULL
 };
 
@@ -381,6 +382,13 @@ enum VNC_ARGS_IDX {
      */
     IDX_FORCE_LOSSLESS,
 
+    /**
+     * "true" if rapidly-updating regions of the display may be streamed to
+     * users as video, "false" or blank otherwise. Video is only used if all
+     * connected users support it.
+     */
+    IDX_ENABLE_VIDEO_STREAMING,
+
     VNC_ARGS_COUNT
 };
 
@@ -445,6 +453,11 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, false);
 
+    /* Video streaming */
+    settings->video_streaming =
+        guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_ENABLE_VIDEO_STREAMING, false);
+
 #ifdef ENABLE_VNC_REPEATER
     /* Set repeater parameters if specified */
     settings->dest_host =
@@ -83,6 +83,12 @@ typedef struct guac_vnc_settings {
      */
     bool lossless;
 
+    /**
+     * Whether rapidly-updating regions of the display may be streamed to
+     * users as video.
+     */
+    bool video_streaming;
+
 #ifdef ENABLE_VNC_REPEATER
     /**
      * The VNC host to connect to, if using a repeater.
@@ -439,6 +439,12 @@ void* guac_vnc_client_thread(void* data) {
      * heuristics) */
     guac_common_display_set_lossless(vnc_client->display, settings->lossless);
 
+    /* Stream rapidly-updating regions as video only if requested */
+    guac_common_display_set_video(vnc_client->display, settings->video_streaming);
+
+    /* Avoid copying updates into the display where possible */
+    guac_vnc_bind_framebuffer(rfb_client);
+
     /* If not read-only, set an appropriate cursor */
     if (settings->read_only == 0) {
         if (settings->remote_cursor)
@@ -25,6 +25,7 @@
 #include "common/clipboard.h"
 #include "common/display.h"
 #include "common/iconv.h"
+#include "common/pixel-format.h"
 #include "common/surface.h"
 #include "settings.h"
 
@@ -90,6 +91,23 @@ typedef struct guac_vnc_client {
      */
     guac_common_display* display;
 
+    /**
+     * Converter for the pixel format of the VNC framebuffer, or NULL if the
+     * pixel format has not yet been examined.
+     */
+    guac_common_pixel_converter* converter;
+
+    /**
+     * Buffer receiving the converted image data of each update, reused
+     * across updates, or NULL if no conversion has yet been necessary.
+     */
+    unsigned char* update_buffer;
+
+    /**
+     * The size of update_buffer, in bytes.
+     */
+    int update_buffer_size;
+
     /**
      * Internal clipboard.
      */
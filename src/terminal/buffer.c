@@ -20,6 +20,7 @@
 
 #include "terminal/buffer.h"
 #include "terminal/common.h"
+#include "terminal/search.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -48,6 +49,7 @@ guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* d
         /* Allocate row  */
         row->available = 256;
         row->length = 0;
+        row->search_mask = 0;
         row->characters = malloc(sizeof(guac_terminal_char) * row->available);
 
         /* Next row */
@@ -165,6 +167,7 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
         /* Copy data */
         memcpy(dst_row->characters, src_row->characters, sizeof(guac_terminal_char) * src_row->length);
         dst_row->length = src_row->length;
+        dst_row->search_mask = src_row->search_mask;
 
         /* Next current_row */
         current_row += step;
@@ -192,6 +195,14 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
     /* Get and expand row */
     guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column+1);
 
+    /* Update search index, discarding stale bits if the entire row is being
+     * overwritten */
+    uint64_t search_mask = guac_terminal_search_mask(character->value);
+    if (start_column <= 0 && end_column + 1 >= buffer_row->length)
+        buffer_row->search_mask = search_mask;
+    else
+        buffer_row->search_mask |= search_mask;
+
     /* Set values */
     current = &(buffer_row->characters[start_column]);
     for (i = start_column; i <= end_column; i += character->width) {
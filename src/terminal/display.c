@@ -465,15 +465,62 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
 }
 
+/**
+ * Returns whether any pending GUAC_CHAR_COPY operation within the given
+ * display copies from a character cell which would lie outside the display
+ * if the display were resized to the given dimensions.
+ *
+ * @param display
+ *     The display whose pending operations should be checked.
+ *
+ * @param width
+ *     The new width of the display, in characters.
+ *
+ * @param height
+ *     The new height of the display, in characters.
+ *
+ * @return
+ *     true if at least one pending copy would read from outside the resized
+ *     display, false otherwise.
+ */
+static bool guac_terminal_display_copies_outside(guac_terminal_display* display,
+        int width, int height) {
+
+    /* Nothing can lie outside a display which is not shrinking */
+    if (width >= display->width && height >= display->height)
+        return false;
+
+    guac_terminal_operation* current = display->operations;
+    int count = display->width * display->height;
+
+    for (; count > 0; count--, current++) {
+        if (current->type == GUAC_CHAR_COPY
+                && (current->row >= height || current->column >= width))
+            return true;
+    }
+
+    return false;
+
+}
+
 void guac_terminal_display_resize(guac_terminal_display* display, int width, int height) {
 
     /* Resize display only if dimensions have changed */
     if (width == display->width && height == display->height)
         return;
 
+    guac_terminal_operation* operations;
     guac_terminal_operation* current;
     int x, y;
 
+    /* Pending operations are carried over into the resized display, such that
+     * a burst of resizes is rendered only once, at the next flush. Pending
+     * copies from a region which is about to be cropped must be performed
+     * first, however, as their source would otherwise be lost. */
+    if (display->operations != NULL
+            && guac_terminal_display_copies_outside(display, width, height))
+        guac_terminal_display_flush(display);
+
     /* Fill with background color */
     guac_terminal_char fill = {
         .value = 0,
@@ -484,37 +531,38 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
         .width = 1
     };
 
-    /* Free old operations buffer */
-    if (display->operations != NULL)
-        free(display->operations);
-
     /* Alloc operations */
-    display->operations = malloc(width * height *
-            sizeof(guac_terminal_operation));
+    operations = malloc(width * height * sizeof(guac_terminal_operation));
 
     /* Init each operation buffer row */
-    current = display->operations;
+    current = operations;
     for (y=0; y<height; y++) {
 
-        /* Init entire row to NOP */
-        for (x=0; x<width; x++) {
+        /* Preserve pending operations on old part of screen */
+        int preserved = 0;
+        if (display->operations != NULL && y < display->height) {
 
-            /* If on old part of screen, do not clear */
-            if (x < display->width && y < display->height)
-                current->type = GUAC_CHAR_NOP;
+            preserved = width < display->width ? width : display->width;
+            memcpy(current, &(display->operations[y * display->width]),
+                    preserved * sizeof(guac_terminal_operation));
 
-            /* Otherwise, clear contents first */
-            else {
-                current->type = GUAC_CHAR_SET;
-                current->character  = fill;
-            }
+            current += preserved;
 
-            current++;
+        }
 
+        /* Clear contents of new part of screen */
+        for (x=preserved; x<width; x++) {
+            current->type = GUAC_CHAR_SET;
+            current->character  = fill;
+            current++;
         }
 
     }
 
+    /* Replace old operations buffer */
+    free(display->operations);
+    display->operations = operations;
+
     /* Set width and height */
     display->width = width;
     display->height = height;
@@ -0,0 +1,293 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "terminal/buffer.h"
+#include "terminal/search.h"
+#include "terminal/select.h"
+#include "terminal/terminal.h"
+#include "terminal/terminal-priv.h"
+#include "terminal/types.h"
+
+#include <guacamole/unicode.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int guac_terminal_search_normalize(int codepoint) {
+
+    /* Blank characters are rendered (and copied) as spaces */
+    if (codepoint == 0)
+        return ' ';
+
+    /* Compare ASCII letters case-insensitively */
+    if (codepoint >= 'A' && codepoint <= 'Z')
+        return codepoint - 'A' + 'a';
+
+    return codepoint;
+
+}
+
+uint64_t guac_terminal_search_mask(int codepoint) {
+
+    codepoint = guac_terminal_search_normalize(codepoint);
+
+    /* Whitespace and continuations are never indexed */
+    if (codepoint == ' ' || codepoint == GUAC_CHAR_CONTINUATION)
+        return 0;
+
+    /* Spread codepoints across all 64 bits (Knuth multiplicative hash) */
+    return UINT64_C(1) << (((uint32_t) codepoint * UINT32_C(2654435761)) >> 26);
+
+}
+
+/**
+ * Searches the given buffer row for the given normalized query, returning
+ * the range of columns containing the first match, if any.
+ *
+ * @param buffer_row
+ *     The row to search.
+ *
+ * @param query
+ *     The query to search for, as an array of codepoints which have each
+ *     already been normalized with guac_terminal_search_normalize().
+ *
+ * @param length
+ *     The number of codepoints within the query.
+ *
+ * @param start_column
+ *     A pointer to an int which will receive the first column of the match.
+ *
+ * @param end_column
+ *     A pointer to an int which will receive the column of the first cell of
+ *     the final character of the match.
+ *
+ * @return
+ *     true if the query was found within the given row, false otherwise.
+ */
+static bool guac_terminal_search_row(guac_terminal_buffer_row* buffer_row,
+        const int* query, int length, int* start_column, int* end_column) {
+
+    guac_terminal_char* characters = buffer_row->characters;
+
+    for (int start = 0; start < buffer_row->length; start++) {
+
+        /* Matches may only begin at the start of a character */
+        if (characters[start].value == GUAC_CHAR_CONTINUATION)
+            continue;
+
+        int column = start;
+        int matched = 0;
+        int last = start;
+
+        /* Compare each character of the query, skipping continuations */
+        while (matched < length && column < buffer_row->length) {
+
+            int codepoint = characters[column].value;
+            if (codepoint != GUAC_CHAR_CONTINUATION) {
+
+                if (guac_terminal_search_normalize(codepoint) != query[matched])
+                    break;
+
+                last = column;
+                matched++;
+
+            }
+
+            column++;
+
+        }
+
+        /* Match found only if entire query was consumed */
+        if (matched == length) {
+            *start_column = start;
+            *end_column = last;
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+int guac_terminal_search_decode(const char* query, int* codepoints) {
+
+    int remaining = strlen(query);
+    int length = 0;
+
+    while (remaining > 0) {
+
+        int codepoint;
+        int bytes = guac_utf8_read(query, remaining, &codepoint);
+        if (bytes == 0)
+            break;
+
+        codepoints[length++] = guac_terminal_search_normalize(codepoint);
+
+        query += bytes;
+        remaining -= bytes;
+
+    }
+
+    return length;
+
+}
+
+bool guac_terminal_buffer_search(guac_terminal_buffer* buffer,
+        const int* query, int length, int* row, int first_row,
+        int* start_column, int* end_column) {
+
+    /* Build search mask of query (normalization does not alter masks) */
+    uint64_t mask = 0;
+    for (int i = 0; i < length; i++)
+        mask |= guac_terminal_search_mask(query[i]);
+
+    int current_row = *row;
+
+    /* Search upward through the buffer, fully examining only those rows whose
+     * search mask indicates that a match is possible */
+    while (--current_row >= first_row) {
+
+        guac_terminal_buffer_row* buffer_row =
+            guac_terminal_buffer_get_row(buffer, current_row, 0);
+
+        if ((buffer_row->search_mask & mask) != mask)
+            continue;
+
+        if (guac_terminal_search_row(buffer_row, query, length,
+                    start_column, end_column)) {
+            *row = current_row;
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+bool guac_terminal_search_next(guac_terminal* terminal, const char* query,
+        int* row, int* start_column, int* end_column) {
+
+    int* codepoints = malloc(sizeof(int) * (strlen(query) + 1));
+    int length = guac_terminal_search_decode(query, codepoints);
+
+    /* An empty query matches nothing */
+    if (length == 0) {
+        free(codepoints);
+        return false;
+    }
+
+    /* Repeating the previous query continues upward from the previous match,
+     * while a new query starts from the bottom of the terminal */
+    int current_row = terminal->term_height;
+    if (terminal->search_query != NULL
+            && strcmp(terminal->search_query, query) == 0)
+        current_row = terminal->search_row;
+
+    else {
+        free(terminal->search_query);
+        terminal->search_query = strdup(query);
+    }
+
+    bool found = guac_terminal_buffer_search(terminal->buffer, codepoints,
+            length, &current_row, -guac_terminal_get_available_scroll(terminal),
+            start_column, end_column);
+
+    free(codepoints);
+
+    /* Forget search position if no further matches exist, such that the
+     * next identical query starts again from the bottom */
+    if (!found) {
+        free(terminal->search_query);
+        terminal->search_query = NULL;
+        return false;
+    }
+
+    terminal->search_row = current_row;
+    *row = current_row;
+    return true;
+
+}
+
+void guac_terminal_search_scroll(guac_terminal* terminal, int amount) {
+
+    if (terminal->search_query == NULL)
+        return;
+
+    /* Rows scrolled beyond the top of the scrollback no longer exist, in
+     * which case the search continues from the top-most row that remains
+     * (finding nothing further) */
+    int first_row = -guac_terminal_get_available_scroll(terminal);
+    terminal->search_row -= amount;
+    if (terminal->search_row < first_row)
+        terminal->search_row = first_row;
+
+}
+
+int guac_terminal_search(guac_terminal* terminal, const char* query,
+        int* row) {
+
+    int current_row;
+    int start_column = 0;
+    int end_column = 0;
+
+    guac_terminal_lock(terminal);
+
+    if (!guac_terminal_search_next(terminal, query, &current_row,
+                &start_column, &end_column)) {
+        guac_terminal_unlock(terminal);
+        return 1;
+    }
+
+    /* Scroll only as far as necessary for the match to be visible, redrawing
+     * only the rows newly scrolled into view */
+    int top_row = -terminal->scroll_offset;
+    int bottom_row = top_row + terminal->term_height - 1;
+    if (current_row < top_row)
+        guac_terminal_scroll_display_up(terminal, top_row - current_row);
+    else if (current_row > bottom_row)
+        guac_terminal_scroll_display_down(terminal, current_row - bottom_row);
+
+    /* Highlight match using the text selection, without altering the
+     * clipboard */
+    guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_get_row(terminal->buffer, current_row, 0);
+
+    terminal->selection_start_row =
+    terminal->selection_end_row   = current_row;
+    terminal->selection_start_column = start_column;
+    terminal->selection_start_width  =
+        buffer_row->characters[start_column].width;
+    terminal->selection_end_column = end_column;
+    terminal->selection_end_width  = buffer_row->characters[end_column].width;
+    terminal->text_selected = true;
+    terminal->selection_committed = true;
+
+    guac_terminal_unlock(terminal);
+    guac_terminal_notify(terminal);
+
+    *row = current_row;
+    return 0;
+
+}
+
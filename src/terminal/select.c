@@ -30,6 +30,7 @@
 #include <guacamole/socket.h>
 #include <guacamole/unicode.h>
 
+#include <pthread.h>
 #include <stdbool.h>
 
 /**
@@ -251,16 +252,113 @@ void guac_terminal_select_resume(guac_terminal* terminal, int row, int column) {
 
 }
 
+/**
+ * Buffer of UTF-8 text which has been produced from the terminal buffer but
+ * not yet appended to the clipboard. Selected text is encoded into this
+ * buffer in bulk, with the clipboard being touched (and its lock acquired)
+ * only once per full buffer rather than once per row.
+ */
+typedef struct guac_terminal_select_export {
+
+    /**
+     * The clipboard receiving the exported text.
+     */
+    guac_common_clipboard* clipboard;
+
+    /**
+     * UTF-8 text pending append to the clipboard.
+     */
+    char buffer[GUAC_COMMON_CLIPBOARD_BLOCK_SIZE];
+
+    /**
+     * The number of bytes currently stored within the buffer.
+     */
+    int length;
+
+} guac_terminal_select_export;
+
+/**
+ * Appends all text currently buffered within the given export to its
+ * clipboard, emptying the buffer.
+ *
+ * @param export
+ *     The export whose buffered text should be appended to the clipboard.
+ *
+ * @return
+ *     true if the clipboard has space remaining for further text, false if
+ *     the clipboard is now full and exporting should stop.
+ */
+static bool guac_terminal_select_export_flush(
+        guac_terminal_select_export* export) {
+
+    guac_common_clipboard* clipboard = export->clipboard;
+
+    int truncated = guac_common_clipboard_append(clipboard, export->buffer,
+            export->length);
+    export->length = 0;
+
+    if (truncated)
+        return false;
+
+    /* The clipboard buffer grows on demand, so it is full only once its
+     * maximum length is reached. The clipboard length may be modified by
+     * other threads, and so must only be read while the clipboard is locked */
+    pthread_mutex_lock(&(clipboard->lock));
+    bool space_remaining = clipboard->length < clipboard->max_length;
+    pthread_mutex_unlock(&(clipboard->lock));
+
+    return space_remaining;
+
+}
+
+/**
+ * Appends the UTF-8 representation of the given codepoint to the given
+ * export, first flushing the buffered text to the clipboard if insufficient
+ * space remains.
+ *
+ * @param export
+ *     The export to append the codepoint to.
+ *
+ * @param codepoint
+ *     The Unicode codepoint to append.
+ *
+ * @return
+ *     true if further text may be appended, false if the clipboard is full
+ *     and exporting should stop.
+ */
+static bool guac_terminal_select_export_codepoint(
+        guac_terminal_select_export* export, int codepoint) {
+
+    /* Every codepoint requires at most 4 bytes of UTF-8 */
+    if (export->length > (int) sizeof(export->buffer) - 4
+            && !guac_terminal_select_export_flush(export))
+        return false;
+
+    /* Bypass general UTF-8 encoding for the common case of ASCII */
+    if (codepoint < 0x80)
+        export->buffer[export->length++] = (char) codepoint;
+    else
+        export->length += guac_utf8_write(codepoint,
+                export->buffer + export->length,
+                sizeof(export->buffer) - export->length);
+
+    return true;
+
+}
+
 /**
  * Appends the text within the given subsection of a terminal row to the
- * clipboard. The provided coordinates are considered inclusiveley (the
+ * given export. The provided coordinates are considered inclusiveley (the
  * characters at the start and end column are included in the copied
  * text). Any out-of-bounds coordinates will be automatically clipped within
  * the bounds of the given row.
  *
  * @param terminal
  *     The guac_terminal instance associated with the buffer containing the
- *     text being copied and the clipboard receiving the copied text.
+ *     text being copied.
+ *
+ * @param export
+ *     The export receiving the copied text.
  *
  * @param row
  *     The row number of the text within the terminal to be copied into the
@@ -278,12 +376,13 @@ void guac_terminal_select_resume(guac_terminal* terminal, int row, int column) {
  *     clipboard associated with the given terminal, where 0 is the first
  *     (left-most) column within the row, or a negative value to denote that
  *     the last column in the row should be used.
+ *
+ * @return
+ *     true if further text may be appended, false if the clipboard is full
+ *     and exporting should stop.
  */
-static void guac_terminal_clipboard_append_row(guac_terminal* terminal,
-        int row, int start, int end) {
-
-    char buffer[1024];
-    int i = start;
+static bool guac_terminal_select_export_row(guac_terminal* terminal,
+        guac_terminal_select_export* export, int row, int start, int end) {
 
     guac_terminal_buffer_row* buffer_row =
         guac_terminal_buffer_get_row(terminal->buffer, row, 0);
@@ -291,50 +390,32 @@ static void guac_terminal_clipboard_append_row(guac_terminal* terminal,
     /* If selection is entirely outside the bounds of the row, then there is
      * nothing to append */
     if (start < 0 || start > buffer_row->length - 1)
-        return;
+        return true;
 
     /* Clip given range to actual bounds of row */
     if (end < 0 || end > buffer_row->length - 1)
         end = buffer_row->length - 1;
 
-    /* Repeatedly convert chunks of terminal buffer rows until entire specified
-     * region has been appended to clipboard */
-    while (i <= end) {
-
-        int remaining = sizeof(buffer);
-        char* current = buffer;
+    guac_terminal_char* current = &(buffer_row->characters[start]);
+    for (int i = start; i <= end; i++, current++) {
 
-        /* Convert as many codepoints within the given range as possible */
-        for (i = start; i <= end; i++) {
+        int codepoint = current->value;
 
-            int codepoint = buffer_row->characters[i].value;
+        /* Ignore null (blank) characters */
+        if (codepoint == 0 || codepoint == GUAC_CHAR_CONTINUATION)
+            continue;
 
-            /* Ignore null (blank) characters */
-            if (codepoint == 0 || codepoint == GUAC_CHAR_CONTINUATION)
-                continue;
-
-            /* Encode current codepoint as UTF-8 */
-            int bytes = guac_utf8_write(codepoint, current, remaining);
-            if (bytes == 0)
-                break;
-
-            current += bytes;
-            remaining -= bytes;
-
-        }
-
-        /* Append converted buffer to clipboard */
-        guac_common_clipboard_append(terminal->clipboard, buffer, current - buffer);
+        if (!guac_terminal_select_export_codepoint(export, codepoint))
+            return false;
 
     }
 
+    return true;
+
 }
 
 void guac_terminal_select_end(guac_terminal* terminal) {
 
-    guac_client* client = terminal->client;
-    guac_socket* socket = client->socket;
-
     /* If no text is selected, nothing to do */
     if (!terminal->text_selected)
         return;
@@ -352,33 +433,34 @@ void guac_terminal_select_end(guac_terminal* terminal) {
     guac_terminal_select_normalized_range(terminal,
             &start_row, &start_col, &end_row, &end_col);
 
-    /* If only one row, simply copy */
-    if (end_row == start_row)
-        guac_terminal_clipboard_append_row(terminal, start_row, start_col, end_col);
-
-    /* Otherwise, copy multiple rows */
-    else {
+    guac_terminal_select_export export = {
+        .clipboard = terminal->clipboard,
+        .length = 0
+    };
 
-        /* Store first row */
-        guac_terminal_clipboard_append_row(terminal, start_row, start_col, -1);
+    /* Encode selected rows, stopping as soon as the clipboard is full (rows
+     * beyond that point could never be copied anyway) */
+    for (int row = start_row; row <= end_row; row++) {
 
-        /* Store all middle rows */
-        for (int row = start_row + 1; row < end_row; row++) {
-            guac_common_clipboard_append(terminal->clipboard, "\n", 1);
-            guac_terminal_clipboard_append_row(terminal, row, 0, -1);
-        }
+        /* Rows after the first are separated by newlines */
+        if (row != start_row
+                && !guac_terminal_select_export_codepoint(&export, '\n'))
+            break;
 
-        /* Store last row */
-        guac_common_clipboard_append(terminal->clipboard, "\n", 1);
-        guac_terminal_clipboard_append_row(terminal, end_row, 0, end_col);
+        /* Only the first and last rows may be partially selected */
+        if (!guac_terminal_select_export_row(terminal, &export, row,
+                    row == start_row ? start_col : 0,
+                    row == end_row   ? end_col   : -1))
+            break;
 
     }
 
-    /* Send data */
-    if (!terminal->disable_copy) {
-        guac_common_clipboard_send(terminal->clipboard, client);
-        guac_socket_flush(socket);
-    }
+    /* Append any remaining text */
+    guac_terminal_select_export_flush(&export);
+
+    /* Send data once the terminal is no longer locked */
+    if (!terminal->disable_copy)
+        terminal->clipboard_send_pending = true;
 
     guac_terminal_notify(terminal);
 
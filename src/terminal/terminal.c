@@ -18,6 +18,8 @@
  */
 
 
+#include "config.h"
+
 #include "common/clipboard.h"
 #include "common/cursor.h"
 #include "common/iconv.h"
@@ -26,6 +28,7 @@
 #include "terminal/common.h"
 #include "terminal/display.h"
 #include "terminal/palette.h"
+#include "terminal/search.h"
 #include "terminal/select.h"
 #include "terminal/terminal.h"
 #include "terminal/terminal-handlers.h"
@@ -332,6 +335,7 @@ guac_terminal_options* guac_terminal_options_create(
     options->font_size = GUAC_TERMINAL_DEFAULT_FONT_SIZE;
     options->color_scheme = GUAC_TERMINAL_DEFAULT_COLOR_SCHEME;
     options->backspace = GUAC_TERMINAL_DEFAULT_BACKSPACE;
+    options->frame_policy = GUAC_TERMINAL_DEFAULT_FRAME_POLICY;
 
     return options;
 }
@@ -471,6 +475,15 @@ guac_terminal* guac_terminal_create(guac_client* client,
     pthread_cond_init(&(term->modified_cond), NULL);
     pthread_mutex_init(&(term->modified_lock), NULL);
 
+    /* Init frame scheduling and statistics */
+    term->frame_policy = options->frame_policy;
+    term->frame_duration = GUAC_TERMINAL_ADAPTIVE_MIN_FRAME_DURATION;
+    term->last_frame_end = guac_timestamp_current();
+    term->frame_stats_start = term->last_frame_end;
+    term->frame_stats_count = 0;
+    term->frame_stats_total_latency = 0;
+    term->frame_stats_max_latency = 0;
+
     /* Maximum and requested scrollback are initially the same */
     term->max_scrollback = options->max_scrollback;
     term->requested_scrollback = options->max_scrollback;
@@ -505,7 +518,12 @@ guac_terminal* guac_terminal_create(guac_client* client,
     /* Init terminal state */
     term->current_attributes = default_char.attributes;
     term->default_char = default_char;
-    term->clipboard = guac_common_clipboard_alloc();
+    term->clipboard =
+        guac_common_clipboard_alloc(GUAC_COMMON_CLIPBOARD_MAX_LENGTH);
+    term->clipboard_send_pending = false;
+
+    /* No search in progress */
+    term->search_query = NULL;
     term->disable_copy = options->disable_copy;
 
     /* Calculate available text display area by character size */
@@ -552,6 +570,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
 
     /* Repaint and resize overall display */
     guac_terminal_repaint_default_layer(term, term->client->socket);
+    term->default_layer_resized = false;
     guac_terminal_display_resize(term->display,
             term->term_width, term->term_height);
 
@@ -637,6 +656,9 @@ void guac_terminal_free(guac_terminal* term) {
     free((char*) term->color_scheme);
     free((char*) term->font_name);
 
+    /* Free any in-progress search */
+    free(term->search_query);
+
     /* Free clipboard */
     guac_common_clipboard_free(term->clipboard);
 
@@ -730,31 +752,91 @@ wait_complete:
 
 }
 
+/**
+ * Records the latency of a frame which has just been flushed, logging
+ * accumulated statistics at the debug level once every
+ * GUAC_TERMINAL_FRAME_STATS_INTERVAL milliseconds.
+ *
+ * @param terminal
+ *     The terminal which rendered the frame.
+ *
+ * @param latency
+ *     The time between the terminal first being modified and the frame being
+ *     flushed, in milliseconds.
+ */
+static void guac_terminal_record_frame(guac_terminal* terminal, int latency) {
+
+    terminal->frame_stats_count++;
+    terminal->frame_stats_total_latency += latency;
+    if (latency > terminal->frame_stats_max_latency)
+        terminal->frame_stats_max_latency = latency;
+
+    /* Log statistics only periodically */
+    guac_timestamp now = terminal->last_frame_end;
+    if (now - terminal->frame_stats_start < GUAC_TERMINAL_FRAME_STATS_INTERVAL)
+        return;
+
+    guac_client_log(terminal->client, GUAC_LOG_DEBUG, "Terminal rendered %i "
+            "frames in %i ms (average latency %i ms, maximum latency %i ms, "
+            "current maximum frame duration %i ms).",
+            terminal->frame_stats_count,
+            (int) (now - terminal->frame_stats_start),
+            terminal->frame_stats_total_latency / terminal->frame_stats_count,
+            terminal->frame_stats_max_latency,
+            terminal->frame_policy == GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE
+                ? terminal->frame_duration : GUAC_TERMINAL_FRAME_DURATION);
+
+    terminal->frame_stats_start = now;
+    terminal->frame_stats_count = 0;
+    terminal->frame_stats_total_latency = 0;
+    terminal->frame_stats_max_latency = 0;
+
+}
+
 int guac_terminal_render_frame(guac_terminal* terminal) {
 
     guac_client* client = terminal->client;
 
     int wait_result;
 
+    int adaptive = terminal->frame_policy == GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE;
+    int frame_duration = adaptive ? terminal->frame_duration
+                                  : GUAC_TERMINAL_FRAME_DURATION;
+    int frame_timeout = adaptive ? GUAC_TERMINAL_ADAPTIVE_FRAME_TIMEOUT
+                                 : GUAC_TERMINAL_FRAME_TIMEOUT;
+
     /* Wait for data to be available */
     wait_result = guac_terminal_wait(terminal, 1000);
     if (wait_result || !terminal->started) {
 
         guac_timestamp frame_start = guac_timestamp_current();
 
+        /* Whether the frame was cut short while output was still arriving */
+        int sustained = 0;
+
         do {
 
             /* Calculate time remaining in frame */
             guac_timestamp frame_end = guac_timestamp_current();
-            int frame_remaining = frame_start + GUAC_TERMINAL_FRAME_DURATION
-                                - frame_end;
+            int frame_remaining = frame_start + frame_duration - frame_end;
+
+            /* If connected users have yet to catch up with previous frames,
+             * continue accumulating output until they are expected to have
+             * done so, rather than sending frames they cannot yet handle */
+            int required_wait = 0;
+            if (adaptive)
+                required_wait = guac_client_get_processing_lag(client)
+                              - (frame_end - terminal->last_frame_end);
 
             /* Wait again if frame remaining */
-            if (frame_remaining > 0 || !terminal->started)
-                wait_result = guac_terminal_wait(terminal,
-                        GUAC_TERMINAL_FRAME_TIMEOUT);
-            else
+            if (required_wait > frame_timeout)
+                wait_result = guac_terminal_wait(terminal, required_wait);
+            else if (frame_remaining > 0 || !terminal->started)
+                wait_result = guac_terminal_wait(terminal, frame_timeout);
+            else {
+                sustained = 1;
                 break;
+            }
 
         } while (client->state == GUAC_CLIENT_RUNNING
                 && (wait_result > 0 || !terminal->started));
@@ -764,6 +846,20 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
         guac_terminal_flush(terminal);
         guac_terminal_unlock(terminal);
 
+        /* Grow maximum frame duration while output is sustained, returning
+         * to the minimum as soon as output pauses */
+        if (sustained) {
+            terminal->frame_duration *= 2;
+            if (terminal->frame_duration > GUAC_TERMINAL_ADAPTIVE_MAX_FRAME_DURATION)
+                terminal->frame_duration = GUAC_TERMINAL_ADAPTIVE_MAX_FRAME_DURATION;
+        }
+        else
+            terminal->frame_duration = GUAC_TERMINAL_ADAPTIVE_MIN_FRAME_DURATION;
+
+        terminal->last_frame_end = guac_timestamp_current();
+        guac_terminal_record_frame(terminal,
+                terminal->last_frame_end - frame_start);
+
     }
 
     return 0;
@@ -994,6 +1090,9 @@ int guac_terminal_scroll_up(guac_terminal* term,
             term->selection_end_row -= amount;
         }
 
+        /* Continue any search from the row containing the previous match */
+        guac_terminal_search_scroll(term, amount);
+
     }
 
     /* Otherwise, just copy row data upwards */
@@ -1380,8 +1479,8 @@ static void __guac_terminal_resize(guac_terminal* term, int width, int height) {
 
     }
 
-    /* Resize display */
-    guac_terminal_display_flush(term->display);
+    /* Resize display (pending operations are preserved, thus any number of
+     * resizes between frames are rendered only once) */
     guac_terminal_display_resize(term->display, width, height);
 
     /* Redraw any characters on right if widening */
@@ -1461,9 +1560,6 @@ static void __guac_terminal_resize(guac_terminal* term, int width, int height) {
 
 int guac_terminal_resize(guac_terminal* terminal, int width, int height) {
 
-    guac_terminal_display* display = terminal->display;
-    guac_client* client = display->client;
-
     /* Acquire exclusive access to terminal */
     guac_terminal_lock(terminal);
 
@@ -1485,8 +1581,9 @@ int guac_terminal_resize(guac_terminal* terminal, int width, int height) {
     terminal->height = adjusted_height;
     terminal->width = adjusted_width;
 
-    /* Resize default layer to given pixel dimensions */
-    guac_terminal_repaint_default_layer(terminal, client->socket);
+    /* Resize default layer to given pixel dimensions at next flush, such that
+     * bursts of resize events result in only one repaint */
+    terminal->default_layer_resized = true;
 
     /* Resize terminal if row/column dimensions have changed */
     if (columns != terminal->term_width || rows != terminal->term_height) {
@@ -1522,6 +1619,12 @@ void guac_terminal_flush(guac_terminal* terminal) {
     if (terminal->pipe_stream_flags & GUAC_TERMINAL_PIPE_AUTOFLUSH)
         guac_terminal_pipe_stream_flush(terminal);
 
+    /* Repaint default layer if resized since last flush */
+    if (terminal->default_layer_resized) {
+        guac_terminal_repaint_default_layer(terminal, terminal->client->socket);
+        terminal->default_layer_resized = false;
+    }
+
     /* Flush display state */
     guac_terminal_select_redraw(terminal);
     guac_terminal_commit_cursor(terminal);
@@ -1825,11 +1928,24 @@ int guac_terminal_send_mouse(guac_terminal* term, guac_user* user,
         int x, int y, int mask) {
 
     int result;
+    bool send_clipboard;
 
     guac_terminal_lock(term);
     result = __guac_terminal_send_mouse(term, user, x, y, mask);
+
+    /* Note whether the mouse event completed a selection */
+    send_clipboard = term->clipboard_send_pending;
+    term->clipboard_send_pending = false;
+
     guac_terminal_unlock(term);
 
+    /* Broadcast newly-selected text without holding the terminal lock (the
+     * clipboard is independently guarded by its own lock) */
+    if (send_clipboard) {
+        guac_common_clipboard_send(term->clipboard, term->client);
+        guac_socket_flush(term->client->socket);
+    }
+
     return result;
 
 }
@@ -2018,10 +2134,22 @@ void guac_terminal_pipe_stream_close(guac_terminal* term) {
 }
 
 int guac_terminal_create_typescript(guac_terminal* term, const char* path,
-        const char* name, int create_path) {
+        const char* name, int create_path, int compress) {
+
+#ifndef ENABLE_ZLIB
+    /* Warn if compression cannot be honored */
+    if (compress) {
+        guac_client_log(term->client, GUAC_LOG_WARNING,
+                "Typescript compression was requested, but guacamole-server "
+                "was built without zlib. The typescript will be written "
+                "uncompressed.");
+        compress = 0;
+    }
+#endif
 
     /* Create typescript */
-    term->typescript = guac_terminal_typescript_alloc(path, name, create_path);
+    term->typescript = guac_terminal_typescript_alloc(path, name, create_path,
+            compress);
 
     /* Log failure */
     if (term->typescript == NULL) {
@@ -2032,9 +2160,10 @@ int guac_terminal_create_typescript(guac_terminal* term, const char* path,
 
     /* If typescript was successfully created, log filenames */
     guac_client_log(term->client, GUAC_LOG_INFO,
-            "Typescript of terminal session will be saved to \"%s\". "
+            "Typescript of terminal session will be saved to \"%s\"%s. "
             "Timing file is \"%s\".",
             term->typescript->data_filename,
+            compress ? " (gzip-compressed)" : "",
             term->typescript->timing_filename);
 
     /* Typescript creation succeeded */
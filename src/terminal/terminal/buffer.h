@@ -31,6 +31,8 @@
 
 #include "types.h"
 
+#include <stdint.h>
+
 /**
  * A single variable-length row of terminal data.
  */
@@ -54,6 +56,16 @@ typedef struct guac_terminal_buffer_row {
      */
     int available;
 
+    /**
+     * Bitwise OR of the search mask bits of all characters which may be
+     * present within this row, as returned by guac_terminal_search_mask().
+     * This mask is maintained as rows are written and is allowed to contain
+     * bits for characters which have since been overwritten, but never lacks
+     * the bit of any character actually present. Rows whose mask does not
+     * contain all bits of a search query's mask need not be searched.
+     */
+    uint64_t search_mask;
+
 } guac_terminal_buffer_row;
 
 /**
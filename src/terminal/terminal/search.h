@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef GUAC_TERMINAL_SEARCH_H
+#define GUAC_TERMINAL_SEARCH_H
+
+/**
+ * Function definitions related to searching the text of the terminal buffer,
+ * including the per-row index which allows rows to be quickly excluded from
+ * consideration.
+ *
+ * @file search.h
+ */
+
+#include "buffer.h"
+#include "terminal.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Returns the value that the given codepoint should be compared against when
+ * searching. ASCII letters are compared case-insensitively, and null (blank)
+ * characters are considered equivalent to spaces.
+ *
+ * @param codepoint
+ *     The Unicode codepoint to normalize.
+ *
+ * @return
+ *     The normalized form of the given codepoint.
+ */
+int guac_terminal_search_normalize(int codepoint);
+
+/**
+ * Returns the bit which represents the given codepoint within the search
+ * mask of a buffer row. The search mask of each row is the bitwise OR of the
+ * bits of all characters which may be present in that row, and thus a row
+ * can only contain a search query if its search mask contains every bit of
+ * the query's own mask. Blank characters and continuations are not
+ * represented and produce a value of zero.
+ *
+ * @param codepoint
+ *     The Unicode codepoint whose search mask bit should be returned.
+ *
+ * @return
+ *     The search mask bit corresponding to the given codepoint, or zero if
+ *     the codepoint is not represented within search masks.
+ */
+uint64_t guac_terminal_search_mask(int codepoint);
+
+/**
+ * Decodes the given UTF-8 search query, storing the normalized form of each
+ * of its codepoints within the given array.
+ *
+ * @param query
+ *     The UTF-8 text to decode.
+ *
+ * @param codepoints
+ *     The array which should receive the normalized codepoints of the query.
+ *     This array must have room for at least strlen(query) codepoints.
+ *
+ * @return
+ *     The number of codepoints stored within the given array.
+ */
+int guac_terminal_search_decode(const char* query, int* codepoints);
+
+/**
+ * Searches the given buffer for the given decoded query, starting with the
+ * row immediately above the given row and continuing upward until a match is
+ * found or the given first row has been examined. Only rows whose search
+ * mask indicates that a match is possible are examined in full.
+ *
+ * @param buffer
+ *     The buffer to search.
+ *
+ * @param query
+ *     The query to search for, as produced by guac_terminal_search_decode().
+ *
+ * @param length
+ *     The number of codepoints within the query.
+ *
+ * @param row
+ *     A pointer to the row below the first row to search. If a match is
+ *     found, this will be updated to the row containing the match.
+ *
+ * @param first_row
+ *     The top-most row which may be searched.
+ *
+ * @param start_column
+ *     A pointer to an int which will receive the first column of the match.
+ *
+ * @param end_column
+ *     A pointer to an int which will receive the column of the first cell of
+ *     the final character of the match.
+ *
+ * @return
+ *     true if a match was found, false otherwise.
+ */
+bool guac_terminal_buffer_search(guac_terminal_buffer* buffer,
+        const int* query, int length, int* row, int first_row,
+        int* start_column, int* end_column);
+
+/**
+ * Finds the next match for the given query within the given terminal,
+ * continuing upward from the previous match if the query is the same as the
+ * previous query, or starting from the bottom of the terminal otherwise. Once
+ * no further matches exist, the search position is forgotten, such that the
+ * next search for the same query wraps around to start from the bottom
+ * again. Unlike guac_terminal_search(), the display is not scrolled and the
+ * match is not highlighted. The terminal must already be locked.
+ *
+ * @param terminal
+ *     The terminal to search.
+ *
+ * @param query
+ *     The UTF-8 text to search for.
+ *
+ * @param row
+ *     A pointer to an int which will receive the row containing the match.
+ *
+ * @param start_column
+ *     A pointer to an int which will receive the first column of the match.
+ *
+ * @param end_column
+ *     A pointer to an int which will receive the column of the first cell of
+ *     the final character of the match.
+ *
+ * @return
+ *     true if a match was found, false otherwise.
+ */
+bool guac_terminal_search_next(guac_terminal* terminal, const char* query,
+        int* row, int* start_column, int* end_column);
+
+/**
+ * Updates the search position of the given terminal to account for the
+ * entire terminal having scrolled up by the given number of rows, such that
+ * repeating the previous search continues from the row which contained the
+ * previous match. The terminal must already be locked.
+ *
+ * @param terminal
+ *     The terminal that has scrolled.
+ *
+ * @param amount
+ *     The number of rows that the terminal scrolled up.
+ */
+void guac_terminal_search_scroll(guac_terminal* terminal, int amount);
+
+#endif
+
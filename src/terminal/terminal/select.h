@@ -109,9 +109,11 @@ void guac_terminal_select_resume(guac_terminal* terminal, int row, int column);
  * Ends text selection, removing any highlight and storing the selected
  * character data within the clipboard associated with the given terminal. If
  * more text is selected than can fit within the clipboard, text at the end of
- * the selected area will be dropped as necessary. This function should only be
- * invoked while the guac_terminal is locked through a call to
- * guac_terminal_lock().
+ * the selected area will be dropped as necessary, and the remainder of the
+ * selection will not be read at all. The clipboard is not sent to connected
+ * users by this function; it is instead flagged for sending once the
+ * terminal lock is released. This function should only be invoked while the
+ * guac_terminal is locked through a call to guac_terminal_lock().
  *
  * @param terminal
  *     The guac_terminal instance associated with the text being selected.
@@ -28,6 +28,7 @@
 #include "scrollbar.h"
 #include "terminal.h"
 #include "typescript.h"
+#include <guacamole/timestamp.h>
 
 struct guac_terminal {
 
@@ -89,6 +90,48 @@ struct guac_terminal {
      */
     pthread_cond_t modified_cond;
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     */
+    guac_terminal_frame_policy frame_policy;
+
+    /**
+     * The maximum duration of the next frame, in milliseconds, as determined
+     * by GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE. This value is unused by other
+     * policies.
+     */
+    int frame_duration;
+
+    /**
+     * The time that the most recent frame was flushed.
+     */
+    guac_timestamp last_frame_end;
+
+    /**
+     * The time that frame latency statistics were last logged.
+     */
+    guac_timestamp frame_stats_start;
+
+    /**
+     * The number of frames rendered since frame latency statistics were last
+     * logged.
+     */
+    int frame_stats_count;
+
+    /**
+     * The sum of the latencies of all frames rendered since frame latency
+     * statistics were last logged, in milliseconds. The latency of a frame is
+     * the time between the terminal first being modified and the frame
+     * being flushed.
+     */
+    int frame_stats_total_latency;
+
+    /**
+     * The largest latency of any frame rendered since frame latency
+     * statistics were last logged, in milliseconds.
+     */
+    int frame_stats_max_latency;
+
     /**
      * Pipe which will be the source of user input. When a terminal code
      * generates synthesized user input, that data will be written to
@@ -191,6 +234,12 @@ struct guac_terminal {
      */
     int outer_height;
 
+    /**
+     * Whether the terminal has been resized since the last flush, and the
+     * default layer must thus be resized and repainted during the next flush.
+     */
+    bool default_layer_resized;
+
     /**
      * The width of the terminal, in pixels.
      */
@@ -413,6 +462,27 @@ struct guac_terminal {
      */
     guac_common_clipboard* clipboard;
 
+    /**
+     * Whether the clipboard has been populated with newly-selected text
+     * which has not yet been sent to connected users. The clipboard is sent
+     * only after the terminal lock is released, such that broadcasting a
+     * large selection does not stall the terminal.
+     */
+    bool clipboard_send_pending;
+
+    /**
+     * The most recent query passed to guac_terminal_search(), or NULL if no
+     * search is in progress. Repeating this query continues the search
+     * upward from search_row.
+     */
+    char* search_query;
+
+    /**
+     * The row containing the most recent match for search_query. This value
+     * is only meaningful if search_query is non-NULL.
+     */
+    int search_row;
+
     /**
      * The name of the font to use when rendering glyphs, as requested at
      * creation time or via guac_terminal_apply_font().
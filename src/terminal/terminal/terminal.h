@@ -77,16 +77,46 @@
 #define GUAC_TERMINAL_MAX_COLUMNS 1024
 
 /**
- * The maximum duration of a single frame, in milliseconds.
+ * The maximum duration of a single frame, in milliseconds, when using
+ * GUAC_TERMINAL_FRAME_POLICY_FIXED.
  */
 #define GUAC_TERMINAL_FRAME_DURATION 40
 
 /**
  * The maximum amount of time to wait for more data before declaring a frame
- * complete, in milliseconds.
+ * complete, in milliseconds, when using GUAC_TERMINAL_FRAME_POLICY_FIXED.
  */
 #define GUAC_TERMINAL_FRAME_TIMEOUT 10
 
+/**
+ * The maximum amount of time to wait for more data before declaring a frame
+ * complete, in milliseconds, when using GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE.
+ * This is deliberately short, such that the echo of interactive typing is
+ * rendered almost immediately.
+ */
+#define GUAC_TERMINAL_ADAPTIVE_FRAME_TIMEOUT 2
+
+/**
+ * The smallest maximum frame duration used by
+ * GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE, in milliseconds. This is the maximum
+ * frame duration used whenever output is not sustained.
+ */
+#define GUAC_TERMINAL_ADAPTIVE_MIN_FRAME_DURATION 10
+
+/**
+ * The largest maximum frame duration used by
+ * GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE, in milliseconds. The maximum frame
+ * duration doubles with each frame that is cut short by continuing output,
+ * up to this limit.
+ */
+#define GUAC_TERMINAL_ADAPTIVE_MAX_FRAME_DURATION 160
+
+/**
+ * The interval at which frame latency statistics are logged, in
+ * milliseconds.
+ */
+#define GUAC_TERMINAL_FRAME_STATS_INTERVAL 10000
+
 /**
  * The maximum number of custom tab stops.
  */
@@ -118,6 +148,36 @@
  */
 typedef struct guac_terminal guac_terminal;
 
+/**
+ * The policies which may be used to determine how terminal output is grouped
+ * into frames.
+ */
+typedef enum guac_terminal_frame_policy {
+
+    /**
+     * Frames end once output has stopped for a very short period, such that
+     * interactive output is rendered immediately. While output continues
+     * without pause, the maximum frame duration grows such that bulk output
+     * is rendered in fewer, larger frames. Frames are further extended as
+     * necessary for connected users to catch up with previous frames, as
+     * determined by guac_client_get_processing_lag().
+     */
+    GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE,
+
+    /**
+     * Frames end once output has stopped for GUAC_TERMINAL_FRAME_TIMEOUT
+     * milliseconds, or after GUAC_TERMINAL_FRAME_DURATION milliseconds,
+     * whichever comes first.
+     */
+    GUAC_TERMINAL_FRAME_POLICY_FIXED
+
+} guac_terminal_frame_policy;
+
+/**
+ * The frame policy to use if no policy is specified.
+ */
+#define GUAC_TERMINAL_DEFAULT_FRAME_POLICY GUAC_TERMINAL_FRAME_POLICY_ADAPTIVE
+
 /**
  * All possible mouse cursors used by the terminal emulator.
  */
@@ -223,6 +283,11 @@ typedef struct guac_terminal_options {
      */
     int backspace;
 
+    /**
+     * The policy determining how terminal output is grouped into frames.
+     */
+    guac_terminal_frame_policy frame_policy;
+
 } guac_terminal_options;
 
 /**
@@ -307,7 +372,8 @@ void guac_terminal_set_file_download_handler(guac_terminal* terminal,
 
 /**
  * Renders a single frame of terminal data. If data is not yet available,
- * this function will block until data is written.
+ * this function will block until data is written. The duration of the frame
+ * is determined by the frame policy of the terminal.
  */
 int guac_terminal_render_frame(guac_terminal* terminal);
 
@@ -640,6 +706,35 @@ void guac_terminal_clipboard_append(guac_terminal* terminal,
  */
 void guac_terminal_remove_user(guac_terminal* terminal, guac_user* user);
 
+/**
+ * Searches the terminal buffer, including scrollback, for the given text,
+ * scrolling the terminal display such that the match is visible and
+ * highlighting the match as selected text. The search proceeds upward from
+ * the bottom of the terminal. Repeated searches for the same text continue
+ * upward from the previous match. Once no further matches remain, the next
+ * search for the same text starts from the bottom again. ASCII letters are
+ * compared case-insensitively. Each row maintains a small index of the
+ * characters it may contain, so only rows which could contain a match are
+ * examined in full. This function acquires the terminal lock and must NOT be
+ * invoked while the terminal is already locked.
+ *
+ * @param terminal
+ *     The terminal to search.
+ *
+ * @param query
+ *     The UTF-8 text to search for.
+ *
+ * @param row
+ *     A pointer to an int which will receive the row containing the match,
+ *     if found, where the first (top-most) row of the terminal is row 0 and
+ *     rows within the scrollback buffer are negative.
+ *
+ * @return
+ *     Zero if a match was found, non-zero otherwise.
+ */
+int guac_terminal_search(guac_terminal* terminal, const char* query,
+        int* row);
+
 /**
  * Requests that the terminal write all output to a new pair of typescript
  * files within the given path and using the given base name. Terminal output
@@ -665,12 +760,18 @@ void guac_terminal_remove_user(guac_terminal* terminal, guac_user* user);
  *     written, or non-zero if the path should be created if it does not yet
  *     exist.
  *
+ * @param compress
+ *     Non-zero if the typescript data file should be written as a gzip
+ *     stream (decompressible with "zcat" prior to replay), zero otherwise. If
+ *     guacamole-server was built without zlib, a warning is logged and the
+ *     data file is written uncompressed.
+ *
  * @return
  *     Zero if the typescript files have been successfully created and a
  *     typescript will be written, non-zero otherwise.
  */
 int guac_terminal_create_typescript(guac_terminal* term, const char* path,
-        const char* name, int create_path);
+        const char* name, int create_path, int compress);
 
 /**
  * Immediately applies the given color scheme to the given terminal, overriding
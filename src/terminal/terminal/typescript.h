@@ -31,6 +31,8 @@
 
 #include <guacamole/timestamp.h>
 
+#include <pthread.h>
+
 /**
  * A NULL-terminated string of raw bytes which should be written at the
  * beginning of any typescript.
@@ -76,22 +78,117 @@
  */
 #define GUAC_TERMINAL_TYPESCRIPT_TIMING_SUFFIX "timing"
 
+/**
+ * The maximum number of bytes of raw terminal output which may be stored
+ * within a single block of a typescript's write queue.
+ */
+#define GUAC_TERMINAL_TYPESCRIPT_BLOCK_SIZE 4096
+
+/**
+ * The number of blocks within the write queue of each typescript. If the
+ * background writer falls this many blocks behind the terminal (the
+ * typescript path resides on a slow or stalled filesystem, for example),
+ * further flushes will block until space is available.
+ */
+#define GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE 64
+
+/**
+ * A single block of raw terminal output within the write queue of a
+ * typescript, along with the timing information that should be written for
+ * that output.
+ */
+typedef struct guac_terminal_typescript_block {
+
+    /**
+     * The number of milliseconds elapsed between the previous flush of the
+     * typescript and the flush which produced this block.
+     */
+    int elapsed_time;
+
+    /**
+     * The number of bytes currently stored in this block.
+     */
+    int length;
+
+    /**
+     * Raw terminal output which has not yet been written to the data file.
+     */
+    char buffer[GUAC_TERMINAL_TYPESCRIPT_BLOCK_SIZE];
+
+} guac_terminal_typescript_block;
+
 /**
  * An active typescript, consisting of a data file (raw terminal output) and
- * timing file (related timestamps and byte counts).
+ * timing file (related timestamps and byte counts). Output is written to
+ * both files by a dedicated background thread, such that slow storage does
+ * not stall the terminal unless the bounded write queue fills.
+ *
+ * If compression was requested (and guacamole-server was built with zlib),
+ * the data file is written as a single standard gzip stream, with a sync
+ * flush performed each time the write queue is drained. The data file can
+ * thus be decompressed at any point, even while the session is still active,
+ * using "gzip -dc" or "zcat". The timing file is never compressed. The
+ * decompressed data file is identical to the data file which would have been
+ * written without compression, and can be replayed as usual with
+ * "scriptreplay NAME.timing NAME".
  */
 typedef struct guac_terminal_typescript {
 
     /**
-     * Buffer of raw terminal output which has not yet been written to the
-     * data file.
+     * Queue of blocks of raw terminal output awaiting the background writer.
+     * The block at index "tail" is the block currently receiving terminal
+     * output and is never visible to the writer until flushed.
      */
-    char buffer[4096];
+    guac_terminal_typescript_block queue[GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE];
 
     /**
-     * The number of bytes currently stored in the buffer.
+     * The index of the oldest flushed block which has not yet been written
+     * by the background writer.
      */
-    int length;
+    int head;
+
+    /**
+     * The index of the block currently receiving terminal output.
+     */
+    int tail;
+
+    /**
+     * The number of flushed blocks which have not yet been written by the
+     * background writer.
+     */
+    int pending;
+
+    /**
+     * Whether the background writer should stop once all pending blocks
+     * have been written.
+     */
+    int stopping;
+
+    /**
+     * Lock which guards access to the head, tail, pending, and stopping
+     * members of this typescript.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever blocks are added to or removed
+     * from the write queue, or when the writer is requested to stop.
+     */
+    pthread_cond_t modified;
+
+    /**
+     * The background thread responsible for writing flushed blocks to the
+     * data and timing files.
+     */
+    pthread_t writer_thread;
+
+    /**
+     * The zlib gzFile handle wrapping data_fd if the data file is being
+     * compressed, or NULL if raw terminal output is written to data_fd
+     * directly. This is declared as void* such that users of this header
+     * need not include zlib.h.
+     */
+    void* data_gz;
 
     /**
      * The full path to the file which will contain the raw terminal output for
@@ -146,16 +243,22 @@ typedef struct guac_terminal_typescript {
  *     written, or non-zero if the path should be created if it does not yet
  *     exist.
  *
+ * @param compress
+ *     Non-zero if the data file should be written as a gzip stream, zero
+ *     otherwise. If guacamole-server was built without zlib, this flag is
+ *     ignored and the data file is never compressed.
+ *
  * @return
  *     A new guac_terminal_typescript representing the typescript files
  *     requested, or NULL if creation of the typescript files failed.
  */
 guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
-        const char* name, int create_path);
+        const char* name, int create_path, int compress);
 
 /**
  * Writes a single byte of terminal data to the typescript, flushing and
- * writing a new timestamp if necessary.
+ * writing a new timestamp if necessary. Data is only buffered by this
+ * function; the actual write to disk occurs within the background writer.
  *
  * @param typescript
  *     The typescript that the given byte of raw terminal data should be
@@ -169,7 +272,9 @@ void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
 
 /**
  * Flushes any pending data to the typescript, writing a new timestamp to the
- * timing file if any data was flushed.
+ * timing file if any data was flushed. The flushed data is handed off to the
+ * background writer, and this function will only block if the background
+ * writer has fallen GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE blocks behind.
  *
  * @param typescript
  *     The typescript which should be flushed.
@@ -178,8 +283,9 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript);
 
 /**
  * Frees all resources associated with the given typescript, flushing and
- * closing the data and timing files and freeing all related memory. If the
- * provided typescript is NULL, this function has no effect.
+ * closing the data and timing files and freeing all related memory. This
+ * function blocks until the background writer has written all pending data.
+ * If the provided typescript is NULL, this function has no effect.
  *
  * @param typescript
  *     The typescript to free.
@@ -0,0 +1,135 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/search.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+
+/**
+ * Writes the given ASCII text to the given row of the given buffer, starting
+ * at the first column.
+ *
+ * @param buffer
+ *     The buffer to write to.
+ *
+ * @param row
+ *     The row to write the text to.
+ *
+ * @param text
+ *     The text to write.
+ */
+static void write_row(guac_terminal_buffer* buffer, int row,
+        const char* text) {
+
+    for (int column = 0; text[column] != '\0'; column++) {
+        guac_terminal_char character = {
+            .value = text[column],
+            .width = 1
+        };
+        guac_terminal_buffer_set_columns(buffer, row, column, column,
+                &character);
+    }
+
+}
+
+/**
+ * Test which verifies that queries are decoded from UTF-8 and normalized.
+ */
+void test_search__decode() {
+
+    int codepoints[16];
+
+    CU_ASSERT_EQUAL(3, guac_terminal_search_decode("AbC", codepoints));
+    CU_ASSERT_EQUAL('a', codepoints[0]);
+    CU_ASSERT_EQUAL('b', codepoints[1]);
+    CU_ASSERT_EQUAL('c', codepoints[2]);
+
+    CU_ASSERT_EQUAL(2, guac_terminal_search_decode("\xC3\xA9!", codepoints));
+    CU_ASSERT_EQUAL(0xE9, codepoints[0]);
+    CU_ASSERT_EQUAL('!', codepoints[1]);
+
+    CU_ASSERT_EQUAL(0, guac_terminal_search_decode("", codepoints));
+
+}
+
+/**
+ * Test which verifies that guac_terminal_buffer_search() finds each match,
+ * searching upward from the given row and comparing case-insensitively.
+ */
+void test_search__match() {
+
+    guac_terminal_char default_char = { .value = 0, .width = 1 };
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(64, &default_char);
+
+    write_row(buffer, 2, "goodbye");
+    write_row(buffer, 0, "hello world");
+    write_row(buffer, -3, "well, HELLO there");
+
+    int codepoints[16];
+    int length = guac_terminal_search_decode("hello", codepoints);
+    int start_column, end_column;
+
+    /* First match is the bottom-most */
+    int row = 5;
+    CU_ASSERT_TRUE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+    CU_ASSERT_EQUAL(0, row);
+    CU_ASSERT_EQUAL(0, start_column);
+    CU_ASSERT_EQUAL(4, end_column);
+
+    /* Continuing from that row finds the next match, regardless of case */
+    CU_ASSERT_TRUE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+    CU_ASSERT_EQUAL(-3, row);
+    CU_ASSERT_EQUAL(6, start_column);
+    CU_ASSERT_EQUAL(10, end_column);
+
+    /* No further matches */
+    CU_ASSERT_FALSE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+    CU_ASSERT_EQUAL(-3, row);
+
+    /* Rows above the first row are never searched */
+    row = 5;
+    CU_ASSERT_TRUE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+    CU_ASSERT_FALSE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -2, &start_column, &end_column));
+
+    /* Queries spanning whitespace match across it */
+    length = guac_terminal_search_decode("o w", codepoints);
+    row = 5;
+    CU_ASSERT_TRUE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+    CU_ASSERT_EQUAL(0, row);
+    CU_ASSERT_EQUAL(4, start_column);
+    CU_ASSERT_EQUAL(6, end_column);
+
+    /* Text not present anywhere is not found */
+    length = guac_terminal_search_decode("xyz", codepoints);
+    row = 5;
+    CU_ASSERT_FALSE(guac_terminal_buffer_search(buffer, codepoints, length,
+                &row, -10, &start_column, &end_column));
+
+    guac_terminal_buffer_free(buffer);
+
+}
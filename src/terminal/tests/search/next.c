@@ -0,0 +1,204 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/search.h"
+#include "terminal/terminal-priv.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+
+/**
+ * The number of rows in the display of each test terminal.
+ */
+#define TEST_TERMINAL_HEIGHT 5
+
+/**
+ * The number of rows of scrollback of each test terminal.
+ */
+#define TEST_TERMINAL_SCROLLBACK 20
+
+/**
+ * Allocates a terminal containing only the state used by searches, with a
+ * full scrollback buffer.
+ *
+ * @return
+ *     A newly-allocated terminal which must be freed with free_terminal().
+ */
+static guac_terminal* alloc_terminal() {
+
+    guac_terminal_char default_char = { .value = 0, .width = 1 };
+
+    guac_terminal* terminal = calloc(1, sizeof(guac_terminal));
+    terminal->term_height = TEST_TERMINAL_HEIGHT;
+    terminal->max_scrollback = TEST_TERMINAL_SCROLLBACK;
+    terminal->requested_scrollback = TEST_TERMINAL_SCROLLBACK;
+    terminal->buffer = guac_terminal_buffer_alloc(TEST_TERMINAL_SCROLLBACK,
+            &default_char);
+    terminal->buffer->length = TEST_TERMINAL_SCROLLBACK;
+
+    return terminal;
+
+}
+
+/**
+ * Frees a terminal allocated with alloc_terminal().
+ *
+ * @param terminal
+ *     The terminal to free.
+ */
+static void free_terminal(guac_terminal* terminal) {
+    guac_terminal_buffer_free(terminal->buffer);
+    free(terminal->search_query);
+    free(terminal);
+}
+
+/**
+ * Writes the given ASCII text to the given row of the given terminal,
+ * replacing the previous contents of that row.
+ *
+ * @param terminal
+ *     The terminal to write to.
+ *
+ * @param row
+ *     The row to write the text to.
+ *
+ * @param text
+ *     The text to write.
+ */
+static void write_row(guac_terminal* terminal, int row, const char* text) {
+
+    guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_get_row(terminal->buffer, row, 0);
+    buffer_row->length = 0;
+    buffer_row->search_mask = 0;
+
+    for (int column = 0; text[column] != '\0'; column++) {
+        guac_terminal_char character = {
+            .value = text[column],
+            .width = 1
+        };
+        guac_terminal_buffer_set_columns(terminal->buffer, row, column,
+                column, &character);
+    }
+
+}
+
+/**
+ * Scrolls the entire given terminal up by the given number of rows, as
+ * guac_terminal_scroll_up() does when output reaches the bottom of the
+ * terminal, leaving the new rows blank.
+ *
+ * @param terminal
+ *     The terminal to scroll.
+ *
+ * @param amount
+ *     The number of rows to scroll.
+ */
+static void scroll_terminal(guac_terminal* terminal, int amount) {
+
+    guac_terminal_buffer* buffer = terminal->buffer;
+
+    buffer->top = (buffer->top + amount) % buffer->available;
+    for (int row = TEST_TERMINAL_HEIGHT - amount; row < TEST_TERMINAL_HEIGHT;
+            row++)
+        write_row(terminal, row, "");
+
+    guac_terminal_search_scroll(terminal, amount);
+
+}
+
+/**
+ * Test which verifies that repeating a search finds each match in turn,
+ * moving upward, and then wraps around to the bottom-most match after
+ * reporting that no further matches exist.
+ */
+void test_search__wrap() {
+
+    guac_terminal* terminal = alloc_terminal();
+    write_row(terminal, 3, "needle one");
+    write_row(terminal, -4, "a needle two");
+    write_row(terminal, -9, "haystack");
+
+    int row, start_column, end_column;
+
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(3, row);
+    CU_ASSERT_EQUAL(0, start_column);
+
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(-4, row);
+    CU_ASSERT_EQUAL(2, start_column);
+
+    /* End of matches is reported once ... */
+    CU_ASSERT_FALSE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+
+    /* ... after which the search wraps around */
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(3, row);
+
+    /* A different query always starts from the bottom */
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "hay", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(-9, row);
+
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(3, row);
+
+    free_terminal(terminal);
+
+}
+
+/**
+ * Test which verifies that a repeated search continues from the previous
+ * match even if output has scrolled the terminal since that match was found.
+ */
+void test_search__scroll() {
+
+    guac_terminal* terminal = alloc_terminal();
+    write_row(terminal, 0, "needle one");
+    write_row(terminal, -2, "needle two");
+
+    int row, start_column, end_column;
+
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(0, row);
+
+    /* Matches move up along with the text that scrolls */
+    scroll_terminal(terminal, 3);
+    CU_ASSERT_TRUE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+    CU_ASSERT_EQUAL(-5, row);
+
+    /* Once the previous match has scrolled out of the buffer entirely, no
+     * further matches remain */
+    scroll_terminal(terminal, TEST_TERMINAL_SCROLLBACK);
+    CU_ASSERT_FALSE(guac_terminal_search_next(terminal, "needle", &row,
+                &start_column, &end_column));
+
+    free_terminal(terminal);
+
+}
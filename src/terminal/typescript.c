@@ -17,12 +17,15 @@
  * under the License.
  */
 
+#include "config.h"
+
 #include "common/io.h"
 #include "terminal/typescript.h"
 
 #include <guacamole/timestamp.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -31,6 +34,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
 /**
  * Attempts to open a new typescript data file within the given path and having
  * the given name. If such a file already exists, sequential numeric suffixes
@@ -107,8 +114,151 @@ static int guac_terminal_typescript_open_data_file(const char* path,
 
 }
 
+/**
+ * Writes the given raw terminal output to the data file of the given
+ * typescript, compressing that output if the typescript was created with
+ * compression enabled.
+ *
+ * @param typescript
+ *     The typescript whose data file should receive the given output.
+ *
+ * @param buffer
+ *     The raw terminal output to write.
+ *
+ * @param length
+ *     The number of bytes of raw terminal output to write.
+ */
+static void guac_terminal_typescript_write_data(
+        guac_terminal_typescript* typescript, void* buffer, int length) {
+
+#ifdef ENABLE_ZLIB
+    if (typescript->data_gz != NULL) {
+        gzwrite((gzFile) typescript->data_gz, buffer, length);
+        return;
+    }
+#endif
+
+    guac_common_write(typescript->data_fd, buffer, length);
+
+}
+
+/**
+ * Closes the data file of the given typescript, finishing the gzip stream
+ * first if the typescript was created with compression enabled.
+ *
+ * @param typescript
+ *     The typescript whose data file should be closed.
+ */
+static void guac_terminal_typescript_close_data(
+        guac_terminal_typescript* typescript) {
+
+#ifdef ENABLE_ZLIB
+    /* Closing the gzip stream also closes the underlying file descriptor */
+    if (typescript->data_gz != NULL) {
+        gzclose((gzFile) typescript->data_gz);
+        return;
+    }
+#endif
+
+    close(typescript->data_fd);
+
+}
+
+/**
+ * Writes the contents of the given block to the data file of the given
+ * typescript, along with a corresponding line of timing information within
+ * the timing file.
+ *
+ * @param typescript
+ *     The typescript that the block should be written to.
+ *
+ * @param block
+ *     The flushed block of raw terminal output to write.
+ */
+static void guac_terminal_typescript_write_block(
+        guac_terminal_typescript* typescript,
+        guac_terminal_typescript_block* block) {
+
+    /* Produce single line of timestamp output */
+    char timestamp_buffer[32];
+    int timestamp_length = snprintf(timestamp_buffer, sizeof(timestamp_buffer),
+            "%0.6f %i\n", block->elapsed_time / 1000.0, block->length);
+
+    /* Calculate actual length of timestamp line */
+    if (timestamp_length > sizeof(timestamp_buffer))
+        timestamp_length = sizeof(timestamp_buffer);
+
+    /* Write timestamp to timing file */
+    guac_common_write(typescript->timing_fd,
+            timestamp_buffer, timestamp_length);
+
+    /* Empty block into data file */
+    guac_terminal_typescript_write_data(typescript,
+            block->buffer, block->length);
+
+}
+
+/**
+ * Background writer thread which writes each flushed block within the write
+ * queue of the given typescript to disk, in order, until the typescript is
+ * freed. The typescript lock is NOT held while blocks are being written, such
+ * that the terminal may continue flushing new output during slow writes.
+ *
+ * @param data
+ *     The guac_terminal_typescript whose write queue should be processed.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_terminal_typescript_writer_thread(void* data) {
+
+    guac_terminal_typescript* typescript = (guac_terminal_typescript*) data;
+
+    pthread_mutex_lock(&(typescript->lock));
+
+    for (;;) {
+
+        /* Wait for flushed blocks (or a request to stop) */
+        while (typescript->pending == 0 && !typescript->stopping)
+            pthread_cond_wait(&(typescript->modified), &(typescript->lock));
+
+        /* Stop only once all pending data has been written */
+        if (typescript->pending == 0)
+            break;
+
+        /* The head block cannot be modified by the terminal while pending */
+        guac_terminal_typescript_block* block =
+            &(typescript->queue[typescript->head]);
+
+        pthread_mutex_unlock(&(typescript->lock));
+        guac_terminal_typescript_write_block(typescript, block);
+        pthread_mutex_lock(&(typescript->lock));
+
+        /* Release block for reuse by the terminal */
+        typescript->head = (typescript->head + 1)
+            % GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE;
+        typescript->pending--;
+        pthread_cond_broadcast(&(typescript->modified));
+
+#ifdef ENABLE_ZLIB
+        /* Ensure compressed output written thus far can be decompressed
+         * once the queue has been drained */
+        if (typescript->pending == 0 && typescript->data_gz != NULL) {
+            pthread_mutex_unlock(&(typescript->lock));
+            gzflush((gzFile) typescript->data_gz, Z_SYNC_FLUSH);
+            pthread_mutex_lock(&(typescript->lock));
+        }
+#endif
+
+    }
+
+    pthread_mutex_unlock(&(typescript->lock));
+    return NULL;
+
+}
+
 guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
-        const char* name, int create_path) {
+        const char* name, int create_path, int compress) {
 
     /* Create path if it does not exist, fail if impossible */
     if (create_path && mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP)
@@ -148,14 +298,47 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
         return NULL;
     }
 
-    /* Typescript starts out flushed */
-    typescript->length = 0;
+    /* Wrap data file in gzip stream if compression is requested */
+    typescript->data_gz = NULL;
+#ifdef ENABLE_ZLIB
+    if (compress) {
+        typescript->data_gz = gzdopen(typescript->data_fd, "wb");
+        if (typescript->data_gz == NULL) {
+            close(typescript->data_fd);
+            close(typescript->timing_fd);
+            free(typescript);
+            return NULL;
+        }
+    }
+#endif
+
+    /* Typescript starts out flushed, with an empty write queue */
+    typescript->head = 0;
+    typescript->tail = 0;
+    typescript->pending = 0;
+    typescript->stopping = 0;
+    typescript->queue[0].length = 0;
     typescript->last_flush = guac_timestamp_current();
 
     /* Write header */
-    guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_HEADER,
+    guac_terminal_typescript_write_data(typescript,
+            GUAC_TERMINAL_TYPESCRIPT_HEADER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_HEADER) - 1);
 
+    pthread_mutex_init(&(typescript->lock), NULL);
+    pthread_cond_init(&(typescript->modified), NULL);
+
+    /* Start background writer */
+    if (pthread_create(&(typescript->writer_thread), NULL,
+                guac_terminal_typescript_writer_thread, typescript)) {
+        pthread_cond_destroy(&(typescript->modified));
+        pthread_mutex_destroy(&(typescript->lock));
+        guac_terminal_typescript_close_data(typescript);
+        close(typescript->timing_fd);
+        free(typescript);
+        return NULL;
+    }
+
     return typescript;
 
 }
@@ -163,19 +346,27 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
 void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
         char c) {
 
+    guac_terminal_typescript_block* block =
+        &(typescript->queue[typescript->tail]);
+
     /* Flush buffer if no space is available */
-    if (typescript->length == sizeof(typescript->buffer))
+    if (block->length == sizeof(block->buffer)) {
         guac_terminal_typescript_flush(typescript);
+        block = &(typescript->queue[typescript->tail]);
+    }
 
     /* Append single byte to buffer */
-    typescript->buffer[typescript->length++] = c;
+    block->buffer[block->length++] = c;
 
 }
 
 void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
 
+    guac_terminal_typescript_block* block =
+        &(typescript->queue[typescript->tail]);
+
     /* Do nothing if nothing to flush */
-    if (typescript->length == 0)
+    if (block->length == 0)
         return;
 
     /* Get timestamps of previous and current flush */
@@ -187,25 +378,24 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
     if (elapsed_time > GUAC_TERMINAL_TYPESCRIPT_MAX_DELAY)
         elapsed_time = GUAC_TERMINAL_TYPESCRIPT_MAX_DELAY;
 
-    /* Produce single line of timestamp output */
-    char timestamp_buffer[32];
-    int timestamp_length = snprintf(timestamp_buffer, sizeof(timestamp_buffer),
-            "%0.6f %i\n", elapsed_time / 1000.0, typescript->length);
+    block->elapsed_time = elapsed_time;
 
-    /* Calculate actual length of timestamp line */
-    if (timestamp_length > sizeof(timestamp_buffer))
-        timestamp_length = sizeof(timestamp_buffer);
+    pthread_mutex_lock(&(typescript->lock));
 
-    /* Write timestamp to timing file */
-    guac_common_write(typescript->timing_fd,
-            timestamp_buffer, timestamp_length);
+    /* Hand block off to background writer */
+    typescript->pending++;
+    typescript->tail = (typescript->tail + 1)
+        % GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE;
+    pthread_cond_broadcast(&(typescript->modified));
 
-    /* Empty buffer into data file */
-    guac_common_write(typescript->data_fd,
-            typescript->buffer, typescript->length);
+    /* Wait for writer to catch up if the next block is still pending */
+    while (typescript->pending == GUAC_TERMINAL_TYPESCRIPT_QUEUE_SIZE)
+        pthread_cond_wait(&(typescript->modified), &(typescript->lock));
+
+    pthread_mutex_unlock(&(typescript->lock));
 
     /* Buffer is now flushed */
-    typescript->length = 0;
+    typescript->queue[typescript->tail].length = 0;
     typescript->last_flush = this_flush;
 
 }
@@ -219,16 +409,26 @@ void guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
     /* Flush any pending data */
     guac_terminal_typescript_flush(typescript);
 
+    /* Wait for background writer to write all pending data */
+    pthread_mutex_lock(&(typescript->lock));
+    typescript->stopping = 1;
+    pthread_cond_broadcast(&(typescript->modified));
+    pthread_mutex_unlock(&(typescript->lock));
+    pthread_join(typescript->writer_thread, NULL);
+
+    pthread_cond_destroy(&(typescript->modified));
+    pthread_mutex_destroy(&(typescript->lock));
+
     /* Write footer */
-    guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_FOOTER,
+    guac_terminal_typescript_write_data(typescript,
+            GUAC_TERMINAL_TYPESCRIPT_FOOTER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_FOOTER) - 1);
 
     /* Close file descriptors */
-    close(typescript->data_fd);
+    guac_terminal_typescript_close_data(typescript);
     close(typescript->timing_fd);
 
     /* Free allocated typescript data */
     free(typescript);
 
 }
-